@@ -0,0 +1,125 @@
+// Automatic gain control
+// State is written only by the I2S RX callbacks; readers copy it with interrupts disabled.
+
+#include "agc.h"
+#include "pipeline_config.h"
+#include "main.h"
+#include "deferred_log.h"
+#include <cmath>
+
+// GAIN TABLE (Q12, one entry per quarter octave of envelope)
+static int32_t gainTable[AGC_LEVELS];
+
+// STATE (written by the RX callbacks only)
+static int32_t dcOffset = 0;
+static uint32_t envelope = 0;
+static int32_t gain = AGC_UNITY_GAIN;
+static AgcStats stats = {};
+
+// One block, Count is uint32_t or BlockCount (constant bounds, see pipeline_config.h)
+template <typename Count>
+static void process(const int32_t* in, int32_t* out, Count n, const BlockStats* block) {
+    // DC and peak come from the block statistics (one pass in the RX callback, block_stats.h).
+    // The first block seeds the DC estimate, the microphone offset would otherwise look like signal
+    if (stats.blocks == 0) dcOffset = block->dc;
+    // The block is corrected with the estimate as it stood before the block
+    int32_t offset = dcOffset;
+    dcOffset += (block->dc - dcOffset) >> AGC_DC_SHIFT;
+    uint32_t peak = block->peak;
+
+    // Envelope with fast attack and slow release, this block already counts (no onset overshoot)
+    if (peak > envelope) {
+        envelope += (uint32_t)(((uint64_t)(peak - envelope) * AGC_ATTACK) >> 15);
+    } else {
+        envelope -= ((envelope - peak) * AGC_RELEASE) >> 15;
+    }
+    uint32_t level = Agc_Level(envelope);
+
+    int32_t target = gain;
+#if AGC_ENABLED
+    if (envelope >= AGC_NOISE_FLOOR) target = gainTable[level];
+#else
+    target = AGC_UNITY_GAIN;
+#endif
+
+    // One pass: DC removal, SMULL + SSAT per sample. Increases ramp across the block, reductions
+    // apply at once so a loud onset does not clip
+    if (target < gain) gain = target;
+    int32_t step = (target - gain) / (int32_t)n;
+    int32_t g = gain;
+    uint32_t clipped = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        g += step;
+        int32_t y = (int32_t)(((int64_t)(in[i] - offset) * g) >> AGC_GAIN_SHIFT);
+        int32_t saturated = __SSAT(y, 18);
+        clipped += (saturated != y);
+        out[i] = saturated;
+    }
+    gain = target;
+
+    stats.blocks++;
+    stats.clipped += clipped;
+    stats.gain = gain;
+    if (gain < stats.minGain) stats.minGain = gain;
+    if (gain > stats.maxGain) stats.maxGain = gain;
+    stats.envelope = envelope;
+    stats.dcOffset = dcOffset;
+}
+
+extern "C" {
+
+uint32_t Agc_Level(uint32_t value) {
+    if (value == 0) return 0;
+    uint32_t octave = 31 - __CLZ(value);
+    // Two bits below the leading one select the quarter
+    uint32_t level = 4 * octave + (((value << 2) >> octave) & 3);
+    return level < AGC_LEVELS ? level : AGC_LEVELS - 1;
+}
+
+void Agc_Init(void) {
+    for (int level = 0; level < AGC_LEVELS; level++) {
+        // Gain that brings the middle of the quarter octave to the target peak
+        float center = powf(2.0f, (level + 0.5f) / 4.0f);
+        float g = (float)AGC_TARGET_PEAK / center * AGC_UNITY_GAIN;
+        if (g > AGC_MAX_GAIN) g = AGC_MAX_GAIN;
+        if (g < AGC_MIN_GAIN) g = AGC_MIN_GAIN;
+        gainTable[level] = (int32_t)g;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    dcOffset = 0;
+    envelope = 0;
+    gain = AGC_UNITY_GAIN;
+    stats = AgcStats();
+    stats.gain = gain;
+    stats.minGain = gain;
+    stats.maxGain = gain;
+    __set_PRIMASK(primask);
+}
+
+void Agc_Process(const int32_t* in, int32_t* out, uint32_t n, const BlockStats* block) {
+    if (n == 0) return;
+    if (n == PIPELINE.blockSamples) {
+        process(in, out, BlockCount(), block);
+    } else {
+        process(in, out, n, block);
+    }
+}
+
+void Agc_GetStats(AgcStats* out) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    *out = stats;
+    __set_PRIMASK(primask);
+}
+
+void Agc_PrintStats(void) {
+    AgcStats s;
+    Agc_GetStats(&s);
+    DLOG("[AGC] gain: %ld/4096 (min %ld, max %ld), envelope: %lu, DC: %ld, clipped samples: %lu, blocks: %lu",
+         (long)s.gain, (long)s.minGain, (long)s.maxGain, (unsigned long)s.envelope,
+         (long)s.dcOffset, (unsigned long)s.clipped, (unsigned long)s.blocks);
+}
+
+} // extern "C"
@@ -0,0 +1,96 @@
+/**
+ * @file    agc.h
+ * @brief   Fixed-point automatic gain control for the microphone blocks
+ *
+ * Runs in the I2S RX callbacks on every DMA block, between the 18-bit sample merge and storage,
+ * so recordings, features and the audio stream see a consistent level for near and far talkers.
+ *
+ * Per block: the DC offset of the microphone is removed, the block peak drives an envelope with
+ * fast attack and slow release, and a gain table indexed by the envelope level (quarter octaves)
+ * gives the target gain. Gain increases ramp linearly across the block, reductions take effect at
+ * once (no clipped onsets); the gain is held while the envelope is below the noise floor, so pauses
+ * do not pump it up. Samples are scaled with a 32x32->64 multiply and saturated back to 18 bit.
+ * Block mean and peak come from BlockStats (block_stats.h), computed once per block by the RX
+ * callback; the peak is taken against the previous block's mean, which tracks the DC offset.
+ */
+
+#ifndef AGC_H
+#define AGC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "block_stats.h"
+
+/* 0 = samples pass through with the DC offset removed, gain fixed at 1 */
+#ifndef AGC_ENABLED
+#define AGC_ENABLED        1
+#endif
+
+#define AGC_GAIN_SHIFT     12                     /* Gains are Q12 */
+#define AGC_UNITY_GAIN     (1 << AGC_GAIN_SHIFT)
+
+/* Block peak the gain aims for (18-bit scale, about -12 dBFS) */
+#define AGC_TARGET_PEAK    32768
+#define AGC_MAX_GAIN       (16 * AGC_UNITY_GAIN)  /* +24 dB */
+#define AGC_MIN_GAIN       (AGC_UNITY_GAIN / 2)   /* -6 dB */
+/* Envelope below this is background, the gain is held */
+#define AGC_NOISE_FLOOR    768
+
+/* Envelope smoothing per block, Q15 (block = 250 samples = 15.6 ms) */
+#define AGC_ATTACK         16384                  /* ~ 20 ms */
+#define AGC_RELEASE        655                    /* ~ 800 ms */
+#define AGC_DC_SHIFT       4                      /* DC estimate, ~ 250 ms */
+
+/* Envelope level in quarter octaves (1.5 dB steps), 0 .. AGC_LEVELS - 1 */
+#define AGC_LEVELS         72
+
+typedef struct {
+    uint32_t blocks;        /* Blocks processed */
+    uint32_t clipped;       /* Samples saturated at 18 bit */
+    int32_t gain;           /* Current gain, Q12 */
+    int32_t minGain;        /* Lowest / highest gain since Agc_Init, Q12 */
+    int32_t maxGain;
+    uint32_t envelope;      /* Input envelope (peak, DC removed) */
+    int32_t dcOffset;       /* Estimated microphone DC offset */
+} AgcStats;
+
+/**
+ * @brief  Build the gain table and reset envelope, gain and statistics
+ * @note   Call before the I2S DMA starts
+ */
+void Agc_Init(void);
+
+/**
+ * @brief  Remove the DC offset and apply the gain to one block
+ * @param  in: 18-bit samples from the RX callback
+ * @param  out: n gained 18-bit samples (may not alias in)
+ * @param  block: BlockStats of in, its mean feeds the DC estimate and its peak the envelope
+ * @note   Called from the I2S RX callbacks only. One pass over the samples, the statistics are
+ *         not computed again
+ */
+void Agc_Process(const int32_t* in, int32_t* out, uint32_t n, const BlockStats* block);
+
+/**
+ * @brief  Quarter-octave level of an envelope value
+ */
+uint32_t Agc_Level(uint32_t envelope);
+
+/**
+ * @brief  Get a consistent copy of the gain telemetry
+ */
+void Agc_GetStats(AgcStats* stats);
+
+/**
+ * @brief  Print gain, envelope and clipping
+ */
+void Agc_PrintStats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AGC_H */
@@ -0,0 +1,12 @@
+// Shared activation arena for all X-CUBE-AI models
+
+#include "ai_model.h"
+
+static_assert(AI_ACTIVATION_POOL_SIZE % AI_NETWORK_ACTIVATIONS_ALIGNMENT == 0,
+              "activation pool must keep the model alignment");
+
+AI_ALIGNED(32) static ai_u8 activationPool[AI_ACTIVATION_POOL_SIZE];
+
+ai_handle AiActivationPool_Get(void) {
+    return AI_HANDLE_PTR(activationPool);
+}
@@ -0,0 +1,133 @@
+/**
+ * @file    ai_model.h
+ * @brief   Uniform C++ wrapper for X-CUBE-AI generated models
+ *
+ * Every generated model (c_name "xxx") keeps its own handle and weights, all models share
+ * one activation arena. Only one model runs at a time, so the arena is sized for the
+ * largest model and adding a model does not add its activations on top.
+ *
+ * Adding a model:
+ *   1. Generate it with X-CUBE-AI under a new c_name (e.g. "wakeword")
+ *   2. Include its headers below and add AI_WAKEWORD_DATA_ACTIVATIONS_SIZE to aiActivationSizes
+ *   3. AiModel<AI_WAKEWORD_IN_1_SIZE, AI_WAKEWORD_OUT_1_SIZE> model(AI_MODEL_API(wakeword));
+ */
+
+#ifndef AI_MODEL_H
+#define AI_MODEL_H
+
+#include "ai_platform.h"
+#include "network.h"
+#include "network_data.h"
+#include <stdint.h>
+
+/* Generated entry points of one model */
+struct AiModelApi {
+    const char* name;
+    ai_error (*createAndInit)(ai_handle* network, const ai_handle activations[], const ai_handle weights[]);
+    ai_buffer* (*inputsGet)(ai_handle network, ai_u16* count);
+    ai_buffer* (*outputsGet)(ai_handle network, ai_u16* count);
+    ai_i32 (*run)(ai_handle network, const ai_buffer* input, ai_buffer* output);
+    ai_error (*getError)(ai_handle network);
+};
+
+#define AI_MODEL_API(cname) { #cname, \
+    ai_##cname##_create_and_init, ai_##cname##_inputs_get, ai_##cname##_outputs_get, \
+    ai_##cname##_run, ai_##cname##_get_error }
+
+/* Activation sizes of all generated models linked into the firmware */
+constexpr uint32_t aiActivationSizes[] = {
+    AI_NETWORK_DATA_ACTIVATIONS_SIZE,
+};
+
+constexpr uint32_t aiMaxActivationSize(uint32_t i = 0, uint32_t best = 0) {
+    return i == sizeof(aiActivationSizes) / sizeof(aiActivationSizes[0])
+        ? best
+        : aiMaxActivationSize(i + 1, aiActivationSizes[i] > best ? aiActivationSizes[i] : best);
+}
+
+/* Size of the shared activation arena */
+constexpr uint32_t AI_ACTIVATION_POOL_SIZE = aiMaxActivationSize();
+
+/**
+ * @brief  Get the shared activation arena (AI_ACTIVATION_POOL_SIZE bytes, 32-byte aligned)
+ */
+ai_handle AiActivationPool_Get(void);
+
+/* What init() found: tensor counts and the element counts of the first input and output */
+struct AiModelShape {
+    uint16_t numIn;
+    uint16_t numOut;
+    uint32_t inSize;
+    uint32_t outSize;
+};
+
+/**
+ * Float model with one input and one output tensor.
+ * The tensor sizes are template parameters and checked once in init(), so run() does
+ * no per-call shape checks.
+ *
+ * @warning Inputs and outputs live in the shared arena: fill input() right before run()
+ *          and read output() before another model runs.
+ */
+template <uint32_t InSize, uint32_t OutSize>
+class AiModel {
+public:
+    static constexpr uint32_t inputSize = InSize;
+    static constexpr uint32_t outputSize = OutSize;
+
+    explicit constexpr AiModel(const AiModelApi& api) : api(api) {}
+
+    /**
+     * @brief  Create the instance on the shared arena and verify the tensor sizes
+     * @return true on success
+     * @note   On failure shapeMismatch() tells a runtime error (see error()) from tensors that do
+     *         not match InSize / OutSize (see shape()); the runtime reports no error for those
+     */
+    bool init() {
+        mismatch = false;
+        found = AiModelShape();
+        const ai_handle acts[] = { AiActivationPool_Get() };
+        ai_error err = api.createAndInit(&handle, acts, nullptr);
+        if (err.type != AI_ERROR_NONE) return false;
+
+        ai_u16 numIn = 0, numOut = 0;
+        in = api.inputsGet(handle, &numIn);
+        out = api.outputsGet(handle, &numOut);
+        found.numIn = numIn;
+        found.numOut = numOut;
+        if (numIn > 0) found.inSize = AI_BUFFER_SIZE(&in[0]);
+        if (numOut > 0) found.outSize = AI_BUFFER_SIZE(&out[0]);
+        mismatch = !(numIn == 1 && numOut == 1 && found.inSize == InSize && found.outSize == OutSize);
+        return !mismatch;
+    }
+
+    float* input() { return static_cast<float*>(in[0].data); }
+    const float* output() const { return static_cast<const float*>(out[0].data); }
+
+    /**
+     * @brief  Run one inference on the current input
+     * @return true on success
+     */
+    bool run() { return api.run(handle, in, out) == 1; }
+
+    ai_error error() const { return api.getError(handle); }
+    /* true if the last init() failed on the tensor counts or sizes */
+    bool shapeMismatch() const { return mismatch; }
+    const AiModelShape& shape() const { return found; }
+    const char* name() const { return api.name; }
+    /* Runtime instance, for the platform observer (per-layer timing) */
+    ai_handle instance() const { return handle; }
+
+private:
+    const AiModelApi api;
+    ai_handle handle = AI_HANDLE_NULL;
+    ai_buffer* in = nullptr;
+    ai_buffer* out = nullptr;
+    AiModelShape found = {};
+    bool mismatch = false;
+};
+
+/* Models available in this firmware */
+typedef AiModel<AI_NETWORK_IN_1_SIZE, AI_NETWORK_OUT_1_SIZE> CommandModel;
+
+#endif /* AI_MODEL_H */
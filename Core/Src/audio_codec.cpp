@@ -0,0 +1,193 @@
+// Lossless audio block codec (fixed prediction + Rice coding)
+// Portable, also built into Tools/stream_decode.
+
+#include "audio_codec.h"
+
+// BIT I/O
+
+namespace {
+
+struct BitWriter {
+    uint8_t* out;
+    uint32_t capacity;
+    uint32_t bytes;
+    uint64_t acc;
+    uint32_t count;
+    bool overflow;
+
+    void put(uint32_t value, uint32_t bits) {
+        acc = (acc << bits) | (value & (bits == 32 ? 0xFFFFFFFFu : ((1u << bits) - 1)));
+        count += bits;
+        while (count >= 8) {
+            count -= 8;
+            if (bytes < capacity) out[bytes++] = (uint8_t)(acc >> count);
+            else overflow = true;
+        }
+    }
+
+    void ones(uint32_t n) {
+        while (n >= 16) { put(0xFFFF, 16); n -= 16; }
+        if (n) put((1u << n) - 1, n);
+    }
+
+    uint32_t finish() {
+        if (count) put(0, 8 - count);
+        return bytes;
+    }
+};
+
+struct BitReader {
+    const uint8_t* in;
+    uint32_t size;
+    uint32_t pos;  // bit position
+
+    bool get(uint32_t bits, uint32_t* value) {
+        if (pos + bits > size * 8) return false;
+        uint32_t v = 0;
+        for (uint32_t i = 0; i < bits; i++, pos++) {
+            v = (v << 1) | ((in[pos >> 3] >> (7 - (pos & 7))) & 1u);
+        }
+        *value = v;
+        return true;
+    }
+};
+
+inline uint32_t zigzag(int32_t v) {
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+inline int32_t unzigzag(uint32_t v) {
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+inline int32_t absValue(int32_t v) {
+    return v < 0 ? -v : v;
+}
+
+// Prediction of x[i] for a fixed polynomial order
+inline int32_t predict(const int32_t* x, uint32_t i, uint32_t order) {
+    switch (order) {
+        case 1:  return x[i - 1];
+        case 2:  return 2 * x[i - 1] - x[i - 2];
+        case 3:  return 3 * x[i - 1] - 3 * x[i - 2] + x[i - 3];
+        default: return 0;
+    }
+}
+
+inline int32_t signExtend(uint32_t v, uint32_t bits) {
+    return (int32_t)(v << (32 - bits)) >> (32 - bits);
+}
+
+uint32_t encodeVerbatim(const int32_t* samples, uint32_t n, uint8_t* out) {
+    BitWriter w = { out, AUDIO_CODEC_MAX_BYTES(n), 0, 0, 0, false };
+    w.put(AUDIO_CODEC_VERBATIM, 3);
+    w.put(0, 5);
+    for (uint32_t i = 0; i < n; i++) w.put((uint32_t)samples[i], AUDIO_CODEC_SAMPLE_BITS);
+    return w.finish();
+}
+
+} // namespace
+
+extern "C" {
+
+uint32_t AudioCodec_Encode(const int32_t* samples, uint32_t n, uint8_t* out) {
+    if (n <= AUDIO_CODEC_MAX_ORDER) return encodeVerbatim(samples, n, out);
+
+    // Residual magnitude of all fixed predictors in one pass (running differences)
+    uint32_t error[AUDIO_CODEC_MAX_ORDER + 1] = { 0, 0, 0, 0 };
+    int32_t d0 = samples[2], d1 = samples[2] - samples[1];
+    int32_t d2 = d1 - (samples[1] - samples[0]);
+    for (uint32_t i = AUDIO_CODEC_MAX_ORDER; i < n; i++) {
+        int32_t e0 = samples[i];
+        int32_t e1 = e0 - d0;
+        int32_t e2 = e1 - d1;
+        int32_t e3 = e2 - d2;
+        error[0] += (uint32_t)absValue(e0);
+        error[1] += (uint32_t)absValue(e1);
+        error[2] += (uint32_t)absValue(e2);
+        error[3] += (uint32_t)absValue(e3);
+        d0 = e0;
+        d1 = e1;
+        d2 = e2;
+    }
+    uint32_t order = 0;
+    for (uint32_t o = 1; o <= AUDIO_CODEC_MAX_ORDER; o++) {
+        if (error[o] < error[order]) order = o;
+    }
+
+    // Rice parameter from the mean zigzag residual (about twice the mean magnitude)
+    uint64_t sum = 2ull * error[order];
+    uint64_t count = n - AUDIO_CODEC_MAX_ORDER;
+    uint32_t k = 0;
+    while (k < 30 && (count << (k + 1)) < sum) k++;
+
+    BitWriter w = { out, AUDIO_CODEC_MAX_BYTES(n), 0, 0, 0, false };
+    w.put(order, 3);
+    w.put(k, 5);
+    for (uint32_t i = 0; i < order; i++) w.put((uint32_t)samples[i], AUDIO_CODEC_SAMPLE_BITS);
+    for (uint32_t i = order; i < n && !w.overflow; i++) {
+        uint32_t v = zigzag(samples[i] - predict(samples, i, order));
+        uint32_t q = v >> k;
+        if (q < AUDIO_CODEC_ESCAPE) {
+            w.ones(q);
+            w.put(0, 1);
+            if (k) w.put(v, k);
+        } else {
+            w.ones(AUDIO_CODEC_ESCAPE);
+            w.put(v, 32);
+        }
+    }
+    uint32_t size = w.finish();
+
+    // Noise-like block: verbatim is smaller
+    if (w.overflow || size >= AUDIO_CODEC_MAX_BYTES(n)) return encodeVerbatim(samples, n, out);
+    return size;
+}
+
+bool AudioCodec_Decode(const uint8_t* in, uint32_t size, int32_t* samples, uint32_t n) {
+    BitReader r = { in, size, 0 };
+    uint32_t method, k, v;
+    if (!r.get(3, &method) || !r.get(5, &k)) return false;
+
+    if (method == AUDIO_CODEC_VERBATIM) {
+        for (uint32_t i = 0; i < n; i++) {
+            if (!r.get(AUDIO_CODEC_SAMPLE_BITS, &v)) return false;
+            samples[i] = signExtend(v, AUDIO_CODEC_SAMPLE_BITS);
+        }
+        return true;
+    }
+    if (method > AUDIO_CODEC_MAX_ORDER || k > 30) return false;
+
+    uint32_t order = method;
+    for (uint32_t i = 0; i < order && i < n; i++) {
+        if (!r.get(AUDIO_CODEC_SAMPLE_BITS, &v)) return false;
+        samples[i] = signExtend(v, AUDIO_CODEC_SAMPLE_BITS);
+    }
+    for (uint32_t i = order; i < n; i++) {
+        uint32_t q = 0, bit;
+        while (q < AUDIO_CODEC_ESCAPE) {
+            if (!r.get(1, &bit)) return false;
+            if (!bit) break;
+            q++;
+        }
+        if (q == AUDIO_CODEC_ESCAPE) {
+            if (!r.get(32, &v)) return false;
+        } else {
+            uint32_t low = 0;
+            if (k && !r.get(k, &low)) return false;
+            v = (q << k) | low;
+        }
+        samples[i] = unzigzag(v) + predict(samples, i, order);
+    }
+    return true;
+}
+
+uint16_t AudioCodec_Crc16(const uint8_t* data, uint32_t length, uint16_t crc) {
+    for (uint32_t i = 0; i < length; i++) {
+        crc ^= (uint16_t)(data[i] << 8);
+        for (int b = 0; b < 8; b++) crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+    return crc;
+}
+
+} // extern "C"
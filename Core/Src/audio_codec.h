@@ -0,0 +1,62 @@
+/**
+ * @file    audio_codec.h
+ * @brief   Lossless block codec for the 18-bit microphone samples (shared with Tools/stream_decode)
+ *
+ * Shorten/FLAC style: every block picks the fixed polynomial predictor (order 0..3) with the
+ * smallest residual sum and codes the residuals with one Rice parameter. The first `order`
+ * samples of a block are stored verbatim, so every block decodes on its own and a lost frame
+ * costs only its own samples. If coding does not pay off the block is stored verbatim.
+ *
+ * Block layout (MSB first):
+ *   method (3 bits: 0..3 = predictor order, 7 = verbatim)
+ *   rice k (5 bits, only for predictor blocks)
+ *   order warm-up samples (AUDIO_CODEC_SAMPLE_BITS each, two's complement)
+ *   residuals: zigzag value v as unary (v >> k) ones, a zero, then the low k bits;
+ *              quotients >= AUDIO_CODEC_ESCAPE are sent as AUDIO_CODEC_ESCAPE ones + 32 raw bits
+ */
+
+#ifndef AUDIO_CODEC_H
+#define AUDIO_CODEC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define AUDIO_CODEC_SAMPLE_BITS  18
+#define AUDIO_CODEC_MAX_ORDER    3
+#define AUDIO_CODEC_VERBATIM     7
+#define AUDIO_CODEC_ESCAPE       24
+
+/* Worst case encoded size of a block (verbatim + method byte) */
+#define AUDIO_CODEC_MAX_BYTES(n)  (((n) * AUDIO_CODEC_SAMPLE_BITS + 8 + 7) / 8)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief  Encode one block
+ * @param  samples: n samples in the AUDIO_CODEC_SAMPLE_BITS range
+ * @param  out: at least AUDIO_CODEC_MAX_BYTES(n) bytes
+ * @return Encoded size in bytes
+ */
+uint32_t AudioCodec_Encode(const int32_t* samples, uint32_t n, uint8_t* out);
+
+/**
+ * @brief  Decode one block
+ * @param  in: encoded block
+ * @param  size: encoded size in bytes
+ * @param  samples: receives n samples
+ * @return false if the data is malformed
+ */
+bool AudioCodec_Decode(const uint8_t* in, uint32_t size, int32_t* samples, uint32_t n);
+
+/**
+ * @brief  CRC-16/CCITT-FALSE, used by the stream framing
+ */
+uint16_t AudioCodec_Crc16(const uint8_t* data, uint32_t length, uint16_t crc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AUDIO_CODEC_H */
@@ -3,6 +3,18 @@
 
 #include "audio_processing.h"
 #include "led_array.h"
+#include "audio_timeline.h"
+#include "trace.h"
+#include "deferred_log.h"
+#include "audio_stream.h"
+#include "agc.h"
+#include "mic_warmup.h"
+#include "clock_governor.h"
+#include "dma_copy.h"
+#include "block_stats.h"
+#include "i2s_unpack.h"
+#include "trigger_detector.h"
+#include "pipeline_config.h"
 #include <stdio.h>
 #include <cmath>
 #include <cstring>
@@ -12,22 +24,33 @@ extern I2S_HandleTypeDef hi2s2;
 
 // BUFFERS
 
-// DMA input buffer
-static uint16_t inputBuffer1[I2S_BUF_SIZE * 2];
+// Sizes from PIPELINE (pipeline_config.h), int like the counters below
+static constexpr int RECORDING_SAMPLES = PIPELINE.recordingSamples;
+static constexpr int BLOCK_SAMPLES = PIPELINE.blockSamples;
+
+// DMA input buffer, two halves
+static uint16_t inputBuffer1[PIPELINE.dmaHalfwords() * 2];
 
 // Merged audio frame (after combining 16-bit pairs)
-static int32_t mergedFrame[I2S_BUF_SIZE / 4];
-// Dass wir durch 4 teilen, liegt an zwei Faktoren, die gleichzeitig passieren: 
+static int32_t mergedFrame[PIPELINE.blockSamples];
+// Dass ein Block ein Viertel des halben DMA-Puffers ist (I2S_UNPACK_STRIDE), liegt an zwei Faktoren, die gleichzeitig passieren: 
 // der Umwandlung von Datengrößen (16-Bit zu 32-Bit) -> durch 2 
 // und der Umwandlung von Kanälen (Stereo zu Mono) -> wieder durch 2. TOTAL DURCH 4!
 
-// 1 second recording buffer (16000 samples @ 16kHz)
-static int32_t ISecArray[16000];
+// Same block after DC removal and AGC (agc.h): this is what gets recorded for the KWS. The
+// trigger and the capture stream (dataset collection, detector tuning) take the raw mergedFrame
+static int32_t gainedFrame[PIPELINE.blockSamples];
+
+// Recording buffer (1 second)
+static int32_t ISecArray[PIPELINE.recordingSamples];
 
 // Ring buffer to capture audio BEFORE threshold is exceeded
-static int32_t RingBuffer[4000];
-static int RingBufferSize = 4000;
+static int32_t RingBuffer[PIPELINE.preRollSamples];
+static constexpr int RingBufferSize = PIPELINE.preRollSamples;
 static int RingBufferIndex = 0;
+// DMA jobs on the buffers (dma_copy.h)
+static volatile uint32_t preRollPending = 0;    // Pre-roll copies into ISecArray still running
+static volatile bool ringClearing = false;      // RingBuffer being cleared
 
 //STATE VARIABLES
 static volatile bool isRecording = false;
@@ -35,15 +58,28 @@ static volatile bool datenVerarbeiten = false;  // Data processing enabled flag
 static volatile int iZaehler = 0;               // Recording sample counter
 static volatile uint32_t recordingStartTime = 0;
 static volatile bool recordingComplete = false; // Flag to signal main loop
-static volatile uint32_t cooldownEndTime = 0;   // Cooldown timer (no blocking delay)
 
-// THRESHOLD VARIABLES
-static int noise = NOISE_THRESHOLD;
-static int OFFSET = INITIAL_OFFSET;
+// TIMESTAMPS (audio timeline, see audio_timeline.h)
+static AudioBlock currentBlock = {};            // Block being processed by Audio1Sec
+static AudioRecordingInfo recordingInfo = {};
+static uint32_t lostAtTrigger = 0;
+
+// TRIGGER (adaptive threshold, spike filter, cooldown; parameters in detector_config.h)
+static TriggerDetector detector;
+
+static void preRollCopied(void* context) {
+    (void)context;
+    preRollPending--;
+}
+
+static void ringCleared(void* context) {
+    (void)context;
+    ringClearing = false;
+}
 
 // Process audio frame and check for threshold
 /**
- * @warning
+ * @warning (Schwellenwert in trigger_detector.cpp, Faktoren in detector_config.h)
  * _OFFSET: Das ist das neue Ergebnis. Hier wird der Schwellenwert gespeichert, den wir für den nächsten Aufzeichnungsschritt benutzen wollen. 
  * 0.113: Das ist der Reaktions-Faktor. Er bestimmt, wie stark ein neuer Ton den Schwellenwert verändern darf (hier ca. 11 %).
  * mergedFrame[i]: Das ist der aktuelle Ton-Wert, den wir gerade frisch vom Mikrofon bekommen haben.
@@ -53,72 +89,81 @@ static int OFFSET = INITIAL_OFFSET;
  * Durch die 0.9 hat das System ein Gedächtnis. Es bleibt ruhig und ändert sich nur, wenn es im Raum dauerhaft lauter wird.
  * In der Mathematik für Filter gilt oft die Regel: Die beiden Faktoren sollten zusammen ungefähr 1 ergeben ($0.9 + 0.113 \approx 1$).
  */
+static uint32_t timelineLostBlocks(void) {
+    AudioTimelineStats timeline;
+    AudioTimeline_GetStats(&timeline);
+    return timeline.lostBlocks;
+}
+
 void Audio1Sec(void) {
-    // Das ist ein „Lautstärke-Zähler“. Er zählt, wie viele Aufzeichnungen hintereinander laut waren. Wir starten bei 0.
-    int loudSoundCounter = 0;
-    // Das ist unser Filter. Ein kurzes „Knacksen“ (çatırtı) dauert vielleicht nur 1 oder 2 Aufzeichnungen. 
-    // Wir sagen: Erst wenn es 5 Mal hintereinander laut ist, glauben wir, dass es ein echtes Wort ist.
-    const int LOUD_SOUND_DURATION = 5;  // Samples needed to trigger recording
+    TRACE_BEGIN(AUDIO_1SEC);
+    // Der „Lautstärke-Zähler“ zählt, wie viele Samples hintereinander laut waren, und startet mit
+    // jedem Block bei 0. Ein kurzes „Knacksen“ dauert nur 1 oder 2 Samples: erst DETECTOR_LOUD_SAMPLES
+    // laute Samples hintereinander sind ein echtes Wort.
+    TriggerDetector_BlockStart(&detector);
 
     // Wie ich schon sagte, enthält der Speicher 1000 Plätze, aber wegen des Mono/Stereo-Sprungs (i+=4) 
     // sind nur 250 davon echte Ton-Werte. Also läuft diese Schleife 250 Mal
-    for (int i = 0; i < I2S_BUF_SIZE / 4; i++) {
-        // Schallwerte können positiv oder negativ sein. Wir nehmen den Betrag (abs) um sie positiv zu machen.
-        OFFSET = 0.113 * abs(mergedFrame[i]) + 0.9 * OFFSET;
-        // Filter EMA (Exponential Moving Average) -> Adaptiven Schwellwerts -> NICHT STATISCH SONDERN DYNAMISCH! BESSER ZUM FILTERN VON NOISE! UND BESSERE LÖSUNG ALS DIE VORGESCHLAGENE STATISCHE LÖSUNG IM PDF!
-
-
-        // Check if signal exceeds threshold
-        if (abs(mergedFrame[i]) > OFFSET) {
-            loudSoundCounter++;
-        } else {
-            loudSoundCounter = 0;
-        }
-
-        // Filter out extreme noise spikes
-        if (abs(mergedFrame[i]) > noise) {
+    for (int i = 0; i < BLOCK_SAMPLES; i++) {
+        // Threshold EMA and loud run on the raw sample, extreme noise spikes are skipped
+        uint64_t sample = currentBlock.firstSample + i;
+        TriggerEvent event = TriggerDetector_Sample(&detector, mergedFrame[i], sample);
+        if (event == TRIGGER_SPIKE) {
             continue;  // Skip this sample
         }
 
         // Store in ring buffer (captures audio BEFORE trigger)
         // this was actually not really necessary, because we could just use the mergedFrame array directly
         // But i saw that in Aufgabe 2 they wanted us to save the audio before the trigger to give it to AI to not miss the trigger word!
-        RingBuffer[RingBufferIndex] = mergedFrame[i];
-        RingBufferIndex = (RingBufferIndex + 1) % RingBufferSize;
-
-        if (loudSoundCounter >= LOUD_SOUND_DURATION && 
-            abs(mergedFrame[i]) > OFFSET && 
-            !isRecording &&
-            HAL_GetTick() > cooldownEndTime) {
-            
+        // Not while recording (the DMA reads the pre-roll from it) or while the DMA clears it: the
+        // ring is cleared after every recording anyway
+        if (!isRecording && !ringClearing) {
+            RingBuffer[RingBufferIndex] = gainedFrame[i];
+            if (++RingBufferIndex == RingBufferSize) RingBufferIndex = 0;
+        }
+
+        if (event == TRIGGER_START) {
             isRecording = true;
             recordingStartTime = HAL_GetTick();
-            printf(">>> Aufnahme beginnt\r\n");
-
-            // Copy ring buffer content (audio before trigger)
-            int copyIndex = RingBufferIndex;
-            for (int k = 0; k < RingBufferSize && iZaehler < 16000; k++) {
-                ISecArray[iZaehler++] = RingBuffer[copyIndex];
-                copyIndex = (copyIndex + 1) % RingBufferSize;
-            }
+            TRACE_INSTANT(TRIGGER, currentBlock.sequence);
+            // Full speed for the recording and the inference that follows
+            Governor_Boost();
+            recordingInfo.triggerSample = sample;
+            lostAtTrigger = timelineLostBlocks();
+            DLOG(">>> Aufnahme beginnt @ Sample %lu", (unsigned long)recordingInfo.triggerSample);
+
+            // Copy ring buffer content (audio before trigger), oldest first: two DMA copies that
+            // finish long before the recording does
+            int preRoll = RingBufferSize < RECORDING_SAMPLES - iZaehler ? RingBufferSize : RECORDING_SAMPLES - iZaehler;
+            int first = RingBufferSize - RingBufferIndex < preRoll ? RingBufferSize - RingBufferIndex : preRoll;
+            preRollPending = 2;
+            DmaCopy_Copy(&ISecArray[iZaehler], &RingBuffer[RingBufferIndex], first * sizeof(int32_t),
+                         preRollCopied, nullptr);
+            DmaCopy_Copy(&ISecArray[iZaehler + first], RingBuffer, (preRoll - first) * sizeof(int32_t),
+                         preRollCopied, nullptr);
+            iZaehler += preRoll;
         }
 
         // Continue recording
         if (isRecording) {
-            ISecArray[iZaehler++] = mergedFrame[i];
+            ISecArray[iZaehler++] = gainedFrame[i];
 
-            if (iZaehler >= 16000) {
+            if (iZaehler >= RECORDING_SAMPLES) {
                 // Set flag for main loop to handle (NO blocking delay in ISR!)
+                recordingInfo.endSample = sample;
+                recordingInfo.lostBlocks = timelineLostBlocks() - lostAtTrigger;
                 recordingComplete = true;
                 isRecording = false;
+                TRACE_INSTANT(RECORDING_END, currentBlock.sequence);
                 
-                // Set cooldown time (1 second from now)
-                cooldownEndTime = HAL_GetTick() + 1000;
+                // Cooldown (DETECTOR_COOLDOWN_MS from now, no blocking delay)
+                TriggerDetector_RecordingDone(&detector, sample);
                 
                 break;
             }
         }
     }
+    TRACE_END(AUDIO_1SEC);
 }
 
 /* 
@@ -131,8 +176,11 @@ void AudioProcessing_Init(void) {
     // Clear all buffers
     memset(inputBuffer1, 0, sizeof(inputBuffer1));
     memset(mergedFrame, 0, sizeof(mergedFrame));
-    memset(ISecArray, 0, sizeof(ISecArray));
-    memset(RingBuffer, 0, sizeof(RingBuffer));
+    memset(gainedFrame, 0, sizeof(gainedFrame));
+    // The recording buffers (80 kB) are cleared by the DMA while the KWS init runs
+    ringClearing = true;
+    DmaCopy_Fill(ISecArray, 0, sizeof(ISecArray), nullptr, nullptr);
+    DmaCopy_Fill(RingBuffer, 0, sizeof(RingBuffer), ringCleared, nullptr);
     
     // Reset state
     isRecording = false;
@@ -140,11 +188,17 @@ void AudioProcessing_Init(void) {
     iZaehler = 0;
     recordingStartTime = 0;
     recordingComplete = false;
-    cooldownEndTime = 0;
+    preRollPending = 0;
+    recordingInfo = AudioRecordingInfo();
+    AudioTimeline_Init(PIPELINE.blockSamples);
+    Agc_Init();
+    BlockStats_Init();
+    MicWarmup_Init();
     
-    // Reset thresholds
-    noise = NOISE_THRESHOLD;
-    OFFSET = INITIAL_OFFSET;
+    // Reset threshold and cooldown
+    TriggerDetectorParams params;
+    TriggerDetector_DefaultParams(&params);
+    TriggerDetector_Init(&detector, &params);
 }
 
 void AudioProcessing_Enable(bool enable) {
@@ -152,37 +206,32 @@ void AudioProcessing_Enable(bool enable) {
 }
 
 void LautstaerkeZeigen(void) {
-    for (int i = 0; i < I2S_BUF_SIZE / 4; i++) {
-        // Scale sample to LED count (0-10)
-        // the divisor is adjusted based on our microphone sensitivity
-        // I had to try out different values to get the best result
-        int anzahl = abs(mergedFrame[i] / 550) - 12;
-        if (anzahl < 0) anzahl = 0;
-        if (anzahl > 10) anzahl = 10;
-        led_func(anzahl);
-    }
+    // Input level from the published block peak (before gain, DC removed): one LED per 6 dB above
+    // the noise floor, independent of the microphone sensitivity
+    BlockStats stats;
+    if (!BlockStats_Get(&stats)) stats.peak = 0;
+    int anzahl = ((int)Agc_Level(stats.peak) - (int)Agc_Level(AGC_NOISE_FLOOR)) / 4 + 1;
+    if (anzahl < 0) anzahl = 0;
+    if (anzahl > 10) anzahl = 10;
+    led_func(anzahl);
 }
 
-int mittelwert(void) {
-    int volume = 0;
-
-    // Calculate average absolute amplitude
-    for (int i = 0; i < I2S_BUF_SIZE / 4; i++) {
-        volume += abs(mergedFrame[i]);
-    }
-    volume /= (I2S_BUF_SIZE / 4);
-    
-    return volume;
+bool AudioProcessing_IsRecordingComplete(void) {
+    return recordingComplete && preRollPending == 0;
 }
 
-bool AudioProcessing_IsRecordingComplete(void) {
-    return recordingComplete;
+bool AudioProcessing_IsRecording(void) {
+    return isRecording;
 }
 
 uint32_t AudioProcessing_GetRecordingStartTime(void) {
     return recordingStartTime;
 }
 
+void AudioProcessing_GetRecordingInfo(AudioRecordingInfo* info) {
+    *info = recordingInfo;
+}
+
 int32_t* AudioProcessing_GetRecordedData(void) {
     return ISecArray;
 }
@@ -192,9 +241,10 @@ void AudioProcessing_ClearRecordingComplete(void) {
 }
 
 void AudioProcessing_ResetRecording(void) {
-    memset(RingBuffer, 0, sizeof(RingBuffer));
+    ringClearing = true;
     RingBufferIndex = 0;
     iZaehler = 0;
+    DmaCopy_Fill(RingBuffer, 0, sizeof(RingBuffer), ringCleared, nullptr);
 }
 
 uint16_t* AudioProcessing_GetInputBuffer(void) {
@@ -203,6 +253,36 @@ uint16_t* AudioProcessing_GetInputBuffer(void) {
 
 } // extern "C"
 
+// One DMA half-buffer, both RX callbacks. Tools/kernel_bench times the same steps without the
+// I/O as rx_block (kernel_bench.cpp), keep the two in step.
+static void processBlock(const uint16_t* half) {
+    // Timeline runs during warmup too, so timestamps count from DMA start
+    AudioTimeline_BlockReceived(&currentBlock);
+    TRACE_BEGIN_ARG(DMA_BLOCK, currentBlock.sequence);
+
+    // Data goes into the RAM 16 bit values, we need to merge them to 32 bit values!
+    // Because a real voice value is 18 bit! So it can be represented by 32 bit!
+    // After merging we shift right 14 bits to get the 18-bit sample! (i2s_unpack.h)
+    I2sUnpack_Block(half, mergedFrame, BlockCount());
+    // One pass for level, DC, crossings and clipping, the main loop reads the published copy
+    BlockStats blockStats;
+    BlockStats_Update(mergedFrame, PIPELINE.blockSamples, currentBlock.sequence, &blockStats);
+
+    if (!datenVerarbeiten) {
+        // Warmup phase: the first data from the microphone is unusable (THE PDF SAYS SO), it only
+        // goes to the readiness detector until DC offset and noise floor have settled
+        MicWarmup_ProcessBlock(&blockStats);
+        TRACE_END(DMA_BLOCK);
+        return;
+    }
+
+    Agc_Process(mergedFrame, gainedFrame, PIPELINE.blockSamples, &blockStats);
+
+    AudioStream_PushBlock(&currentBlock, mergedFrame, PIPELINE.blockSamples);
+    Audio1Sec();
+    TRACE_END(DMA_BLOCK);
+}
+
 /**
  * DMA CALLBACKS (Direct Memory Access): This callback function is called by the HAL Library when the half of DMA transfer is complete.
  * @brief  Process first half of buffer while the second half is being transferred. This is done in parallel.
@@ -215,41 +295,10 @@ uint16_t* AudioProcessing_GetInputBuffer(void) {
  */
 extern "C" void HAL_I2S_RxHalfCpltCallback(I2S_HandleTypeDef* hi2s) {
     // if (hi2s->Instance != SPI2) return;
-    
-    if (!datenVerarbeiten) {
-        // Warmup phase - discard data
-        // THE PDF SAYS: "There may be problematic and wrong data at the beginning of the recording!"
-        // SO WE DISCARD THE DATA!
-        return;
-    }
-
-    // Data goes into the RAM 16 bit values, we need to merge them to 32 bit values!
-    // Because a real voice value is 18 bit! So it can be represented by 32 bit!
-    // After merging we shift right 14 bits to get the 18-bit sample!  
-    for (int i = 0, j = 0; i < I2S_BUF_SIZE; i += 4, j++) {
-        // Merge two 16-bit values into 32-bit
-        int32_t mergedValue = ((int32_t)inputBuffer1[i] << 16) | inputBuffer1[i + 1];
-        // Shift right 14 bits to get 18-bit sample
-        mergedValue = mergedValue >> 14;
-        mergedFrame[j] = mergedValue;
-    }
-
-    Audio1Sec();
+    processBlock(&inputBuffer1[0]);
 }
 // called when the whole DMA transfer is complete
 extern "C" void HAL_I2S_RxCpltCallback(I2S_HandleTypeDef* hi2s) {
     // if (hi2s->Instance != SPI2) return;
-    
-    if (!datenVerarbeiten) {
-        return;
-    }
-
-    for (int i = I2S_BUF_SIZE, j = 0; i < I2S_BUF_SIZE * 2; i += 4, j++) {
-        int32_t mergedValue = ((int32_t)inputBuffer1[i] << 16) | inputBuffer1[i + 1];
-        mergedValue = mergedValue >> 14;
-        mergedFrame[j] = mergedValue;
-    }
-
-    Audio1Sec();
+    processBlock(&inputBuffer1[PIPELINE.dmaHalfwords()]);
 }
-
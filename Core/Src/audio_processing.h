@@ -18,12 +18,15 @@ extern "C" {
 #include <stdint.h>
 #include <stdbool.h>
 
-/* Buffer size for I2S DMA */
-#define I2S_BUF_SIZE 1000
-/* Noise threshold (upper limit - samples above this are ignored as noise) */
-#define NOISE_THRESHOLD 12000
-/* Initial adaptive threshold offset */
-#define INITIAL_OFFSET 7500
+/* DMA buffer, block and recording sizes: PIPELINE (pipeline_config.h) */
+/* Trigger thresholds, cooldown and pre-roll: detector_config.h */
+
+/* Timestamps of one recording on the audio timeline (see audio_timeline.h) */
+typedef struct {
+    uint64_t triggerSample;  /* Sample that started the recording */
+    uint64_t endSample;      /* Last recorded sample */
+    uint32_t lostBlocks;     /* DMA blocks lost between trigger and end, 0 = gapless */
+} AudioRecordingInfo;
 
 /**
  * @brief  Initialize audio processing module
@@ -49,18 +52,17 @@ void Audio1Sec(void);
  */
 void LautstaerkeZeigen(void);
 
-/**
- * @brief  Calculate average volume of current frame
- * @return Average absolute amplitude
- */
-int mittelwert(void);
-
 /**
  * @brief  Check if recording is complete
  * @return true if 1 second recording is complete
  */
 bool AudioProcessing_IsRecordingComplete(void);
 
+/**
+ * @brief  Check if a recording is in progress (trigger fired, 1 second not complete yet)
+ */
+bool AudioProcessing_IsRecording(void);
+
 /**
  * @brief  Get recording start time
  * @return Recording start time in milliseconds
@@ -68,7 +70,13 @@ bool AudioProcessing_IsRecordingComplete(void);
 uint32_t AudioProcessing_GetRecordingStartTime(void);
 
 /**
- * @brief  Get recorded audio data (1 second, 16000 samples)
+ * @brief  Get sample-exact timestamps of the last recording (audio timeline samples)
+ * @param  info: filled with trigger/end sample and blocks lost during the recording
+ */
+void AudioProcessing_GetRecordingInfo(AudioRecordingInfo* info);
+
+/**
+ * @brief  Get recorded audio data (PIPELINE.recordingSamples, 1 second)
  * @return Pointer to ISecArray buffer
  */
 int32_t* AudioProcessing_GetRecordedData(void);
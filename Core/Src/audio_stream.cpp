@@ -0,0 +1,106 @@
+// Audio capture stream
+// Runs inside the I2S RX callbacks; the frame buffer is only touched from there.
+
+#include "audio_stream.h"
+#include "pipeline_config.h"
+#include "uart_dma.h"
+#include "usb_stream.h"
+#include "udp_publisher.h"
+#include "timer.h"
+#include "deferred_log.h"
+#include "main.h"
+
+// Largest block the frame buffer takes: one DMA half-buffer
+static const uint32_t MAX_BLOCK_SAMPLES = PIPELINE.blockSamples;
+
+// FRAME BUFFERS (RX callbacks only)
+// UART and USB copy a frame right away, UDP sends it zero-copy and holds it until the DMA is done.
+static uint8_t frames[2][AUDIO_STREAM_MAX_FRAME(MAX_BLOCK_SAMPLES)];
+static volatile bool udpBusy[2] = {false, false};
+
+// STATE
+static volatile bool active = false;
+static volatile AudioStreamStats stats = {};
+
+static void udpDone(void* context) {
+    *static_cast<volatile bool*>(context) = false;
+}
+
+extern "C" {
+
+void AudioStream_Start(void) {
+    DLOG("[STREAM] Start, %lu baud", (unsigned long)AUDIO_STREAM_BAUDRATE);
+    DeferredLog_Flush();
+    UartDma_SetBaudrate(AUDIO_STREAM_BAUDRATE);
+    active = true;
+}
+
+void AudioStream_Stop(void) {
+    active = false;
+}
+
+void AudioStream_PushBlock(const AudioBlock* block, const int32_t* samples, uint32_t n) {
+    bool usb = UsbStream_IsOpen();
+    bool udp = UdpPublisher_IsActive();
+    if ((!active && !usb && !udp) || n > MAX_BLOCK_SAMPLES) return;
+
+    // A buffer the Ethernet DMA is not reading
+    uint32_t index = udpBusy[0] ? 1 : 0;
+    if (udpBusy[index]) {
+        stats.droppedFrames++;
+        return;
+    }
+    uint8_t* frame = frames[index];
+
+    uint32_t start = cycleCounterGet();
+    uint32_t size = AudioStream_BuildFrame(block, samples, n, frame);
+    uint32_t payload = size - AUDIO_STREAM_HEADER_SIZE - 2;
+    uint32_t cycles = cycleCounterGet() - start;
+
+    // The USB audio channel carries the same frames (see stream_mux.h)
+    bool sent = false;
+    if (usb) sent = UsbStream_Send(STREAM_MUX_AUDIO, block->sequence, frame, size);
+    if (active) sent = UartDma_Write(frame, size, false) || sent;
+    if (udp) {
+        udpBusy[index] = true;
+        if (UdpPublisher_Send(UDP_MSG_AUDIO, frame, size, udpDone, (void*)&udpBusy[index])) sent = true;
+        else udpBusy[index] = false;
+    }
+
+    if (sent) {
+        stats.frames++;
+        stats.samples += n;
+        stats.payloadBytes += payload;
+    } else {
+        stats.droppedFrames++;
+    }
+    stats.encodeCycles += cycles;
+}
+
+void AudioStream_GetStats(AudioStreamStats* out) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    out->frames = stats.frames;
+    out->droppedFrames = stats.droppedFrames;
+    out->samples = stats.samples;
+    out->payloadBytes = stats.payloadBytes;
+    out->encodeCycles = stats.encodeCycles;
+    __set_PRIMASK(primask);
+}
+
+void AudioStream_PrintStats(void) {
+    AudioStreamStats s;
+    AudioStream_GetStats(&s);
+    if (s.samples == 0) return;
+
+    // Bits per sample and encoder load in 1/100, relative to real time
+    uint32_t bitsPerSample = (uint32_t)((uint64_t)s.payloadBytes * 800 / s.samples);
+    uint64_t realtimeCycles = (uint64_t)s.samples * (SystemCoreClock / AUDIO_TIMELINE_SAMPLE_RATE);
+    uint32_t load = (uint32_t)(s.encodeCycles * 10000 / realtimeCycles);
+    DLOG("[STREAM] frames: %lu, dropped: %lu, %lu.%02lu bit/sample (18 raw), encoder CPU: %lu.%02lu %%",
+         (unsigned long)s.frames, (unsigned long)s.droppedFrames,
+         (unsigned long)(bitsPerSample / 100), (unsigned long)(bitsPerSample % 100),
+         (unsigned long)(load / 100), (unsigned long)(load % 100));
+}
+
+} // extern "C"
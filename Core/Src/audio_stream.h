@@ -0,0 +1,94 @@
+/**
+ * @file    audio_stream.h
+ * @brief   Lossless raw-audio capture stream over USART3 (dataset collection)
+ *
+ * Every DMA block is compressed raw, before DC removal and AGC (the signal the trigger sees, so
+ * a capture replays exactly through the trigger and the AGC on the host), in the RX callback (audio_codec.h) and queued as one frame
+ * on the UART DMA (uart_dma.h), on the USB audio channel while a host has it open
+ * (usb_stream.h) and as UDP datagrams while the Ethernet link is up (udp_publisher.h). Tools/stream_decode turns a capture into a WAV file; blocks lost
+ * on the board (DMA overrun, full TX queue) show up as gaps in the sequence numbers and are
+ * filled with silence so the timing stays intact.
+ *
+ * Frame (little-endian):
+ *   0xA5 0x5A | version | flags | samples (2) | payload bytes (2) | block sequence (4)
+ *   | payload | CRC-16 over everything after the sync bytes (2)
+ */
+
+#ifndef AUDIO_STREAM_H
+#define AUDIO_STREAM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "audio_timeline.h"
+#include "audio_codec.h"
+
+/* 1 = start streaming after warmup (my_main) */
+#ifndef AUDIO_STREAM_MODE
+#define AUDIO_STREAM_MODE 0
+#endif
+
+/* 18-bit audio needs ~160 kbit/s even compressed, far above 115200 baud */
+#define AUDIO_STREAM_BAUDRATE    921600
+
+#define AUDIO_STREAM_SYNC0       0xA5
+#define AUDIO_STREAM_SYNC1       0x5A
+#define AUDIO_STREAM_VERSION     1
+#define AUDIO_STREAM_HEADER_SIZE 12
+#define AUDIO_STREAM_FLAG_GAP    0x01  /* DMA blocks were lost right before this one */
+
+/* Largest frame of n samples (every block verbatim) */
+#define AUDIO_STREAM_MAX_FRAME(n)  (AUDIO_STREAM_HEADER_SIZE + AUDIO_CODEC_MAX_BYTES(n) + 2)
+
+typedef struct {
+    uint32_t frames;         /* Frames queued */
+    uint32_t droppedFrames;  /* Frames dropped because the TX queue was full */
+    uint32_t samples;        /* Samples encoded */
+    uint32_t payloadBytes;   /* Compressed bytes (without framing) */
+    uint64_t encodeCycles;   /* CPU cycles spent in the encoder */
+} AudioStreamStats;
+
+/**
+ * @brief  Switch USART3 to AUDIO_STREAM_BAUDRATE and start sending blocks
+ */
+void AudioStream_Start(void);
+
+/**
+ * @brief  Stop sending blocks (the baud rate is kept)
+ */
+void AudioStream_Stop(void);
+
+/**
+ * @brief  Compress one DMA block and queue it, called from the RX callbacks
+ * @param  block: timeline position of the block
+ * @param  samples: 18-bit samples
+ * @param  n: number of samples
+ */
+void AudioStream_PushBlock(const AudioBlock* block, const int32_t* samples, uint32_t n);
+
+/**
+ * @brief  Compress one block into a complete frame: header, payload and CRC
+ * @param  frame: AUDIO_STREAM_MAX_FRAME(n) bytes
+ * @return Frame size in bytes
+ * @note   Portable (audio_stream_frame.cpp), Tools/kernel_bench times it as part of rx_block
+ */
+uint32_t AudioStream_BuildFrame(const AudioBlock* block, const int32_t* samples, uint32_t n, uint8_t* frame);
+
+/**
+ * @brief  Get a copy of the stream counters
+ */
+void AudioStream_GetStats(AudioStreamStats* stats);
+
+/**
+ * @brief  Print compression ratio, encoder CPU load and dropped frames
+ */
+void AudioStream_PrintStats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AUDIO_STREAM_H */
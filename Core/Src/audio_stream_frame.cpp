@@ -0,0 +1,30 @@
+// Audio capture stream framing
+// Portable, shared between the firmware (audio_stream.cpp) and Tools/kernel_bench.
+
+#include "audio_stream.h"
+#include "audio_codec.h"
+
+static inline void putLe16(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+extern "C" {
+
+uint32_t AudioStream_BuildFrame(const AudioBlock* block, const int32_t* samples, uint32_t n, uint8_t* frame) {
+    uint32_t payload = AudioCodec_Encode(samples, n, &frame[AUDIO_STREAM_HEADER_SIZE]);
+
+    frame[0] = AUDIO_STREAM_SYNC0;
+    frame[1] = AUDIO_STREAM_SYNC1;
+    frame[2] = AUDIO_STREAM_VERSION;
+    frame[3] = block->lostBefore ? AUDIO_STREAM_FLAG_GAP : 0;
+    putLe16(&frame[4], n);
+    putLe16(&frame[6], payload);
+    putLe16(&frame[8], block->sequence);
+    putLe16(&frame[10], block->sequence >> 16);
+    uint32_t size = AUDIO_STREAM_HEADER_SIZE + payload;
+    putLe16(&frame[size], AudioCodec_Crc16(&frame[2], size - 2, 0xFFFF));
+    return size + 2;
+}
+
+} // extern "C"
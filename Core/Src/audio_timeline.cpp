@@ -0,0 +1,106 @@
+// Audio timeline
+// Written only from the I2S DMA callbacks. Readers in lower priority contexts retry until the
+// block sequence did not change while they copied the 64-bit counter.
+
+#include "audio_timeline.h"
+#include "main.h"
+#include "timer.h"
+#include "deferred_log.h"
+
+// TIMELINE STATE (written by the RX callbacks only)
+static volatile uint64_t nextSample = 0;
+static volatile uint32_t nextSequence = 0;
+static uint32_t blockSamples = PIPELINE.blockSamples;
+static uint32_t blockCycles = 0;      // Block period in CPU cycles
+static uint32_t lastArrival = 0;
+static bool firstBlock = true;
+
+// STATISTICS
+static volatile AudioTimelineStats stats = {};
+
+extern "C" {
+
+void AudioTimeline_Init(uint32_t samplesPerBlock) {
+    blockSamples = samplesPerBlock;
+    blockCycles = (uint32_t)((uint64_t)SystemCoreClock * samplesPerBlock / AUDIO_TIMELINE_SAMPLE_RATE);
+    nextSample = 0;
+    nextSequence = 0;
+    firstBlock = true;
+    stats.blocks = 0;
+    stats.lostBlocks = 0;
+    stats.gaps = 0;
+    stats.maxLatency = 0;
+}
+
+void AudioTimeline_ClockChanged(void) {
+    blockCycles = (uint32_t)((uint64_t)SystemCoreClock * blockSamples / AUDIO_TIMELINE_SAMPLE_RATE);
+    firstBlock = true;
+}
+
+void AudioTimeline_BlockReceived(AudioBlock* block) {
+    uint32_t now = cycleCounterGet();
+    uint32_t lost = 0;
+
+    if (!firstBlock) {
+        // Unsigned difference is wrap-safe for gaps below ~25 s
+        uint32_t elapsed = now - lastArrival;
+        if (elapsed > blockCycles) {
+            uint32_t late = elapsed - blockCycles;
+            if (late > stats.maxLatency) stats.maxLatency = late;
+            // More than half a period late: the other half-buffer was overwritten
+            lost = (late + blockCycles / 2) / blockCycles;
+        }
+    }
+    firstBlock = false;
+    lastArrival = now;
+
+    if (lost) {
+        stats.lostBlocks += lost;
+        stats.gaps++;
+    }
+    stats.blocks++;
+
+    uint64_t first = nextSample + (uint64_t)lost * blockSamples;
+    uint32_t sequence = nextSequence + lost;
+    nextSample = first + blockSamples;
+    nextSequence = sequence + 1;
+
+    if (block) {
+        block->firstSample = first;
+        block->sequence = sequence;
+        block->lostBefore = lost;
+    }
+}
+
+uint64_t AudioTimeline_Now(void) {
+    uint32_t sequence;
+    uint64_t sample;
+    do {
+        sequence = nextSequence;
+        sample = nextSample;
+    } while (sequence != nextSequence);
+    return sample;
+}
+
+void AudioTimeline_GetStats(AudioTimelineStats* out) {
+    uint32_t sequence;
+    do {
+        sequence = nextSequence;
+        out->blocks = stats.blocks;
+        out->lostBlocks = stats.lostBlocks;
+        out->gaps = stats.gaps;
+        out->maxLatency = stats.maxLatency;
+    } while (sequence != nextSequence);
+}
+
+void AudioTimeline_PrintStats(void) {
+    AudioTimelineStats s;
+    AudioTimeline_GetStats(&s);
+    uint64_t now = AudioTimeline_Now();
+    DLOG("[AUDIO] t=%lu ms, blocks: %lu, lost: %lu (%lu samples) in %lu gaps, max latency: %lu us",
+         (unsigned long)AudioTimeline_SamplesToMs(now), (unsigned long)s.blocks,
+         (unsigned long)s.lostBlocks, (unsigned long)(s.lostBlocks * blockSamples),
+         (unsigned long)s.gaps, (unsigned long)(s.maxLatency / (SystemCoreClock / 1000000u)));
+}
+
+} // extern "C"
@@ -0,0 +1,87 @@
+/**
+ * @file    audio_timeline.h
+ * @brief   Sample-accurate 64-bit audio timeline with DMA block loss detection
+ *
+ * Every I2S DMA half-buffer advances a 64-bit sample counter and gets a block sequence number.
+ * The arrival time of each block is taken from the DWT cycle counter; a block that arrives more
+ * than half a block period late means the DMA has overwritten data in between (e.g. while
+ * interrupts were disabled in sendSequence). The missed blocks are counted and skipped on the
+ * timeline, so sample timestamps stay aligned with real time.
+ */
+
+#ifndef AUDIO_TIMELINE_H
+#define AUDIO_TIMELINE_H
+
+#include "pipeline_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define AUDIO_TIMELINE_SAMPLE_RATE  (PIPELINE.sampleRate)
+
+/* One DMA block as seen by the RX callbacks */
+typedef struct {
+    uint64_t firstSample;  /* Timeline index of the first sample in the block */
+    uint32_t sequence;     /* Block number on the timeline, jumps by the number of lost blocks */
+    uint32_t lostBefore;   /* Blocks lost directly before this one */
+} AudioBlock;
+
+typedef struct {
+    uint32_t blocks;       /* Blocks received */
+    uint32_t lostBlocks;   /* Blocks overwritten before they were processed */
+    uint32_t gaps;         /* Number of loss events */
+    uint32_t maxLatency;   /* Largest block arrival delay in cycles (beyond one period) */
+} AudioTimelineStats;
+
+/**
+ * @brief  Reset the timeline
+ * @param  blockSamples: samples per DMA half-buffer
+ * @note   Call before starting the I2S DMA, the DWT cycle counter (cycleCounterInit)
+ *         must run before the first block arrives
+ */
+void AudioTimeline_Init(uint32_t blockSamples);
+
+/**
+ * @brief  Recompute the block period after a core clock change (clock_governor.h)
+ * @note   Call with interrupts disabled; the next block only re-arms the loss check, its interval
+ *         straddles two clock rates
+ */
+void AudioTimeline_ClockChanged(void);
+
+/**
+ * @brief  Account one DMA half-buffer, call first thing in each RX callback
+ * @param  block: filled with the timestamp of the block, may be NULL
+ */
+void AudioTimeline_BlockReceived(AudioBlock* block);
+
+/**
+ * @brief  Timeline index of the next sample to be received (safe from any context)
+ */
+uint64_t AudioTimeline_Now(void);
+
+/**
+ * @brief  Convert a sample count to milliseconds
+ */
+static inline uint32_t AudioTimeline_SamplesToMs(uint64_t samples) {
+    return (uint32_t)(samples * 1000u / AUDIO_TIMELINE_SAMPLE_RATE);
+}
+
+/**
+ * @brief  Get a copy of the loss counters
+ */
+void AudioTimeline_GetStats(AudioTimelineStats* stats);
+
+/**
+ * @brief  Print timeline position and loss counters
+ */
+void AudioTimeline_PrintStats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AUDIO_TIMELINE_H */
@@ -0,0 +1,202 @@
+// Benchmark mode
+// Runs in thread context before the audio starts, the recording buffer is free as scratch.
+
+#include "benchmark.h"
+#include "main.h"
+#include "timer.h"
+#include "audio_processing.h"
+#include "kernel_bench.h"
+#include "pipeline_config.h"
+#include "feature_extraction.h"
+#include "kws.h"
+#include "dma_copy.h"
+#include "uart_dma.h"
+#include "led_array.h"
+#include <stdio.h>
+#include <string.h>
+
+static const uint32_t VECTOR_SAMPLES = PIPELINE.recordingSamples;
+static const uint32_t COPY_BYTES = 16384;
+static const uint32_t CCM_COPY_BYTES = 8192;
+static const uint32_t FLASH_READ_BYTES = 32768;
+static_assert(KERNEL_BENCH_SCRATCH_BYTES <= VECTOR_SAMPLES * sizeof(int32_t), "scratch must fit the recording buffer");
+static_assert(2 * COPY_BYTES <= VECTOR_SAMPLES * sizeof(int32_t), "copy buffers must fit the recording buffer");
+
+// Destination of the CCM copy, CPU only: CCM RAM, not loaded, not cleared
+static uint8_t ccmBuffer[CCM_COPY_BYTES] __attribute__((section(".ccmbss"), aligned(4)));
+
+// STATE
+static uint32_t overBudget = 0;
+
+struct Result {
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+    uint32_t runs;
+};
+
+static void resultAdd(Result& r, uint32_t cycles) {
+    if (r.runs == 0 || cycles < r.min) r.min = cycles;
+    if (cycles > r.max) r.max = cycles;
+    r.sum += cycles;
+    r.runs++;
+}
+
+static void report(const char* name, const char* unit, uint32_t items, uint32_t budget, const Result& r) {
+    if (r.runs == 0) return;
+    uint32_t hclkMhz = SystemCoreClock / 1000000u;
+    uint32_t perItemMilli = (uint32_t)((uint64_t)r.min * 1000u / items);
+    printf("[BENCH] kernel=%s unit=%s items=%lu min=%lu mean=%lu max=%lu per_item=%lu.%03lu us=%lu",
+           name, unit, (unsigned long)items, (unsigned long)r.min, (unsigned long)(r.sum / r.runs),
+           (unsigned long)r.max, (unsigned long)(perItemMilli / 1000), (unsigned long)(perItemMilli % 1000),
+           (unsigned long)(r.min / hclkMhz));
+    if (!strcmp(unit, "byte")) {
+        // bytes / (cycles / HCLK), in MB/s
+        printf(" mb_s=%lu", (unsigned long)((uint64_t)items * hclkMhz / r.min));
+    }
+    if (budget) {
+        bool over = r.min > budget;
+        if (over) overBudget++;
+        printf(" budget=%lu status=%s", (unsigned long)budget, over ? "over" : "ok");
+    }
+    printf("\r\n");
+}
+
+// SHARED KERNELS (kernel_bench.h)
+
+static void runKernels(void* scratch) {
+    KernelBench_Setup(scratch);
+    uint32_t count;
+    const KernelBenchKernel* kernels = KernelBench_Kernels(&count);
+    for (uint32_t k = 0; k < count; k++) {
+        Result r = {};
+        for (uint32_t run = 0; run < BENCHMARK_RUNS; run++) {
+            uint32_t start = cycleCounterGet();
+            kernels[k].run();
+            resultAdd(r, cycleCounterGet() - start);
+        }
+        report(kernels[k].name, kernels[k].unit, kernels[k].items, kernels[k].budgetCycles, r);
+    }
+}
+
+static uint32_t runRfBit(void) {
+    // sendSequence: every bit is transmit(1, 3) followed by transmit(1, 3) or transmit(3, 1)
+    uint32_t start = cycleCounterGet();
+    delayMicroseconds(350);
+    delayMicroseconds(3 * 350);
+    delayMicroseconds(350);
+    delayMicroseconds(3 * 350);
+    return cycleCounterGet() - start;
+}
+
+// BANDWIDTH (trashes the buffer)
+
+static void runBandwidth(uint8_t* buffer) {
+    Result sram = {}, dma = {}, ccm = {}, flash = {};
+    for (uint32_t run = 0; run < BENCHMARK_RUNS; run++) {
+        uint32_t start = cycleCounterGet();
+        memcpy(buffer + COPY_BYTES, buffer, COPY_BYTES);
+        resultAdd(sram, cycleCounterGet() - start);
+
+        start = cycleCounterGet();
+        DmaCopy_Copy(buffer + COPY_BYTES, buffer, COPY_BYTES, nullptr, nullptr);
+        DmaCopy_Wait();
+        resultAdd(dma, cycleCounterGet() - start);
+
+        start = cycleCounterGet();
+        memcpy(ccmBuffer, buffer, CCM_COPY_BYTES);
+        resultAdd(ccm, cycleCounterGet() - start);
+
+        // Sequential word reads from the start of the image, through the ART accelerator
+        const volatile uint32_t* words = reinterpret_cast<const volatile uint32_t*>(FLASH_BASE);
+        uint32_t sum = 0;
+        start = cycleCounterGet();
+        for (uint32_t i = 0; i < FLASH_READ_BYTES / 4; i += 4) {
+            sum += words[i] + words[i + 1] + words[i + 2] + words[i + 3];
+        }
+        resultAdd(flash, cycleCounterGet() - start);
+        __asm__ volatile("" : : "r"(sum));  // Keep the reads
+    }
+    report("sram_copy", "byte", COPY_BYTES, 0, sram);
+    report("dma_copy", "byte", COPY_BYTES, 0, dma);
+    report("ccm_copy", "byte", CCM_COPY_BYTES, 0, ccm);
+    report("flash_read", "byte", FLASH_READ_BYTES, 0, flash);
+}
+
+// KEYWORD SPOTTING (one recording per run, then the network layer by layer)
+
+static void runKws(const int32_t* vector) {
+    Result features = {}, network = {}, decision = {};
+    uint32_t layerCount;
+    const KernelBenchLayer* layers = KernelBench_Layers(&layerCount);
+    Result layerResults[KWS_MAX_LAYER_ID] = {};
+    if (layerCount > KWS_MAX_LAYER_ID) layerCount = KWS_MAX_LAYER_ID;
+
+    for (uint32_t run = 0; run < BENCHMARK_RUNS; run++) {
+        KwsStageCycles cycles;
+        uint32_t layerCycles[KWS_MAX_LAYER_ID];
+        if (!Kws_ProfileStages(vector, &cycles)) {
+            printf("[BENCH] error=network\r\n");
+            return;
+        }
+        if (!Kws_ProfileLayers(vector, layerCycles)) {
+            printf("[BENCH] error=network\r\n");
+            return;
+        }
+        resultAdd(features, cycles.features);
+        resultAdd(network, cycles.network);
+        resultAdd(decision, cycles.decision);
+        for (uint32_t i = 0; i < layerCount; i++) {
+            if (layers[i].layerId < KWS_MAX_LAYER_ID) resultAdd(layerResults[i], layerCycles[layers[i].layerId]);
+        }
+    }
+    report("features", "frame", FEATURES_NUM_FRAMES, 0, features);
+    report("network", "window", 1, 0, network);
+    report("decision", "window", 1, 0, decision);
+    for (uint32_t i = 0; i < layerCount; i++) {
+        report(layers[i].name, "macc", layers[i].macc, layers[i].budgetCycles, layerResults[i]);
+    }
+}
+
+static void printHeader(void) {
+    const uint32_t* uid = reinterpret_cast<const uint32_t*>(UID_BASE);
+    printf("\r\n[BENCH] format=%d build=\"%s %s\" device=0x%03lx revision=0x%04lx uid=%08lx%08lx%08lx "
+           "hclk=%lu flash_acr=0x%08lx runs=%d\r\n",
+           BENCHMARK_FORMAT, __DATE__, __TIME__, (unsigned long)(DBGMCU->IDCODE & 0xFFFu),
+           (unsigned long)(DBGMCU->IDCODE >> 16), (unsigned long)uid[2], (unsigned long)uid[1],
+           (unsigned long)uid[0], (unsigned long)SystemCoreClock, (unsigned long)FLASH->ACR, BENCHMARK_RUNS);
+}
+
+extern "C" {
+
+bool Benchmark_Requested(void) {
+    return HAL_GPIO_ReadPin(USER_Btn_GPIO_Port, USER_Btn_Pin) == GPIO_PIN_SET;
+}
+
+void Benchmark_Run(void) {
+    cycleCounterInit();
+    led_func(0);
+    printHeader();
+
+    int32_t* recording = AudioProcessing_GetRecordedData();
+    runBandwidth(reinterpret_cast<uint8_t*>(recording));
+    runKernels(recording);
+
+    Result rf = {};
+    for (uint32_t run = 0; run < BENCHMARK_RUNS; run++) resultAdd(rf, runRfBit());
+    report("rf_bit", "bit", 1, 0, rf);
+
+    KernelBench_TestVector(recording, 0, VECTOR_SAMPLES);
+    runKws(recording);
+
+    printf("[BENCH] done over=%lu\r\n", (unsigned long)overBudget);
+    UartDma_Drain();
+
+    // Reset to leave: all LEDs on as long as the benchmark mode holds the board
+    led_func(10);
+    while (1) {
+        __WFI();
+    }
+}
+
+} // extern "C"
@@ -0,0 +1,59 @@
+/**
+ * @file    benchmark.h
+ * @brief   On-target benchmark mode, selected by holding USER_Btn (PC13) during reset
+ *
+ * my_main checks the button after the audio and KWS init, before the I2S DMA starts. If it is
+ * held, every kernel runs BENCHMARK_RUNS times on fixed test vectors (kernel_bench.h, the same
+ * on every board and on the host) and the report goes to USART3. The application does not
+ * start; reset without the button to leave the mode.
+ *
+ * Nothing else runs meanwhile (no I2S, Ethernet or USB, the clock governor is not started), so
+ * the numbers depend only on firmware and hardware. Cycles come from the DWT cycle counter at
+ * full HCLK; min is the figure to compare, max shows SysTick / UART interrupts hitting a run.
+ *
+ * Report, one record per line, key=value fields (grep "^\[BENCH\]"):
+ *   [BENCH] format=2 build="<date time>" device=0x<id> revision=0x<rev> uid=<hex> hclk=<Hz>
+ *           flash_acr=0x<ACR> runs=<N>
+ *   [BENCH] kernel=<name> unit=<unit> items=<per run> min=<cycles> mean=<cycles> max=<cycles>
+ *           per_item=<min cycles / items> us=<min microseconds per run>
+ *           [budget=<cycles> status=ok|over]   (kernels with a budget, see kernel_bench.h)
+ *   [BENCH] done over=<kernels over budget>
+ * Kernels in order: memory bandwidth (unit=byte, adds mb_s=<MB/s at min>), the shared DSP
+ * kernels, the RF bit, the KWS stages and the network layers (unit=macc).
+ * The RF kernel replays the delays of one encoded bit (sendSequence) without driving the
+ * transmitter, a frame is 10 x 12 bits plus sync.
+ */
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+
+/* Runs per kernel */
+#ifndef BENCHMARK_RUNS
+#define BENCHMARK_RUNS  20
+#endif
+
+/* Report format, bump when fields change meaning */
+#define BENCHMARK_FORMAT  2
+
+/**
+ * @brief  true if USER_Btn is held
+ */
+bool Benchmark_Requested(void);
+
+/**
+ * @brief  Run all kernels, print the report and stop
+ * @note   After AudioProcessing_Init and Kws_Init, before the I2S DMA starts; does not return
+ */
+void Benchmark_Run(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BENCHMARK_H */
@@ -0,0 +1,115 @@
+// Block statistics
+// Written by the RX callbacks only, read through the sequence lock (see block_stats.h).
+
+#include "block_stats.h"
+#include "pipeline_config.h"
+#include "main.h"
+
+// STATE (written by the RX callbacks only)
+static BlockStats published = {};
+static volatile uint32_t sequenceLock = 0;  // Odd while the record is written
+static int32_t previousMean = 0;
+static bool havePrevious = false;
+
+// Running sums of one pass
+struct Accumulator {
+    int32_t sum;
+    int64_t sumSquares;
+    uint32_t peak;
+    uint32_t absSum;
+    uint32_t crossings;
+    uint32_t clipped;
+    int32_t sign;           // Of the last sample against the reference, 0 or -1
+};
+
+// Branch-free: SMLAL for the squares, sign masks for abs and crossings
+static inline void accumulate(Accumulator& a, int32_t x, int32_t reference) {
+    a.sum += x;
+    a.sumSquares += (int64_t)x * x;
+    int32_t d = x - reference;
+    int32_t sign = d >> 31;
+    uint32_t magnitude = (uint32_t)((d ^ sign) - sign);
+    a.absSum += magnitude;
+    a.peak = magnitude > a.peak ? magnitude : a.peak;
+    a.crossings += (uint32_t)(sign ^ a.sign) & 1u;
+    a.sign = sign;
+    a.clipped += (uint32_t)(x >= BLOCK_STATS_CLIP_HIGH) + (uint32_t)(x <= BLOCK_STATS_CLIP_LOW);
+}
+
+// One pass over n samples, Count is uint32_t or BlockCount (constant bounds, see pipeline_config.h)
+template <typename Count>
+static void compute(const int32_t* samples, Count n, int32_t reference, BlockStats* stats) {
+    *stats = BlockStats();
+    if (n == 0) return;
+
+    // 18-bit input: the sums fit 32 bit for n < 16384
+    Accumulator a = {};
+    a.sign = (samples[0] - reference) >> 31;
+    uint32_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        accumulate(a, samples[i], reference);
+        accumulate(a, samples[i + 1], reference);
+        accumulate(a, samples[i + 2], reference);
+        accumulate(a, samples[i + 3], reference);
+    }
+    for (; i < n; i++) accumulate(a, samples[i], reference);
+
+    stats->n = n;
+    stats->dc = a.sum / (int32_t)n;
+    stats->peak = a.peak;
+    stats->meanAbs = a.absSum / n;
+    stats->energy = (uint64_t)(a.sumSquares - (int64_t)a.sum * a.sum / (int64_t)n);
+    stats->zeroCrossings = a.crossings;
+    stats->clipped = a.clipped;
+}
+
+extern "C" {
+
+void BlockStats_Compute(const int32_t* samples, uint32_t n, int32_t reference, BlockStats* stats) {
+    if (n == PIPELINE.blockSamples) {
+        compute(samples, BlockCount(), reference, stats);
+    } else {
+        compute(samples, n, reference, stats);
+    }
+}
+
+void BlockStats_Init(void) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    sequenceLock += 2;  // Readers in flight retry
+    published = BlockStats();
+    previousMean = 0;
+    havePrevious = false;
+    __set_PRIMASK(primask);
+}
+
+void BlockStats_Update(const int32_t* samples, uint32_t n, uint32_t sequence, BlockStats* stats) {
+    BlockStats s;
+    // The first block has no previous mean, its own first sample stands in
+    BlockStats_Compute(samples, n, havePrevious ? previousMean : (n ? samples[0] : 0), &s);
+    s.sequence = sequence;
+    previousMean = s.dc;
+    havePrevious = true;
+
+    sequenceLock++;
+    __DMB();
+    published = s;
+    __DMB();
+    sequenceLock++;
+
+    if (stats) *stats = s;
+}
+
+bool BlockStats_Get(BlockStats* stats) {
+    uint32_t before, after;
+    do {
+        before = sequenceLock;
+        __DMB();
+        *stats = published;
+        __DMB();
+        after = sequenceLock;
+    } while ((before & 1u) || before != after);
+    return stats->n != 0;
+}
+
+} // extern "C"
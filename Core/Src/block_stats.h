@@ -0,0 +1,74 @@
+/**
+ * @file    block_stats.h
+ * @brief   Per-block statistics of the microphone signal, one pass in the RX callbacks
+ *
+ * The RX callbacks hand every merged 18-bit block (before AGC) to BlockStats_Update, which
+ * computes all statistics in a single unrolled pass and publishes them. Readers take a copy with
+ * BlockStats_Get instead of scanning mergedFrame, which the next callback overwrites.
+ *
+ * A single pass cannot know the block's mean before the end, so peak, mean absolute value and
+ * zero crossings are taken against the previous block's mean (the microphone DC moves by a few
+ * units per block once settled). The energy is exact: sum of squares minus the mean's share.
+ *
+ * Publication is a sequence lock: the writer makes the sequence odd, copies the record and makes
+ * it even again; a reader retries if the sequence was odd or changed during its copy. The writer
+ * never waits and readers never mask interrupts. Readers must run at a lower priority than the
+ * I2S interrupt (main loop), else a reader that preempted the writer would spin.
+ */
+
+#ifndef BLOCK_STATS_H
+#define BLOCK_STATS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* 18-bit samples at or beyond these count as clipped */
+#define BLOCK_STATS_CLIP_HIGH   131071
+#define BLOCK_STATS_CLIP_LOW   (-131072)
+
+typedef struct {
+    uint32_t sequence;       /* Block number on the audio timeline (audio_timeline.h) */
+    uint32_t n;              /* Samples */
+    int32_t dc;              /* Mean of this block */
+    uint32_t peak;           /* Largest |x - previous mean| */
+    uint32_t meanAbs;        /* Mean |x - previous mean| */
+    uint64_t energy;         /* Sum of (x - dc)^2 */
+    uint32_t zeroCrossings;  /* Sign changes of x - previous mean */
+    uint32_t clipped;        /* Samples at the 18-bit limits */
+} BlockStats;
+
+/**
+ * @brief  Forget the published record and the previous mean
+ * @note   Call before the I2S DMA starts
+ */
+void BlockStats_Init(void);
+
+/**
+ * @brief  Compute the statistics of one block and publish them
+ * @param  stats: receives the record (may be NULL)
+ * @note   Called from the I2S RX callbacks only
+ */
+void BlockStats_Update(const int32_t* samples, uint32_t n, uint32_t sequence, BlockStats* stats);
+
+/**
+ * @brief  Compute the statistics of a block, reference for peak / mean absolute / zero crossings
+ * @note   Pure, any context
+ */
+void BlockStats_Compute(const int32_t* samples, uint32_t n, int32_t reference, BlockStats* stats);
+
+/**
+ * @brief  Copy of the latest record, lock-free
+ * @return false if no block was published yet
+ * @note   Not from contexts that can preempt the I2S interrupt
+ */
+bool BlockStats_Get(BlockStats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BLOCK_STATS_H */
@@ -0,0 +1,85 @@
+// Boot profiler
+// Marks are only written from thread context during boot, no locking.
+
+#include "boot_profile.h"
+#include "main.h"
+#include "deferred_log.h"
+
+struct BootMark {
+    const char* stage;
+    uint32_t durationUs;
+    uint32_t endUs;
+};
+
+// STATE
+static BootMark marks[BOOT_PROFILE_MAX_MARKS];
+static uint32_t markCount = 0;
+static uint32_t lastCycles = 0;
+static uint32_t lastClockHz = 0;
+static uint32_t elapsedUs = 0;
+static BootResetCause resetCause = BOOT_RESET_UNKNOWN;
+
+static const char* const RESET_NAMES[] = {
+    "unknown", "power-on", "brownout", "reset pin", "software", "independent watchdog",
+    "window watchdog", "low-power"
+};
+
+static BootResetCause readResetCause(void) {
+    // POR also sets BORRSTF and PINRSTF, every reset sets PINRSTF: most specific first
+    if (__HAL_RCC_GET_FLAG(RCC_FLAG_LPWRRST)) return BOOT_RESET_LOW_POWER;
+    if (__HAL_RCC_GET_FLAG(RCC_FLAG_WWDGRST)) return BOOT_RESET_WINDOW_WATCHDOG;
+    if (__HAL_RCC_GET_FLAG(RCC_FLAG_IWDGRST)) return BOOT_RESET_INDEPENDENT_WATCHDOG;
+    if (__HAL_RCC_GET_FLAG(RCC_FLAG_SFTRST)) return BOOT_RESET_SOFTWARE;
+    if (__HAL_RCC_GET_FLAG(RCC_FLAG_PORRST)) return BOOT_RESET_POWER_ON;
+    if (__HAL_RCC_GET_FLAG(RCC_FLAG_BORRST)) return BOOT_RESET_BROWNOUT;
+    if (__HAL_RCC_GET_FLAG(RCC_FLAG_PINRST)) return BOOT_RESET_PIN;
+    return BOOT_RESET_UNKNOWN;
+}
+
+extern "C" {
+
+void BootProfile_Start(void) {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    resetCause = readResetCause();
+    __HAL_RCC_CLEAR_RESET_FLAGS();
+
+    markCount = 0;
+    lastCycles = 0;
+    lastClockHz = SystemCoreClock;
+    elapsedUs = 0;
+}
+
+void BootProfile_Mark(const char* stage) {
+    uint32_t now = DWT->CYCCNT;
+    uint32_t durationUs = (uint32_t)((uint64_t)(now - lastCycles) * 1000000u / lastClockHz);
+    lastCycles = now;
+    lastClockHz = SystemCoreClock;
+    elapsedUs += durationUs;
+
+    if (markCount >= BOOT_PROFILE_MAX_MARKS) return;
+    marks[markCount].stage = stage;
+    marks[markCount].durationUs = durationUs;
+    marks[markCount].endUs = elapsedUs;
+    markCount++;
+}
+
+uint32_t BootProfile_ElapsedUs(void) {
+    return elapsedUs;
+}
+
+BootResetCause BootProfile_ResetCause(void) {
+    return resetCause;
+}
+
+void BootProfile_Print(void) {
+    DLOG("[BOOT] Reset cause: %s, %lu stages", RESET_NAMES[resetCause], (unsigned long)markCount);
+    for (uint32_t i = 0; i < markCount; i++) {
+        DLOG("[BOOT] %-24s %8lu us  (at %8lu us)", marks[i].stage, (unsigned long)marks[i].durationUs,
+             (unsigned long)marks[i].endUs);
+    }
+}
+
+} // extern "C"
@@ -0,0 +1,69 @@
+/**
+ * @file    boot_profile.h
+ * @brief   Boot timeline from DWT cycle counter marks
+ *
+ * BootProfile_Start runs first thing in main() (USER CODE 1): it enables the cycle counter and
+ * latches the reset cause. Every BootProfile_Mark closes the stage that ends there, e.g. the
+ * USER CODE blocks after HAL_Init, SystemClock_Config and each MX_*_Init, then the stages of
+ * my_main. BootProfile_Print lists the stages once the device is listening.
+ *
+ * Cycles are converted with the core clock in effect when the stage began (16 MHz HSI until
+ * SystemClock_Config), so the clock setup stage itself is an upper bound. The startup code before
+ * main() (.data/.bss init) is not covered.
+ */
+
+#ifndef BOOT_PROFILE_H
+#define BOOT_PROFILE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#define BOOT_PROFILE_MAX_MARKS  24
+
+typedef enum {
+    BOOT_RESET_UNKNOWN = 0,
+    BOOT_RESET_POWER_ON,
+    BOOT_RESET_BROWNOUT,
+    BOOT_RESET_PIN,
+    BOOT_RESET_SOFTWARE,
+    BOOT_RESET_INDEPENDENT_WATCHDOG,
+    BOOT_RESET_WINDOW_WATCHDOG,
+    BOOT_RESET_LOW_POWER
+} BootResetCause;
+
+/**
+ * @brief  Enable the DWT cycle counter, latch and clear the RCC reset flags
+ * @note   Call first in main(), before HAL_Init
+ */
+void BootProfile_Start(void);
+
+/**
+ * @brief  End the current stage
+ * @param  stage: name of the stage that just finished (string literal, kept by pointer)
+ * @note   Marks beyond BOOT_PROFILE_MAX_MARKS are dropped
+ */
+void BootProfile_Mark(const char* stage);
+
+/**
+ * @brief  Microseconds since BootProfile_Start up to the last mark
+ */
+uint32_t BootProfile_ElapsedUs(void);
+
+/**
+ * @brief  Cause of the last reset
+ */
+BootResetCause BootProfile_ResetCause(void);
+
+/**
+ * @brief  Print the reset cause and one line per stage (duration and time since start)
+ */
+void BootProfile_Print(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BOOT_PROFILE_H */
@@ -0,0 +1,209 @@
+// Clock governor
+// Switches run in the main loop; Governor_Boost only sets a flag and may come from an ISR.
+
+#include "clock_governor.h"
+#include "main.h"
+#include "audio_timeline.h"
+#include "uart_dma.h"
+#include "trace.h"
+#include "deferred_log.h"
+
+static_assert(GOVERNOR_LOW_HCLK_DIV == 2 || GOVERNOR_LOW_HCLK_DIV == 4 || GOVERNOR_LOW_HCLK_DIV == 8,
+              "GOVERNOR_LOW_HCLK_DIV must be 2, 4 or 8");
+
+extern TIM_HandleTypeDef htim4;
+
+// LEVELS (AHB prescaler, APB1 / APB2 dividers; APB1 <= 42 MHz, APB2 <= 84 MHz)
+struct ClockSetting {
+    uint32_t ahb;
+    uint32_t apb1;
+    uint32_t apb2;
+};
+
+static const ClockSetting SETTINGS[2] = {
+#if GOVERNOR_LOW_HCLK_DIV == 2
+    {RCC_SYSCLK_DIV2, RCC_HCLK_DIV2, RCC_HCLK_DIV1},  // 84 / 42 / 84 MHz
+#elif GOVERNOR_LOW_HCLK_DIV == 4
+    {RCC_SYSCLK_DIV4, RCC_HCLK_DIV1, RCC_HCLK_DIV1},  // 42 / 42 / 42 MHz
+#else
+    {RCC_SYSCLK_DIV8, RCC_HCLK_DIV1, RCC_HCLK_DIV1},  // 21 / 21 / 21 MHz
+#endif
+    {RCC_SYSCLK_DIV1, RCC_HCLK_DIV4, RCC_HCLK_DIV2},  // 168 / 42 / 84 MHz, as SystemClock_Config
+};
+
+// STATE
+static GovernorLevel level = GOVERNOR_HIGH;
+static volatile bool boostRequested = false;
+static volatile uint32_t boostRequestCycles = 0;
+static uint32_t lastAccountCycles = 0;
+static uint32_t lastActivity = 0;            // HAL tick
+static uint64_t stretchLowUs = 0;            // Time per level when the current stretch began
+static uint64_t stretchHighUs = 0;
+static GovernorStats stats = {};
+
+static uint32_t modelMicroamps(uint32_t hz) {
+    return GOVERNOR_BASE_UA + GOVERNOR_UA_PER_MHZ * (hz / 1000000u);
+}
+
+// Two fixed clocks: the energy follows from the time at each level (uA x mV x us = 1e-9 uJ)
+static uint64_t energyUj(uint64_t lowUs, uint64_t highUs) {
+    return (lowUs * modelMicroamps(stats.lowHz) + highUs * modelMicroamps(stats.highHz)) *
+           GOVERNOR_SUPPLY_MV / 1000000000u;
+}
+
+// Time since the last call at the current level, called often enough that the cycle counter does
+// not wrap (25 s at 168 MHz). Whole microseconds only, the remainder carries over to the next call.
+static void account(void) {
+    uint32_t cyclesPerUs = SystemCoreClock / 1000000u;
+    uint32_t us = (DWT->CYCCNT - lastAccountCycles) / cyclesPerUs;
+    lastAccountCycles += us * cyclesPerUs;
+    if (level == GOVERNOR_HIGH) stats.highUs += us;
+    else stats.lowUs += us;
+}
+
+// Flash wait states for HCLK at 2.7 - 3.6 V: one per started 30 MHz
+static uint32_t flashLatency(uint32_t hclk) {
+    return (hclk - 1) / 30000000u;
+}
+
+// AHB and both APB prescalers in one CFGR write, so the peripherals never run from a mixed
+// setting; with GOVERNOR_LOW_HCLK_DIV 2 or 4 PCLK1 stays at 42 MHz across the switch.
+// (HAL_RCC_ClockConfig sets the APB dividers to /16 first, then HPRE.) Wait states rise before
+// a faster clock and drop after a slower one.
+static void writeClocks(const ClockSetting& s, uint32_t hclk) {
+    uint32_t latency = flashLatency(hclk);
+    bool moreWaitStates = latency > (FLASH->ACR & FLASH_ACR_LATENCY);
+    if (moreWaitStates) {
+        MODIFY_REG(FLASH->ACR, FLASH_ACR_LATENCY, latency);
+        while ((FLASH->ACR & FLASH_ACR_LATENCY) != latency) {
+        }
+    }
+    MODIFY_REG(RCC->CFGR, RCC_CFGR_HPRE | RCC_CFGR_PPRE1 | RCC_CFGR_PPRE2, s.ahb | s.apb1 | (s.apb2 << 3));
+    if (!moreWaitStates) MODIFY_REG(FLASH->ACR, FLASH_ACR_LATENCY, latency);
+
+    SystemCoreClock = hclk;
+    HAL_InitTick(uwTickPrio);
+}
+
+static void setLevel(GovernorLevel next) {
+    if (next == level) return;
+    account();
+
+    const ClockSetting& s = SETTINGS[next];
+    uint32_t sysclk = HAL_RCC_GetSysClockFreq();
+    uint32_t hclk = sysclk >> AHBPrescTable[(s.ahb & RCC_CFGR_HPRE) >> RCC_CFGR_HPRE_Pos];
+    uint32_t pclk1 = hclk >> APBPrescTable[(s.apb1 & RCC_CFGR_PPRE1) >> RCC_CFGR_PPRE1_Pos];
+    uint32_t oldHz = SystemCoreClock;
+
+    // USART3 runs from PCLK1: a byte on the wire when it changes would go out at the wrong rate
+    if (pclk1 != HAL_RCC_GetPCLK1Freq()) UartDma_Drain();
+
+    uint32_t start = DWT->CYCCNT;
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    writeClocks(s, hclk);
+    // TIM4 counts microseconds (delayMicroseconds); timer clock is 2 x PCLK1 unless APB1 is /1
+    uint32_t timerHz = HAL_RCC_GetPCLK1Freq() * (s.apb1 == RCC_HCLK_DIV1 ? 1u : 2u);
+    htim4.Init.Prescaler = timerHz / 1000000u - 1;
+    htim4.Instance->PSC = htim4.Init.Prescaler;
+    htim4.Instance->EGR = TIM_EGR_UG;
+    AudioTimeline_ClockChanged();
+    level = next;
+    __set_PRIMASK(primask);
+    uint32_t cycles = DWT->CYCCNT - start;
+
+    // Baud register only if PCLK1 changed (the ring was drained above)
+    UartDma_ClockChanged();
+
+    // Cycles ran at both clocks, the slower one gives an upper bound
+    uint32_t slowHz = oldHz < SystemCoreClock ? oldHz : SystemCoreClock;
+    stats.lastSwitchUs = (uint32_t)((uint64_t)cycles * 1000000u / slowHz);
+    if (stats.lastSwitchUs > stats.maxSwitchUs) stats.maxSwitchUs = stats.lastSwitchUs;
+    stats.switches++;
+    lastAccountCycles = DWT->CYCCNT;
+    TRACE_INSTANT(CLOCK_SWITCH, ((oldHz / 1000000u) << 8) | (SystemCoreClock / 1000000u));
+}
+
+extern "C" {
+
+void Governor_Init(void) {
+    stats = GovernorStats();
+    stats.highHz = HAL_RCC_GetSysClockFreq();
+#if GOVERNOR_ENABLED
+    stats.lowHz = stats.highHz / GOVERNOR_LOW_HCLK_DIV;
+#else
+    stats.lowHz = stats.highHz;
+#endif
+    boostRequested = false;
+    lastAccountCycles = DWT->CYCCNT;
+    lastActivity = HAL_GetTick();
+#if GOVERNOR_ENABLED
+    setLevel(GOVERNOR_LOW);
+#else
+    level = GOVERNOR_LOW;
+#endif
+}
+
+void Governor_Boost(void) {
+    if (!boostRequested) boostRequestCycles = DWT->CYCCNT;
+    boostRequested = true;
+}
+
+void Governor_Poll(bool busy) {
+    uint32_t now = HAL_GetTick();
+    if (busy || boostRequested) lastActivity = now;
+
+    if (boostRequested && level == GOVERNOR_LOW) {
+        uint32_t waitCycles = DWT->CYCCNT - boostRequestCycles;
+        uint32_t waitUs = (uint32_t)((uint64_t)waitCycles * 1000000u / SystemCoreClock);
+#if GOVERNOR_ENABLED
+        setLevel(GOVERNOR_HIGH);
+#else
+        account();
+        level = GOVERNOR_HIGH;
+#endif
+        stats.lastBoostUs = waitUs + stats.lastSwitchUs;
+        if (stats.lastBoostUs > stats.maxBoostUs) stats.maxBoostUs = stats.lastBoostUs;
+        stretchLowUs = stats.lowUs;
+        stretchHighUs = stats.highUs;
+    }
+    boostRequested = false;
+
+    if (level == GOVERNOR_HIGH && now - lastActivity >= GOVERNOR_HOLD_MS) {
+#if GOVERNOR_ENABLED
+        setLevel(GOVERNOR_LOW);
+#else
+        account();
+        level = GOVERNOR_LOW;
+#endif
+        uint64_t uj = energyUj(stats.lowUs - stretchLowUs, stats.highUs - stretchHighUs);
+        stats.lastDetectionUj = (uint32_t)uj;
+        stats.totalDetectionUj += uj;
+        stats.detections++;
+    }
+    account();
+}
+
+GovernorLevel Governor_Level(void) {
+    return level;
+}
+
+void Governor_GetStats(GovernorStats* out) {
+    *out = stats;
+}
+
+void Governor_PrintStats(void) {
+    GovernorStats s = stats;
+    uint32_t lowUw = (uint32_t)((uint64_t)modelMicroamps(s.lowHz) * GOVERNOR_SUPPLY_MV / 1000u);
+    uint64_t total = s.lowUs + s.highUs;
+    uint32_t highPermille = total ? (uint32_t)(s.highUs * 1000u / total) : 0;
+    DLOG("[GOV] %lu/%lu MHz, %lu switches (last %lu us, max %lu us), boost latency max %lu us",
+         (unsigned long)(s.lowHz / 1000000u), (unsigned long)(s.highHz / 1000000u), (unsigned long)s.switches,
+         (unsigned long)s.lastSwitchUs, (unsigned long)s.maxSwitchUs, (unsigned long)s.maxBoostUs);
+    DLOG("[GOV] full speed %lu.%lu %% of the time, listening ~%lu mW, detection ~%lu uJ (avg %lu uJ over %lu)",
+         (unsigned long)(highPermille / 10u), (unsigned long)(highPermille % 10u),
+         (unsigned long)(lowUw / 1000u), (unsigned long)s.lastDetectionUj,
+         (unsigned long)(s.detections ? s.totalDetectionUj / s.detections : 0), (unsigned long)s.detections);
+}
+
+} // extern "C"
@@ -0,0 +1,114 @@
+/**
+ * @file    clock_governor.h
+ * @brief   Core clock governor: reduced HCLK while listening, full speed for inference
+ *
+ * Listening needs a few percent of the CPU, the I2S clock comes from PLLI2S and the 48 MHz USB
+ * clock from PLLQ. So the main PLL keeps running at 168 MHz and only the AHB prescaler changes:
+ *   GOVERNOR_HIGH   HCLK 168 MHz, APB1 /4 (42 MHz), APB2 /2 (84 MHz), 5 flash wait states
+ *   GOVERNOR_LOW    HCLK 168 / GOVERNOR_LOW_HCLK_DIV, APB dividers lowered to keep APB1 near
+ *                   42 MHz, wait states for the lower clock
+ * No PLL relock, so a switch takes a few microseconds. AHB and APB prescalers change in one
+ * RCC->CFGR write, with the flash latency raised before and lowered after it (not
+ * HAL_RCC_ClockConfig, which passes through APB /16 and would garble a UART byte in flight).
+ * The governor reloads SysTick and recomputes the TIM4 prescaler (1 us ticks), the UART baud
+ * register (only when PCLK1 changed, the UART is drained before such a switch) and the audio
+ * timeline's block period, and records a CLOCK_SWITCH trace event so Tools/trace_convert can
+ * rescale cycles.
+ *
+ * Policy: Governor_Boost (trigger fired, any context) requests full speed, the main loop applies
+ * it in Governor_Poll. The clock drops again once nothing is busy (recording, inference) for
+ * GOVERNOR_HOLD_MS.
+ *
+ * Energy is estimated from a linear current model, I = GOVERNOR_BASE_UA + GOVERNOR_UA_PER_MHZ *
+ * f(HCLK) at GOVERNOR_SUPPLY_MV (typical run-mode values from the STM32F429 datasheet, all
+ * peripherals enabled); measure the board supply to calibrate. A detection is one stretch at full
+ * speed, from the boost to the drop back.
+ */
+
+#ifndef CLOCK_GOVERNOR_H
+#define CLOCK_GOVERNOR_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* 0 = stay at full speed, statistics still count */
+#ifndef GOVERNOR_ENABLED
+#define GOVERNOR_ENABLED        1
+#endif
+
+/* HCLK divider while listening: 2, 4 or 8. Ethernet needs HCLK >= 25 MHz, so 8 only without it */
+#ifndef GOVERNOR_LOW_HCLK_DIV
+#define GOVERNOR_LOW_HCLK_DIV   4
+#endif
+
+/* Full speed stays this long after the last activity */
+#define GOVERNOR_HOLD_MS        300
+
+/* Current model */
+#define GOVERNOR_SUPPLY_MV      3300
+#define GOVERNOR_BASE_UA        5000
+#define GOVERNOR_UA_PER_MHZ     520
+
+typedef enum {
+    GOVERNOR_LOW = 0,
+    GOVERNOR_HIGH
+} GovernorLevel;
+
+typedef struct {
+    uint32_t switches;           /* Clock changes */
+    uint32_t lastSwitchUs;       /* Duration of the last / slowest clock change */
+    uint32_t maxSwitchUs;
+    uint32_t lastBoostUs;        /* Boost request -> full speed (main loop response included) */
+    uint32_t maxBoostUs;
+    uint64_t lowUs;              /* Time at each level */
+    uint64_t highUs;
+    uint32_t detections;         /* Full-speed stretches */
+    uint32_t lastDetectionUj;    /* Estimated energy of the last stretch */
+    uint64_t totalDetectionUj;
+    uint32_t lowHz;              /* HCLK at each level */
+    uint32_t highHz;
+} GovernorStats;
+
+/**
+ * @brief  Reset the statistics and drop to the listening clock
+ * @note   Call from the main loop context once the device listens
+ */
+void Governor_Init(void);
+
+/**
+ * @brief  Request full speed (trigger / VAD fired)
+ * @note   Safe from any context, takes effect in the next Governor_Poll
+ */
+void Governor_Boost(void);
+
+/**
+ * @brief  Apply boost requests, drop the clock when idle, update the time accounting
+ * @param  busy: recording or inference pending, keeps full speed
+ * @note   Main loop only
+ */
+void Governor_Poll(bool busy);
+
+/**
+ * @brief  Current level
+ */
+GovernorLevel Governor_Level(void);
+
+/**
+ * @brief  Get a copy of the statistics
+ */
+void Governor_GetStats(GovernorStats* stats);
+
+/**
+ * @brief  Print clock, switch latency, time per level and energy per detection
+ */
+void Governor_PrintStats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CLOCK_GOVERNOR_H */
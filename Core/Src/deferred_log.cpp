@@ -0,0 +1,67 @@
+// Deferred logger
+// Producers (main loop and ISRs) copy a record into the ring with interrupts masked for the
+// few bytes of the copy, the main loop is the only consumer.
+
+#include "deferred_log.h"
+#include "main.h"
+#include "uart_dma.h"
+
+extern UART_HandleTypeDef huart3;
+
+// RING
+static uint8_t ring[DEFERRED_LOG_BUFFER_SIZE];
+static volatile uint32_t head = 0;  // next write position (producers)
+static volatile uint32_t tail = 0;  // next send position (main loop)
+static volatile uint32_t dropped = 0;
+
+extern "C" {
+
+void DeferredLog_Commit(uint16_t id, const uint8_t* payload, uint32_t length) {
+    uint32_t ms = HAL_GetTick();
+    uint8_t header[DEFERRED_LOG_HEADER_SIZE] = {
+        DEFERRED_LOG_SYNC, (uint8_t)length, (uint8_t)id, (uint8_t)(id >> 8),
+        (uint8_t)ms, (uint8_t)(ms >> 8), (uint8_t)(ms >> 16), (uint8_t)(ms >> 24)
+    };
+    uint8_t sum = 0;
+    for (uint32_t i = 1; i < DEFERRED_LOG_HEADER_SIZE; i++) sum += header[i];
+    for (uint32_t i = 0; i < length; i++) sum += payload[i];
+
+    uint32_t total = DEFERRED_LOG_HEADER_SIZE + length + 1;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint32_t h = head;
+    if (DEFERRED_LOG_BUFFER_SIZE - 1 - ((h - tail) % DEFERRED_LOG_BUFFER_SIZE) < total) {
+        dropped = dropped + 1;
+    } else {
+        for (uint32_t i = 0; i < DEFERRED_LOG_HEADER_SIZE; i++) ring[(h + i) % DEFERRED_LOG_BUFFER_SIZE] = header[i];
+        h += DEFERRED_LOG_HEADER_SIZE;
+        for (uint32_t i = 0; i < length; i++) ring[(h + i) % DEFERRED_LOG_BUFFER_SIZE] = payload[i];
+        h += length;
+        ring[h % DEFERRED_LOG_BUFFER_SIZE] = sum;
+        head = (h + 1) % DEFERRED_LOG_BUFFER_SIZE;
+    }
+    __set_PRIMASK(primask);
+}
+
+void DeferredLog_Flush(void) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint32_t count = dropped;
+    dropped = 0;
+    __set_PRIMASK(primask);
+    if (count) {
+        DLOG("[LOG] %lu records dropped", (unsigned long)count);
+    }
+
+    // Send up to the head seen now, in at most two contiguous pieces
+    uint32_t h = head;
+    while (tail != h) {
+        uint32_t end = h > tail ? h : DEFERRED_LOG_BUFFER_SIZE;
+        if (UartDma_IsReady()) UartDma_Write(&ring[tail], end - tail, true);
+        else HAL_UART_Transmit(&huart3, &ring[tail], (uint16_t)(end - tail), HAL_MAX_DELAY);
+        tail = end % DEFERRED_LOG_BUFFER_SIZE;
+    }
+}
+
+} // extern "C"
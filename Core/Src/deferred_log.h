@@ -0,0 +1,135 @@
+/**
+ * @file    deferred_log.h
+ * @brief   Binary logger with host-side formatting
+ *
+ * DLOG("fmt", args...) stores the format string in the non-loaded .logstr section (see the
+ * linker script), whose address is its 16-bit id. A call site only copies the id, a ms timestamp
+ * and the raw argument bytes into a RAM ring; the main loop sends the ring over UART with
+ * DeferredLog_Flush(). Tools/log_decode reads the format strings from the ELF and rebuilds the
+ * text, plain printf output on the same UART is passed through.
+ *
+ * Record: 0x1E | payload length | id (2) | HAL tick ms (4) | payload | 8-bit sum of bytes 1..n
+ * Arguments: integers and pointers 4 bytes (long long 8), float/double as float,
+ * strings as length byte + characters (max 32).
+ *
+ * Call sites must not add "\r\n", the decoder ends every record with a newline.
+ * Build with DEFERRED_LOG_ENABLED=0 to turn DLOG into printf.
+ */
+
+#ifndef DEFERRED_LOG_H
+#define DEFERRED_LOG_H
+
+#include <stdint.h>
+
+#ifndef DEFERRED_LOG_ENABLED
+#define DEFERRED_LOG_ENABLED 1
+#endif
+
+/* Ring size in bytes */
+#define DEFERRED_LOG_BUFFER_SIZE  2048
+/* Largest payload of one record */
+#define DEFERRED_LOG_MAX_PAYLOAD  64
+/* Longest string argument */
+#define DEFERRED_LOG_MAX_STRING   32
+
+#define DEFERRED_LOG_SYNC         0x1E
+#define DEFERRED_LOG_HEADER_SIZE  8
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief  Queue one record (use DLOG)
+ * @note   Safe from any context, drops the record if the ring is full
+ */
+void DeferredLog_Commit(uint16_t id, const uint8_t* payload, uint32_t length);
+
+/**
+ * @brief  Send all queued records over UART
+ * @note   Blocking, call from the main loop
+ */
+void DeferredLog_Flush(void);
+
+#ifdef __cplusplus
+}
+
+#include <string.h>
+#include <type_traits>
+
+namespace deferred_log {
+
+struct Encoder {
+    uint8_t* pos;
+    uint8_t* end;
+};
+
+inline void put(Encoder& e, const void* data, uint32_t length) {
+    if (e.pos + length > e.end) {
+        e.pos = e.end;  // truncated, the decoder prints "<?>" for missing arguments
+        return;
+    }
+    memcpy(e.pos, data, length);
+    e.pos += length;
+}
+
+inline void encodeArg(Encoder& e, const char* s) {
+    uint8_t length = 0;
+    while (s && s[length] && length < DEFERRED_LOG_MAX_STRING) length++;
+    put(e, &length, 1);
+    put(e, s, length);
+}
+
+inline void encodeArg(Encoder& e, char* s) { encodeArg(e, (const char*)s); }
+
+inline void encodeArg(Encoder& e, float v) {
+    put(e, &v, 4);
+}
+
+inline void encodeArg(Encoder& e, double v) {
+    encodeArg(e, (float)v);
+}
+
+// Widen like printf varargs: signed types sign-extend
+template <typename T>
+inline uint32_t toWord(T* v) { return (uint32_t)(uintptr_t)v; }
+
+template <typename T>
+inline uint32_t toWord(T v) { return std::is_signed<T>::value ? (uint32_t)(int32_t)v : (uint32_t)v; }
+
+template <typename T>
+inline void encodeArg(Encoder& e, T v) {
+    static_assert(std::is_integral<T>::value || std::is_enum<T>::value || std::is_pointer<T>::value,
+                  "DLOG arguments must be integers, floats, pointers or strings");
+    if (sizeof(T) == 8 && !std::is_pointer<T>::value) {
+        put(e, &v, 8);
+    } else {
+        uint32_t word = toWord(v);
+        put(e, &word, 4);
+    }
+}
+
+template <typename... Args>
+inline void write(const char* format, Args... args) {
+    uint8_t payload[DEFERRED_LOG_MAX_PAYLOAD];
+    Encoder e = { payload, payload + sizeof(payload) };
+    int expand[] = { 0, (encodeArg(e, args), 0)... };
+    (void)expand;
+    DeferredLog_Commit((uint16_t)(uintptr_t)format, payload, (uint32_t)(e.pos - payload));
+}
+
+} // namespace deferred_log
+
+#if DEFERRED_LOG_ENABLED
+#define DLOG(fmt, ...) do { \
+        static const char dlogFormat[] __attribute__((section(".logstr"), used)) = fmt; \
+        deferred_log::write(dlogFormat, ##__VA_ARGS__); \
+    } while (0)
+#else
+#include <stdio.h>
+#define DLOG(fmt, ...) printf(fmt "\r\n", ##__VA_ARGS__)
+#endif
+
+#endif /* __cplusplus */
+
+#endif /* DEFERRED_LOG_H */
@@ -0,0 +1,21 @@
+/**
+ * @file    detector_config.h
+ * @brief   Trigger detector parameters (see trigger_detector.h)
+ *
+ * Generated by: detector_tune --write detector_config.h <corpus>
+ * Corpus:       none (hand-tuned defaults; not tuned yet: capture labeled audio with the raw
+ *               audio stream, decode it with Tools/stream_decode and run detector_tune --write)
+ */
+
+#ifndef DETECTOR_CONFIG_H
+#define DETECTOR_CONFIG_H
+
+#define DETECTOR_NOISE_THRESHOLD   12000
+#define DETECTOR_INITIAL_OFFSET    7500
+#define DETECTOR_ATTACK            0.113
+#define DETECTOR_DECAY             0.900
+#define DETECTOR_LOUD_SAMPLES      5
+#define DETECTOR_COOLDOWN_MS       1000
+#define DETECTOR_PRE_ROLL_SAMPLES  4000
+
+#endif /* DETECTOR_CONFIG_H */
@@ -0,0 +1,210 @@
+// DMA memory-to-memory jobs
+// Queue and counters are changed with interrupts masked: jobs are submitted from the main loop
+// and from the I2S interrupt, the DMA2 interrupt retires them.
+
+#include "dma_copy.h"
+#include "timer.h"
+#include "deferred_log.h"
+#include "main.h"
+#include <string.h>
+
+#define DMA_COPY_STREAM  DMA2_Stream0
+
+static const uint32_t STREAM0_FLAGS =
+    DMA_LIFCR_CTCIF0 | DMA_LIFCR_CHTIF0 | DMA_LIFCR_CTEIF0 | DMA_LIFCR_CDMEIF0 | DMA_LIFCR_CFEIF0;
+static const uint32_t MAX_ITEMS = 0xFFFF;  // NDTR
+
+struct Job {
+    uint8_t* dst;
+    const uint8_t* src;      // nullptr for a fill
+    uint32_t bytes;
+    uint32_t pattern;        // Fill value in every byte, read by the DMA from here
+    DmaCopyCallback done;
+    void* context;
+    uint32_t queuedCycles;
+};
+
+// QUEUE
+static Job queue[DMA_COPY_QUEUE_SIZE];
+static volatile uint32_t head = 0;      // Next free slot
+static volatile uint32_t count = 0;     // Jobs in the queue, the first one runs
+static uint32_t offset = 0;             // Bytes of the running job done by earlier chunks
+static uint32_t chunk = 0;              // Bytes of the chunk on the stream
+static volatile bool ready = false;
+
+static DmaCopyStats stats = {};
+
+static uint32_t address(const void* p) {
+    return (uint32_t)reinterpret_cast<uintptr_t>(p);
+}
+
+static bool inCcm(const void* p, uint32_t bytes) {
+    uint32_t a = address(p);
+    return a < CCMDATARAM_END + 1 && a + bytes > CCMDATARAM_BASE;
+}
+
+// log2 of the widest item that fits the alignment of every address and the size
+static uint32_t itemShift(uint32_t bits) {
+    if ((bits & 3u) == 0) return 2;
+    if ((bits & 1u) == 0) return 1;
+    return 0;
+}
+
+static void cpuDo(const Job& job, uint32_t from) {
+    if (job.src) memcpy(job.dst + from, job.src + from, job.bytes - from);
+    else memset(job.dst + from, (uint8_t)job.pattern, job.bytes - from);
+}
+
+static uint32_t cyclesToUs(uint32_t cycles) {
+    return (uint32_t)((uint64_t)cycles * 1000000u / SystemCoreClock);
+}
+
+// Program the next chunk of the first job, call with interrupts masked
+static void startChunk(void) {
+    Job& job = queue[(head + DMA_COPY_QUEUE_SIZE - count) % DMA_COPY_QUEUE_SIZE];
+    uint32_t remaining = job.bytes - offset;
+    uint32_t addressBits = address(job.dst) | remaining;
+    if (job.src) addressBits |= address(job.src);
+    uint32_t shift = itemShift(addressBits | offset);
+    uint32_t items = remaining >> shift;
+    if (items > MAX_ITEMS) items = MAX_ITEMS;
+    chunk = items << shift;
+
+    DMA_Stream_TypeDef* s = DMA_COPY_STREAM;
+    s->CR = 0;
+    while (s->CR & DMA_SxCR_EN) {
+    }
+    DMA2->LIFCR = STREAM0_FLAGS;
+    // Memory-to-memory: the peripheral port is the source
+    s->PAR = job.src ? address(job.src + offset) : address(&job.pattern);
+    s->M0AR = address(job.dst + offset);
+    s->NDTR = items;
+    // FIFO mode is mandatory for memory-to-memory
+    s->FCR = DMA_SxFCR_DMDIS | DMA_SxFCR_FTH_0 | DMA_SxFCR_FTH_1;
+    uint32_t size = shift == 2 ? DMA_SxCR_PSIZE_1 | DMA_SxCR_MSIZE_1
+                  : shift == 1 ? DMA_SxCR_PSIZE_0 | DMA_SxCR_MSIZE_0 : 0;
+    s->CR = DMA_SxCR_DIR_1 | DMA_SxCR_MINC | (job.src ? DMA_SxCR_PINC : 0) | size | DMA_SxCR_TCIE | DMA_SxCR_TEIE;
+    s->CR |= DMA_SxCR_EN;
+}
+
+static bool submit(const Job& job) {
+    if (job.bytes == 0) {
+        if (job.done) job.done(job.context);
+        return false;
+    }
+    bool cpu = !ready || inCcm(job.dst, job.bytes) || (job.src && inCcm(job.src, job.bytes));
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    // A small job still queues behind running ones, to keep the order
+    if (!cpu && job.bytes < DMA_COPY_MIN_BYTES && count == 0) cpu = true;
+    if (!cpu && count == DMA_COPY_QUEUE_SIZE) {
+        stats.queueFull++;
+        cpu = true;
+    }
+    if (cpu) {
+        stats.cpuJobs++;
+        __set_PRIMASK(primask);
+        cpuDo(job, 0);
+        if (job.done) job.done(job.context);
+        return false;
+    }
+    queue[head] = job;
+    queue[head].queuedCycles = cycleCounterGet();
+    head = (head + 1) % DMA_COPY_QUEUE_SIZE;
+    count++;
+    if (count > stats.maxQueued) stats.maxQueued = count;
+    if (count == 1) {
+        offset = 0;
+        startChunk();
+    }
+    __set_PRIMASK(primask);
+    return true;
+}
+
+extern "C" {
+
+void DmaCopy_Init(void) {
+    __HAL_RCC_DMA2_CLK_ENABLE();
+    DMA_COPY_STREAM->CR = 0;
+    DMA2->LIFCR = STREAM0_FLAGS;
+    HAL_NVIC_SetPriority(DMA2_Stream0_IRQn, 5, 0);
+    HAL_NVIC_EnableIRQ(DMA2_Stream0_IRQn);
+    head = count = 0;
+    ready = true;
+}
+
+bool DmaCopy_Copy(void* dst, const void* src, uint32_t bytes, DmaCopyCallback done, void* context) {
+    Job job = {static_cast<uint8_t*>(dst), static_cast<const uint8_t*>(src), bytes, 0, done, context, 0};
+    return submit(job);
+}
+
+bool DmaCopy_Fill(void* dst, uint8_t value, uint32_t bytes, DmaCopyCallback done, void* context) {
+    Job job = {static_cast<uint8_t*>(dst), nullptr, bytes, value * 0x01010101u, done, context, 0};
+    return submit(job);
+}
+
+bool DmaCopy_IsIdle(void) {
+    return count == 0;
+}
+
+void DmaCopy_Wait(void) {
+    while (count) {
+    }
+}
+
+void DmaCopy_GetStats(DmaCopyStats* out) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    *out = stats;
+    __set_PRIMASK(primask);
+}
+
+void DmaCopy_PrintStats(void) {
+    DmaCopyStats s;
+    DmaCopy_GetStats(&s);
+    if (s.jobs == 0 && s.cpuJobs == 0) return;
+    DLOG("[DMA] %lu copies/fills (%lu kB, max %lu us, queue max %lu), %lu by the CPU (%lu queue full), %lu errors",
+         (unsigned long)s.jobs, (unsigned long)(s.bytes / 1024u), (unsigned long)s.maxJobUs,
+         (unsigned long)s.maxQueued, (unsigned long)s.cpuJobs, (unsigned long)s.queueFull, (unsigned long)s.errors);
+}
+
+void DmaCopy_IRQHandler(void) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint32_t flags = DMA2->LISR & (DMA_LISR_TCIF0 | DMA_LISR_TEIF0);
+    DMA2->LIFCR = STREAM0_FLAGS;
+    if (!count || !flags) {
+        __set_PRIMASK(primask);
+        return;
+    }
+
+    Job job = queue[(head + DMA_COPY_QUEUE_SIZE - count) % DMA_COPY_QUEUE_SIZE];
+    if (flags & DMA_LISR_TEIF0) {
+        // The stream disabled itself, the rest is copied by the CPU
+        stats.errors++;
+        cpuDo(job, offset);
+        offset = job.bytes;
+    } else {
+        offset += chunk;
+    }
+    if (offset < job.bytes) {
+        startChunk();
+        __set_PRIMASK(primask);
+        return;
+    }
+
+    stats.jobs++;
+    stats.bytes += job.bytes;
+    uint32_t us = cyclesToUs(cycleCounterGet() - job.queuedCycles);
+    if (us > stats.maxJobUs) stats.maxJobUs = us;
+    count--;
+    if (count) {
+        offset = 0;
+        startChunk();
+    }
+    __set_PRIMASK(primask);
+    if (job.done) job.done(job.context);
+}
+
+} // extern "C"
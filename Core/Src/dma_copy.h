@@ -0,0 +1,102 @@
+/**
+ * @file    dma_copy.h
+ * @brief   Asynchronous memory copy and fill on DMA2 Stream0 (memory-to-memory)
+ *
+ * Only DMA2 can do memory-to-memory transfers. Jobs go into a small descriptor queue and run one
+ * after the other, in submission order, so a copy queued behind a fill of the same buffer reads
+ * the filled data. Each job calls its completion callback from the DMA2 Stream0 interrupt
+ * (priority 5, below the I2S DMA). Transfers use 32-bit items when source, destination and size
+ * are word aligned, otherwise 16 or 8 bits; jobs above 65535 items are split.
+ *
+ * The CPU does the job instead, and calls the callback before the submit returns, when:
+ *   - the job is smaller than DMA_COPY_MIN_BYTES and nothing is queued (setting up the stream
+ *     costs more)
+ *   - source or destination lies in CCM RAM, which the DMA cannot reach
+ *   - the queue is full (the job then overtakes the queued ones), or DmaCopy_Init has not run
+ *
+ * The DMA shares the bus matrix with the CPU: a copy of SRAM to SRAM takes about as long as a
+ * CPU loop but runs in parallel. Nothing may touch the destination, or write the source, until
+ * the callback.
+ */
+
+#ifndef DMA_COPY_H
+#define DMA_COPY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Pending jobs, the one running included */
+#define DMA_COPY_QUEUE_SIZE  8
+
+/* Smaller jobs are done by the CPU */
+#define DMA_COPY_MIN_BYTES   64
+
+/* Called when a job is done: DMA2 interrupt, or the submitter if the CPU did it */
+typedef void (*DmaCopyCallback)(void* context);
+
+typedef struct {
+    uint32_t jobs;           /* Jobs done by the DMA */
+    uint32_t bytes;
+    uint32_t cpuJobs;        /* Jobs done by the CPU (small, CCM or queue full) */
+    uint32_t queueFull;
+    uint32_t errors;         /* Transfer errors, the CPU redid the job */
+    uint32_t maxQueued;
+    uint32_t maxJobUs;       /* Longest job, queueing to completion */
+} DmaCopyStats;
+
+/**
+ * @brief  Enable DMA2 and its Stream0 interrupt
+ */
+void DmaCopy_Init(void);
+
+/**
+ * @brief  Copy bytes, memcpy semantics (no overlap)
+ * @param  done: may be NULL
+ * @return true if the DMA took the job, false if the CPU has already done it
+ * @note   Safe from any context
+ */
+bool DmaCopy_Copy(void* dst, const void* src, uint32_t bytes, DmaCopyCallback done, void* context);
+
+/**
+ * @brief  Fill bytes with a value, memset semantics
+ * @param  done: may be NULL
+ * @return true if the DMA took the job, false if the CPU has already done it
+ * @note   Safe from any context
+ */
+bool DmaCopy_Fill(void* dst, uint8_t value, uint32_t bytes, DmaCopyCallback done, void* context);
+
+/**
+ * @brief  true if no job is queued or running
+ */
+bool DmaCopy_IsIdle(void);
+
+/**
+ * @brief  Wait until every queued job is done
+ * @note   Main loop only, completion needs the DMA2 interrupt
+ */
+void DmaCopy_Wait(void);
+
+/**
+ * @brief  Snapshot of the counters
+ */
+void DmaCopy_GetStats(DmaCopyStats* stats);
+
+/**
+ * @brief  Print jobs, CPU fallbacks, queue depth and errors
+ */
+void DmaCopy_PrintStats(void);
+
+/**
+ * @brief  DMA2 Stream0 interrupt, called from DMA2_Stream0_IRQHandler
+ */
+void DmaCopy_IRQHandler(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DMA_COPY_H */
@@ -0,0 +1,226 @@
+// MFCC front-end for the KWS model
+// Same parameters as the training pipeline: 40 ms / 20 ms frames, 40 mel bands (20-4000 Hz),
+// log mel energies, orthonormal DCT-II, first 10 coefficients.
+// The fixed-point path computes the same features with q31 arithmetic; each path has its own
+// tables, generated at compile time by feature_tables.h.
+
+#include "feature_extraction.h"
+#include "feature_tables.h"
+#include "arm_math.h"
+#include <cmath>
+#include <cstring>
+
+// 18-bit samples -> [-1, 1)
+static const float SAMPLE_SCALE = 1.0f / 131072.0f;
+static const float LOG_FLOOR = 1e-12f;
+
+#if FEATURES_HAS_FIXED
+// log2 mantissa table: FIXED_LOG_TABLE intervals between 1 and 2, Q16
+#define FIXED_LOG_BITS   6
+#define FIXED_LOG_TABLE  (1 << FIXED_LOG_BITS)
+static const int32_t FIXED_LOG_FLOOR = -2612476;  // log2(LOG_FLOOR) in Q16
+#endif
+
+// TABLES (constexpr, so they stay in flash and nothing is built at boot)
+// Sparse mel filterbank: band b covers bins start[b] .. start[b] + length[b] - 1, its weights are
+// packed from weights[offset[b]]; MEL_WEIGHTS is the exact number of non-zero weights
+static constexpr int MEL_WEIGHTS = melWeightCount(FEATURES_SAMPLE_RATE, FEATURES_FFT_SIZE, FEATURES_NUM_MEL,
+                                                  FEATURES_MEL_LOW_HZ, FEATURES_MEL_HIGH_HZ);
+#if FEATURES_HAS_FLOAT
+static constexpr WindowTable<float, FEATURES_FRAME_LENGTH> window =
+    makeHannWindow<float, FEATURES_FRAME_LENGTH>();
+static constexpr MelFilterbank<float, FEATURES_NUM_MEL, MEL_WEIGHTS> mel =
+    makeMelFilterbank<float, FEATURES_NUM_MEL, MEL_WEIGHTS>(FEATURES_SAMPLE_RATE, FEATURES_FFT_SIZE,
+                                                            FEATURES_MEL_LOW_HZ, FEATURES_MEL_HIGH_HZ);
+static constexpr DctTable<float, FEATURES_NUM_MFCC, FEATURES_NUM_MEL> dct =
+    makeDct<float, FEATURES_NUM_MFCC, FEATURES_NUM_MEL>();
+#endif
+#if FEATURES_HAS_FIXED
+static constexpr WindowTable<q31_t, FEATURES_FRAME_LENGTH> windowQ31 =
+    makeHannWindow<q31_t, FEATURES_FRAME_LENGTH>();
+static constexpr MelFilterbank<int32_t, FEATURES_NUM_MEL, MEL_WEIGHTS> melQ12 =
+    makeMelFilterbank<int32_t, FEATURES_NUM_MEL, MEL_WEIGHTS, 12>(FEATURES_SAMPLE_RATE, FEATURES_FFT_SIZE,
+                                                                  FEATURES_MEL_LOW_HZ, FEATURES_MEL_HIGH_HZ);
+// Includes ln 2 (log2 -> ln)
+static constexpr DctTable<q31_t, FEATURES_NUM_MFCC, FEATURES_NUM_MEL> dctQ31 =
+    makeDct<q31_t, FEATURES_NUM_MFCC, FEATURES_NUM_MEL>(ctLn2);
+static constexpr Log2Table<FIXED_LOG_TABLE> log2Table = makeLog2Table<FIXED_LOG_TABLE>();
+#endif
+
+// WORK BUFFERS
+// Host tools build with -DFEATURES_WORK_STORAGE="static thread_local" to extract features in parallel
+#ifndef FEATURES_WORK_STORAGE
+#define FEATURES_WORK_STORAGE static
+#endif
+#if FEATURES_HAS_FLOAT
+static arm_rfft_fast_instance_f32 rfft;
+FEATURES_WORK_STORAGE float fftIn[FEATURES_FFT_SIZE];
+FEATURES_WORK_STORAGE float fftOut[FEATURES_FFT_SIZE];
+FEATURES_WORK_STORAGE float power[FEATURES_NUM_BINS];
+FEATURES_WORK_STORAGE float melEnergies[FEATURES_NUM_MEL];
+#endif
+#if FEATURES_HAS_FIXED
+static arm_rfft_instance_q31 rfftQ31;
+// The q31 RFFT uses its input as scratch and writes the full complex spectrum
+FEATURES_WORK_STORAGE q31_t fftInQ31[FEATURES_FFT_SIZE];
+FEATURES_WORK_STORAGE q31_t fftOutQ31[2 * FEATURES_FFT_SIZE];
+FEATURES_WORK_STORAGE q31_t melLogQ16[FEATURES_NUM_MEL];
+#endif
+
+#if FEATURES_HAS_FLOAT
+// Window (zero padded up to the FFT size), FFT, power spectrum
+static void frameSpectrum(const int32_t* frame) {
+    for (int i = 0; i < FEATURES_FRAME_LENGTH; i++) {
+        fftIn[i] = frame[i] * SAMPLE_SCALE * window.w[i];
+    }
+    memset(&fftIn[FEATURES_FRAME_LENGTH], 0,
+           (FEATURES_FFT_SIZE - FEATURES_FRAME_LENGTH) * sizeof(float));
+
+    arm_rfft_fast_f32(&rfft, fftIn, fftOut, 0);
+
+    // Packed output: [0] = DC, [1] = Nyquist, then (re, im) pairs
+    power[0] = fftOut[0] * fftOut[0];
+    power[FEATURES_NUM_BINS - 1] = fftOut[1] * fftOut[1];
+    arm_cmplx_mag_squared_f32(&fftOut[2], &power[1], FEATURES_NUM_BINS - 2);
+}
+
+static void frameMel(void) {
+    for (int b = 0; b < FEATURES_NUM_MEL; b++) {
+        float energy;
+        // CMSIS takes non-const sources, the tables are only read
+        arm_dot_prod_f32(&power[mel.start[b]], const_cast<float*>(&mel.weights[mel.offset[b]]), mel.length[b],
+                         &energy);
+        melEnergies[b] = logf(energy + LOG_FLOOR);
+    }
+}
+
+static void frameDct(float* mfcc) {
+    for (int c = 0; c < FEATURES_NUM_MFCC; c++) {
+        arm_dot_prod_f32(const_cast<float*>(dct.m[c]), melEnergies, FEATURES_NUM_MEL, &mfcc[c]);
+    }
+}
+
+static void computeFrame(const int32_t* frame, float* mfcc) {
+    frameSpectrum(frame);
+    frameMel();
+    frameDct(mfcc);
+}
+#endif
+
+#if FEATURES_HAS_FIXED
+// log2 of a positive 64-bit value in Q16: exponent from the leading one, mantissa from the table
+static int32_t log2Q16(uint64_t x) {
+    int32_t exponent = 63 - __builtin_clzll(x);
+    uint32_t fraction = (uint32_t)((x << (63 - exponent)) >> 31);  // leading one shifted out
+    uint32_t index = fraction >> (32 - FIXED_LOG_BITS);
+    uint32_t rest = (fraction >> (16 - FIXED_LOG_BITS)) & 0xFFFF;
+    int32_t base = log2Table.v[index];
+    return (exponent << 16) + base + (int32_t)(((log2Table.v[index + 1] - base) * rest) >> 16);
+}
+
+static void computeFrameFixed(const int32_t* frame, int16_t* mfcc) {
+    // Block normalization: the largest sample gets 30 bits, so quiet frames keep their precision
+    // through the FFT's internal down-scaling
+    uint32_t bits = 0;
+    for (int i = 0; i < FEATURES_FRAME_LENGTH; i++) bits |= (uint32_t)(frame[i] < 0 ? -frame[i] : frame[i]);
+    int shift = bits ? __builtin_clz(bits) - 2 : 0;
+    for (int i = 0; i < FEATURES_FRAME_LENGTH; i++) fftInQ31[i] = (q31_t)((uint32_t)frame[i] << shift);
+    arm_mult_q31(fftInQ31, const_cast<q31_t*>(windowQ31.w), fftInQ31, FEATURES_FRAME_LENGTH);
+    memset(&fftInQ31[FEATURES_FRAME_LENGTH], 0,
+           (FEATURES_FFT_SIZE - FEATURES_FRAME_LENGTH) * sizeof(q31_t));
+
+    // 1.31 in, 11.21 out (RFFT scales by 1/1024)
+    arm_rfft_q31(&rfftQ31, fftInQ31, fftOutQ31);
+
+    // Power and mel weighting in 64 bit (SMLAL). arm_cmplx_mag_squared_q31 drops 33 bits and
+    // leaves ~70 dB below the strongest bin, too little for the leakage bands next to a tone; here
+    // the power keeps ~114 dB. Bins shared by two bands are squared twice, cheaper than a buffer.
+    // Power = float power x 2^(2 shift - 4), Q12 weights add 2^12:
+    // log2 of the float mel energy is log2(energy) - (2 shift + 8)
+    const int32_t offset = (2 * shift + 8) << 16;
+    for (int b = 0; b < FEATURES_NUM_MEL; b++) {
+        const q31_t* bin = &fftOutQ31[2 * melQ12.start[b]];
+        const int32_t* weight = &melQ12.weights[melQ12.offset[b]];
+        uint64_t energy = 0;
+        for (int k = 0; k < melQ12.length[b]; k++) {
+            uint64_t power = ((uint64_t)((int64_t)bin[2 * k] * bin[2 * k]) +
+                              (uint64_t)((int64_t)bin[2 * k + 1] * bin[2 * k + 1])) >> 18;
+            energy += power * (uint32_t)weight[k];
+        }
+        int32_t log2Energy = energy ? log2Q16(energy) - offset : FIXED_LOG_FLOOR;
+        melLogQ16[b] = log2Energy > FIXED_LOG_FLOOR ? log2Energy : FIXED_LOG_FLOOR;
+    }
+
+    // Q31 x Q16 >> 14 = Q33
+    for (int c = 0; c < FEATURES_NUM_MFCC; c++) {
+        q63_t acc;
+        arm_dot_prod_q31(const_cast<q31_t*>(dctQ31.m[c]), melLogQ16, FEATURES_NUM_MEL, &acc);
+        q63_t q = (acc + (1LL << (32 - FEATURES_Q_FRAC_BITS))) >> (33 - FEATURES_Q_FRAC_BITS);
+        mfcc[c] = (int16_t)(q > INT16_MAX ? INT16_MAX : (q < INT16_MIN ? INT16_MIN : q));
+    }
+}
+#endif
+
+/*
+ * PUBLIC FUNCTIONS
+ */
+
+extern "C" {
+
+void Features_Init(void) {
+#if FEATURES_HAS_FLOAT
+    arm_rfft_fast_init_f32(&rfft, FEATURES_FFT_SIZE);
+#endif
+#if FEATURES_HAS_FIXED
+    arm_rfft_init_q31(&rfftQ31, FEATURES_FFT_SIZE, 0, 1);
+#endif
+}
+
+void Features_Compute(const int32_t* samples, float* out) {
+    Features_ComputeFrames(samples, out, 0, FEATURES_NUM_FRAMES);
+}
+
+void Features_ComputeFrames(const int32_t* samples, float* out, int first, int count) {
+    for (int f = first; f < first + count; f++) {
+#if FEATURES_FIXED_POINT
+        // Float model input
+        int16_t mfcc[FEATURES_NUM_MFCC];
+        computeFrameFixed(&samples[f * FEATURES_FRAME_SHIFT], mfcc);
+        for (int c = 0; c < FEATURES_NUM_MFCC; c++) {
+            out[f * FEATURES_NUM_MFCC + c] = mfcc[c] * (1.0f / (1 << FEATURES_Q_FRAC_BITS));
+        }
+#else
+        computeFrame(&samples[f * FEATURES_FRAME_SHIFT], &out[f * FEATURES_NUM_MFCC]);
+#endif
+    }
+}
+
+#if FEATURES_HAS_FLOAT
+void Features_ComputeFloat(const int32_t* samples, float* out) {
+    for (int f = 0; f < FEATURES_NUM_FRAMES; f++) {
+        computeFrame(&samples[f * FEATURES_FRAME_SHIFT], &out[f * FEATURES_NUM_MFCC]);
+    }
+}
+
+void Features_FrameSpectrum(const int32_t* frame) {
+    frameSpectrum(frame);
+}
+
+void Features_FrameMel(void) {
+    frameMel();
+}
+
+void Features_FrameDct(float* mfcc) {
+    frameDct(mfcc);
+}
+#endif
+
+#if FEATURES_HAS_FIXED
+void Features_ComputeFixed(const int32_t* samples, int16_t* out) {
+    for (int f = 0; f < FEATURES_NUM_FRAMES; f++) {
+        computeFrameFixed(&samples[f * FEATURES_FRAME_SHIFT], &out[f * FEATURES_NUM_MFCC]);
+    }
+}
+#endif
+
+} // extern "C"
@@ -0,0 +1,104 @@
+/**
+ * @file    feature_extraction.h
+ * @brief   MFCC Feature Extraction for the KWS Model
+ *
+ * Input:  1 second recording (16000 samples, 18-bit, 16 kHz)
+ * Output: 48 frames x 10 MFCC (matches AI_NETWORK_IN_1_HEIGHT/WIDTH)
+ * Frame:  40 ms window (640 samples), 20 ms hop (320 samples), 1024-point FFT
+ * The dimensions are set in PIPELINE (pipeline_config.h), the FEATURES_* sizes are its fields.
+ *
+ * Fixed point (FEATURES_FIXED_POINT=1): the same features from the q31 CMSIS-DSP functions. Each
+ * frame is block-normalized before the real FFT, power and mel weighting accumulate in 64 bit,
+ * log2 comes from a mantissa table and the DCT has ln 2 folded in.
+ * Output is Q7 (FEATURES_Q_FRAC_BITS).
+ * Tools/features_compare measures the difference to the float path.
+ */
+
+#ifndef FEATURE_EXTRACTION_H
+#define FEATURE_EXTRACTION_H
+
+#include "pipeline_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/* int, like the literals they stood for before */
+#define FEATURES_SAMPLE_RATE   ((int)PIPELINE.sampleRate)
+#define FEATURES_FRAME_LENGTH  ((int)PIPELINE.frameLength)
+#define FEATURES_FRAME_SHIFT   ((int)PIPELINE.frameShift)
+#define FEATURES_FFT_SIZE      ((int)PIPELINE.fftSize)
+#define FEATURES_NUM_BINS      ((int)PIPELINE.numBins())
+#define FEATURES_NUM_MEL       ((int)PIPELINE.numMel)
+#define FEATURES_MEL_LOW_HZ    20.0f
+#define FEATURES_MEL_HIGH_HZ   4000.0f
+#define FEATURES_NUM_MFCC      ((int)PIPELINE.numMfcc)
+#define FEATURES_NUM_FRAMES    ((int)PIPELINE.numFrames)
+#define FEATURES_SIZE          ((int)PIPELINE.featureSize())
+
+/* Front-end arithmetic: 0 = float (CMSIS f32), 1 = fixed point (CMSIS q31) */
+#ifndef FEATURES_FIXED_POINT
+#define FEATURES_FIXED_POINT 0
+#endif
+/* Host harnesses build both paths into one binary */
+#ifndef FEATURES_BOTH_PATHS
+#define FEATURES_BOTH_PATHS 0
+#endif
+#define FEATURES_HAS_FLOAT (!FEATURES_FIXED_POINT || FEATURES_BOTH_PATHS)
+#define FEATURES_HAS_FIXED (FEATURES_FIXED_POINT || FEATURES_BOTH_PATHS)
+
+/* Fixed-point MFCC: value = q / 2^FEATURES_Q_FRAC_BITS */
+#define FEATURES_Q_FRAC_BITS   7
+
+/**
+ * @brief  Set up the FFT instances (the tables are compile-time constants)
+ * @note   Must be called once before Features_Compute()
+ */
+void Features_Init(void);
+
+/**
+ * @brief  Compute the MFCC matrix of one recording
+ * @param  samples: 18-bit samples, at least the span covered by FEATURES_NUM_FRAMES frames
+ * @param  out: FEATURES_NUM_FRAMES x FEATURES_NUM_MFCC floats, row-major (frame, coefficient)
+ * @note   Float model input. With FEATURES_FIXED_POINT the Q7 result is converted at the end.
+ */
+void Features_Compute(const int32_t* samples, float* out);
+
+/**
+ * @brief  Compute frames first .. first + count - 1 of the MFCC matrix, the rest of out is untouched
+ * @param  samples, out: the whole recording and matrix, as for Features_Compute
+ * @note   Frames are independent, so a recording can be split into several calls (Kws_Step)
+ */
+void Features_ComputeFrames(const int32_t* samples, float* out, int first, int count);
+
+#if FEATURES_HAS_FLOAT
+/**
+ * @brief  Float path, same layout as Features_Compute
+ */
+void Features_ComputeFloat(const int32_t* samples, float* out);
+
+/**
+ * @brief  Stages of one float frame, for the kernel benchmarks (kernel_bench.h)
+ * @note   Spectrum: window, FFT and power of FEATURES_FRAME_LENGTH samples;
+ *         Mel: log mel energies of that spectrum; Dct: FEATURES_NUM_MFCC coefficients
+ */
+void Features_FrameSpectrum(const int32_t* frame);
+void Features_FrameMel(void);
+void Features_FrameDct(float* mfcc);
+#endif
+
+#if FEATURES_HAS_FIXED
+/**
+ * @brief  Fixed-point path
+ * @param  out: FEATURES_SIZE values in Q7, same layout as Features_Compute
+ */
+void Features_ComputeFixed(const int32_t* samples, int16_t* out);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FEATURE_EXTRACTION_H */
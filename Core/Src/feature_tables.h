@@ -0,0 +1,228 @@
+/**
+ * @file    feature_tables.h
+ * @brief   Compile-time generators for the MFCC front-end tables (window, mel filterbank, DCT)
+ *
+ * Everything here is constexpr, so feature_extraction.cpp keeps the tables as static constexpr
+ * objects in flash and builds nothing at boot. The generators take the front-end parameters
+ * (sample rate, FFT size, mel bands, cepstral coefficients) as arguments, the table sizes as
+ * template parameters. Math is done in double with the small constexpr helpers below (no libm).
+ *
+ * The mel filterbank is sparse: per band the first bin, the number of bins and the offset of its
+ * weights in one packed array, sized to the exact number of non-zero weights.
+ *
+ * C++ only, included by feature_extraction.cpp.
+ */
+
+#ifndef FEATURE_TABLES_H
+#define FEATURE_TABLES_H
+
+#include <stdint.h>
+
+// CONSTEXPR MATH
+
+constexpr double ctPi = 3.14159265358979323846;
+constexpr double ctLn2 = 0.69314718055994530942;
+
+constexpr double ctAbs(double x) {
+    return x < 0.0 ? -x : x;
+}
+
+// Reduced to [-pi, pi], then Taylor series until the terms vanish
+constexpr double ctCos(double x) {
+    long turns = (long)(x / (2.0 * ctPi));
+    x -= turns * 2.0 * ctPi;
+    if (x > ctPi) x -= 2.0 * ctPi;
+    if (x < -ctPi) x += 2.0 * ctPi;
+    double term = 1.0, sum = 1.0;
+    for (int n = 1; n < 40 && ctAbs(term) > 1e-18; n++) {
+        term *= -x * x / ((2 * n - 1) * (2 * n));
+        sum += term;
+    }
+    return sum;
+}
+
+// x = m * 2^k with m in [0.75, 1.5), ln m = 2 atanh((m - 1) / (m + 1))
+constexpr double ctLog(double x) {
+    int k = 0;
+    while (x >= 1.5) {
+        x *= 0.5;
+        k++;
+    }
+    while (x < 0.75) {
+        x *= 2.0;
+        k--;
+    }
+    double y = (x - 1.0) / (x + 1.0);
+    double y2 = y * y, power = y, sum = 0.0;
+    for (int n = 1; n < 80 && ctAbs(power) > 1e-20; n += 2) {
+        sum += power / n;
+        power *= y2;
+    }
+    return 2.0 * sum + k * ctLn2;
+}
+
+constexpr double ctLog2(double x) {
+    return ctLog(x) / ctLn2;
+}
+
+constexpr double ctSqrt(double x) {
+    if (x <= 0.0) return 0.0;
+    double r = x > 1.0 ? x : 1.0;
+    for (int i = 0; i < 100; i++) {
+        double next = 0.5 * (r + x / r);
+        if (next == r) break;
+        r = next;
+    }
+    return r;
+}
+
+constexpr long ctRound(double x) {
+    return x < 0.0 ? -(long)(0.5 - x) : (long)(x + 0.5);
+}
+
+constexpr int32_t ctToQ31(double x) {
+    return x >= 1.0 ? INT32_MAX : (x <= -1.0 ? INT32_MIN : (int32_t)ctRound(x * 2147483648.0));
+}
+
+// Table entry from a double: float as is, int32_t (q31_t) as Q31
+template <typename T>
+constexpr T ctEntry(double x);
+
+template <>
+constexpr float ctEntry<float>(double x) {
+    return (float)x;
+}
+
+template <>
+constexpr int32_t ctEntry<int32_t>(double x) {
+    return ctToQ31(x);
+}
+
+// WINDOW
+
+template <typename T, int Length>
+struct WindowTable {
+    T w[Length];
+};
+
+// Periodic Hann window, float or Q31
+template <typename T, int Length>
+constexpr WindowTable<T, Length> makeHannWindow() {
+    WindowTable<T, Length> t = {};
+    for (int i = 0; i < Length; i++) {
+        double w = 0.5 - 0.5 * ctCos(2.0 * ctPi * i / Length);
+        t.w[i] = ctEntry<T>(w);
+    }
+    return t;
+}
+
+// MEL FILTERBANK
+
+constexpr double ctHzToMel(double hz) {
+    return 1127.0 * ctLog(1.0 + hz / 700.0);
+}
+
+// HTK-style mel scale, bands evenly spaced in mel with 50 % overlap
+struct MelScale {
+    double low;
+    double step;
+};
+
+constexpr MelScale makeMelScale(int bands, double lowHz, double highHz) {
+    return MelScale{ctHzToMel(lowHz), (ctHzToMel(highHz) - ctHzToMel(lowHz)) / (bands + 1)};
+}
+
+// Triangle weight of band b at the given mel value, 0 outside
+constexpr double melWeight(const MelScale& scale, int b, double mel) {
+    const double left = scale.low + b * scale.step;
+    const double center = left + scale.step;
+    const double right = center + scale.step;
+    if (mel > left && mel <= center) return (mel - left) / scale.step;
+    if (mel > center && mel < right) return (right - mel) / scale.step;
+    return 0.0;
+}
+
+// Number of non-zero weights, sizes the packed weight array
+constexpr int melWeightCount(int sampleRate, int fftSize, int bands, double lowHz, double highHz) {
+    const MelScale scale = makeMelScale(bands, lowHz, highHz);
+    int count = 0;
+    for (int k = 0; k <= fftSize / 2; k++) {
+        const double mel = ctHzToMel((double)k * sampleRate / fftSize);
+        for (int b = 0; b < bands; b++) count += melWeight(scale, b, mel) > 0.0;
+    }
+    return count;
+}
+
+// Band b covers bins start[b] .. start[b] + length[b] - 1, its weights follow from weights[offset[b]]
+template <typename T, int Bands, int Weights>
+struct MelFilterbank {
+    uint16_t start[Bands];
+    uint16_t length[Bands];
+    uint16_t offset[Bands];
+    uint16_t firstBin;     // First bin any band reads
+    uint16_t endBin;       // One past the last bin any band reads
+    T weights[Weights];
+};
+
+// Weights as float or fixed point with FracBits fractional bits. A Weights smaller than
+// melWeightCount() fails to compile
+template <typename T, int Bands, int Weights, int FracBits = 0>
+constexpr MelFilterbank<T, Bands, Weights> makeMelFilterbank(int sampleRate, int fftSize, double lowHz, double highHz) {
+    MelFilterbank<T, Bands, Weights> t = {};
+    const MelScale scale = makeMelScale(Bands, lowHz, highHz);
+    int offset = 0;
+    for (int b = 0; b < Bands; b++) {
+        t.offset[b] = (uint16_t)offset;
+        for (int k = 0; k <= fftSize / 2; k++) {
+            double w = melWeight(scale, b, ctHzToMel((double)k * sampleRate / fftSize));
+            if (w <= 0.0) continue;
+            if (t.length[b] == 0) t.start[b] = (uint16_t)k;
+            // Bins are visited in order, so the band stays contiguous
+            t.weights[offset++] = FracBits ? (T)ctRound(w * (1L << FracBits)) : (T)w;
+            t.length[b]++;
+        }
+    }
+    t.firstBin = t.start[0];
+    t.endBin = (uint16_t)(t.start[Bands - 1] + t.length[Bands - 1]);
+    return t;
+}
+
+// DCT
+
+template <typename T, int Coeffs, int Bands>
+struct DctTable {
+    T m[Coeffs][Bands];
+};
+
+// Orthonormal DCT-II, scaled by gain (ln 2 turns log2 inputs into natural log MFCC),
+// float or Q31
+template <typename T, int Coeffs, int Bands>
+constexpr DctTable<T, Coeffs, Bands> makeDct(double gain = 1.0) {
+    DctTable<T, Coeffs, Bands> t = {};
+    const double scale0 = ctSqrt(1.0 / Bands);
+    const double scale = ctSqrt(2.0 / Bands);
+    for (int c = 0; c < Coeffs; c++) {
+        for (int m = 0; m < Bands; m++) {
+            double d = gain * (c == 0 ? scale0 : scale) * ctCos(ctPi / Bands * (m + 0.5) * c);
+            t.m[c][m] = ctEntry<T>(d);
+        }
+    }
+    return t;
+}
+
+// LOG2
+
+template <int Entries>
+struct Log2Table {
+    int32_t v[Entries + 1];
+};
+
+// log2(1 + i / Entries) in Q16, Entries + 1 points for interpolation
+template <int Entries>
+constexpr Log2Table<Entries> makeLog2Table() {
+    Log2Table<Entries> t = {};
+    for (int i = 0; i <= Entries; i++) t.v[i] = (int32_t)ctRound(ctLog2(1.0 + (double)i / Entries) * 65536.0);
+    return t;
+}
+
+#endif /* FEATURE_TABLES_H */
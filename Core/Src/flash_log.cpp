@@ -0,0 +1,317 @@
+// Log-structured clip store
+// Portable, shared between the firmware and Tools/flash_log.
+
+#include "flash_log.h"
+#include <stddef.h>
+#include <string.h>
+
+static_assert(sizeof(FlashLogSector) == 16, "sector header layout");
+static_assert(sizeof(FlashLogClipInfo) == 24, "clip info layout");
+static_assert(sizeof(FlashLogRecord) == 48, "record header layout");
+static_assert(offsetof(FlashLogRecord, commit) == sizeof(FlashLogRecord) - 4, "commit word must come last");
+
+static const uint32_t SECTOR_WORDS = sizeof(FlashLogSector) / 4;
+static const uint32_t COMMIT_WORD = offsetof(FlashLogRecord, commit) / 4;
+
+static uint32_t recordSize(uint32_t length) {
+    return sizeof(FlashLogRecord) + ((length + 3) & ~3u);
+}
+
+static bool isErased(const uint8_t* data, uint32_t length) {
+    for (uint32_t i = 0; i < length; i++) {
+        if (data[i] != 0xFF) return false;
+    }
+    return true;
+}
+
+static bool sectorValid(const uint8_t* base, uint32_t generation) {
+    const FlashLogSector* h = reinterpret_cast<const FlashLogSector*>(base);
+    return h->magic == FLASH_LOG_SECTOR_MAGIC && h->check == ~h->generation && h->generation == generation;
+}
+
+static bool recordValid(const FlashLog* log, const FlashLogRecord* r, uint32_t offset) {
+    return r->magic == FLASH_LOG_RECORD_MAGIC && r->headerCrc == FlashLog_HeaderCrc(r) &&
+           r->length <= log->dev->sectorSize - offset - sizeof(FlashLogRecord);
+}
+
+// End of the records in a sector. A tail that is neither a record nor erased (reset during a
+// header write) closes the sector.
+static uint32_t walk(const FlashLog* log, const uint8_t* base, uint32_t* nextId, bool* torn) {
+    uint32_t size = log->dev->sectorSize;
+    uint32_t offset = sizeof(FlashLogSector);
+    *torn = false;
+    while (offset + sizeof(FlashLogRecord) <= size) {
+        const FlashLogRecord* r = reinterpret_cast<const FlashLogRecord*>(base + offset);
+        if (isErased(base + offset, sizeof(FlashLogRecord))) return offset;
+        if (!recordValid(log, r, offset)) {
+            *torn = true;
+            return size;
+        }
+        if (r->id + 1 > *nextId) *nextId = r->id + 1;
+        offset += recordSize(r->length);
+    }
+    return size;
+}
+
+static uint32_t aheadSector(const FlashLog* log) {
+    uint32_t next = log->opened ? log->generation + 1 : 0;
+    return next % log->dev->sectorCount;
+}
+
+// Pick the place of the pending record, opening the next sector if it does not fit
+static bool place(FlashLog* log) {
+    uint32_t size = recordSize(log->record.length);
+    if (log->opened && log->offset + size <= log->dev->sectorSize) {
+        log->recordOffset = log->offset;
+        return true;
+    }
+    if (!log->aheadErased) {
+        if (!log->waiting) log->stats.waits++;
+        log->waiting = true;
+        return false;
+    }
+
+    log->generation = log->opened ? log->generation + 1 : 0;
+    log->opened = true;
+    log->offset = sizeof(FlashLogSector);
+    log->recordOffset = log->offset;
+    log->sectorWord = 0;
+    // The sector after this one is erased next, ahead of the append that needs it
+    log->aheadErased = false;
+    log->eraseScheduled = true;
+    return true;
+}
+
+// Next word to program: a new sector's header first, then the record with its commit word last.
+// Erased words (0xFFFFFFFF) are skipped.
+static bool nextWord(FlashLog* log, uint32_t* offset, uint32_t* value) {
+    while (log->sectorWord < SECTOR_WORDS) {
+        FlashLogSector h = {FLASH_LOG_SECTOR_MAGIC, log->generation, ~log->generation, FLASH_LOG_ERASED};
+        uint32_t i = log->sectorWord++;
+        *offset = i * 4;
+        *value = reinterpret_cast<const uint32_t*>(&h)[i];
+        if (*value != FLASH_LOG_ERASED) return true;
+    }
+    while (log->word < log->words) {
+        uint32_t i = log->word++;
+        if (i < COMMIT_WORD) {
+            *offset = log->recordOffset + i * 4;
+            *value = reinterpret_cast<const uint32_t*>(&log->record)[i];
+        } else if (i == log->words - 1) {
+            *offset = log->recordOffset + COMMIT_WORD * 4;
+            *value = FLASH_LOG_COMMITTED;
+        } else {
+            uint32_t byte = (i - COMMIT_WORD) * 4;
+            uint8_t bytes[4] = {0xFF, 0xFF, 0xFF, 0xFF};
+            for (uint32_t k = 0; k < 4 && byte + k < log->record.length; k++) bytes[k] = log->payload[byte + k];
+            *offset = log->recordOffset + sizeof(FlashLogRecord) + byte;
+            memcpy(value, bytes, 4);
+        }
+        if (*value != FLASH_LOG_ERASED) return true;
+    }
+    return false;
+}
+
+static void finishRecord(FlashLog* log) {
+    log->offset = log->recordOffset + recordSize(log->record.length);
+    log->stats.appended++;
+    log->stats.bytes += recordSize(log->record.length);
+    log->nextId++;
+    log->pending = false;
+}
+
+extern "C" {
+
+void FlashLog_Mount(FlashLog* log, const FlashLogDevice* dev) {
+    memset(log, 0, sizeof(*log));
+    log->dev = dev;
+    uint32_t count = dev->sectorCount;
+
+    for (uint32_t s = 0; s < count; s++) {
+        const uint8_t* base = dev->read(s);
+        uint32_t generation = reinterpret_cast<const FlashLogSector*>(base)->generation;
+        if (!sectorValid(base, generation) || generation % count != s) continue;
+        if (!log->opened || generation > log->generation) log->generation = generation;
+        log->opened = true;
+    }
+
+    if (log->opened) {
+        // Clip ids continue after the newest record of any sector still in the log
+        uint32_t oldest = log->generation + 1 >= count ? log->generation + 1 - count : 0;
+        for (uint32_t g = oldest; g <= log->generation; g++) {
+            const uint8_t* base = dev->read(g % count);
+            if (!sectorValid(base, g)) continue;
+            bool torn;
+            uint32_t end = walk(log, base, &log->nextId, &torn);
+            if (g == log->generation) {
+                log->offset = end;
+                if (torn) log->stats.closedTails++;
+            }
+        }
+    }
+
+    // Anything but a blank sector ahead (older clips, an erase cut short) is erased first
+    log->aheadErased = isErased(dev->read(aheadSector(log)), dev->sectorSize);
+    log->eraseScheduled = !log->aheadErased;
+    log->sectorWord = SECTOR_WORDS;
+}
+
+bool FlashLog_Append(FlashLog* log, const FlashLogClipInfo* info, const uint8_t* payload, uint32_t length) {
+    if (log->pending) {
+        log->stats.busy++;
+        return false;
+    }
+    if (recordSize(length) > log->dev->sectorSize - sizeof(FlashLogSector)) {
+        log->stats.tooLarge++;
+        return false;
+    }
+
+    FlashLogRecord& r = log->record;
+    memset(&r, 0xFF, sizeof(r));
+    r.magic = FLASH_LOG_RECORD_MAGIC;
+    r.length = length;
+    r.id = log->nextId;
+    r.info = *info;
+    r.payloadCrc = AudioCodec_Crc16(payload, length, 0xFFFF);
+    r.headerCrc = FlashLog_HeaderCrc(&r);
+
+    log->payload = payload;
+    log->word = 0;
+    log->words = COMMIT_WORD + (length + 3) / 4 + 1;
+    log->placed = false;
+    log->waiting = false;
+    log->pending = true;
+    return true;
+}
+
+void FlashLog_Poll(FlashLog* log, uint32_t maxWords) {
+    const FlashLogDevice* dev = log->dev;
+    if (!dev) return;
+    uint32_t started = 0;
+
+    while (true) {
+        FlashLogDevStatus status = dev->status();
+        if (status == FLASH_LOG_DEV_BUSY) {
+            if (log->erasing) return;
+            continue;  // word program, tens of microseconds
+        }
+        if (status == FLASH_LOG_DEV_ERROR) log->stats.errors++;
+
+        if (log->erasing) {
+            // A failed erase is repeated
+            log->erasing = false;
+            log->aheadErased = status == FLASH_LOG_DEV_IDLE;
+            log->eraseScheduled = !log->aheadErased;
+        }
+        if (log->programming) {
+            log->programming = false;
+            if (status == FLASH_LOG_DEV_ERROR) {
+                // Record stays uncommitted, the sector is closed so nothing lands behind it
+                log->offset = dev->sectorSize;
+                log->sectorWord = SECTOR_WORDS;
+                log->pending = false;
+            }
+        }
+
+        if (log->pending) {
+            if (!log->placed) {
+                log->placed = place(log);
+                if (!log->placed && !log->eraseScheduled) return;  // erase running
+            }
+            if (log->placed) {
+                if (started >= maxWords) return;
+                uint32_t offset, value;
+                if (!nextWord(log, &offset, &value)) {
+                    finishRecord(log);
+                    continue;
+                }
+                uint32_t sector = log->generation % dev->sectorCount;
+                dev->programStart(sector, offset, value);
+                log->programming = true;
+                started++;
+                continue;
+            }
+        }
+
+        if (log->eraseScheduled) {
+            dev->eraseStart(aheadSector(log));
+            log->eraseScheduled = false;
+            log->erasing = true;
+            log->stats.erases++;
+        }
+        return;
+    }
+}
+
+bool FlashLog_IsIdle(const FlashLog* log) {
+    return !log->pending;
+}
+
+bool FlashLog_DeviceBusy(const FlashLog* log) {
+    return log->erasing || log->programming;
+}
+
+bool FlashLog_Next(const FlashLog* log, FlashLogCursor* cursor, const FlashLogRecord** record,
+                   const uint8_t** payload) {
+    if (!log->opened) return false;
+    const FlashLogDevice* dev = log->dev;
+    uint32_t count = dev->sectorCount;
+    uint32_t oldest = log->generation + 1 >= count ? log->generation + 1 - count : 0;
+    if (!cursor->started || cursor->generation < oldest) {
+        // Start, or the sector under the cursor was reused since the last call
+        cursor->generation = oldest;
+        cursor->offset = sizeof(FlashLogSector);
+        cursor->started = true;
+    }
+
+    while (cursor->generation <= log->generation) {
+        const uint8_t* base = dev->read(cursor->generation % count);
+        if (sectorValid(base, cursor->generation)) {
+            while (cursor->offset + sizeof(FlashLogRecord) <= dev->sectorSize) {
+                const FlashLogRecord* r = reinterpret_cast<const FlashLogRecord*>(base + cursor->offset);
+                if (!recordValid(log, r, cursor->offset)) break;
+                cursor->offset += recordSize(r->length);
+                if (r->commit == FLASH_LOG_COMMITTED) {
+                    *record = r;
+                    *payload = base + cursor->offset - recordSize(r->length) + sizeof(FlashLogRecord);
+                    return true;
+                }
+            }
+        }
+        cursor->generation++;
+        cursor->offset = sizeof(FlashLogSector);
+    }
+    return false;
+}
+
+uint32_t FlashLog_EncodeClip(const int32_t* samples, uint32_t n, uint8_t* out) {
+    uint32_t size = 0;
+    for (uint32_t i = 0; i < n; i += FLASH_LOG_BLOCK_SAMPLES) {
+        uint32_t count = n - i < FLASH_LOG_BLOCK_SAMPLES ? n - i : FLASH_LOG_BLOCK_SAMPLES;
+        uint32_t bytes = AudioCodec_Encode(samples + i, count, out + size + 2);
+        out[size] = (uint8_t)bytes;
+        out[size + 1] = (uint8_t)(bytes >> 8);
+        size += 2 + bytes;
+    }
+    return size;
+}
+
+bool FlashLog_DecodeClip(const uint8_t* payload, uint32_t length, int32_t* samples, uint32_t n) {
+    uint32_t position = 0;
+    for (uint32_t i = 0; i < n; i += FLASH_LOG_BLOCK_SAMPLES) {
+        uint32_t count = n - i < FLASH_LOG_BLOCK_SAMPLES ? n - i : FLASH_LOG_BLOCK_SAMPLES;
+        if (position + 2 > length) return false;
+        uint32_t bytes = payload[position] | (uint32_t)payload[position + 1] << 8;
+        position += 2;
+        if (bytes > length - position) return false;
+        if (!AudioCodec_Decode(payload + position, bytes, samples + i, count)) return false;
+        position += bytes;
+    }
+    return position == length;
+}
+
+uint16_t FlashLog_HeaderCrc(const FlashLogRecord* record) {
+    return AudioCodec_Crc16(reinterpret_cast<const uint8_t*>(record), offsetof(FlashLogRecord, headerCrc), 0xFFFF);
+}
+
+} // extern "C"
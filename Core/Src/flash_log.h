@@ -0,0 +1,208 @@
+/**
+ * @file    flash_log.h
+ * @brief   Circular log-structured clip store on NOR flash sectors (shared with Tools/flash_log)
+ *
+ * The log uses the sectors of a FlashLogDevice as a ring. Generation g (counts up with every
+ * sector the log opens) always lives in sector g % sectorCount, so the order survives a reset.
+ * Every sector starts with a FlashLogSector header, records follow back to back and never span
+ * sectors:
+ *   FlashLogRecord | payload, padded to a word with 0xFF
+ * The commit word of a record is programmed last. A record cut short by a reset is skipped on
+ * read, a sector whose tail cannot be parsed is closed and the next append opens a new one.
+ *
+ * Appends never wait for an erase in the normal case: opening a sector schedules the erase of the
+ * one after it (which drops the oldest clips), and the erase runs once the record is written, long
+ * before the next one comes. Erasing and programming happen in FlashLog_Poll one step at a time;
+ * FlashLog_Append only references the record, so nothing blocks the caller.
+ *
+ * Clip payload: the samples in blocks of FLASH_LOG_BLOCK_SAMPLES, each coded with audio_codec.h
+ * and preceded by its size (2 bytes, little-endian).
+ *
+ * Portable, nothing here locks: one context drives the log and reads it.
+ */
+
+#ifndef FLASH_LOG_H
+#define FLASH_LOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "audio_codec.h"
+
+#define FLASH_LOG_SECTOR_MAGIC   0x474F4C46u  /* "FLOG" */
+#define FLASH_LOG_RECORD_MAGIC   0x50494C43u  /* "CLIP" */
+#define FLASH_LOG_COMMITTED      0x00000000u
+#define FLASH_LOG_ERASED         0xFFFFFFFFu
+
+/* Codec block of the clip payload, part of the on-flash format: PIPELINE.blockSamples, which
+   flash_recorder.cpp checks (this header stays free of the C++ pipeline config) */
+#define FLASH_LOG_BLOCK_SAMPLES  250
+
+/* Worst case clip payload (every block verbatim) */
+#define FLASH_LOG_MAX_PAYLOAD(n) \
+    ((((n) + FLASH_LOG_BLOCK_SAMPLES - 1) / FLASH_LOG_BLOCK_SAMPLES) * \
+     (2 + AUDIO_CODEC_MAX_BYTES(FLASH_LOG_BLOCK_SAMPLES)))
+
+/* FlashLogClipInfo.flags */
+#define FLASH_LOG_FLAG_RESULT    0x01  /* label / best / decision / score are valid */
+
+typedef enum {
+    FLASH_LOG_DEV_IDLE = 0,
+    FLASH_LOG_DEV_BUSY,
+    FLASH_LOG_DEV_ERROR      /* Last operation failed, reading the status clears it */
+} FlashLogDevStatus;
+
+/* Flash access, all offsets relative to the log's first sector */
+typedef struct {
+    uint32_t sectorSize;     /* Bytes, multiple of 4 */
+    uint32_t sectorCount;    /* At least 2 */
+    const uint8_t* (*read)(uint32_t sector);  /* Memory-mapped sector contents, device idle */
+    void (*eraseStart)(uint32_t sector);
+    void (*programStart)(uint32_t sector, uint32_t offset, uint32_t word);
+    FlashLogDevStatus (*status)(void);
+} FlashLogDevice;
+
+/* Sector header */
+typedef struct {
+    uint32_t magic;          /* FLASH_LOG_SECTOR_MAGIC */
+    uint32_t generation;
+    uint32_t check;          /* ~generation */
+    uint32_t reserved;
+} FlashLogSector;
+
+/* Clip metadata, filled by the caller */
+typedef struct {
+    uint64_t triggerSample;  /* Audio timeline (audio_timeline.h) */
+    uint32_t uptimeMs;       /* When the clip was saved */
+    uint16_t samples;
+    uint16_t lostBlocks;     /* DMA blocks lost during the recording */
+    uint8_t label;           /* KWS result (kws.h), see flags, 0xFF = none */
+    uint8_t best;
+    uint8_t decision;
+    uint8_t flags;           /* FLASH_LOG_FLAG_* */
+    uint16_t score;          /* Probability x 65535 */
+    uint16_t reserved;       /* 0 */
+} FlashLogClipInfo;
+
+/* Record header, 48 bytes */
+typedef struct {
+    uint32_t magic;          /* FLASH_LOG_RECORD_MAGIC */
+    uint32_t length;         /* Payload bytes */
+    uint32_t id;             /* Clip number, counts up over the life of the log */
+    uint32_t reserved;
+    FlashLogClipInfo info;
+    uint16_t payloadCrc;     /* CRC-16 (AudioCodec_Crc16) of the payload */
+    uint16_t headerCrc;      /* CRC-16 of everything above */
+    uint32_t commit;         /* FLASH_LOG_COMMITTED once the record is complete */
+} FlashLogRecord;
+
+typedef struct {
+    uint32_t appended;       /* Records written */
+    uint32_t bytes;          /* Bytes programmed (headers and padding included) */
+    uint32_t busy;           /* Appends refused, previous record still being written */
+    uint32_t tooLarge;       /* Appends refused, record larger than a sector */
+    uint32_t waits;          /* Appends that had to wait for an erase */
+    uint32_t erases;
+    uint32_t errors;         /* Failed erase / program operations */
+    uint32_t closedTails;    /* Sectors closed at mount because of a torn record */
+} FlashLogStats;
+
+/* Read position, zero-initialize to start at the oldest clip */
+typedef struct {
+    uint32_t generation;
+    uint32_t offset;
+    bool started;
+} FlashLogCursor;
+
+typedef struct {
+    const FlashLogDevice* dev;
+    bool opened;              /* A sector has been opened */
+    uint32_t generation;      /* Of the sector being written */
+    uint32_t offset;          /* Next free byte in it */
+    uint32_t nextId;
+
+    /* Sector after the current one */
+    bool aheadErased;
+    bool eraseScheduled;
+    bool erasing;
+
+    /* Record being written, FlashLog_Append references the payload */
+    FlashLogRecord record;
+    const uint8_t* payload;
+    bool pending;
+    bool placed;              /* Sector and offset chosen */
+    bool waiting;             /* Counted in stats.waits */
+    uint32_t recordOffset;
+    uint32_t sectorWord;      /* Next word of a newly opened sector's header */
+    uint32_t word;            /* Next word of the record to program */
+    uint32_t words;
+    bool programming;         /* A program operation is running */
+
+    FlashLogStats stats;
+} FlashLog;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief  Attach a device and find the end of the log after a reset
+ * @note   Reads every sector once, the device must be idle
+ */
+void FlashLog_Mount(FlashLog* log, const FlashLogDevice* dev);
+
+/**
+ * @brief  Queue a record
+ * @param  payload: must stay valid until FlashLog_IsIdle
+ * @return false if the previous record is still being written or the record exceeds a sector
+ */
+bool FlashLog_Append(FlashLog* log, const FlashLogClipInfo* info, const uint8_t* payload, uint32_t length);
+
+/**
+ * @brief  Advance the background work: start the scheduled erase, program up to maxWords words
+ * @note   Waits for each word program (tens of microseconds), never for an erase
+ */
+void FlashLog_Poll(FlashLog* log, uint32_t maxWords);
+
+/**
+ * @brief  true if no record is pending (an erase may still run)
+ */
+bool FlashLog_IsIdle(const FlashLog* log);
+
+/**
+ * @brief  true while the device runs an erase or program, sectors must not be read then
+ */
+bool FlashLog_DeviceBusy(const FlashLog* log);
+
+/**
+ * @brief  Get the next committed record, oldest first
+ * @param  record, payload: point into the flash mapping
+ * @return false at the end of the log
+ * @note   Device must be idle. Payload CRC is not checked here
+ */
+bool FlashLog_Next(const FlashLog* log, FlashLogCursor* cursor, const FlashLogRecord** record,
+                   const uint8_t** payload);
+
+/**
+ * @brief  Compress a clip into the payload format
+ * @param  out: at least FLASH_LOG_MAX_PAYLOAD(n) bytes
+ * @return Payload bytes
+ */
+uint32_t FlashLog_EncodeClip(const int32_t* samples, uint32_t n, uint8_t* out);
+
+/**
+ * @brief  Decompress a clip payload
+ * @param  samples: receives n samples
+ * @return false if the payload is malformed
+ */
+bool FlashLog_DecodeClip(const uint8_t* payload, uint32_t length, int32_t* samples, uint32_t n);
+
+/**
+ * @brief  Header CRC of a record
+ */
+uint16_t FlashLog_HeaderCrc(const FlashLogRecord* record);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FLASH_LOG_H */
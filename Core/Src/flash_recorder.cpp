@@ -0,0 +1,234 @@
+// Flash clip recorder
+// Everything runs in the main loop except FlashRecorder_RequestDownload (USB interrupt).
+
+#include "flash_recorder.h"
+#include "flash_log.h"
+#include "pipeline_config.h"
+#include "usb_stream.h"
+#include "timer.h"
+#include "deferred_log.h"
+#include "main.h"
+
+static_assert(FLASH_RECORDER_FIRST_SECTOR >= FLASH_SECTOR_17 &&
+              FLASH_RECORDER_FIRST_SECTOR + FLASH_RECORDER_SECTORS - 1 <= FLASH_SECTOR_23,
+              "log sectors must be the 128 KB sectors of bank 2");
+static_assert(FLASH_RECORDER_BASE == 0x08120000u + (FLASH_RECORDER_FIRST_SECTOR - 17) * FLASH_RECORDER_SECTOR_SIZE,
+              "FLASH_RECORDER_BASE does not match FLASH_RECORDER_FIRST_SECTOR");
+static_assert(FLASH_RECORDER_CHUNK <= STREAM_MUX_MAX_PAYLOAD, "chunk must fit a stream frame");
+static_assert(FLASH_LOG_BLOCK_SAMPLES == PIPELINE.blockSamples,
+              "clips are coded in DMA blocks like the stream; a new block length changes the clip format "
+              "(update FLASH_LOG_BLOCK_SAMPLES and re-read old logs with the previous Tools/flash_log)");
+
+static const uint32_t CLIP_SAMPLES = PIPELINE.recordingSamples;
+
+// Staging buffer for the compressed clip, CPU only: CCM RAM, not loaded, not cleared
+static uint8_t staging[FLASH_LOG_MAX_PAYLOAD(CLIP_SAMPLES)] __attribute__((section(".ccmbss"), aligned(4)));
+
+// FLASH DEVICE (bank 2, programmed with 32-bit words)
+
+static const uint32_t FLASH_ERROR_FLAGS =
+    FLASH_FLAG_OPERR | FLASH_FLAG_WRPERR | FLASH_FLAG_PGAERR | FLASH_FLAG_PGPERR | FLASH_FLAG_PGSERR;
+
+static const uint8_t* deviceRead(uint32_t sector) {
+    // The data cache may still hold words from before the last erase or program
+    __HAL_FLASH_DATA_CACHE_DISABLE();
+    __HAL_FLASH_DATA_CACHE_RESET();
+    __HAL_FLASH_DATA_CACHE_ENABLE();
+    return reinterpret_cast<const uint8_t*>(FLASH_RECORDER_BASE + sector * FLASH_RECORDER_SECTOR_SIZE);
+}
+
+static void deviceEraseStart(uint32_t sector) {
+    HAL_FLASH_Unlock();
+    __HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_EOP | FLASH_ERROR_FLAGS);
+    // Starts the erase and returns, HAL_FLASHEx_Erase would wait for it (~1 s)
+    FLASH_Erase_Sector(FLASH_RECORDER_FIRST_SECTOR + sector, FLASH_VOLTAGE_RANGE_3);
+}
+
+static void deviceProgramStart(uint32_t sector, uint32_t offset, uint32_t word) {
+    HAL_FLASH_Unlock();
+    __HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_EOP | FLASH_ERROR_FLAGS);
+    MODIFY_REG(FLASH->CR, FLASH_CR_PSIZE, FLASH_PSIZE_WORD);
+    SET_BIT(FLASH->CR, FLASH_CR_PG);
+    *reinterpret_cast<volatile uint32_t*>(FLASH_RECORDER_BASE + sector * FLASH_RECORDER_SECTOR_SIZE + offset) = word;
+}
+
+static FlashLogDevStatus deviceStatus(void) {
+    if (FLASH->SR & FLASH_SR_BSY) return FLASH_LOG_DEV_BUSY;
+    CLEAR_BIT(FLASH->CR, FLASH_CR_PG | FLASH_CR_SER | FLASH_CR_SNB);
+    uint32_t errors = FLASH->SR & FLASH_ERROR_FLAGS;
+    __HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_EOP | errors);
+    HAL_FLASH_Lock();
+    return errors ? FLASH_LOG_DEV_ERROR : FLASH_LOG_DEV_IDLE;
+}
+
+static const FlashLogDevice device = {
+    FLASH_RECORDER_SECTOR_SIZE, FLASH_RECORDER_SECTORS,
+    deviceRead, deviceEraseStart, deviceProgramStart, deviceStatus
+};
+
+// STATE
+static FlashLog flashLog;
+static bool mounted = false;
+static uint32_t savedBytes = 0;       // Compressed payload of the clips saved since boot
+static uint32_t savedSamples = 0;
+static uint32_t maxEncodeUs = 0;
+
+// Download (main loop), requested from the USB interrupt
+static volatile bool downloadRequested = false;
+static bool downloading = false;
+static FlashLogCursor cursor;
+static const FlashLogRecord* sendRecord = nullptr;  // Record being sent
+static uint32_t sendId = 0;
+static uint32_t sendOffset = 0;
+static uint32_t sentClips = 0;
+
+static uint16_t toUnit16(float p) {
+    if (p <= 0.0f) return 0;
+    if (p >= 1.0f) return 0xFFFF;
+    return (uint16_t)(p * 65535.0f + 0.5f);
+}
+
+static void onUsbReceive(const uint8_t* data, uint32_t length) {
+    for (uint32_t i = 0; i < length; i++) {
+        if (data[i] == FLASH_RECORDER_CMD_DOWNLOAD) FlashRecorder_RequestDownload();
+    }
+}
+
+// Send chunks while the USB ring has room, the next poll continues
+static void downloadStep(void) {
+    if (downloadRequested) {
+        downloadRequested = false;
+        downloading = true;
+        cursor = FlashLogCursor();
+        sendRecord = nullptr;
+        sentClips = 0;
+    }
+    if (!downloading || FlashLog_DeviceBusy(&flashLog)) return;
+    if (!UsbStream_IsOpen()) {
+        downloading = false;
+        DLOG("[REC] Download aborted, USB port closed");
+        return;
+    }
+
+    for (uint32_t chunks = 0; chunks < 4; chunks++) {
+        if (!sendRecord) {
+            const uint8_t* payload;
+            if (!FlashLog_Next(&flashLog, &cursor, &sendRecord, &payload)) {
+                if (!UsbStream_CanSend(sizeof(sentClips))) return;
+                UsbStream_Send(STREAM_MUX_CLIPS, FLASH_RECORDER_END_TAG, &sentClips, sizeof(sentClips));
+                downloading = false;
+                DLOG("[REC] Download complete, %lu clips", (unsigned long)sentClips);
+                return;
+            }
+            sendId = sendRecord->id;
+            sendOffset = 0;
+        }
+
+        // An erase since the last poll may have taken the record, the host sees a short clip
+        if (sendRecord->magic != FLASH_LOG_RECORD_MAGIC || sendRecord->id != sendId) {
+            sendRecord = nullptr;
+            continue;
+        }
+
+        uint32_t size = sizeof(FlashLogRecord) + sendRecord->length;
+        uint32_t length = size - sendOffset;
+        if (length > FLASH_RECORDER_CHUNK) length = FLASH_RECORDER_CHUNK;
+        if (!UsbStream_CanSend(length)) return;
+        UsbStream_Send(STREAM_MUX_CLIPS, sendId, reinterpret_cast<const uint8_t*>(sendRecord) + sendOffset, length);
+        sendOffset += length;
+        if (sendOffset == size) {
+            sendRecord = nullptr;
+            sentClips++;
+        }
+    }
+}
+
+extern "C" {
+
+void FlashRecorder_Init(void) {
+    uint32_t start = cycleCounterGet();
+    FlashLog_Mount(&flashLog, &device);
+    uint32_t us = (uint32_t)((uint64_t)(cycleCounterGet() - start) * 1000000u / SystemCoreClock);
+    mounted = true;
+
+    uint32_t clips = 0, bytes = 0;
+    FlashLogCursor scan = FlashLogCursor();
+    const FlashLogRecord* record;
+    const uint8_t* payload;
+    while (FlashLog_Next(&flashLog, &scan, &record, &payload)) {
+        clips++;
+        bytes += record->length;
+    }
+    DLOG("[REC] Flash log: %lu clips (%lu kB), next id %lu, mounted in %lu us%s",
+         (unsigned long)clips, (unsigned long)(bytes / 1024), (unsigned long)flashLog.nextId, (unsigned long)us,
+         flashLog.stats.closedTails ? ", torn record skipped" : "");
+
+    UsbStream_SetReceiveCallback(onUsbReceive);
+}
+
+bool FlashRecorder_SaveClip(const int32_t* samples, uint32_t n, uint64_t triggerSample, uint32_t lostBlocks,
+                            const KwsResult* result) {
+#if FLASH_RECORDER_ENABLED
+    if (!mounted || n > CLIP_SAMPLES) return false;
+    // The staging buffer still holds the previous clip
+    if (!FlashLog_IsIdle(&flashLog)) {
+        flashLog.stats.busy++;
+        return false;
+    }
+
+    FlashLogClipInfo clip = {};
+    clip.triggerSample = triggerSample;
+    clip.uptimeMs = HAL_GetTick();
+    clip.samples = (uint16_t)n;
+    clip.lostBlocks = (uint16_t)(lostBlocks > 0xFFFF ? 0xFFFF : lostBlocks);
+    if (result) {
+        clip.label = (uint8_t)result->label;
+        clip.best = (uint8_t)result->best;
+        clip.decision = (uint8_t)result->decision;
+        clip.flags = FLASH_LOG_FLAG_RESULT;
+        clip.score = toUnit16(result->score);
+    }
+
+    uint32_t start = cycleCounterGet();
+    uint32_t length = FlashLog_EncodeClip(samples, n, staging);
+    uint32_t us = (uint32_t)((uint64_t)(cycleCounterGet() - start) * 1000000u / SystemCoreClock);
+    if (us > maxEncodeUs) maxEncodeUs = us;
+
+    if (!FlashLog_Append(&flashLog, &clip, staging, length)) return false;
+    savedBytes += length;
+    savedSamples += n;
+    return true;
+#else
+    (void)samples;
+    (void)n;
+    (void)triggerSample;
+    (void)lostBlocks;
+    (void)result;
+    return false;
+#endif
+}
+
+void FlashRecorder_Poll(void) {
+    if (!mounted) return;
+    FlashLog_Poll(&flashLog, FLASH_RECORDER_POLL_WORDS);
+    downloadStep();
+}
+
+void FlashRecorder_RequestDownload(void) {
+    downloadRequested = true;
+}
+
+void FlashRecorder_PrintStats(void) {
+    const FlashLogStats& s = flashLog.stats;
+    if (!mounted || (s.appended == 0 && s.busy == 0 && s.errors == 0)) return;
+    // Bits per sample of the compressed clips (18-bit input)
+    uint32_t bitsX10 = savedSamples ? (uint32_t)((uint64_t)savedBytes * 80u / savedSamples) : 0;
+    DLOG("[REC] %lu clips saved (%lu.%lu bit/sample, encode max %lu us), %lu skipped busy, %lu waited for erase",
+         (unsigned long)s.appended, (unsigned long)(bitsX10 / 10u), (unsigned long)(bitsX10 % 10u),
+         (unsigned long)maxEncodeUs, (unsigned long)s.busy, (unsigned long)s.waits);
+    if (s.errors || s.tooLarge) {
+        DLOG("[REC] %lu flash errors, %lu clips too large", (unsigned long)s.errors, (unsigned long)s.tooLarge);
+    }
+}
+
+} // extern "C"
@@ -0,0 +1,88 @@
+/**
+ * @file    flash_recorder.h
+ * @brief   Every recording, compressed and tagged with its KWS result, in a flash ring (flash_log.h)
+ *
+ * The log takes the last FLASH_RECORDER_SECTORS 128 KB sectors of bank 2. The linker script keeps
+ * the program in bank 1, so code and constants are fetched from the other bank while the log
+ * erases or programs (read-while-write): the audio interrupts never wait for the flash. A clip
+ * compresses to about 20 KB, the default 512 KB keep the last ~20 of them; a sector's erase
+ * drops its clips about one sector ahead of the writer.
+ *
+ * FlashRecorder_SaveClip compresses the recording into a staging buffer in CCM RAM and returns,
+ * FlashRecorder_Poll (main loop) programs it and runs the erases in the background.
+ *
+ * Download: the host sends FLASH_RECORDER_CMD_DOWNLOAD over the USB port (usb_stream.h), e.g.
+ *   printf D > /dev/ttyACM0
+ * and every clip in the log, oldest first, comes back on the STREAM_MUX_CLIPS channel: the
+ * record (FlashLogRecord + payload) in chunks of up to FLASH_RECORDER_CHUNK bytes tagged with
+ * the clip id, then one frame tagged FLASH_RECORDER_END_TAG carrying the clip count (4 bytes).
+ * Tools/flash_log turns a capture into WAV files and a CSV with the metadata.
+ */
+
+#ifndef FLASH_RECORDER_H
+#define FLASH_RECORDER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "kws.h"
+
+/* 0 = recordings are not saved */
+#ifndef FLASH_RECORDER_ENABLED
+#define FLASH_RECORDER_ENABLED      1
+#endif
+
+/* Log sectors: FLASH_SECTOR_20..23 at 0x08180000 (bank 2, 128 KB each) */
+#define FLASH_RECORDER_FIRST_SECTOR 20
+#define FLASH_RECORDER_SECTORS      4
+#define FLASH_RECORDER_BASE         0x08180000u
+#define FLASH_RECORDER_SECTOR_SIZE  0x20000u
+
+/* Words programmed per FlashRecorder_Poll, ~16 us each (x32 at 2.7 - 3.6 V) */
+#define FLASH_RECORDER_POLL_WORDS   32
+
+#define FLASH_RECORDER_CMD_DOWNLOAD 'D'
+#define FLASH_RECORDER_CHUNK        1024
+#define FLASH_RECORDER_END_TAG      0xFFFFFFFFu
+
+/**
+ * @brief  Find the end of the log and listen for the download command
+ * @note   After UsbStream_Init
+ */
+void FlashRecorder_Init(void);
+
+/**
+ * @brief  Compress a recording and queue it for the flash
+ * @param  triggerSample, lostBlocks: from AudioProcessing_GetRecordingInfo
+ * @param  result: KWS result, nullptr if inference failed
+ * @return false if the previous clip is still being written (the recording is skipped)
+ * @note   Main loop, the samples are no longer needed when it returns
+ */
+bool FlashRecorder_SaveClip(const int32_t* samples, uint32_t n, uint64_t triggerSample, uint32_t lostBlocks,
+                            const KwsResult* result);
+
+/**
+ * @brief  Program the queued clip, run scheduled erases, send the download
+ * @note   Main loop
+ */
+void FlashRecorder_Poll(void);
+
+/**
+ * @brief  Start sending all clips over USB
+ * @note   Safe from any context
+ */
+void FlashRecorder_RequestDownload(void);
+
+/**
+ * @brief  Print saved clips, compression, erase waits and errors
+ */
+void FlashRecorder_PrintStats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FLASH_RECORDER_H */
@@ -0,0 +1,40 @@
+/**
+ * @file    i2s_unpack.h
+ * @brief   18-bit microphone samples from the I2S DMA buffer (shared with Tools/kernel_bench)
+ *
+ * The SPH0645 sends 24-bit frames on a stereo bus, the DMA stores every channel as two 16-bit
+ * halfwords: [left high, left low, right high, right low]. Only the left channel carries data;
+ * high and low half give a 32-bit word whose top 18 bits are the sample.
+ *
+ * C++ only: the sample count is a template type, BlockCount (pipeline_config.h) gives the RX
+ * callbacks a loop with a constant trip count.
+ */
+
+#ifndef I2S_UNPACK_H
+#define I2S_UNPACK_H
+
+#include <stdint.h>
+
+/* Halfwords per mono sample (two channels, two halfwords each) */
+#define I2S_UNPACK_STRIDE  4
+
+/**
+ * @brief  Merge the left-channel halfwords and keep the 18-bit sample
+ * @param  in: samples * I2S_UNPACK_STRIDE halfwords from the DMA buffer
+ * @param  out: samples 18-bit values
+ * @param  samples: uint32_t, or a FixedCount for the configured block
+ */
+extern "C++" {
+
+template <typename Count>
+static inline void I2sUnpack_Block(const uint16_t* in, int32_t* out, Count samples) {
+    for (uint32_t j = 0; j < samples; j++, in += I2S_UNPACK_STRIDE) {
+        // Merge two 16-bit values into 32-bit, shift right 14 bits to get the 18-bit sample
+        int32_t merged = (int32_t)(((uint32_t)in[0] << 16) | in[1]);
+        out[j] = merged >> 14;
+    }
+}
+
+} // extern "C++"
+
+#endif /* I2S_UNPACK_H */
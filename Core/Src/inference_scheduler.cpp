@@ -0,0 +1,157 @@
+// Inference scheduler
+// Every slot has one atomic word: generation (upper 24 bits) | state (lower 8 bits).
+// All transitions are compare-and-swap on that word (LDREX/STREX on the M4), the generation
+// is bumped whenever a slot is freed, so a stale handle can never cancel or observe a newer job.
+//
+//   FREE --submit--> CLAIMED --fields written--> QUEUED --poll--> RUNNING --last step--> FREE (gen+1)
+//                                                  \--cancel--> FREE (gen+1)
+//
+// Only InferenceScheduler_Poll (main loop) starts and finishes jobs, so the running slot index
+// is a plain variable.
+
+#include "inference_scheduler.h"
+#include <atomic>
+
+enum SlotState : uint32_t {
+    SLOT_FREE = 0,
+    SLOT_CLAIMED,
+    SLOT_QUEUED,
+    SLOT_RUNNING
+};
+
+struct JobSlot {
+    std::atomic<uint32_t> word;
+    // Only written while CLAIMED, only read while QUEUED/RUNNING of the same generation
+    InferenceJobFn run;
+    InferenceDoneFn done;
+    void* context;
+    uint8_t priority;
+    uint32_t ticket;  // submission order within a priority
+};
+
+static_assert(INFERENCE_MAX_JOBS <= 256, "slot index must fit the handle");
+
+// SLOTS
+static JobSlot slots[INFERENCE_MAX_JOBS];
+static std::atomic<uint32_t> nextTicket(0);
+// Slot in RUNNING, -1 if none (main loop only)
+static int running = -1;
+
+static inline uint32_t pack(uint32_t generation, uint32_t state) {
+    return (generation << 8) | state;
+}
+
+static inline uint32_t generationOf(uint32_t word) {
+    return word >> 8;
+}
+
+static inline uint32_t stateOf(uint32_t word) {
+    return word & 0xFFu;
+}
+
+// Generation 0 is never used, so handle 0 stays invalid
+static inline uint32_t nextGeneration(uint32_t generation) {
+    generation = (generation + 1) & 0x00FFFFFFu;
+    return generation ? generation : 1;
+}
+
+static inline InferenceJobHandle makeHandle(uint32_t generation, uint32_t slot) {
+    return (generation << 8) | slot;
+}
+
+extern "C" {
+
+void InferenceScheduler_Init(void) {
+    for (uint32_t i = 0; i < INFERENCE_MAX_JOBS; i++) {
+        slots[i].word.store(pack(1, SLOT_FREE), std::memory_order_relaxed);
+    }
+    nextTicket.store(0, std::memory_order_relaxed);
+    running = -1;
+}
+
+InferenceJobHandle InferenceScheduler_Submit(InferencePriority priority, InferenceJobFn run,
+                                             InferenceDoneFn done, void* context) {
+    for (uint32_t i = 0; i < INFERENCE_MAX_JOBS; i++) {
+        JobSlot& slot = slots[i];
+        uint32_t word = slot.word.load(std::memory_order_relaxed);
+        if (stateOf(word) != SLOT_FREE) continue;
+
+        uint32_t generation = generationOf(word);
+        if (!slot.word.compare_exchange_strong(word, pack(generation, SLOT_CLAIMED), std::memory_order_acquire)) {
+            continue;  // taken by a preempting submitter
+        }
+
+        slot.run = run;
+        slot.done = done;
+        slot.context = context;
+        slot.priority = (uint8_t)priority;
+        slot.ticket = nextTicket.fetch_add(1, std::memory_order_relaxed);
+        slot.word.store(pack(generation, SLOT_QUEUED), std::memory_order_release);
+        return makeHandle(generation, i);
+    }
+    return INFERENCE_JOB_INVALID;
+}
+
+bool InferenceScheduler_Cancel(InferenceJobHandle job) {
+    uint32_t index = job & 0xFFu;
+    if (job == INFERENCE_JOB_INVALID || index >= INFERENCE_MAX_JOBS) return false;
+
+    uint32_t generation = job >> 8;
+    uint32_t expected = pack(generation, SLOT_QUEUED);
+    return slots[index].word.compare_exchange_strong(expected, pack(nextGeneration(generation), SLOT_FREE),
+                                                     std::memory_order_acq_rel);
+}
+
+InferenceJobState InferenceScheduler_GetState(InferenceJobHandle job) {
+    uint32_t index = job & 0xFFu;
+    if (job == INFERENCE_JOB_INVALID || index >= INFERENCE_MAX_JOBS) return INFERENCE_JOB_FINISHED;
+
+    uint32_t word = slots[index].word.load(std::memory_order_acquire);
+    if (generationOf(word) != job >> 8) return INFERENCE_JOB_FINISHED;
+
+    switch (stateOf(word)) {
+        case SLOT_CLAIMED:
+        case SLOT_QUEUED:  return INFERENCE_JOB_QUEUED;
+        case SLOT_RUNNING: return INFERENCE_JOB_RUNNING;
+        default:           return INFERENCE_JOB_FINISHED;
+    }
+}
+
+void InferenceScheduler_Poll(void) {
+    while (running < 0) {
+        // Pick the oldest job of the highest priority
+        int best = -1;
+        uint32_t bestWord = 0;
+        for (uint32_t i = 0; i < INFERENCE_MAX_JOBS; i++) {
+            uint32_t word = slots[i].word.load(std::memory_order_acquire);
+            if (stateOf(word) != SLOT_QUEUED) continue;
+            if (best < 0 ||
+                slots[i].priority > slots[best].priority ||
+                (slots[i].priority == slots[best].priority && (int32_t)(slots[i].ticket - slots[best].ticket) < 0)) {
+                best = (int)i;
+                bestWord = word;
+            }
+        }
+        if (best < 0) return;
+
+        uint32_t generation = generationOf(bestWord);
+        if (slots[best].word.compare_exchange_strong(bestWord, pack(generation, SLOT_RUNNING),
+                                                     std::memory_order_acquire)) {
+            running = best;
+        }
+        // else cancelled in the meantime, pick again
+    }
+
+    JobSlot& slot = slots[running];
+    if (!slot.run(slot.context)) return;
+
+    // Free the slot before the callback, so the callback may submit a follow-up job
+    InferenceDoneFn done = slot.done;
+    void* context = slot.context;
+    uint32_t generation = generationOf(slot.word.load(std::memory_order_relaxed));
+    running = -1;
+    slot.word.store(pack(nextGeneration(generation), SLOT_FREE), std::memory_order_release);
+    if (done) done(context);
+}
+
+} // extern "C"
@@ -0,0 +1,93 @@
+/**
+ * @file    inference_scheduler.h
+ * @brief   Runs inference jobs in slices from the main loop
+ *
+ * A job is a step function that does a bounded piece of work and returns whether it is done.
+ * The main loop calls InferenceScheduler_Poll once per pass, which runs one step of the current
+ * job, so the governor, log flush, UDP and flash polling and the LEDs keep running between steps.
+ * Audio is protected by interrupt priority: the I2S DMA interrupt and every other peripheral
+ * interrupt preempt thread mode, so a step never delays a block. The main loop waits at most the
+ * longest step (for KWS the network run, Kws_Step).
+ * Jobs are taken by priority, FIFO within a priority; a started job runs to completion before
+ * the next one starts. Queued jobs can be cancelled.
+ * Submit, cancel and completion use atomic state words only (no IRQ masking, no locks),
+ * so jobs may be submitted from the main loop or from any interrupt.
+ *
+ * Steps and the completion callback run in thread mode, like the rest of the main loop.
+ */
+
+#ifndef INFERENCE_SCHEDULER_H
+#define INFERENCE_SCHEDULER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Number of job slots (queued + running) */
+#define INFERENCE_MAX_JOBS  4
+
+/* Returned by InferenceScheduler_Submit if all slots are in use */
+#define INFERENCE_JOB_INVALID  0u
+
+typedef uint32_t InferenceJobHandle;
+
+typedef enum {
+    INFERENCE_PRIORITY_LOW = 0,
+    INFERENCE_PRIORITY_NORMAL,
+    INFERENCE_PRIORITY_HIGH
+} InferencePriority;
+
+typedef enum {
+    INFERENCE_JOB_QUEUED = 0,
+    INFERENCE_JOB_RUNNING,
+    INFERENCE_JOB_FINISHED   /* Completed or cancelled, the handle is stale */
+} InferenceJobState;
+
+/* One step of the job, returns true once the job is done */
+typedef bool (*InferenceJobFn)(void* context);
+/* Completion callback, runs from InferenceScheduler_Poll right after the last step */
+typedef void (*InferenceDoneFn)(void* context);
+
+/**
+ * @brief  Clear all slots
+ * @note   Call once before the first submit
+ */
+void InferenceScheduler_Init(void);
+
+/**
+ * @brief  Queue a job, it starts on a later InferenceScheduler_Poll
+ * @param  priority: higher priorities are taken first
+ * @param  run: job step, called until it returns true
+ * @param  done: completion callback, may be NULL
+ * @param  context: passed to run and done
+ * @return Job handle, INFERENCE_JOB_INVALID if all slots are in use
+ */
+InferenceJobHandle InferenceScheduler_Submit(InferencePriority priority, InferenceJobFn run,
+                                             InferenceDoneFn done, void* context);
+
+/**
+ * @brief  Remove a job that has not started yet
+ * @return true if the job will not run (done is not called either),
+ *         false if it is already running or finished
+ */
+bool InferenceScheduler_Cancel(InferenceJobHandle job);
+
+/**
+ * @brief  Get the state of a job
+ */
+InferenceJobState InferenceScheduler_GetState(InferenceJobHandle job);
+
+/**
+ * @brief  Run one step of the current job, or start the next queued one
+ * @note   Call from the main loop only (thread mode, not reentrant)
+ */
+void InferenceScheduler_Poll(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INFERENCE_SCHEDULER_H */
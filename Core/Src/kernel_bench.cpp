@@ -0,0 +1,180 @@
+// DSP kernel microbenchmarks
+// Portable, shared between the firmware (benchmark.cpp) and Tools/kernel_bench.
+
+#include "kernel_bench.h"
+#include "kernel_budgets.h"
+#include "pipeline_config.h"
+#include "block_stats.h"
+#include "agc.h"
+#include "trigger_detector.h"
+#include "feature_extraction.h"
+#include "flash_log.h"
+#include "audio_stream.h"
+#include <math.h>
+#include <string.h>
+
+static const uint32_t BLOCK_SAMPLES = PIPELINE.blockSamples;
+static const uint32_t CLIP_FIRST = 4000;        // Test recording samples in the scratch area
+static const uint32_t CLIP_SAMPLES = 4000;      // 16 flash log blocks for the encoder
+static const uint32_t FRAME_FIRST = 3000;       // Frame offset within the clip, in the loud part
+
+// SCRATCH LAYOUT
+struct Scratch {
+    uint16_t raw[BLOCK_SAMPLES * I2S_UNPACK_STRIDE];  // DMA buffer half, the clip's first block
+    int32_t clip[CLIP_SAMPLES];
+    int32_t unpacked[BLOCK_SAMPLES];
+    int32_t gained[BLOCK_SAMPLES];
+    float mfcc[FEATURES_NUM_MFCC];
+    BlockStats clipStats;                             // Of the clip's first block, AGC input
+    uint8_t frame[AUDIO_STREAM_MAX_FRAME(BLOCK_SAMPLES)];
+    uint8_t encoded[FLASH_LOG_MAX_PAYLOAD(CLIP_SAMPLES)];
+};
+static_assert(sizeof(Scratch) <= KERNEL_BENCH_SCRATCH_BYTES, "test vectors must fit the scratch area");
+static_assert(FRAME_FIRST + FEATURES_FRAME_LENGTH <= CLIP_SAMPLES, "frame must lie within the clip");
+
+// STATE
+static Scratch* s = nullptr;
+static TriggerDetector detector;
+
+// KERNELS
+
+static void runUnpack(void) {
+    I2sUnpack_Block(s->raw, s->unpacked, BlockCount());
+}
+
+static void runBlockStats(void) {
+    BlockStats stats;
+    BlockStats_Compute(s->clip, BLOCK_SAMPLES, s->clip[0], &stats);
+    __asm__ volatile("" : : "r"(&stats) : "memory");
+}
+
+static void runAgc(void) {
+    Agc_Process(s->clip, s->gained, BLOCK_SAMPLES, &s->clipStats);
+}
+
+static void detectorBlock(const int32_t* x) {
+    // Restart every run, else the detector sits in a recording after the first runs
+    TriggerDetectorParams params;
+    TriggerDetector_DefaultParams(&params);
+    TriggerDetector_Init(&detector, &params);
+    TriggerDetector_BlockStart(&detector);
+    for (uint32_t i = 0; i < BLOCK_SAMPLES; i++) TriggerDetector_Sample(&detector, x[i], CLIP_FIRST + i);
+}
+
+static void runDetector(void) {
+    detectorBlock(s->clip);
+}
+
+static void streamFrame(const int32_t* x) {
+    AudioBlock block = { CLIP_FIRST, CLIP_FIRST / BLOCK_SAMPLES, 0 };
+    AudioStream_BuildFrame(&block, x, BLOCK_SAMPLES, s->frame);
+}
+
+static void runStreamFrame(void) {
+    streamFrame(s->clip);
+}
+
+// processBlock (audio_processing.cpp) with an open capture stream, without its I/O: the frame is
+// built but not queued, and of Audio1Sec only the detector loop runs (the trigger on the test
+// block starts no recording, the ring and recording stores and pre-roll DMA requests are left out)
+static void runRxBlock(void) {
+    I2sUnpack_Block(s->raw, s->unpacked, BlockCount());
+    BlockStats stats;
+    BlockStats_Update(s->unpacked, BLOCK_SAMPLES, CLIP_FIRST / BLOCK_SAMPLES, &stats);
+    Agc_Process(s->unpacked, s->gained, BLOCK_SAMPLES, &stats);
+    streamFrame(s->unpacked);
+    detectorBlock(s->unpacked);
+}
+
+#if FEATURES_HAS_FLOAT
+static void runFftFrame(void) {
+    Features_FrameSpectrum(&s->clip[FRAME_FIRST]);
+}
+
+static void runMelFrame(void) {
+    Features_FrameMel();
+}
+
+static void runDctFrame(void) {
+    Features_FrameDct(s->mfcc);
+}
+#endif
+
+static void runClipEncode(void) {
+    FlashLog_EncodeClip(s->clip, CLIP_SAMPLES, s->encoded);
+}
+
+// Budgets from kernel_budgets.h, generated from a board run (KERNEL_BUDGET_<NAME>)
+static const KernelBenchKernel kernels[] = {
+    { "i2s_unpack", "sample", BLOCK_SAMPLES, KERNEL_BUDGET_I2S_UNPACK, runUnpack },
+    { "block_stats", "sample", BLOCK_SAMPLES, KERNEL_BUDGET_BLOCK_STATS, runBlockStats },
+    { "agc", "sample", BLOCK_SAMPLES, KERNEL_BUDGET_AGC, runAgc },
+    { "trigger_detector", "sample", BLOCK_SAMPLES, KERNEL_BUDGET_TRIGGER_DETECTOR, runDetector },
+    { "stream_frame", "sample", BLOCK_SAMPLES, KERNEL_BUDGET_STREAM_FRAME, runStreamFrame },
+    { "rx_block", "sample", BLOCK_SAMPLES, KERNEL_BUDGET_RX_BLOCK, runRxBlock },
+#if FEATURES_HAS_FLOAT
+    { "fft_frame", "frame", 1, KERNEL_BUDGET_FFT_FRAME, runFftFrame },
+    { "mel_frame", "frame", 1, KERNEL_BUDGET_MEL_FRAME, runMelFrame },
+    { "dct_frame", "frame", 1, KERNEL_BUDGET_DCT_FRAME, runDctFrame },
+#endif
+    { "clip_encode", "sample", CLIP_SAMPLES, KERNEL_BUDGET_CLIP_ENCODE, runClipEncode },
+};
+
+static const KernelBenchLayer layers[] = {
+    { "conv2d_0", 0, 209984, KERNEL_BUDGET_CONV2D_0 },  // Convolution and its ReLU node
+    { "conv2d_1", 1, 20800, KERNEL_BUDGET_CONV2D_1 },
+    { "conv2d_2", 3, 19016, KERNEL_BUDGET_CONV2D_2 },   // Pointwise, ReLU and average pool fused
+    { "gemm_5", 5, 2190, KERNEL_BUDGET_GEMM_5 },
+};
+
+extern "C" {
+
+void KernelBench_TestVector(int32_t* x, uint32_t first, uint32_t n) {
+    const float twoPi = 2.0f * 3.14159265f;
+    const uint32_t length = PIPELINE.recordingSamples;
+    uint32_t seed = 0x2545F491u;
+    float phase = 0.0f;
+    for (uint32_t i = 0; i < first + n; i++) {
+        float frequency = 200.0f + 2800.0f * (float)i / (float)length;
+        phase += twoPi * frequency / (float)PIPELINE.sampleRate;
+        if (phase > twoPi) phase -= twoPi;
+        seed = seed * 1664525u + 1013904223u;
+        if (i < first) continue;
+        int32_t noise = (int32_t)(seed >> 22) - 512;
+        float envelope = (float)i / (float)length;
+        x[i - first] = 2000 + (int32_t)(80000.0f * envelope * envelope * sinf(phase)) + noise;
+    }
+}
+
+void KernelBench_Setup(void* scratch) {
+    s = static_cast<Scratch*>(scratch);
+    memset(s, 0, sizeof(Scratch));
+    KernelBench_TestVector(s->clip, CLIP_FIRST, CLIP_SAMPLES);
+
+    // DMA layout of the clip's first block: left channel high / low halfword, right channel empty
+    for (uint32_t j = 0; j < BLOCK_SAMPLES; j++) {
+        uint32_t word = (uint32_t)s->clip[j] << 14;
+        s->raw[j * I2S_UNPACK_STRIDE] = (uint16_t)(word >> 16);
+        s->raw[j * I2S_UNPACK_STRIDE + 1] = (uint16_t)word;
+    }
+
+    BlockStats_Compute(s->clip, BLOCK_SAMPLES, s->clip[0], &s->clipStats);
+
+#if FEATURES_HAS_FLOAT
+    // The mel and DCT kernels work on the spectrum and energies the previous stage left behind
+    Features_FrameSpectrum(&s->clip[FRAME_FIRST]);
+    Features_FrameMel();
+#endif
+}
+
+const KernelBenchKernel* KernelBench_Kernels(uint32_t* count) {
+    *count = sizeof(kernels) / sizeof(kernels[0]);
+    return kernels;
+}
+
+const KernelBenchLayer* KernelBench_Layers(uint32_t* count) {
+    *count = sizeof(layers) / sizeof(layers[0]);
+    return layers;
+}
+
+} // extern "C"
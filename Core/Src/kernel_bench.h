@@ -0,0 +1,84 @@
+/**
+ * @file    kernel_bench.h
+ * @brief   DSP kernel microbenchmarks, shared by the target benchmark mode and Tools/kernel_bench
+ *
+ * One kernel table for both builds: the firmware times every kernel with the DWT cycle counter
+ * (benchmark.h, USER_Btn at boot), the host binary with the steady clock in the style of Google
+ * Benchmark. The kernels call the firmware functions on fixed test vectors written by
+ * KernelBench_Setup into a caller-provided scratch area (the recording buffer on the target).
+ *
+ * Network layers are timed per platform under the names of KernelBench_Layers: the X-CUBE-AI
+ * observer on the target (Kws_ProfileLayers), the reference network of Tools/kws_eval on the
+ * host.
+ *
+ * Regression thresholds:
+ *   - target: budgetCycles, the most one run may take on the STM32F429 at 168 MHz; a change
+ *     that exceeds one is reported as "status=over" and counted in the final "[BENCH] done"
+ *     line. The budgets live in kernel_budgets.h, generated from the UART log of a board run:
+ *     kernel_bench --budgets <log> --write Core/Src/kernel_budgets.h sets each to the measured
+ *     minimum plus --headroom (default 15 %). Until a board run is converted they are 0 and
+ *     the target only reports; the host comparison below is then the only gate.
+ *   - host: Tools/kernel_bench --compare against a baseline saved from the previous build on
+ *     the same machine, a kernel slower by more than the tolerance fails the run.
+ * rx_block is processBlock, the body of both RX callbacks (audio_processing.cpp), with an open
+ * capture stream and its I/O left out: unpack, block statistics with the seqlock publish, AGC,
+ * the stream frame (codec and CRC, also alone as stream_frame) and the trigger detector.
+ */
+
+#ifndef KERNEL_BENCH_H
+#define KERNEL_BENCH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/* Scratch for the test vectors and outputs, word aligned */
+#define KERNEL_BENCH_SCRATCH_BYTES  32768
+
+typedef struct {
+    const char* name;
+    const char* unit;         /* What items counts */
+    uint32_t items;           /* Units per run */
+    uint32_t budgetCycles;    /* Target limit per run, 0 = none */
+    void (*run)(void);
+} KernelBenchKernel;
+
+typedef struct {
+    const char* name;
+    uint16_t layerId;         /* X-CUBE-AI layer id (network.c), c-nodes of one layer are summed */
+    uint32_t macc;            /* Multiply-accumulates, network_generate_report.txt */
+    uint32_t budgetCycles;
+} KernelBenchLayer;
+
+/**
+ * @brief  Write the test vectors into the scratch area and reset the kernels' state
+ * @param  scratch: KERNEL_BENCH_SCRATCH_BYTES, must stay untouched while kernels run
+ * @note   Features_Init and Agc_Init must have run
+ */
+void KernelBench_Setup(void* scratch);
+
+/**
+ * @brief  Kernel table
+ * @param  count: receives the number of kernels
+ */
+const KernelBenchKernel* KernelBench_Kernels(uint32_t* count);
+
+/**
+ * @brief  Network layer table, in execution order
+ */
+const KernelBenchLayer* KernelBench_Layers(uint32_t* count);
+
+/**
+ * @brief  Samples first .. first + n - 1 of the 1 second test recording
+ * @note   Chirp 200 Hz .. 3 kHz rising to 60 % of full scale, microphone DC offset, LCG noise;
+ *         the same on every board and on the host
+ */
+void KernelBench_TestVector(int32_t* x, uint32_t first, uint32_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* KERNEL_BENCH_H */
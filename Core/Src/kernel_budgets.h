@@ -0,0 +1,27 @@
+/**
+ * @file    kernel_budgets.h
+ * @brief   Target cycle budgets of the kernel benchmarks (see kernel_bench.h), 0 = no budget
+ *
+ * Generated by: kernel_bench --budgets <benchmark log> --write kernel_budgets.h
+ * Board run:    none (no budgets, the target reports without status until a log is converted)
+ */
+
+#ifndef KERNEL_BUDGETS_H
+#define KERNEL_BUDGETS_H
+
+#define KERNEL_BUDGET_I2S_UNPACK        0
+#define KERNEL_BUDGET_BLOCK_STATS       0
+#define KERNEL_BUDGET_AGC               0
+#define KERNEL_BUDGET_TRIGGER_DETECTOR  0
+#define KERNEL_BUDGET_STREAM_FRAME      0
+#define KERNEL_BUDGET_RX_BLOCK          0
+#define KERNEL_BUDGET_FFT_FRAME         0
+#define KERNEL_BUDGET_MEL_FRAME         0
+#define KERNEL_BUDGET_DCT_FRAME         0
+#define KERNEL_BUDGET_CLIP_ENCODE       0
+#define KERNEL_BUDGET_CONV2D_0          0
+#define KERNEL_BUDGET_CONV2D_1          0
+#define KERNEL_BUDGET_CONV2D_2          0
+#define KERNEL_BUDGET_GEMM_5            0
+
+#endif /* KERNEL_BUDGETS_H */
@@ -0,0 +1,209 @@
+// Keyword spotting cascade
+// Features are written straight into the network input tensor (it lives in the shared activation pool),
+// the silence check reads them from there before the network overwrites the activations.
+
+#include "kws.h"
+#include "feature_extraction.h"
+#include "pipeline_config.h"
+#include "kws_decision.h"
+#include "kws_calibration.h"
+#include "timer.h"
+#include "ai_model.h"
+#include "ai_platform_interface.h"
+#include "kws_labels.h"
+#include "trace.h"
+#include "deferred_log.h"
+#include "usb_stream.h"
+#include <stdio.h>
+
+// PIPELINE (pipeline_config.h) against the generated model, network.h
+static_assert(PIPELINE.numFrames == AI_NETWORK_IN_1_HEIGHT, "feature frames must match the model input");
+static_assert(PIPELINE.numMfcc == AI_NETWORK_IN_1_WIDTH, "feature coefficients must match the model input");
+static_assert(AI_NETWORK_IN_1_CHANNEL == 1, "the model input must be one MFCC matrix");
+static_assert(PIPELINE.featureSize() == CommandModel::inputSize, "feature matrix must fill the model input");
+static_assert(KWS_NUM_LABELS == CommandModel::outputSize, "one label per model output");
+
+// NETWORK (activations in the shared pool, see ai_model.h)
+static CommandModel commandModel(AI_MODEL_API(network));
+
+// THRESHOLDS
+static float networkThreshold = KWS_NETWORK_THRESHOLD;
+
+// STATISTICS
+static KwsStats stats = {};
+
+// WINDOW IN PROGRESS (Kws_Start / Kws_Step)
+static const int32_t* windowSamples = nullptr;
+static int windowFrame = 0;        // Next feature frame
+static uint32_t windowCycles = 0;  // Sum over the steps so far
+
+// LAYER PROFILE (Kws_ProfileLayers, observer called before and after every c-node)
+struct LayerProfile {
+    uint32_t* cycles;
+    uint32_t start;
+};
+
+static ai_u32 layerObserver(const ai_handle cookie, const ai_u32 flags, const ai_observer_node* node) {
+    LayerProfile* profile = static_cast<LayerProfile*>(cookie);
+    uint32_t now = cycleCounterGet();
+    if (flags & AI_OBSERVER_PRE_EVT) {
+        profile->start = now;
+    } else if ((flags & AI_OBSERVER_POST_EVT) && node->id < KWS_MAX_LAYER_ID) {
+        profile->cycles[node->id] += now - profile->start;
+    }
+    return 0;
+}
+
+extern "C" {
+
+bool Kws_Init(void) {
+    Features_Init();
+
+    if (!commandModel.init()) {
+        if (commandModel.shapeMismatch()) {
+            const AiModelShape& shape = commandModel.shape();
+            printf("[ERROR] %s init: tensors in=%u x %lu out=%u x %lu, expected in=1 x %lu out=1 x %lu\r\n",
+                   commandModel.name(), (unsigned)shape.numIn, (unsigned long)shape.inSize,
+                   (unsigned)shape.numOut, (unsigned long)shape.outSize,
+                   (unsigned long)CommandModel::inputSize, (unsigned long)CommandModel::outputSize);
+            return false;
+        }
+        ai_error err = commandModel.error();
+        printf("[ERROR] %s init: type=%d code=%d\r\n", commandModel.name(), err.type, err.code);
+        return false;
+    }
+    printf("[INIT] AI activation pool: %lu bytes\r\n", (unsigned long)AI_ACTIVATION_POOL_SIZE);
+#if !KWS_CALIBRATED
+    printf("[INIT] KWS decision not calibrated (kws_calibration.h): global threshold only, no silence floor\r\n");
+#endif
+
+    stats = KwsStats();
+    return true;
+}
+
+void Kws_SetThreshold(float net) {
+    networkThreshold = net;
+}
+
+void Kws_Start(const int32_t* samples) {
+    windowSamples = samples;
+    windowFrame = 0;
+    windowCycles = 0;
+}
+
+KwsStep Kws_Step(KwsResult* result) {
+    uint32_t start = cycleCounterGet();
+    float* features = commandModel.input();
+
+    // STAGE 1: features, KWS_FRAMES_PER_STEP frames per step
+    if (windowFrame < FEATURES_NUM_FRAMES) {
+        int count = FEATURES_NUM_FRAMES - windowFrame;
+        if (count > KWS_FRAMES_PER_STEP) count = KWS_FRAMES_PER_STEP;
+        TRACE_BEGIN_ARG(FEATURES, windowFrame);
+        Features_ComputeFrames(windowSamples, features, windowFrame, count);
+        TRACE_END(FEATURES);
+        windowFrame += count;
+        windowCycles += cycleCounterGet() - start;
+        return KWS_STEP_PENDING;
+    }
+
+    // Last step: silence check, network and decision
+    result->label = KWS_LABEL_NONE;
+    result->best = KWS_LABEL_NONE;
+    result->decision = KWS_DECISION_UNKNOWN;
+    result->score = 0.0f;
+    result->margin = 0.0f;
+
+    UsbStream_Send(STREAM_MUX_FEATURES, stats.windows, features, FEATURES_SIZE * sizeof(float));
+    float meanLogEnergy = KwsDecision_MeanLogEnergy(features);
+    bool silent = KwsDecision_IsSilent(meanLogEnergy);
+    if (silent) result->decision = KWS_DECISION_SILENCE;
+
+    // STAGE 2: full network and calibrated decision, only for windows with signal
+    bool ok = true;
+    if (!silent) {
+        TRACE_BEGIN(INFERENCE);
+        bool ran = commandModel.run();
+        TRACE_END(INFERENCE);
+        if (!ran) {
+            ai_error err = commandModel.error();
+            DLOG("[ERROR] %s run: type=%d code=%d", commandModel.name(), err.type, err.code);
+            ok = false;
+        } else {
+            UsbStream_Send(STREAM_MUX_LOGITS, stats.windows, commandModel.output(), KWS_NUM_LABELS * sizeof(float));
+            KwsDecision decision;
+            TRACE_BEGIN(DECISION);
+            KwsDecision_Decide(commandModel.output(), meanLogEnergy, networkThreshold, &decision);
+            TRACE_END(DECISION);
+            result->label = decision.label;
+            result->best = decision.best;
+            result->decision = decision.type;
+            result->score = decision.probability;
+            result->margin = decision.margin;
+        }
+    }
+
+    result->cycles = windowCycles + (cycleCounterGet() - start);
+
+    stats.windows++;
+    if (silent) stats.rejectedEarly++;
+    else if (result->decision == KWS_DECISION_KEYWORD) stats.keywords++;
+    else stats.unknown++;
+    stats.totalCycles += result->cycles;
+
+    return ok ? KWS_STEP_DONE : KWS_STEP_FAILED;
+}
+
+bool Kws_ProfileStages(const int32_t* samples, KwsStageCycles* cycles) {
+    float* features = commandModel.input();
+
+    uint32_t start = cycleCounterGet();
+    Features_Compute(samples, features);
+    uint32_t featuresDone = cycleCounterGet();
+    float meanLogEnergy = KwsDecision_MeanLogEnergy(features);
+    bool ran = commandModel.run();
+    uint32_t networkDone = cycleCounterGet();
+    KwsDecision decision;
+    if (ran) KwsDecision_Decide(commandModel.output(), meanLogEnergy, networkThreshold, &decision);
+    uint32_t decisionDone = cycleCounterGet();
+
+    cycles->features = featuresDone - start;
+    cycles->network = networkDone - featuresDone;
+    cycles->decision = decisionDone - networkDone;
+    return ran;
+}
+
+bool Kws_ProfileLayers(const int32_t* samples, uint32_t* cycles) {
+    for (uint32_t i = 0; i < KWS_MAX_LAYER_ID; i++) cycles[i] = 0;
+    // The input shares the activation arena, the previous run overwrote it
+    Features_Compute(samples, commandModel.input());
+    LayerProfile profile = { cycles, 0 };
+    ai_handle network = commandModel.instance();
+    if (!ai_platform_observer_register(network, layerObserver, &profile,
+                                       AI_OBSERVER_PRE_EVT | AI_OBSERVER_POST_EVT)) {
+        return false;
+    }
+    bool ran = commandModel.run();
+    ai_platform_observer_unregister(network, layerObserver, &profile);
+    return ran;
+}
+
+void Kws_GetStats(KwsStats* out) {
+    *out = stats;
+}
+
+void Kws_PrintStats(void) {
+    if (stats.windows == 0) return;
+    unsigned long rejectedPermille = (unsigned long)stats.rejectedEarly * 1000UL / stats.windows;
+    unsigned long avgCycles = (unsigned long)(stats.totalCycles / stats.windows);
+    DLOG("[KWS] windows: %lu, rejected early: %lu.%lu %%, unknown: %lu, keywords: %lu, cycles/window: %lu",
+         (unsigned long)stats.windows, rejectedPermille / 10, rejectedPermille % 10,
+         (unsigned long)stats.unknown, (unsigned long)stats.keywords, avgCycles);
+}
+
+const char* Kws_GetLabelName(int label) {
+    if (label < 0 || label >= KWS_NUM_LABELS) return "none";
+    return kwsLabelNames[label];
+}
+
+} // extern "C"
@@ -0,0 +1,134 @@
+/**
+ * @file    kws.h
+ * @brief   Keyword Spotting Pipeline (two-stage cascade)
+ *
+ * Stage 1: MFCC features -> silence check, silent windows skip the network
+ * Stage 2: X-CUBE-AI "network" model (251,990 MACC), 30 classes
+ * Decision: per-class calibrated thresholds with open-set rejection (kws_decision.h)
+ */
+
+#ifndef KWS_H
+#define KWS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "kws_decision.h"
+
+/* Default network threshold (global floor on top of the per-class calibration) */
+#define KWS_NETWORK_THRESHOLD  0.6f
+
+/* Feature frames computed per Kws_Step, bounds the time the main loop waits for one step */
+#define KWS_FRAMES_PER_STEP  8
+
+/* Class indices of the commands we react to */
+#define KWS_LABEL_NONE  (-1)
+#define KWS_LABEL_OFF   15
+#define KWS_LABEL_ON    16
+
+/* Result of one recognition window */
+typedef struct {
+    int label;            /* Recognized command, KWS_LABEL_NONE if rejected */
+    int best;             /* Top class of the network, KWS_LABEL_NONE if stage 2 did not run */
+    KwsDecisionType decision;
+    float score;          /* Stage 2 probability of the best class (0 if rejected early) */
+    float margin;         /* Probability gap to the runner-up */
+    uint32_t cycles;      /* CPU cycles for the whole window, summed over its steps */
+} KwsResult;
+
+typedef enum {
+    KWS_STEP_PENDING = 0,  /* More steps to go */
+    KWS_STEP_DONE,         /* Result filled */
+    KWS_STEP_FAILED        /* The network failed to run */
+} KwsStep;
+
+/* Cascade statistics since Kws_Init() */
+typedef struct {
+    uint32_t windows;        /* Windows processed */
+    uint32_t rejectedEarly;  /* Windows rejected before stage 2 (silence) */
+    uint32_t unknown;        /* Windows rejected by the decision stage (open set) */
+    uint32_t keywords;       /* Accepted commands */
+    uint64_t totalCycles;    /* Sum of KwsResult.cycles */
+} KwsStats;
+
+/* Layer ids of the network (X-CUBE-AI codegen ids, network.c) are below this */
+#define KWS_MAX_LAYER_ID  8
+
+/* CPU cycles of each stage, every stage run unconditionally (Kws_ProfileStages) */
+typedef struct {
+    uint32_t features;
+    uint32_t network;
+    uint32_t decision;
+} KwsStageCycles;
+
+/**
+ * @brief  Initialize feature extraction and create the network instance
+ * @return true on success
+ */
+bool Kws_Init(void);
+
+/**
+ * @brief  Set the network threshold
+ * @param  networkThreshold: minimum stage 2 probability to accept a class,
+ *         per-class thresholds from kws_calibration.h apply on top
+ */
+void Kws_SetThreshold(float networkThreshold);
+
+/**
+ * @brief  Start a window, the cascade then runs in Kws_Step calls
+ * @param  samples: 1 second recording (see AudioProcessing_GetRecordedData), unchanged until
+ *         the last step
+ * @note   One window at a time, not reentrant
+ */
+void Kws_Start(const int32_t* samples);
+
+/**
+ * @brief  Run the next step of the window: KWS_FRAMES_PER_STEP feature frames, or at the end the
+ *         silence check, network and decision (the network run is the longest step)
+ * @param  result: filled with the decision once the step returns KWS_STEP_DONE
+ * @note   Runs as an inference job step (inference_scheduler.h)
+ */
+KwsStep Kws_Step(KwsResult* result);
+
+/**
+ * @brief  Time every stage of the cascade on one recording, without early rejection
+ * @param  samples: 1 second recording
+ * @param  cycles: filled with the cycles per stage
+ * @return false if the network failed to run
+ * @note   Benchmark only: the statistics are not updated, nothing is streamed
+ */
+bool Kws_ProfileStages(const int32_t* samples, KwsStageCycles* cycles);
+
+/**
+ * @brief  Compute the features of one recording and run the network on them, timing every layer
+ * @param  samples: 1 second recording, as for Kws_ProfileStages
+ * @param  cycles: KWS_MAX_LAYER_ID entries, cycles summed per layer id (c-nodes of a layer share it)
+ * @return false if the observer could not be registered or the network failed
+ * @note   Benchmark only: features are not timed, nothing is streamed
+ */
+bool Kws_ProfileLayers(const int32_t* samples, uint32_t* cycles);
+
+/**
+ * @brief  Get a copy of the cascade statistics
+ */
+void Kws_GetStats(KwsStats* stats);
+
+/**
+ * @brief  Print early-reject fraction and average cycles per window
+ */
+void Kws_PrintStats(void);
+
+/**
+ * @brief  Get the name of a class
+ * @return Label string, "none" for KWS_LABEL_NONE
+ */
+const char* Kws_GetLabelName(int label);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* KWS_H */
@@ -0,0 +1,52 @@
+/**
+ * @file    kws_calibration.h
+ * @brief   Decision thresholds per class (see kws_decision.h)
+ *
+ * Generated by: kws_eval --calibrate kws_calibration.h <corpus>
+ * Corpus:       none (not calibrated, the decision stage is off until this file is generated)
+ */
+
+#ifndef KWS_CALIBRATION_H
+#define KWS_CALIBRATION_H
+
+#include "kws_decision.h"
+#include "kws_labels.h"
+
+/* 0 = no corpus yet: no silence floor, no per-class threshold or margin, a command fires at the
+ * global network threshold (KWS_NETWORK_THRESHOLD) alone */
+#define KWS_CALIBRATED 0
+
+static const KwsClassCalibration kwsCalibration[KWS_NUM_LABELS] = {
+    { false, 0.00f, 0.00f },  /* bed */
+    { false, 0.00f, 0.00f },  /* bird */
+    { false, 0.00f, 0.00f },  /* cat */
+    { false, 0.00f, 0.00f },  /* dog */
+    { false, 0.00f, 0.00f },  /* down */
+    { false, 0.00f, 0.00f },  /* eight */
+    { false, 0.00f, 0.00f },  /* five */
+    { false, 0.00f, 0.00f },  /* four */
+    { false, 0.00f, 0.00f },  /* go */
+    { false, 0.00f, 0.00f },  /* happy */
+    { false, 0.00f, 0.00f },  /* house */
+    { false, 0.00f, 0.00f },  /* left */
+    { false, 0.00f, 0.00f },  /* marvin */
+    { false, 0.00f, 0.00f },  /* nine */
+    { false, 0.00f, 0.00f },  /* no */
+    { true,  0.00f, 0.00f },  /* off */
+    { true,  0.00f, 0.00f },  /* on */
+    { false, 0.00f, 0.00f },  /* one */
+    { false, 0.00f, 0.00f },  /* right */
+    { false, 0.00f, 0.00f },  /* seven */
+    { false, 0.00f, 0.00f },  /* sheila */
+    { false, 0.00f, 0.00f },  /* six */
+    { false, 0.00f, 0.00f },  /* stop */
+    { false, 0.00f, 0.00f },  /* three */
+    { false, 0.00f, 0.00f },  /* tree */
+    { false, 0.00f, 0.00f },  /* two */
+    { false, 0.00f, 0.00f },  /* up */
+    { false, 0.00f, 0.00f },  /* wow */
+    { false, 0.00f, 0.00f },  /* yes */
+    { false, 0.00f, 0.00f },  /* zero */
+};
+
+#endif /* KWS_CALIBRATION_H */
@@ -0,0 +1,64 @@
+// Calibrated decision stage: per-class thresholds, runner-up margin, silence and unknown handling
+
+#include "kws_decision.h"
+#include "kws_calibration.h"
+#include "feature_extraction.h"
+#include <cmath>
+
+extern "C" {
+
+float KwsDecision_MeanLogEnergy(const float* features) {
+    // Orthonormal DCT: c0 = sum(log mel) / sqrt(NUM_MEL)
+    float sum = 0.0f;
+    for (int f = 0; f < FEATURES_NUM_FRAMES; f++) {
+        sum += features[f * FEATURES_NUM_MFCC];
+    }
+    return sum / FEATURES_NUM_FRAMES / sqrtf((float)FEATURES_NUM_MEL);
+}
+
+bool KwsDecision_IsSilent(float meanLogEnergy) {
+#if KWS_CALIBRATED
+    return meanLogEnergy < KWS_SILENCE_LOG_ENERGY;
+#else
+    (void)meanLogEnergy;
+    return false;
+#endif
+}
+
+void KwsDecision_Decide(const float* logits, float meanLogEnergy, float minProbability,
+                        KwsDecision* decision) {
+    int best = 0, second = 1;
+    if (logits[second] > logits[best]) { best = 1; second = 0; }
+    for (int i = 2; i < KWS_NUM_LABELS; i++) {
+        if (logits[i] > logits[best]) {
+            second = best;
+            best = i;
+        } else if (logits[i] > logits[second]) {
+            second = i;
+        }
+    }
+
+    float sum = 0.0f;
+    for (int i = 0; i < KWS_NUM_LABELS; i++) sum += expf(logits[i] - logits[best]);
+    float pBest = 1.0f / sum;
+    float pSecond = expf(logits[second] - logits[best]) / sum;
+
+    decision->best = best;
+    decision->probability = pBest;
+    decision->margin = pBest - pSecond;
+    decision->label = -1;
+
+    const KwsClassCalibration& cal = kwsCalibration[best];
+    float threshold = cal.threshold > minProbability ? cal.threshold : minProbability;
+
+    if (KwsDecision_IsSilent(meanLogEnergy)) {
+        decision->type = KWS_DECISION_SILENCE;
+    } else if (!cal.command || pBest < threshold || decision->margin < cal.margin) {
+        decision->type = KWS_DECISION_UNKNOWN;
+    } else {
+        decision->type = KWS_DECISION_KEYWORD;
+        decision->label = best;
+    }
+}
+
+} // extern "C"
@@ -0,0 +1,69 @@
+/**
+ * @file    kws_decision.h
+ * @brief   Calibrated decision stage for the KWS network output
+ *
+ * Turns the 30 logits into one of: command keyword, silence or unknown (open-set rejection).
+ * A class only fires if it is marked as command in the calibration table, its probability
+ * reaches the class threshold and it beats the runner-up by the class margin.
+ * Thresholds come from kws_calibration.h, generated offline by Tools/kws_eval --calibrate.
+ * Until it has been generated from a labeled corpus (KWS_CALIBRATED 0) only the command flags
+ * and the global probability floor apply, and no window counts as silence.
+ */
+
+#ifndef KWS_DECISION_H
+#define KWS_DECISION_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum {
+    KWS_DECISION_KEYWORD = 0,  /* A command class passed all tests */
+    KWS_DECISION_SILENCE,      /* Window energy below the silence floor */
+    KWS_DECISION_UNKNOWN       /* Speech, but no confident command */
+} KwsDecisionType;
+
+/* Per-class calibration entry */
+typedef struct {
+    bool command;     /* Class may fire at all */
+    float threshold;  /* Minimum softmax probability */
+    float margin;     /* Minimum probability gap to the runner-up */
+} KwsClassCalibration;
+
+typedef struct {
+    KwsDecisionType type;
+    int label;          /* Accepted class, -1 unless type == KWS_DECISION_KEYWORD */
+    int best;           /* Top class of the network */
+    float probability;  /* Softmax probability of the top class */
+    float margin;       /* Top probability minus runner-up probability */
+} KwsDecision;
+
+/**
+ * @brief  Mean log mel energy of an MFCC window (from coefficient 0)
+ * @param  features: FEATURES_NUM_FRAMES x FEATURES_NUM_MFCC matrix
+ */
+float KwsDecision_MeanLogEnergy(const float* features);
+
+/**
+ * @brief  true if the window is below the calibrated silence floor, always false uncalibrated
+ */
+bool KwsDecision_IsSilent(float meanLogEnergy);
+
+/**
+ * @brief  Decide on one window
+ * @param  logits: network output (KWS_NUM_LABELS values)
+ * @param  meanLogEnergy: see KwsDecision_MeanLogEnergy
+ * @param  minProbability: global probability floor applied on top of the class thresholds
+ * @param  decision: filled with the result
+ */
+void KwsDecision_Decide(const float* logits, float meanLogEnergy, float minProbability,
+                        KwsDecision* decision);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* KWS_DECISION_H */
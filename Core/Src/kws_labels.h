@@ -0,0 +1,17 @@
+/**
+ * @file    kws_labels.h
+ * @brief   Class labels of the KWS model (training order of the 30 outputs)
+ */
+
+#ifndef KWS_LABELS_H
+#define KWS_LABELS_H
+
+#define KWS_NUM_LABELS 30
+
+static const char* const kwsLabelNames[KWS_NUM_LABELS] = {
+    "bed", "bird", "cat", "dog", "down", "eight", "five", "four", "go", "happy",
+    "house", "left", "marvin", "nine", "no", "off", "on", "one", "right", "seven",
+    "sheila", "six", "stop", "three", "tree", "two", "up", "wow", "yes", "zero"
+};
+
+#endif /* KWS_LABELS_H */
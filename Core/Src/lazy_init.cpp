@@ -0,0 +1,45 @@
+// Deferred peripheral initialization
+
+#include "lazy_init.h"
+#include "main.h"
+#include "deferred_log.h"
+
+struct LazyEntry {
+    void (*init)(void);
+    const char* name;
+    bool ready;
+};
+
+// STATE (thread context only)
+static LazyEntry entries[LAZY_PERIPHERAL_COUNT] = {};
+
+extern "C" {
+
+void LazyInit_Register(LazyPeripheral peripheral, void (*init)(void), const char* name) {
+    if ((unsigned)peripheral >= LAZY_PERIPHERAL_COUNT) return;
+    entries[peripheral].init = init;
+    entries[peripheral].name = name;
+}
+
+bool LazyInit_Require(LazyPeripheral peripheral) {
+    if ((unsigned)peripheral >= LAZY_PERIPHERAL_COUNT) return false;
+    LazyEntry& entry = entries[peripheral];
+    if (entry.ready) return true;
+    if (!entry.init) {
+        DLOG("[ERROR] Peripheral %lu needed but not registered", (unsigned long)peripheral);
+        return false;
+    }
+
+    uint32_t start = DWT->CYCCNT;
+    entry.init();
+    uint32_t us = (uint32_t)((uint64_t)(DWT->CYCCNT - start) * 1000000u / SystemCoreClock);
+    entry.ready = true;
+    DLOG("[INIT] %s (deferred): %lu us", entry.name, (unsigned long)us);
+    return true;
+}
+
+bool LazyInit_IsReady(LazyPeripheral peripheral) {
+    return (unsigned)peripheral < LAZY_PERIPHERAL_COUNT && entries[peripheral].ready;
+}
+
+} // extern "C"
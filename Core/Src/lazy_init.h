@@ -0,0 +1,49 @@
+/**
+ * @file    lazy_init.h
+ * @brief   Deferred initialization of peripherals that only some features use
+ *
+ * CubeMX generates no call for these MX_*_Init functions in main() ("Do Not Generate Function
+ * Call" in the .ioc); main.c registers them in USER CODE 2 instead, and the feature that needs
+ * the peripheral calls LazyInit_Require. The first call runs the init function and logs how long
+ * it took, later calls return at once. A device that never streams never waits for the Ethernet
+ * MAC reset or sets up the USB core.
+ */
+
+#ifndef LAZY_INIT_H
+#define LAZY_INIT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+
+typedef enum {
+    LAZY_ETH = 0,      /* MX_ETH_Init (UDP publisher) */
+    LAZY_USB,          /* MX_USB_OTG_FS_PCD_Init (USB stream) */
+    LAZY_PERIPHERAL_COUNT
+} LazyPeripheral;
+
+/**
+ * @brief  Register the init function of a deferred peripheral
+ * @param  name: shown in the init log line (string literal)
+ */
+void LazyInit_Register(LazyPeripheral peripheral, void (*init)(void), const char* name);
+
+/**
+ * @brief  Initialize the peripheral on first use
+ * @return false if nothing was registered for it
+ * @note   Thread context only (the MX_*_Init functions use HAL_GetTick / HAL_Delay)
+ */
+bool LazyInit_Require(LazyPeripheral peripheral);
+
+/**
+ * @brief  true once the peripheral has been initialized
+ */
+bool LazyInit_IsReady(LazyPeripheral peripheral);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LAZY_INIT_H */
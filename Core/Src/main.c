@@ -25,6 +25,8 @@
 #include "led_array.h"
 #include "transmit.h"
 #include "my_main.h"
+#include "boot_profile.h"
+#include "lazy_init.h"
 
 
 /* USER CODE END Includes */
@@ -91,6 +93,7 @@ int main(void)
 {
 
   /* USER CODE BEGIN 1 */
+  BootProfile_Start();
 
   /* USER CODE END 1 */
 
@@ -100,6 +103,7 @@ int main(void)
   HAL_Init();
 
   /* USER CODE BEGIN Init */
+  BootProfile_Mark("HAL_Init");
 
   /* USER CODE END Init */
 
@@ -107,19 +111,22 @@ int main(void)
   SystemClock_Config();
 
   /* USER CODE BEGIN SysInit */
+  BootProfile_Mark("SystemClock_Config");
 
   /* USER CODE END SysInit */
 
   /* Initialize all configured peripherals */
   MX_GPIO_Init();
   MX_DMA_Init();
-  MX_ETH_Init();
   MX_USART3_UART_Init();
-  MX_USB_OTG_FS_PCD_Init();
   MX_TIM4_Init();
   MX_I2S2_Init();
   /* USER CODE BEGIN 2 */
+  // Ethernet and USB come up when the UDP publisher / USB stream first need them (lazy_init.h)
+  LazyInit_Register(LAZY_ETH, MX_ETH_Init, "MX_ETH_Init");
+  LazyInit_Register(LAZY_USB, MX_USB_OTG_FS_PCD_Init, "MX_USB_OTG_FS_PCD_Init");
   HAL_TIM_Base_Start(&htim4);
+  BootProfile_Mark("HAL_TIM_Base_Start");
   uint16_t on_sequence  = 0b111111000010;
   uint16_t off_sequence = 0b111111000001;
   int f = 0;
@@ -272,6 +279,7 @@ static void MX_I2S2_Init(void)
     Error_Handler();
   }
   /* USER CODE BEGIN I2S2_Init 2 */
+  BootProfile_Mark("MX_I2S2_Init");
 
   /* USER CODE END I2S2_Init 2 */
 
@@ -317,6 +325,7 @@ static void MX_TIM4_Init(void)
     Error_Handler();
   }
   /* USER CODE BEGIN TIM4_Init 2 */
+  BootProfile_Mark("MX_TIM4_Init");
 
   /* USER CODE END TIM4_Init 2 */
 
@@ -331,6 +340,8 @@ static void MX_USART3_UART_Init(void)
 {
 
   /* USER CODE BEGIN USART3_Init 0 */
+  // Called right after MX_DMA_Init, which has no user code section
+  BootProfile_Mark("MX_DMA_Init");
 
   /* USER CODE END USART3_Init 0 */
 
@@ -350,6 +361,7 @@ static void MX_USART3_UART_Init(void)
     Error_Handler();
   }
   /* USER CODE BEGIN USART3_Init 2 */
+  BootProfile_Mark("MX_USART3_UART_Init");
 
   /* USER CODE END USART3_Init 2 */
 
@@ -494,6 +506,7 @@ static void MX_GPIO_Init(void)
   HAL_GPIO_Init(USB_OverCurrent_GPIO_Port, &GPIO_InitStruct);
 
   /* USER CODE BEGIN MX_GPIO_Init_2 */
+  BootProfile_Mark("MX_GPIO_Init");
 
   /* USER CODE END MX_GPIO_Init_2 */
 }
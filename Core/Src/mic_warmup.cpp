@@ -0,0 +1,77 @@
+// Microphone warmup
+// State is written only by the I2S RX callbacks; readers copy it with interrupts disabled.
+
+#include "mic_warmup.h"
+#include "main.h"
+
+// STATE (written by the RX callbacks only)
+static MicWarmupStats state = {};
+static volatile bool ready = false;
+static int32_t lastMean = 0;
+
+extern "C" {
+
+void MicWarmup_Init(void) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    state = MicWarmupStats();
+    ready = false;
+    __set_PRIMASK(primask);
+}
+
+void MicWarmup_ProcessBlock(const BlockStats* block) {
+    if (ready || block->n == 0) return;
+
+    int32_t mean = block->dc;
+    uint32_t level = block->meanAbs;
+
+    state.blocks++;
+    if (state.blocks <= MIC_WARMUP_SKIP_BLOCKS || level == 0) {
+        state.stableRun = 0;
+        return;
+    }
+    // First usable block seeds the estimates
+    if (state.noiseLevel == 0) {
+        state.dcOffset = mean;
+        state.noiseLevel = level;
+        lastMean = mean;
+        return;
+    }
+
+    // Drift against the previous block, a decaying offset shows up without smoothing lag
+    int32_t drift = mean - lastMean;
+    lastMean = mean;
+    bool dcStable = (uint32_t)(drift < 0 ? -drift : drift) <= MIC_WARMUP_DC_DRIFT + level / 4;
+    bool levelStable = level <= 2 * state.noiseLevel && 2 * level >= state.noiseLevel;
+    state.stableRun = (dcStable && levelStable) ? state.stableRun + 1 : 0;
+
+    // Smoothing over ~4 blocks
+    state.dcOffset += (mean - state.dcOffset) / 4;
+    state.noiseLevel = (3 * state.noiseLevel + level + 2) / 4;
+
+    if (state.stableRun >= MIC_WARMUP_STABLE_BLOCKS) {
+        state.ready = true;
+        ready = true;
+    }
+}
+
+bool MicWarmup_IsReady(void) {
+    return ready;
+}
+
+bool MicWarmup_Wait(uint32_t timeoutMs) {
+    uint32_t start = HAL_GetTick();
+    while (!ready) {
+        if (HAL_GetTick() - start >= timeoutMs) return false;
+    }
+    return true;
+}
+
+void MicWarmup_GetStats(MicWarmupStats* out) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    *out = state;
+    __set_PRIMASK(primask);
+}
+
+} // extern "C"
@@ -0,0 +1,80 @@
+/**
+ * @file    mic_warmup.h
+ * @brief   Microphone readiness detection after the I2S DMA starts
+ *
+ * A MEMS microphone delivers garbage and a decaying DC offset for a short time after its clock
+ * starts. Instead of a fixed wait, the RX callbacks hand the statistics of every block
+ * (block_stats.h) to MicWarmup_ProcessBlock while processing is still disabled. Per block the DC
+ * offset (mean) and the noise level (mean absolute deviation from the previous block's mean, so a
+ * drifting offset raises it) are smoothed; the microphone counts as stable once
+ * MIC_WARMUP_STABLE_BLOCKS blocks in a row stay within the tolerances:
+ *   - block mean within MIC_WARMUP_DC_DRIFT + level / 4 of the previous block's (the means of
+ *     two noise-only blocks differ by about level / 9)
+ *   - block level within a factor of two of the smoothed noise floor
+ * All-zero blocks (microphone not driving the data line yet) never count as stable.
+ * MicWarmup_Wait gives up after a configurable timeout, e.g. when someone talks during boot.
+ */
+
+#ifndef MIC_WARMUP_H
+#define MIC_WARMUP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "block_stats.h"
+
+/* Blocks discarded unconditionally after DMA start (block = 250 samples = 15.6 ms) */
+#define MIC_WARMUP_SKIP_BLOCKS     4
+/* Consecutive stable blocks required (~125 ms) */
+#define MIC_WARMUP_STABLE_BLOCKS   8
+/* Allowed DC drift per block on top of the noise term, 18-bit units */
+#define MIC_WARMUP_DC_DRIFT        64
+/* Upper bound for MicWarmup_Wait when the microphone never settles */
+#ifndef MIC_WARMUP_TIMEOUT_MS
+#define MIC_WARMUP_TIMEOUT_MS      2000
+#endif
+
+typedef struct {
+    uint32_t blocks;        /* Blocks inspected */
+    uint32_t stableRun;     /* Current run of stable blocks */
+    int32_t dcOffset;       /* Smoothed DC offset */
+    uint32_t noiseLevel;    /* Smoothed noise floor (mean absolute deviation) */
+    bool ready;             /* Converged */
+} MicWarmupStats;
+
+/**
+ * @brief  Reset the detector
+ * @note   Call before the I2S DMA starts
+ */
+void MicWarmup_Init(void);
+
+/**
+ * @brief  Feed the statistics of one block (no-op once ready)
+ * @note   Called from the I2S RX callbacks while processing is disabled
+ */
+void MicWarmup_ProcessBlock(const BlockStats* block);
+
+/**
+ * @brief  True once DC offset and noise floor have converged
+ */
+bool MicWarmup_IsReady(void);
+
+/**
+ * @brief  Wait until the microphone is stable or timeoutMs passed
+ * @return true if it converged, false on timeout
+ */
+bool MicWarmup_Wait(uint32_t timeoutMs);
+
+/**
+ * @brief  Get a consistent copy of the detector state
+ */
+void MicWarmup_GetStats(MicWarmupStats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MIC_WARMUP_H */
@@ -4,6 +4,23 @@
 #include "timer.h"
 #include "transmit.h"
 #include "audio_processing.h"
+#include "pipeline_config.h"
+#include "audio_timeline.h"
+#include "kws.h"
+#include "inference_scheduler.h"
+#include "trace.h"
+#include "deferred_log.h"
+#include "uart_dma.h"
+#include "audio_stream.h"
+#include "usb_stream.h"
+#include "udp_publisher.h"
+#include "agc.h"
+#include "mic_warmup.h"
+#include "boot_profile.h"
+#include "clock_governor.h"
+#include "flash_recorder.h"
+#include "dma_copy.h"
+#include "benchmark.h"
 #include <stdio.h>
 #include <cmath>
 #include <cstring>
@@ -16,31 +33,124 @@ extern UART_HandleTypeDef huart3;  // UART for printf output
  // PRINTF RETARGET
 extern "C" int _write(int file, char* ptr, int len) {
     (void)file;
-    HAL_UART_Transmit(&huart3, reinterpret_cast<uint8_t*>(ptr), len, HAL_MAX_DELAY);
+    if (!UartDma_IsReady()) {
+        HAL_UART_Transmit(&huart3, reinterpret_cast<uint8_t*>(ptr), len, HAL_MAX_DELAY);
+        return len;
+    }
+    // One write must stay below the ring size, longer output goes in pieces
+    const int piece = UART_DMA_BUFFER_SIZE / 2;
+    for (int sent = 0; sent < len; sent += piece) {
+        UartDma_Write(ptr + sent, (uint32_t)(len - sent < piece ? len - sent : piece), true);
+    }
     return len;
 }
 
+// KEYWORD SPOTTING JOB (one Kws_Step per main loop pass, see inference_scheduler.h)
+struct KwsJob {
+    const int32_t* samples;
+    KwsResult result;
+    bool started;
+    bool ok;
+    uint64_t finishedSample;  // Audio timeline when the result was ready
+    bool finished;
+};
+static KwsJob kwsJob;
+static InferenceJobHandle kwsJobHandle = INFERENCE_JOB_INVALID;
+
+static bool kwsJobStep(void* context) {
+    KwsJob* job = static_cast<KwsJob*>(context);
+    if (!job->started) {
+        TRACE_BEGIN(KWS_JOB);
+        Kws_Start(job->samples);
+        job->started = true;
+    }
+    KwsStep step = Kws_Step(&job->result);
+    if (step == KWS_STEP_PENDING) return false;
+    job->ok = step == KWS_STEP_DONE;
+    TRACE_END(KWS_JOB);
+    return true;
+}
+
+static void kwsJobDone(void* context) {
+    KwsJob* job = static_cast<KwsJob*>(context);
+    job->finishedSample = AudioTimeline_Now();
+    job->finished = true;
+}
+
+// UDP MESSAGES (sent zero-copy, a buffer is reused only after the Ethernet DMA released it)
+static UdpDetectionEvent detectionEvent;
+static UdpMetrics metrics;
+static volatile bool detectionBusy = false;
+static volatile bool metricsBusy = false;
+
+static void udpDone(void* context) {
+    *static_cast<volatile bool*>(context) = false;
+}
+
+static void publishResult(const KwsResult& result, const AudioRecordingInfo& info, uint64_t finishedSample) {
+    if (!UdpPublisher_IsActive()) return;
+
+    if (!detectionBusy) {
+        KwsStats stats;
+        Kws_GetStats(&stats);
+        detectionEvent.window = stats.windows - 1;
+        detectionEvent.label = result.label;
+        detectionEvent.best = result.best;
+        detectionEvent.decision = (uint32_t)result.decision;
+        detectionEvent.score = result.score;
+        detectionEvent.margin = result.margin;
+        detectionEvent.triggerSample = (uint32_t)info.triggerSample;
+        detectionEvent.latencyMs = AudioTimeline_SamplesToMs(finishedSample - info.endSample);
+        detectionEvent.cycles = result.cycles;
+        detectionBusy = true;
+        if (!UdpPublisher_Send(UDP_MSG_DETECTION, &detectionEvent, sizeof(detectionEvent), udpDone,
+                               (void*)&detectionBusy)) {
+            detectionBusy = false;
+        }
+    }
+
+    if (!metricsBusy) {
+        UdpPublisher_CollectMetrics(&metrics);
+        metricsBusy = true;
+        if (!UdpPublisher_Send(UDP_MSG_METRICS, &metrics, sizeof(metrics), udpDone, (void*)&metricsBusy)) {
+            metricsBusy = false;
+        }
+    }
+}
+
 extern "C" void my_main(void) {
-    // Visual confirmation that my_main is running
+    // All UART output from here on is queued on DMA1 Stream4
+    UartDma_Init();
+    // Bulk buffer copies and clears on DMA2 Stream0, before the audio buffers are cleared
+    DmaCopy_Init();
+
+    // Visual confirmation that my_main is running: all LEDs on until the microphone is ready
     uint16_t on  =  0b111111000010;
     uint16_t off = 0b111111000001;
     sendSequence(off);
+    led_func(10);
 
-    for(int i = 0; i < 3; i++) {
-        led_func(10);  // All LEDs ON
-        HAL_Delay(200);
-        led_func(0);   // All LEDs OFF
-        HAL_Delay(200);
-    }
-    
     printf("\r\n");
     printf("   DIY Alexa - Aufgabe 1\r\n");
 
     // Initialize audio processing module
     AudioProcessing_Init();
 
-    // Start I2S DMA reception
-    HAL_StatusTypeDef status = HAL_I2S_Receive_DMA(&hi2s2, AudioProcessing_GetInputBuffer(), I2S_BUF_SIZE);
+    // Initialize keyword spotting (features, network)
+    cycleCounterInit();
+    InferenceScheduler_Init();
+    if (!Kws_Init()) {
+        printf("[ERROR] KWS init failed!\r\n");
+    }
+    BootProfile_Mark("audio / KWS init");
+
+    // Benchmark mode: USER_Btn held during reset, the kernels run instead of the application (benchmark.h)
+    if (Benchmark_Requested()) {
+        Benchmark_Run();
+    }
+
+    // Start I2S DMA reception, circular over both halves (24-bit data: Size counts 32-bit values)
+    HAL_StatusTypeDef status = HAL_I2S_Receive_DMA(&hi2s2, AudioProcessing_GetInputBuffer(), PIPELINE.dmaHalfwords());
     if (status != HAL_OK) {
         printf("[ERROR] I2S DMA start failed! Error: %d\r\n", status);
         while (1) {
@@ -51,52 +161,144 @@ extern "C" void my_main(void) {
         }
     }
     printf("[INIT] I2S DMA started\r\n");
+    BootProfile_Mark("I2S DMA start");
 
-    // Warmup: Wait 2 seconds for microphone stabilization
-    printf("\r\n[WARMUP] Waiting 2 seconds for microphone...\r\n");
+    // Warmup: until DC offset and noise floor of the microphone have settled (mic_warmup.h)
     uint32_t warmupStart = HAL_GetTick();
-    while (HAL_GetTick() - warmupStart < 2000) {
-        // LED animation during warmup
-        int pos = ((HAL_GetTick() / 100) % 20);
-        if (pos >= 10) pos = 19 - pos;
-        led_func(pos + 1);
-    }
+    bool micStable = MicWarmup_Wait(MIC_WARMUP_TIMEOUT_MS);
+    MicWarmupStats warmup;
+    MicWarmup_GetStats(&warmup);
     led_func(0);
-    printf("[WARMUP] Complete!\r\n");
+    if (micStable) {
+        printf("\r\n[WARMUP] Microphone stable after %lu ms (DC %ld, noise %lu)\r\n",
+               (unsigned long)(HAL_GetTick() - warmupStart), (long)warmup.dcOffset, (unsigned long)warmup.noiseLevel);
+    } else {
+        printf("\r\n[WARMUP] Microphone not settled after %d ms (%lu blocks), starting anyway\r\n",
+               MIC_WARMUP_TIMEOUT_MS, (unsigned long)warmup.blocks);
+    }
+    BootProfile_Mark("mic warmup");
 
     // Enable data processing
     AudioProcessing_Enable(true);
+#if AUDIO_STREAM_MODE
+    // Dataset collection: lossless audio stream at AUDIO_STREAM_BAUDRATE (Tools/stream_decode)
+    AudioStream_Start();
+#endif
     printf("\r\n>>> Listening for audio...\r\n\r\n");
+    BootProfile_Mark("listening");
 
-    // Main loop
-    bool flag = false;
+    // Streams start after the device listens, Ethernet and USB are initialized here on first use
+    // Audio, features, logits and trace records over USB while a host has the port open
+    UsbStream_Init();
+    // Detection events, audio and metrics as UDP broadcasts once the Ethernet link is up
+    UdpPublisher_Init();
+    BootProfile_Mark("USB / UDP streams");
+    // Recordings go to the flash log in bank 2, downloadable over USB
+    FlashRecorder_Init();
+    BootProfile_Mark("flash log mount");
+    BootProfile_Print();
+
+    // Reduced core clock while listening, full speed from the trigger until the result is handled
+    Governor_Init();
 
+    // Main loop
     while (1) {
-        // Check if recording just completed (flag set by ISR)
-        if (AudioProcessing_IsRecordingComplete()) {
+        Governor_Poll(AudioProcessing_IsRecording() || AudioProcessing_IsRecordingComplete() ||
+                      kwsJobHandle != INFERENCE_JOB_INVALID);
+
+        // One step of the running inference job, the rest of the loop runs between steps
+        InferenceScheduler_Poll();
+
+        // Recording complete: hand it to the inference job
+        if (AudioProcessing_IsRecordingComplete() && kwsJobHandle == INFERENCE_JOB_INVALID) {
             // Print recording info (safe to do in main loop)
-            printf("\r\n>>> Aufnahme beendet. Dauer: %lu ms\r\n",
-                   HAL_GetTick() - AudioProcessing_GetRecordingStartTime());
-            printf("    Samples: 16000\r\n");
-            
-            // Toggle steckdose: ein/aus bei jedem Schwellwert-Überschreiten
-            if(flag == false) {
-                printf(">>> Steckdose EIN\r\n");
-                sendSequence(on);
-                flag = true;
-            } else {
-                printf(">>> Steckdose AUS\r\n");
-                sendSequence(off);
-                flag = false;
+            TRACE_BEGIN(SUBMIT);
+            AudioRecordingInfo info;
+            AudioProcessing_GetRecordingInfo(&info);
+            DLOG(">>> Aufnahme beendet. Dauer: %lu ms",
+                 (unsigned long)AudioTimeline_SamplesToMs(info.endSample - info.triggerSample + 1));
+            DLOG("    Samples: %lu, Trigger @ %lu ms (Sample %lu)", (unsigned long)PIPELINE.recordingSamples,
+                 (unsigned long)AudioTimeline_SamplesToMs(info.triggerSample), (unsigned long)info.triggerSample);
+            if (info.lostBlocks) {
+                DLOG("[WARN] Aufnahme lueckenhaft: %lu DMA-Bloecke verloren", (unsigned long)info.lostBlocks);
             }
-            
-            // Reset recording state
+
+            kwsJob.samples = AudioProcessing_GetRecordedData();
+            kwsJob.started = false;
+            kwsJob.finished = false;
+            kwsJobHandle = InferenceScheduler_Submit(INFERENCE_PRIORITY_NORMAL, kwsJobStep, kwsJobDone, &kwsJob);
+            if (kwsJobHandle == INFERENCE_JOB_INVALID) {
+                DLOG("[ERROR] No free inference slot");
+                AudioProcessing_ResetRecording();
+                AudioProcessing_ClearRecordingComplete();
+            }
+            TRACE_END(SUBMIT);
+        }
+
+        // Keyword spotting finished: only "on" / "off" switch the socket
+        if (kwsJobHandle != INFERENCE_JOB_INVALID && kwsJob.finished) {
+            TRACE_BEGIN_ARG(RESULT, kwsJob.result.label);
+            kwsJobHandle = INFERENCE_JOB_INVALID;
+            const KwsResult& result = kwsJob.result;
+            AudioRecordingInfo info;
+            AudioProcessing_GetRecordingInfo(&info);
+            if (kwsJob.ok) {
+                if (result.decision == KWS_DECISION_SILENCE) {
+                    DLOG(">>> Stille");
+                } else if (result.decision == KWS_DECISION_UNKNOWN) {
+                    DLOG(">>> Unbekannt (%s, %d %%)",
+                         Kws_GetLabelName(result.best), (int)(result.score * 100.0f));
+                } else {
+                    DLOG(">>> Erkannt: %s (%d %%)",
+                         Kws_GetLabelName(result.label), (int)(result.score * 100.0f));
+                }
+
+                if (result.label == KWS_LABEL_ON) {
+                    DLOG(">>> Steckdose EIN");
+                    sendSequence(on);
+                } else if (result.label == KWS_LABEL_OFF) {
+                    DLOG(">>> Steckdose AUS");
+                    sendSequence(off);
+                }
+            }
+            DLOG("    Entscheidung @ Sample %lu, Latenz %lu ms nach Aufnahmeende",
+                 (unsigned long)kwsJob.finishedSample,
+                 (unsigned long)AudioTimeline_SamplesToMs(kwsJob.finishedSample - info.endSample));
+            if (kwsJob.ok) publishResult(result, info, kwsJob.finishedSample);
+            // Keep the clip for later analysis, compressed into a staging buffer before the reset below
+            FlashRecorder_SaveClip(kwsJob.samples, PIPELINE.recordingSamples, info.triggerSample, info.lostBlocks,
+                                   kwsJob.ok ? &result : nullptr);
+            Kws_PrintStats();
+            AudioTimeline_PrintStats();
+            Agc_PrintStats();
+            AudioStream_PrintStats();
+            UsbStream_PrintStats();
+            UdpPublisher_PrintStats();
+            Governor_PrintStats();
+            FlashRecorder_PrintStats();
+            DmaCopy_PrintStats();
+            TRACE_END(RESULT);
+#if TRACE_ENABLED
+            DeferredLog_Flush();
+            Trace_DumpUtterance();
+#endif
+
+            // Reset recording state only now, the job read the recording until here
             AudioProcessing_ResetRecording();
             AudioProcessing_ClearRecordingComplete();
 
-            printf("\r\n>>> Listening for audio...\r\n\r\n");
+            DLOG(">>> Listening for audio...");
         }
 
+        // Send queued log records
+        DeferredLog_Flush();
+
+        // Ethernet link check, release sent UDP buffers
+        UdpPublisher_Poll();
+
+        // Clip log: program the staged clip, erase ahead, USB download
+        FlashRecorder_Poll();
+
         // Volume display
         LautstaerkeZeigen();
     }
@@ -0,0 +1,85 @@
+/**
+ * @file    pipeline_config.h
+ * @brief   Audio pipeline dimensions, one constexpr record every buffer size and loop bound follows
+ *
+ * Sample rate, DMA block, recording window with its pre-roll and the MFCC front-end (window, hop,
+ * FFT, mel bands, coefficients, frames) are set once in PIPELINE. The DMA buffer, the recording
+ * and ring buffers and the feature tables are sized from it, and the size macros of the modules
+ * (FEATURES_*, AUDIO_TIMELINE_SAMPLE_RATE) are aliases of its fields. The static_asserts below
+ * reject a configuration the modules cannot run; kws.cpp checks the feature matrix against the
+ * model input (AI_NETWORK_IN_1_HEIGHT/WIDTH), which a new model changes in network.h.
+ *
+ * Block kernels (I2sUnpack_Block, BlockStats_Compute, Agc_Process) are templated on the type of
+ * their sample count: BlockCount carries the configured block as a compile-time constant, a plain
+ * uint32_t any other length (host tools). For the configured block the compiler sees constant
+ * trip counts: no loop-count checks, the unroll remainder resolved at compile time, divisions by
+ * the block length as multiplications, and vectorized loops where the target has vector units.
+ *
+ * C++ only. Wrapped in extern "C++": the module headers include it inside their extern "C" blocks.
+ */
+
+#ifndef PIPELINE_CONFIG_H
+#define PIPELINE_CONFIG_H
+
+#include <stdint.h>
+#include "i2s_unpack.h"
+#include "detector_config.h"
+
+extern "C++" {
+
+struct PipelineConfig {
+    uint32_t sampleRate;        // Hz
+    uint32_t blockSamples;      // Mono samples per DMA half-buffer, one RX callback
+    uint32_t recordingSamples;  // Window handed to the KWS per trigger
+    uint32_t preRollSamples;    // Of the recording, taken from before the trigger
+    uint32_t frameLength;       // MFCC window
+    uint32_t frameShift;        // MFCC hop
+    uint32_t fftSize;
+    uint32_t numMel;
+    uint32_t numMfcc;
+    uint32_t numFrames;         // Frames per recording, the model input height
+
+    // Halfwords per DMA half-buffer. Also the Size for HAL_I2S_Receive_DMA: with 24/32-bit data
+    // HAL counts 32-bit values and doubles Size for the halfword DMA, so the transfer spans both halves
+    constexpr uint32_t dmaHalfwords() const { return blockSamples * I2S_UNPACK_STRIDE; }
+    constexpr uint32_t numBins() const { return fftSize / 2 + 1; }
+    // Samples the feature frames cover, from the start of the recording
+    constexpr uint32_t featureSpan() const { return (numFrames - 1) * frameShift + frameLength; }
+    constexpr uint32_t featureSize() const { return numFrames * numMfcc; }
+};
+
+constexpr PipelineConfig PIPELINE = {
+    16000,                      // sampleRate
+    250,                        // blockSamples: 15.6 ms
+    16000,                      // recordingSamples: 1 s
+    DETECTOR_PRE_ROLL_SAMPLES,  // preRollSamples (tuned with Tools/detector_tune)
+    640,                        // frameLength: 40 ms
+    320,                        // frameShift: 20 ms
+    1024,                       // fftSize
+    40,                         // numMel
+    10,                         // numMfcc
+    48,                         // numFrames
+};
+
+static_assert(PIPELINE.blockSamples > 0 && PIPELINE.blockSamples < 16384,
+              "block sums of 18-bit samples must fit 32 bit (block_stats, agc)");
+static_assert(2 * PIPELINE.dmaHalfwords() <= 0xFFFFu, "DMA buffer exceeds one stream transfer");
+static_assert(PIPELINE.preRollSamples > 0 && PIPELINE.preRollSamples < PIPELINE.recordingSamples,
+              "pre-roll must fit the recording");
+static_assert(PIPELINE.featureSpan() <= PIPELINE.recordingSamples, "feature frames must lie within the recording");
+static_assert(PIPELINE.frameLength <= PIPELINE.fftSize, "frame must fit the FFT");
+static_assert(PIPELINE.fftSize >= 32 && PIPELINE.fftSize <= 4096 && (PIPELINE.fftSize & (PIPELINE.fftSize - 1)) == 0,
+              "FFT size must be a CMSIS-DSP real FFT length");
+static_assert(PIPELINE.numMfcc <= PIPELINE.numMel, "more coefficients than mel bands");
+
+// Sample count known at compile time, converts to uint32_t like a runtime count
+template <uint32_t N>
+struct FixedCount {
+    constexpr operator uint32_t() const { return N; }
+};
+
+typedef FixedCount<PIPELINE.blockSamples> BlockCount;
+
+} // extern "C++"
+
+#endif /* PIPELINE_CONFIG_H */
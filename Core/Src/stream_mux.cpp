@@ -0,0 +1,204 @@
+// Stream multiplexer framing
+// Portable, shared between the firmware and Tools/stream_mux.
+
+#include "stream_mux.h"
+#include <string.h>
+
+static_assert((STREAM_MUX_TX_SIZE & (STREAM_MUX_TX_SIZE - 1)) == 0, "STREAM_MUX_TX_SIZE must be a power of two");
+static_assert(STREAM_MUX_MAX_FRAME < STREAM_MUX_TX_SIZE, "a frame must fit the TX ring");
+
+static const char* const channelNames[STREAM_MUX_NUM_CHANNELS] = {"audio", "features", "logits", "trace", "clips"};
+
+static inline void putLe16(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline uint32_t getLe16(const uint8_t* p) {
+    return p[0] | (uint32_t)p[1] << 8;
+}
+
+static inline void putLe32(uint8_t* p, uint32_t v) {
+    putLe16(p, v);
+    putLe16(p + 2, v >> 16);
+}
+
+static inline uint32_t getLe32(const uint8_t* p) {
+    return getLe16(p) | getLe16(p + 2) << 16;
+}
+
+// CRC-32 (IEEE, reflected), continued from crc; start with 0xFFFFFFFF, the result is not inverted.
+// 32 bits: after a lost USB packet the parser checks about one spliced frame per loss, a 16-bit
+// CRC let one in 65536 of those through as a valid frame.
+static uint32_t crc32(const uint8_t* data, uint32_t length, uint32_t crc) {
+    for (uint32_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (int b = 0; b < 8; b++) crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+    }
+    return crc;
+}
+
+// Copy into the ring at a free-running position, wrapping as needed
+static void ringPut(StreamMuxTx* tx, uint32_t position, const uint8_t* data, uint32_t length) {
+    uint32_t offset = position & (STREAM_MUX_TX_SIZE - 1);
+    uint32_t first = STREAM_MUX_TX_SIZE - offset;
+    if (first > length) first = length;
+    memcpy(&tx->ring[offset], data, first);
+    memcpy(&tx->ring[0], data + first, length - first);
+}
+
+// PARSER
+
+enum CheckResult { NEED_MORE, COMPLETE, BAD_HEADER, BAD_CRC };
+
+static CheckResult check(const StreamMuxParser* p, uint32_t* size) {
+    const uint8_t* f = p->frame;
+    if (f[0] != STREAM_MUX_SYNC0) return BAD_HEADER;
+    if (p->fill < 2) return NEED_MORE;
+    if (f[1] != STREAM_MUX_SYNC1) return BAD_HEADER;
+    if (p->fill < STREAM_MUX_HEADER_SIZE) return NEED_MORE;
+
+    uint32_t length = getLe16(&f[4]);
+    if (f[2] >= STREAM_MUX_NUM_CHANNELS || length > STREAM_MUX_MAX_PAYLOAD) return BAD_HEADER;
+    *size = STREAM_MUX_HEADER_SIZE + length + STREAM_MUX_TRAILER_SIZE;
+    if (p->fill < *size) return NEED_MORE;
+
+    uint32_t crc = crc32(&f[2], *size - 2 - STREAM_MUX_TRAILER_SIZE, 0xFFFFFFFFu);
+    return crc == getLe32(&f[*size - STREAM_MUX_TRAILER_SIZE]) ? COMPLETE : BAD_CRC;
+}
+
+static void drop(StreamMuxParser* p, uint32_t n) {
+    memmove(p->frame, p->frame + n, p->fill - n);
+    p->fill -= n;
+}
+
+static void deliver(StreamMuxParser* p, StreamMuxFrameCallback onFrame, void* context) {
+    const uint8_t* f = p->frame;
+    StreamMuxChannel channel = (StreamMuxChannel)f[2];
+    uint16_t sequence = (uint16_t)getLe16(&f[6]);
+    uint32_t tag = getLe32(&f[8]);
+
+    // Every channel starts at 0 on the TX side, so frames lost before the first one count too
+    if (sequence != p->nextSequence[channel]) {
+        p->stats.lost[channel] += (uint16_t)(sequence - p->nextSequence[channel]);
+    }
+    p->nextSequence[channel] = (uint16_t)(sequence + 1);
+    p->stats.frames++;
+
+    if (onFrame) onFrame(context, channel, sequence, tag, &f[STREAM_MUX_HEADER_SIZE], getLe16(&f[4]));
+}
+
+extern "C" {
+
+void StreamMux_TxInit(StreamMuxTx* tx) {
+    tx->head = 0;
+    tx->tail = 0;
+    for (uint32_t i = 0; i < STREAM_MUX_NUM_CHANNELS; i++) tx->sequence[i] = 0;
+    tx->frames = 0;
+    tx->dropped = 0;
+}
+
+bool StreamMux_Prepare(const StreamMuxTx* tx, StreamMuxChannel channel, uint32_t tag,
+                       const void* payload, uint32_t length, StreamMuxFrame* frame) {
+    if (length > STREAM_MUX_MAX_PAYLOAD || (uint32_t)channel >= STREAM_MUX_NUM_CHANNELS) return false;
+
+    uint8_t* h = frame->header;
+    h[0] = STREAM_MUX_SYNC0;
+    h[1] = STREAM_MUX_SYNC1;
+    h[2] = (uint8_t)channel;
+    h[3] = 0;
+    putLe16(&h[4], length);
+    putLe16(&h[6], tx->sequence[channel]);
+    putLe32(&h[8], tag);
+
+    frame->payload = static_cast<const uint8_t*>(payload);
+    frame->length = length;
+    uint32_t crc = crc32(&h[2], STREAM_MUX_HEADER_SIZE - 2, 0xFFFFFFFFu);
+    putLe32(frame->trailer, crc32(frame->payload, length, crc));
+    return true;
+}
+
+bool StreamMux_Commit(StreamMuxTx* tx, const StreamMuxFrame* frame) {
+    uint32_t size = STREAM_MUX_HEADER_SIZE + frame->length + STREAM_MUX_TRAILER_SIZE;
+    if (STREAM_MUX_TX_SIZE - (tx->head - tx->tail) < size) {
+        tx->dropped++;
+        return false;
+    }
+
+    uint32_t head = tx->head;
+    ringPut(tx, head, frame->header, STREAM_MUX_HEADER_SIZE);
+    ringPut(tx, head + STREAM_MUX_HEADER_SIZE, frame->payload, frame->length);
+    ringPut(tx, head + STREAM_MUX_HEADER_SIZE + frame->length, frame->trailer, STREAM_MUX_TRAILER_SIZE);
+    tx->head = head + size;  // publish after the copy
+
+    tx->sequence[frame->header[2]]++;
+    tx->frames++;
+    return true;
+}
+
+bool StreamMux_Write(StreamMuxTx* tx, StreamMuxChannel channel, uint32_t tag,
+                     const void* payload, uint32_t length) {
+    StreamMuxFrame frame;
+    if (!StreamMux_Prepare(tx, channel, tag, payload, length, &frame)) {
+        tx->dropped++;
+        return false;
+    }
+    return StreamMux_Commit(tx, &frame);
+}
+
+uint32_t StreamMux_Peek(const StreamMuxTx* tx, const uint8_t** data) {
+    uint32_t pending = tx->head - tx->tail;
+    uint32_t offset = tx->tail & (STREAM_MUX_TX_SIZE - 1);
+    uint32_t contiguous = STREAM_MUX_TX_SIZE - offset;
+    *data = &tx->ring[offset];
+    return pending < contiguous ? pending : contiguous;
+}
+
+void StreamMux_Consume(StreamMuxTx* tx, uint32_t length) {
+    tx->tail += length;
+}
+
+uint32_t StreamMux_Pending(const StreamMuxTx* tx) {
+    return tx->head - tx->tail;
+}
+
+void StreamMux_ParserInit(StreamMuxParser* parser) {
+    memset(parser, 0, sizeof(*parser));
+}
+
+void StreamMux_Parse(StreamMuxParser* p, const uint8_t* data, uint32_t length,
+                     StreamMuxFrameCallback onFrame, void* context) {
+    while (length > 0) {
+        uint32_t n = STREAM_MUX_MAX_FRAME - p->fill;
+        if (n > length) n = length;
+        memcpy(&p->frame[p->fill], data, n);
+        p->fill += n;
+        data += n;
+        length -= n;
+
+        while (p->fill > 0) {
+            uint32_t size = 0;
+            CheckResult result = check(p, &size);
+            if (result == NEED_MORE) break;
+            if (result == COMPLETE) {
+                deliver(p, onFrame, context);
+                drop(p, size);
+                continue;
+            }
+
+            // Resynchronize on the next sync byte
+            if (result == BAD_CRC) p->stats.crcErrors++;
+            uint32_t skip = 1;
+            while (skip < p->fill && p->frame[skip] != STREAM_MUX_SYNC0) skip++;
+            p->stats.skippedBytes += skip;
+            drop(p, skip);
+        }
+    }
+}
+
+const char* StreamMux_ChannelName(StreamMuxChannel channel) {
+    if ((uint32_t)channel >= STREAM_MUX_NUM_CHANNELS) return "unknown";
+    return channelNames[channel];
+}
+
+} // extern "C"
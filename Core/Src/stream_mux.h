@@ -0,0 +1,151 @@
+/**
+ * @file    stream_mux.h
+ * @brief   Sequence-numbered framing that multiplexes several data channels over one byte stream
+ *
+ * Used by the USB stream (usb_stream.h) and by Tools/stream_mux on the host, which also runs the
+ * whole framing/reassembly path through a loopback stand-in for the USB link.
+ *
+ * Frame (little-endian):
+ *   0xB5 0x62 | channel | flags | payload bytes (2) | channel sequence (2) | tag (4)
+ *   | payload | CRC-32 over everything after the sync bytes (4)
+ *
+ * Every channel counts its own sequence, so the receiver sees which channel lost frames. The tag is
+ * channel specific (audio block sequence, KWS window, first trace event index, clip id).
+ *
+ * Writers queue whole frames into a StreamMuxTx ring and the transport drains it in arbitrary
+ * pieces; the parser reassembles frames from arbitrary pieces and resynchronizes after loss.
+ * Nothing here locks. Writing is split so the CRC runs outside the caller's critical section:
+ * StreamMux_Prepare (per channel writer) and StreamMux_Commit (ring copy, under the lock).
+ */
+
+#ifndef STREAM_MUX_H
+#define STREAM_MUX_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define STREAM_MUX_SYNC0         0xB5
+#define STREAM_MUX_SYNC1         0x62
+#define STREAM_MUX_HEADER_SIZE   12
+#define STREAM_MUX_TRAILER_SIZE  4
+#define STREAM_MUX_MAX_PAYLOAD   2048
+#define STREAM_MUX_MAX_FRAME     (STREAM_MUX_HEADER_SIZE + STREAM_MUX_MAX_PAYLOAD + STREAM_MUX_TRAILER_SIZE)
+
+/* TX ring size in bytes, power of two */
+#define STREAM_MUX_TX_SIZE       8192
+
+typedef enum {
+    STREAM_MUX_AUDIO = 0,   /* One audio_stream.h frame per DMA block, tag = block sequence */
+    STREAM_MUX_FEATURES,    /* FEATURES_SIZE floats, tag = KWS window */
+    STREAM_MUX_LOGITS,      /* KWS_NUM_LABELS raw network logits (before softmax), tag = KWS window */
+    STREAM_MUX_TRACE,       /* TraceEvent records, tag = index of the first event */
+    STREAM_MUX_CLIPS,       /* Flash clip download (flash_recorder.h), tag = clip id */
+    STREAM_MUX_NUM_CHANNELS
+} StreamMuxChannel;
+
+/* TX ring, fill with StreamMux_Write, drain with StreamMux_Peek/StreamMux_Consume */
+typedef struct {
+    uint8_t ring[STREAM_MUX_TX_SIZE];
+    volatile uint32_t head;  /* Next write position (free-running) */
+    volatile uint32_t tail;  /* First byte not yet consumed (free-running) */
+    uint16_t sequence[STREAM_MUX_NUM_CHANNELS];
+    uint32_t frames;         /* Frames queued */
+    uint32_t dropped;        /* Frames dropped because the ring was full */
+} StreamMuxTx;
+
+typedef struct {
+    uint32_t frames;                         /* Frames delivered */
+    uint32_t crcErrors;                      /* Frames with a bad CRC */
+    uint32_t skippedBytes;                   /* Bytes discarded while searching for a frame */
+    uint32_t lost[STREAM_MUX_NUM_CHANNELS];  /* Frames missing from the per-channel sequence */
+} StreamMuxParserStats;
+
+typedef void (*StreamMuxFrameCallback)(void* context, StreamMuxChannel channel, uint16_t sequence,
+                                       uint32_t tag, const uint8_t* payload, uint32_t length);
+
+/* Receiver state, one per byte stream */
+typedef struct {
+    uint8_t frame[STREAM_MUX_MAX_FRAME];
+    uint32_t fill;
+    uint16_t nextSequence[STREAM_MUX_NUM_CHANNELS];  /* Expected sequence, 0 after StreamMux_ParserInit */
+    StreamMuxParserStats stats;
+} StreamMuxParser;
+
+/* A frame built by StreamMux_Prepare, the payload is referenced, not copied */
+typedef struct {
+    uint8_t header[STREAM_MUX_HEADER_SIZE];
+    uint8_t trailer[STREAM_MUX_TRAILER_SIZE];
+    const uint8_t* payload;
+    uint32_t length;
+} StreamMuxFrame;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief  Reset a TX ring and its sequence counters
+ */
+void StreamMux_TxInit(StreamMuxTx* tx);
+
+/**
+ * @brief  Build header and CRC for the next frame of a channel
+ * @param  tag: channel specific value carried in the header
+ * @param  payload: at most STREAM_MUX_MAX_PAYLOAD bytes, must stay valid until StreamMux_Commit
+ * @return false if the payload is too long
+ * @note   Only reads the channel's sequence, one writer per channel
+ */
+bool StreamMux_Prepare(const StreamMuxTx* tx, StreamMuxChannel channel, uint32_t tag,
+                       const void* payload, uint32_t length, StreamMuxFrame* frame);
+
+/**
+ * @brief  Copy a prepared frame into the ring and advance the channel sequence
+ * @return false if the ring has no room for the whole frame (counted in tx->dropped)
+ * @note   Not reentrant, one writer at a time
+ */
+bool StreamMux_Commit(StreamMuxTx* tx, const StreamMuxFrame* frame);
+
+/**
+ * @brief  StreamMux_Prepare and StreamMux_Commit in one go
+ */
+bool StreamMux_Write(StreamMuxTx* tx, StreamMuxChannel channel, uint32_t tag,
+                     const void* payload, uint32_t length);
+
+/**
+ * @brief  Get the next contiguous piece of queued bytes
+ * @param  data: receives a pointer into the ring
+ * @return Number of bytes at data, 0 if the ring is empty
+ */
+uint32_t StreamMux_Peek(const StreamMuxTx* tx, const uint8_t** data);
+
+/**
+ * @brief  Release bytes returned by StreamMux_Peek
+ */
+void StreamMux_Consume(StreamMuxTx* tx, uint32_t length);
+
+/**
+ * @brief  Bytes queued and not yet consumed
+ */
+uint32_t StreamMux_Pending(const StreamMuxTx* tx);
+
+/**
+ * @brief  Reset a parser, every channel expects sequence 0 (a fresh StreamMuxTx)
+ */
+void StreamMux_ParserInit(StreamMuxParser* parser);
+
+/**
+ * @brief  Feed received bytes, calls onFrame for every complete frame with a valid CRC
+ */
+void StreamMux_Parse(StreamMuxParser* parser, const uint8_t* data, uint32_t length,
+                     StreamMuxFrameCallback onFrame, void* context);
+
+/**
+ * @brief  Get the name of a channel
+ */
+const char* StreamMux_ChannelName(StreamMuxChannel channel);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STREAM_MUX_H */
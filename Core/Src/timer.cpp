@@ -12,4 +12,12 @@ void delayMicroseconds(int i){
 	}
 }
 
+void cycleCounterInit(void){
+	// Already running since BootProfile_Start: keep counting, the boot timeline refers to it
+	if (DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk) return;
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
 } // extern "C"
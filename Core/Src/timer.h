@@ -10,6 +10,20 @@ extern "C" {
 extern TIM_HandleTypeDef htim4;
 void delayMicroseconds(int i);
 
+/**
+ * @brief  Enable the DWT cycle counter (CPU clock cycles)
+ * @note   Call once at startup before using cycleCounterGet()
+ */
+void cycleCounterInit(void);
+
+/**
+ * @brief  Read the DWT cycle counter
+ * @note   Wraps every ~25 s at 168 MHz, use unsigned differences
+ */
+static inline uint32_t cycleCounterGet(void) {
+	return DWT->CYCCNT;
+}
+
 #ifdef __cplusplus
 }
 #endif
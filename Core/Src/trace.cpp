@@ -0,0 +1,93 @@
+// Trace buffer
+// Writers claim a slot with one atomic increment and fill it; a reader racing with a writer
+// can see one torn event at the head of the ring, the converter drops events with bad ids.
+
+#include "trace.h"
+#include "main.h"
+#include "timer.h"
+#include "usb_stream.h"
+#include <atomic>
+#include <stdio.h>
+
+static_assert((TRACE_CAPACITY & (TRACE_CAPACITY - 1)) == 0, "TRACE_CAPACITY must be a power of two");
+static_assert(sizeof(TraceEvent) == 8, "dump format expects 8-byte events");
+
+// Events kept in front of the trigger (covers the DMA block that contained it)
+static const uint32_t PRE_TRIGGER_EVENTS = 8;
+
+// Events per USB trace frame
+static const uint32_t USB_FRAME_EVENTS = 128;
+
+// RING
+static TraceEvent events[TRACE_CAPACITY];
+static std::atomic<uint32_t> writeIndex(0);
+static uint32_t dumpedIndex = 0;  // main loop only
+
+extern "C" {
+
+void Trace_Record(TraceId id, uint8_t phase, uint16_t arg) {
+    uint32_t index = writeIndex.fetch_add(1, std::memory_order_relaxed);
+    TraceEvent& e = events[index & (TRACE_CAPACITY - 1)];
+    e.cycles = cycleCounterGet();
+    e.id = (uint8_t)id;
+    e.phase = phase;
+    e.arg = arg;
+}
+
+void Trace_DumpUtterance(void) {
+    uint32_t end = writeIndex.load(std::memory_order_acquire);
+    uint32_t start = dumpedIndex;
+    uint32_t dropped = 0;
+    if (end - start > TRACE_CAPACITY) {
+        dropped = end - start - TRACE_CAPACITY;
+        start = end - TRACE_CAPACITY;
+    }
+
+    // Skip the idle blocks before the latest trigger
+    for (uint32_t i = end; i != start; i--) {
+        if (events[(i - 1) & (TRACE_CAPACITY - 1)].id == TRACE_TRIGGER) {
+            if (i - 1 - start > PRE_TRIGGER_EVENTS) start = i - 1 - PRE_TRIGGER_EVENTS;
+            break;
+        }
+    }
+
+    // Binary copy on the USB trace channel, in pieces that do not wrap the ring
+    if (UsbStream_IsOpen()) {
+        uint32_t index = start;
+        while (index != end) {
+            uint32_t offset = index & (TRACE_CAPACITY - 1);
+            uint32_t n = end - index;
+            if (n > USB_FRAME_EVENTS) n = USB_FRAME_EVENTS;
+            if (n > TRACE_CAPACITY - offset) n = TRACE_CAPACITY - offset;
+            UsbStream_Send(STREAM_MUX_TRACE, index, &events[offset], n * sizeof(TraceEvent));
+            index += n;
+        }
+    }
+
+    printf("[TRACE] begin cpu=%lu tick=%lu now=%lu events=%lu dropped=%lu\r\n",
+           (unsigned long)SystemCoreClock, (unsigned long)HAL_GetTick(), (unsigned long)cycleCounterGet(),
+           (unsigned long)(end - start), (unsigned long)dropped);
+
+    static const char hex[] = "0123456789abcdef";
+    char line[8 + TRACE_EVENTS_PER_LINE * 16 + 3];
+    uint32_t index = start;
+    while (index != end) {
+        int pos = sprintf(line, "[TRACE] ");
+        for (int n = 0; n < TRACE_EVENTS_PER_LINE && index != end; n++, index++) {
+            const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&events[index & (TRACE_CAPACITY - 1)]);
+            for (uint32_t b = 0; b < sizeof(TraceEvent); b++) {
+                line[pos++] = hex[bytes[b] >> 4];
+                line[pos++] = hex[bytes[b] & 0x0F];
+            }
+        }
+        line[pos++] = '\r';
+        line[pos++] = '\n';
+        line[pos] = '\0';
+        printf("%s", line);
+    }
+    printf("[TRACE] end\r\n");
+
+    dumpedIndex = end;
+}
+
+} // extern "C"
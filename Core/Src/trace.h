@@ -0,0 +1,59 @@
+/**
+ * @file    trace.h
+ * @brief   Fixed-size binary trace buffer for end-to-end latency measurements
+ *
+ * Begin/end spans and instant events with DWT timestamps go into a ring of TRACE_CAPACITY
+ * events. Recording is lock-free (one atomic increment), so it is safe from the I2S ISR
+ * and the main loop. After each utterance the main loop dumps the events from just
+ * before the trigger over UART; Tools/trace_convert turns the log into Chrome trace JSON.
+ *
+ * Build with TRACE_ENABLED=0 to compile all trace points out.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "trace_events.h"
+
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 1
+#endif
+
+/* Ring size in events (8 bytes each), power of two */
+#define TRACE_CAPACITY 1024
+
+/**
+ * @brief  Append one event
+ * @note   Use the TRACE_* macros below
+ */
+void Trace_Record(TraceId id, uint8_t phase, uint16_t arg);
+
+/**
+ * @brief  Dump all events since the last dump, starting a few events before the latest trigger
+ * @note   Blocking UART output, call from the main loop. The raw events also go to the USB trace
+ *         channel while a host has it open (usb_stream.h).
+ */
+void Trace_DumpUtterance(void);
+
+#if TRACE_ENABLED
+#define TRACE_BEGIN(id)         Trace_Record(TRACE_##id, TRACE_PHASE_BEGIN, 0)
+#define TRACE_BEGIN_ARG(id, a)  Trace_Record(TRACE_##id, TRACE_PHASE_BEGIN, (uint16_t)(a))
+#define TRACE_END(id)           Trace_Record(TRACE_##id, TRACE_PHASE_END, 0)
+#define TRACE_INSTANT(id, a)    Trace_Record(TRACE_##id, TRACE_PHASE_INSTANT, (uint16_t)(a))
+#else
+#define TRACE_BEGIN(id)         ((void)0)
+#define TRACE_BEGIN_ARG(id, a)  ((void)0)
+#define TRACE_END(id)           ((void)0)
+#define TRACE_INSTANT(id, a)    ((void)0)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TRACE_H */
@@ -0,0 +1,55 @@
+/**
+ * @file    trace_events.h
+ * @brief   Trace event ids and the binary dump layout (shared with Tools/trace_convert)
+ */
+
+#ifndef TRACE_EVENTS_H
+#define TRACE_EVENTS_H
+
+#include <stdint.h>
+
+/* X(id, name, context) - context becomes the thread row in the Chrome trace; the KWS job runs in
+ * steps from the main loop (inference_scheduler.h) but gets its own row, so its spans nest */
+#define TRACE_EVENTS(X) \
+    X(DMA_BLOCK,      "dma_block",      "i2s_isr") \
+    X(AUDIO_1SEC,     "audio1sec",      "i2s_isr") \
+    X(TRIGGER,        "trigger",        "i2s_isr") \
+    X(RECORDING_END,  "recording_end",  "i2s_isr") \
+    X(KWS_JOB,        "kws_job",        "kws_job") \
+    X(FEATURES,       "features",       "kws_job") \
+    X(INFERENCE,      "inference",      "kws_job") \
+    X(DECISION,       "decision",       "kws_job") \
+    X(SUBMIT,         "submit",         "main")    \
+    X(RESULT,         "result",         "main")    \
+    X(SEND_SEQUENCE,  "send_sequence",  "main")    \
+    X(CLOCK_SWITCH,   "clock_switch",   "main")
+
+#define TRACE_ID_ENUM(id, name, context) TRACE_##id,
+typedef enum {
+    TRACE_EVENTS(TRACE_ID_ENUM)
+    TRACE_NUM_IDS
+} TraceId;
+#undef TRACE_ID_ENUM
+
+/* Phases, same letters as the Chrome trace "ph" field */
+#define TRACE_PHASE_BEGIN    'B'
+#define TRACE_PHASE_END      'E'
+#define TRACE_PHASE_INSTANT  'i'
+
+/* One event, 8 bytes, dumped little-endian as 16 hex digits */
+typedef struct {
+    uint32_t cycles;  /* DWT cycle counter */
+    uint8_t id;       /* TraceId */
+    uint8_t phase;    /* TRACE_PHASE_* */
+    uint16_t arg;     /* Event specific (block sequence, class label, ...); CLOCK_SWITCH: old MHz << 8 | new MHz */
+} TraceEvent;
+
+/*
+ * UART dump format (one utterance):
+ *   [TRACE] begin cpu=<Hz> tick=<HAL_GetTick ms> now=<DWT cycles> events=<n> dropped=<n>
+ *   [TRACE] <up to 16 events as hex>
+ *   [TRACE] end
+ */
+#define TRACE_EVENTS_PER_LINE 16
+
+#endif /* TRACE_EVENTS_H */
@@ -1,5 +1,6 @@
 #include "transmit.h"
 #include "stm32f4xx_hal.h"
+#include "trace.h"
 
 extern "C" {
 
@@ -15,6 +16,7 @@ void transmit(int high_val,int low_val){
 void sendSequence(uint16_t bitSequence){
 	// CRITICAL: Disable interrupts during transmission to prevent timing issues
 	// I2S DMA interrupts can interfere with microsecond-precise timing
+	TRACE_BEGIN(SEND_SEQUENCE);
 	__disable_irq();
 	
 	uint16_t ref = 0x0800;
@@ -39,6 +41,7 @@ void sendSequence(uint16_t bitSequence){
 	
 	// Re-enable interrupts after transmission is complete
 	__enable_irq();
+	TRACE_END(SEND_SEQUENCE);
 
 }
 
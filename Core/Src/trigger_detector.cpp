@@ -0,0 +1,54 @@
+// Loudness trigger
+// Portable, shared between the firmware and Tools/detector_tune.
+
+#include "trigger_detector.h"
+#include "detector_config.h"
+#include "audio_timeline.h"
+
+extern "C" {
+
+void TriggerDetector_DefaultParams(TriggerDetectorParams* params) {
+    params->noiseThreshold = DETECTOR_NOISE_THRESHOLD;
+    params->initialOffset = DETECTOR_INITIAL_OFFSET;
+    params->attack = DETECTOR_ATTACK;
+    params->decay = DETECTOR_DECAY;
+    params->loudSamples = DETECTOR_LOUD_SAMPLES;
+    params->cooldownMs = DETECTOR_COOLDOWN_MS;
+    params->preRollSamples = DETECTOR_PRE_ROLL_SAMPLES;
+}
+
+void TriggerDetector_Init(TriggerDetector* detector, const TriggerDetectorParams* params) {
+    detector->params = *params;
+    detector->offset = params->initialOffset;
+    detector->loudRun = 0;
+    detector->recording = false;
+    detector->cooldownEnd = 0;
+}
+
+void TriggerDetector_BlockStart(TriggerDetector* detector) {
+    detector->loudRun = 0;
+}
+
+TriggerEvent TriggerDetector_Sample(TriggerDetector* detector, int32_t x, uint64_t sample) {
+    const TriggerDetectorParams& p = detector->params;
+    int32_t magnitude = x < 0 ? -x : x;
+    // EMA (exponential moving average): the threshold follows the room level
+    detector->offset = (int32_t)(p.attack * magnitude + p.decay * detector->offset);
+    bool loud = magnitude > detector->offset;
+    detector->loudRun = loud ? detector->loudRun + 1 : 0;
+
+    if (magnitude > p.noiseThreshold) return TRIGGER_SPIKE;
+
+    if (detector->loudRun >= p.loudSamples && loud && !detector->recording && sample > detector->cooldownEnd) {
+        detector->recording = true;
+        return TRIGGER_START;
+    }
+    return TRIGGER_NONE;
+}
+
+void TriggerDetector_RecordingDone(TriggerDetector* detector, uint64_t sample) {
+    detector->recording = false;
+    detector->cooldownEnd = sample + (uint64_t)detector->params.cooldownMs * AUDIO_TIMELINE_SAMPLE_RATE / 1000u;
+}
+
+} // extern "C"
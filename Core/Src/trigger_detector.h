@@ -0,0 +1,82 @@
+/**
+ * @file    trigger_detector.h
+ * @brief   Loudness trigger that starts the 1 s recordings (shared with Tools/detector_tune)
+ *
+ * Per sample of the raw 18-bit microphone signal:
+ *   - adaptive threshold: offset = attack * |x| + decay * offset, in double (bit-exact with the
+ *     original 0.113 / 0.9 literals), truncated to integer
+ *   - loud run: samples in a row with |x| above the threshold; the run restarts with every DMA
+ *     block (TriggerDetector_BlockStart)
+ *   - |x| above noiseThreshold is a spike: the sample is dropped, it is neither recorded nor
+ *     checked for the trigger
+ *   - trigger once the run reaches loudSamples, if no recording runs and the cooldown after the
+ *     last one has passed
+ * The recording takes preRollSamples from before the trigger and fills up to PIPELINE.recordingSamples after
+ * it. Parameters come from detector_config.h, generated offline by Tools/detector_tune.
+ */
+
+#ifndef TRIGGER_DETECTOR_H
+#define TRIGGER_DETECTOR_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct {
+    int32_t noiseThreshold;   /* |x| above: spike */
+    int32_t initialOffset;    /* Threshold at start */
+    double attack;            /* Threshold EMA factors, double as in the original Audio1Sec loop */
+    double decay;
+    uint32_t loudSamples;     /* Loud run that triggers */
+    uint32_t cooldownMs;      /* No trigger this long after a recording ends */
+    uint32_t preRollSamples;  /* Samples before the trigger in a recording */
+} TriggerDetectorParams;
+
+typedef enum {
+    TRIGGER_NONE = 0,
+    TRIGGER_SPIKE,            /* Drop the sample */
+    TRIGGER_START             /* Start a recording with this sample */
+} TriggerEvent;
+
+typedef struct {
+    TriggerDetectorParams params;
+    int32_t offset;           /* Adaptive threshold */
+    uint32_t loudRun;
+    bool recording;
+    uint64_t cooldownEnd;     /* Audio timeline sample */
+} TriggerDetector;
+
+/**
+ * @brief  Parameters from detector_config.h
+ */
+void TriggerDetector_DefaultParams(TriggerDetectorParams* params);
+
+/**
+ * @brief  Reset threshold, run and cooldown
+ */
+void TriggerDetector_Init(TriggerDetector* detector, const TriggerDetectorParams* params);
+
+/**
+ * @brief  Start of a DMA block, the loud run restarts
+ */
+void TriggerDetector_BlockStart(TriggerDetector* detector);
+
+/**
+ * @brief  Feed one sample
+ * @param  sample: its index on the audio timeline (cooldown)
+ */
+TriggerEvent TriggerDetector_Sample(TriggerDetector* detector, int32_t x, uint64_t sample);
+
+/**
+ * @brief  The recording is full, the cooldown starts
+ */
+void TriggerDetector_RecordingDone(TriggerDetector* detector, uint64_t sample);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TRIGGER_DETECTOR_H */
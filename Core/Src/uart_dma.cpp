@@ -0,0 +1,123 @@
+// UART TX over DMA
+// The ring is filled by producers with interrupts masked for the copy; the DMA sends one
+// contiguous piece at a time and the TX complete callback starts the next one.
+
+#include "uart_dma.h"
+
+extern UART_HandleTypeDef huart3;
+
+DMA_HandleTypeDef hdma_usart3_tx;
+
+// RING
+static uint8_t ring[UART_DMA_BUFFER_SIZE];
+static volatile uint32_t head = 0;      // next write position
+static volatile uint32_t tail = 0;      // first byte not yet sent
+static volatile uint32_t inFlight = 0;  // bytes handed to the DMA
+static volatile bool ready = false;
+
+static uint32_t freeSpace(void) {
+    return UART_DMA_BUFFER_SIZE - 1 - ((head - tail) % UART_DMA_BUFFER_SIZE);
+}
+
+// Start the next piece, call with interrupts masked
+static void kick(void) {
+    if (inFlight || head == tail) return;
+    uint32_t end = head > tail ? head : UART_DMA_BUFFER_SIZE;
+    uint32_t length = end - tail;
+    if (length > 0xFFFF) length = 0xFFFF;
+    inFlight = length;
+    if (HAL_UART_Transmit_DMA(&huart3, &ring[tail], (uint16_t)length) != HAL_OK) {
+        inFlight = 0;  // retried on the next write
+    }
+}
+
+extern "C" {
+
+void UartDma_Init(void) {
+    __HAL_RCC_DMA1_CLK_ENABLE();
+
+    hdma_usart3_tx.Instance = DMA1_Stream4;
+    hdma_usart3_tx.Init.Channel = DMA_CHANNEL_7;
+    hdma_usart3_tx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+    hdma_usart3_tx.Init.PeriphInc = DMA_PINC_DISABLE;
+    hdma_usart3_tx.Init.MemInc = DMA_MINC_ENABLE;
+    hdma_usart3_tx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    hdma_usart3_tx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    hdma_usart3_tx.Init.Mode = DMA_NORMAL;
+    hdma_usart3_tx.Init.Priority = DMA_PRIORITY_LOW;
+    hdma_usart3_tx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+    if (HAL_DMA_Init(&hdma_usart3_tx) != HAL_OK) {
+        Error_Handler();
+    }
+    __HAL_LINKDMA(&huart3, hdmatx, hdma_usart3_tx);
+
+    // Below the I2S DMA (0)
+    HAL_NVIC_SetPriority(DMA1_Stream4_IRQn, 5, 0);
+    HAL_NVIC_EnableIRQ(DMA1_Stream4_IRQn);
+    HAL_NVIC_SetPriority(USART3_IRQn, 5, 0);
+    HAL_NVIC_EnableIRQ(USART3_IRQn);
+
+    head = tail = inFlight = 0;
+    ready = true;
+}
+
+bool UartDma_IsReady(void) {
+    return ready;
+}
+
+bool UartDma_Write(const void* data, uint32_t length, bool block) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    if (length >= UART_DMA_BUFFER_SIZE) return false;
+
+    while (true) {
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        if (freeSpace() >= length) {
+            uint32_t h = head;
+            for (uint32_t i = 0; i < length; i++) ring[(h + i) % UART_DMA_BUFFER_SIZE] = bytes[i];
+            head = (h + length) % UART_DMA_BUFFER_SIZE;
+            kick();
+            __set_PRIMASK(primask);
+            return true;
+        }
+        kick();
+        __set_PRIMASK(primask);
+        if (!block) return false;
+    }
+}
+
+void UartDma_Drain(void) {
+    while (head != tail || inFlight) {
+        // Restarts a piece whose HAL_UART_Transmit_DMA failed, nothing else would
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        kick();
+        __set_PRIMASK(primask);
+    }
+    // Last byte out of the shift register
+    while (__HAL_UART_GET_FLAG(&huart3, UART_FLAG_TC) == RESET) {
+    }
+}
+
+void UartDma_SetBaudrate(uint32_t baudrate) {
+    UartDma_Drain();
+    huart3.Init.BaudRate = baudrate;
+    if (HAL_UART_Init(&huart3) != HAL_OK) {
+        Error_Handler();
+    }
+}
+
+void UartDma_ClockChanged(void) {
+    uint32_t brr = UART_BRR_SAMPLING16(HAL_RCC_GetPCLK1Freq(), huart3.Init.BaudRate);
+    if (huart3.Instance->BRR == brr) return;
+    UartDma_SetBaudrate(huart3.Init.BaudRate);
+}
+
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef* huart) {
+    if (huart != &huart3) return;
+    tail = (tail + inFlight) % UART_DMA_BUFFER_SIZE;
+    inFlight = 0;
+    kick();
+}
+
+} // extern "C"
@@ -0,0 +1,63 @@
+/**
+ * @file    uart_dma.h
+ * @brief   Queued USART3 output over DMA1 Stream4 (channel 7)
+ *
+ * All UART output (printf, deferred log, audio stream) goes through one TX ring that the DMA
+ * drains in the background. Stream3 is taken by the I2S2 RX DMA, so USART3_TX uses its
+ * alternative mapping on Stream4. Writes are all-or-nothing, so frames never interleave.
+ */
+
+#ifndef UART_DMA_H
+#define UART_DMA_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "main.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/* TX ring size in bytes */
+#define UART_DMA_BUFFER_SIZE  8192
+
+/**
+ * @brief  Set up the TX DMA for huart3 and enable its interrupts
+ */
+void UartDma_Init(void);
+
+/**
+ * @brief  Queue bytes for transmission
+ * @param  length: below UART_DMA_BUFFER_SIZE, longer writes fail
+ * @param  block: wait for space (main loop only), otherwise fail if the ring is full
+ * @return true if all bytes were queued
+ * @note   Non-blocking writes are safe from interrupts
+ */
+bool UartDma_Write(const void* data, uint32_t length, bool block);
+
+/**
+ * @brief  Wait until everything queued has been sent
+ */
+void UartDma_Drain(void);
+
+/**
+ * @brief  Change the baud rate after draining the queue
+ */
+void UartDma_SetBaudrate(uint32_t baudrate);
+
+/**
+ * @brief  Reprogram the baud rate register after a bus clock change, if PCLK1 moved
+ * @note   Drains the ring first when it has to change the register
+ */
+void UartDma_ClockChanged(void);
+
+/**
+ * @brief  true once UartDma_Init has run
+ */
+bool UartDma_IsReady(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UART_DMA_H */
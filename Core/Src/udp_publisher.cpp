@@ -0,0 +1,192 @@
+// UDP publisher
+// The TX side of the MAC is started by hand (HAL_ETH_Start would also arm the RX DMA, which has no
+// buffers here). Send may run in the I2S ISR, so the descriptor ring is only touched under PRIMASK.
+
+#include "udp_publisher.h"
+#include "kws.h"
+#include "audio_timeline.h"
+#include "audio_stream.h"
+#include "agc.h"
+#include "lazy_init.h"
+#include "deferred_log.h"
+#include "main.h"
+#include <string.h>
+
+extern ETH_HandleTypeDef heth;
+
+// LAN8742A on the Nucleo board (basic registers from stm32f4xx_hal_conf.h)
+static const uint32_t PHY_ADDRESS = 0;
+static const uint32_t PHY_SCSR = 31;  // special control/status
+static const uint32_t PHY_SCSR_AUTONEG_DONE = 0x1000;
+static const uint32_t PHY_SCSR_100M = 0x0008;
+static const uint32_t PHY_SCSR_FULL_DUPLEX = 0x0010;
+
+static const uint32_t LINK_CHECK_MS = 1000;
+
+// DESCRIPTORS (SRAM, the Ethernet DMA cannot reach CCM RAM)
+static UdpTxDescriptor descriptors[UDP_TX_DESCRIPTORS] __attribute__((aligned(4)));
+
+// STATE
+static UdpTx tx;
+static uint32_t sequence[4] = {};
+static volatile bool started = false;
+static volatile bool linkUp = false;
+static uint32_t lastLinkCheck = 0;
+
+static void startTransmitter(void) {
+    uint32_t scsr = 0;
+    HAL_ETH_ReadPHYRegister(&heth, PHY_ADDRESS, PHY_SCSR, &scsr);
+
+    ETH_MACConfigTypeDef mac;
+    HAL_ETH_GetMACConfig(&heth, &mac);
+    mac.Speed = (scsr & PHY_SCSR_100M) ? ETH_SPEED_100M : ETH_SPEED_10M;
+    mac.DuplexMode = (scsr & PHY_SCSR_FULL_DUPLEX) ? ETH_FULLDUPLEX_MODE : ETH_HALFDUPLEX_MODE;
+    HAL_ETH_SetMACConfig(&heth, &mac);
+
+    ETH_TypeDef* eth = heth.Instance;
+    eth->DMATDLAR = (uint32_t)(uintptr_t)&descriptors[0];
+    eth->MACCR |= ETH_MACCR_TE;
+    eth->DMAOMR |= ETH_DMAOMR_FTF;
+    while (eth->DMAOMR & ETH_DMAOMR_FTF) {
+    }
+    eth->DMAOMR |= ETH_DMAOMR_ST;
+    started = true;
+
+    DLOG("[ETH] Link up, %lu Mbit/s %s duplex, UDP port %lu",
+         (unsigned long)((scsr & PHY_SCSR_100M) ? 100 : 10),
+         (scsr & PHY_SCSR_FULL_DUPLEX) ? "full" : "half", (unsigned long)UDP_PUBLISHER_PORT);
+}
+
+// Link lost: stop the DMA and the MAC, drop what is still queued, the next link-up starts over
+// (speed and duplex may differ)
+static void stopTransmitter(void) {
+    started = false;
+
+    ETH_TypeDef* eth = heth.Instance;
+    eth->DMAOMR &= ~ETH_DMAOMR_ST;
+    // The DMA finishes the frame it is reading, then stops
+    uint32_t start = HAL_GetTick();
+    while ((eth->DMASR & ETH_DMASR_TPS) != ETH_DMASR_TPS_Stopped && HAL_GetTick() - start < 2) {
+    }
+    eth->MACCR &= ~ETH_MACCR_TE;
+    eth->DMAOMR |= ETH_DMAOMR_FTF;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    UdpTx_Reset(&tx);
+    __set_PRIMASK(primask);
+}
+
+extern "C" {
+
+void UdpPublisher_Init(void) {
+    if (!LazyInit_Require(LAZY_ETH)) return;
+
+    UdpTxConfig config = {};
+    static const uint8_t srcIp[4] = UDP_PUBLISHER_SRC_IP;
+    static const uint8_t dstIp[4] = UDP_PUBLISHER_DST_IP;
+    static const uint8_t dstMac[6] = UDP_PUBLISHER_DST_MAC;
+    memcpy(config.srcMac, heth.Init.MACAddr, 6);
+    memcpy(config.dstMac, dstMac, 6);
+    memcpy(config.srcIp, srcIp, 4);
+    memcpy(config.dstIp, dstIp, 4);
+    config.srcPort = UDP_PUBLISHER_PORT;
+    config.dstPort = UDP_PUBLISHER_PORT;
+    UdpTx_Init(&tx, descriptors, &config);
+
+    lastLinkCheck = HAL_GetTick() - LINK_CHECK_MS;
+    UdpPublisher_Poll();
+}
+
+void UdpPublisher_Poll(void) {
+    if (!LazyInit_IsReady(LAZY_ETH)) return;
+    uint32_t now = HAL_GetTick();
+    if (now - lastLinkCheck >= LINK_CHECK_MS) {
+        lastLinkCheck = now;
+        uint32_t bsr = 0, scsr = 0;
+        // Link status is latched low, the second read is current
+        HAL_ETH_ReadPHYRegister(&heth, PHY_ADDRESS, PHY_BSR, &bsr);
+        HAL_ETH_ReadPHYRegister(&heth, PHY_ADDRESS, PHY_BSR, &bsr);
+        HAL_ETH_ReadPHYRegister(&heth, PHY_ADDRESS, PHY_SCSR, &scsr);
+        bool up = (bsr & PHY_LINKED_STATUS) && (scsr & PHY_SCSR_AUTONEG_DONE);
+        if (up && !started) startTransmitter();
+        if (!up && started) {
+            stopTransmitter();
+            DLOG("[ETH] Link down");
+        }
+        linkUp = up;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    UdpTx_Reclaim(&tx);
+    __set_PRIMASK(primask);
+}
+
+bool UdpPublisher_IsActive(void) {
+    return started && linkUp;
+}
+
+bool UdpPublisher_Send(UdpMessageType type, const void* payload, uint32_t length,
+                       UdpTxDoneCallback done, void* context) {
+    if (!UdpPublisher_IsActive()) return false;
+
+    UdpMessageHeader header;
+    header.magic = UDP_PUBLISHER_MAGIC;
+    header.version = UDP_PUBLISHER_VERSION;
+    header.type = (uint8_t)type;
+    header.timeMs = HAL_GetTick();
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    header.sequence = sequence[type & 3];
+    bool queued = UdpTx_Send(&tx, &header, sizeof(header), payload, length, done, context);
+    if (queued) sequence[type & 3]++;
+    __set_PRIMASK(primask);
+
+    if (queued) {
+        // Descriptors are written before the DMA is told to look at them
+        __DSB();
+        heth.Instance->DMATPDR = 0;
+    }
+    return queued;
+}
+
+void UdpPublisher_CollectMetrics(UdpMetrics* m) {
+    KwsStats kws;
+    AudioTimelineStats timeline;
+    AudioStreamStats stream;
+    AgcStats agc;
+    Kws_GetStats(&kws);
+    AudioTimeline_GetStats(&timeline);
+    AudioStream_GetStats(&stream);
+    Agc_GetStats(&agc);
+
+    m->uptimeMs = HAL_GetTick();
+    m->kwsWindows = kws.windows;
+    m->kwsRejectedEarly = kws.rejectedEarly;
+    m->kwsUnknown = kws.unknown;
+    m->kwsKeywords = kws.keywords;
+    m->kwsAvgCycles = kws.windows ? (uint32_t)(kws.totalCycles / kws.windows) : 0;
+    m->audioBlocks = timeline.blocks;
+    m->audioLostBlocks = timeline.lostBlocks;
+    m->audioGaps = timeline.gaps;
+    m->audioMaxLatency = timeline.maxLatency;
+    m->streamFrames = stream.frames;
+    m->streamDropped = stream.droppedFrames;
+    m->udpPackets = tx.stats.packets;
+    m->udpBusy = tx.stats.busy;
+    m->udpErrors = tx.stats.errors;
+    m->agcGain = agc.gain;
+    m->agcEnvelope = agc.envelope;
+    m->agcClipped = agc.clipped;
+}
+
+void UdpPublisher_PrintStats(void) {
+    if (!started) return;
+    DLOG("[ETH] packets: %lu, busy: %lu, errors: %lu, in flight: %lu",
+         (unsigned long)tx.stats.packets, (unsigned long)tx.stats.busy,
+         (unsigned long)tx.stats.errors, (unsigned long)UdpTx_InFlight(&tx));
+}
+
+} // extern "C"
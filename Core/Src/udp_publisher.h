@@ -0,0 +1,130 @@
+/**
+ * @file    udp_publisher.h
+ * @brief   UDP publisher for detection events, compressed audio and metrics over the Ethernet MAC
+ *
+ * Transmit only, on top of the MAC that MX_ETH_Init configures: the publisher points the TX DMA at
+ * its own descriptor ring (udp_tx.h) once the PHY reports a link and sends broadcast datagrams to
+ * UDP_PUBLISHER_PORT. Payloads are sent from the pipeline buffers without copying; every datagram
+ * starts with a UdpMessageHeader. Tools/udp_receive listens for them on the host.
+ *
+ * Message payloads are little-endian structs, shared with the host tool.
+ */
+
+#ifndef UDP_PUBLISHER_H
+#define UDP_PUBLISHER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "udp_tx.h"
+
+#ifndef UDP_PUBLISHER_PORT
+#define UDP_PUBLISHER_PORT     5005
+#endif
+
+/* Source address of the board, the destination defaults to broadcast (no ARP needed) */
+#ifndef UDP_PUBLISHER_SRC_IP
+#define UDP_PUBLISHER_SRC_IP   {192, 168, 1, 50}
+#endif
+#ifndef UDP_PUBLISHER_DST_IP
+#define UDP_PUBLISHER_DST_IP   {255, 255, 255, 255}
+#endif
+#ifndef UDP_PUBLISHER_DST_MAC
+#define UDP_PUBLISHER_DST_MAC  {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF}
+#endif
+
+#define UDP_PUBLISHER_MAGIC    0x574B  /* "KW" */
+#define UDP_PUBLISHER_VERSION  2
+
+typedef enum {
+    UDP_MSG_DETECTION = 1,  /* UdpDetectionEvent, one per recognition window */
+    UDP_MSG_AUDIO     = 2,  /* One audio_stream.h frame per DMA block */
+    UDP_MSG_METRICS   = 3   /* UdpMetrics snapshot after each utterance */
+} UdpMessageType;
+
+/* In front of every payload (copied into the header buffer, not part of the payload) */
+typedef struct {
+    uint16_t magic;
+    uint8_t version;
+    uint8_t type;           /* UdpMessageType */
+    uint32_t sequence;      /* Per message type */
+    uint32_t timeMs;        /* HAL tick when queued */
+} UdpMessageHeader;
+
+typedef struct {
+    uint32_t window;        /* KWS window number */
+    int32_t label;          /* Recognized command, -1 if rejected */
+    int32_t best;           /* Top class of the network, -1 if stage 2 did not run */
+    uint32_t decision;      /* KwsDecisionType */
+    float score;
+    float margin;
+    uint32_t triggerSample; /* Audio timeline, low 32 bits */
+    uint32_t latencyMs;     /* Decision after end of recording */
+    uint32_t cycles;        /* CPU cycles of the cascade */
+} UdpDetectionEvent;
+
+typedef struct {
+    uint32_t uptimeMs;
+    uint32_t kwsWindows;
+    uint32_t kwsRejectedEarly;
+    uint32_t kwsUnknown;
+    uint32_t kwsKeywords;
+    uint32_t kwsAvgCycles;
+    uint32_t audioBlocks;
+    uint32_t audioLostBlocks;
+    uint32_t audioGaps;
+    uint32_t audioMaxLatency;
+    uint32_t streamFrames;
+    uint32_t streamDropped;
+    uint32_t udpPackets;
+    uint32_t udpBusy;
+    uint32_t udpErrors;
+    int32_t agcGain;        /* Q12 */
+    uint32_t agcEnvelope;
+    uint32_t agcClipped;
+} UdpMetrics;
+
+/**
+ * @brief  Initialize the Ethernet peripheral (first use, lazy_init.h) and set up the descriptor
+ *         ring, the MAC starts once the link is up (UdpPublisher_Poll)
+ */
+void UdpPublisher_Init(void);
+
+/**
+ * @brief  Check the PHY link (once a second) and release finished packets, call from the main loop
+ */
+void UdpPublisher_Poll(void);
+
+/**
+ * @brief  true while the link is up and the MAC transmits
+ */
+bool UdpPublisher_IsActive(void);
+
+/**
+ * @brief  Queue one message without copying the payload
+ * @param  payload: must stay unchanged until done(context) runs (DMA accessible memory)
+ * @param  done: called once the DMA is finished with the payload, from the next send or poll
+ * @return false if the link is down or all packet slots are in flight
+ * @note   Safe from interrupts
+ */
+bool UdpPublisher_Send(UdpMessageType type, const void* payload, uint32_t length,
+                       UdpTxDoneCallback done, void* context);
+
+/**
+ * @brief  Fill a metrics snapshot from the pipeline statistics
+ */
+void UdpPublisher_CollectMetrics(UdpMetrics* metrics);
+
+/**
+ * @brief  Print packets sent, refused and failed
+ */
+void UdpPublisher_PrintStats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UDP_PUBLISHER_H */
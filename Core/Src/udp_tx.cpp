@@ -0,0 +1,147 @@
+// Zero-copy UDP transmit
+// Slot i owns descriptors 2i (headers, FS) and 2i+1 (payload, LS). Both are filled before the
+// first one is handed to the DMA, so the DMA never sees half a packet.
+
+#include "udp_tx.h"
+#include <stdint.h>
+#include <string.h>
+
+static_assert(sizeof(UdpTxDescriptor) == 32, "enhanced descriptors are 8 words");
+
+static inline uint32_t dmaAddress(const void* p) {
+    return (uint32_t)(uintptr_t)p;
+}
+
+static inline void putBe16(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+// Ethernet + IPv4 + UDP headers for one datagram
+static void buildHeaders(const UdpTxConfig* c, uint8_t* h, uint32_t udpLength, uint16_t ipId) {
+    // Ethernet II
+    memcpy(&h[0], c->dstMac, 6);
+    memcpy(&h[6], c->srcMac, 6);
+    putBe16(&h[12], 0x0800);
+
+    // IPv4, no options, don't fragment
+    uint8_t* ip = &h[UDP_TX_ETH_HEADER];
+    ip[0] = 0x45;
+    ip[1] = 0;
+    putBe16(&ip[2], UDP_TX_IP_HEADER + udpLength);
+    putBe16(&ip[4], ipId);
+    putBe16(&ip[6], 0x4000);
+    ip[8] = 64;    // TTL
+    ip[9] = 17;    // UDP
+    putBe16(&ip[10], 0);
+    memcpy(&ip[12], c->srcIp, 4);
+    memcpy(&ip[16], c->dstIp, 4);
+    putBe16(&ip[10], (uint16_t)~UdpTx_ChecksumAdd(ip, UDP_TX_IP_HEADER, 0));
+
+    // UDP, checksum inserted by the MAC
+    uint8_t* udp = &ip[UDP_TX_IP_HEADER];
+    putBe16(&udp[0], c->srcPort);
+    putBe16(&udp[2], c->dstPort);
+    putBe16(&udp[4], udpLength);
+    putBe16(&udp[6], 0);
+}
+
+extern "C" {
+
+void UdpTx_Init(UdpTx* tx, UdpTxDescriptor* descriptors, const UdpTxConfig* config) {
+    memset(tx, 0, sizeof(*tx));
+    tx->descriptors = descriptors;
+    tx->config = *config;
+
+    for (uint32_t i = 0; i < UDP_TX_DESCRIPTORS; i++) {
+        UdpTxDescriptor* d = &descriptors[i];
+        d->status = UDP_TX_DESC_TCH;
+        d->size = 0;
+        d->buffer = 0;
+        d->next = dmaAddress(&descriptors[(i + 1) % UDP_TX_DESCRIPTORS]);
+        for (uint32_t k = 0; k < 4; k++) d->extended[k] = 0;
+    }
+}
+
+bool UdpTx_Send(UdpTx* tx, const void* prefix, uint32_t prefixLength,
+                const void* payload, uint32_t payloadLength,
+                UdpTxDoneCallback done, void* context) {
+    if (payloadLength == 0 || prefixLength > UDP_TX_MAX_PREFIX ||
+        prefixLength + payloadLength > UDP_TX_MAX_PAYLOAD) {
+        return false;
+    }
+
+    UdpTx_Reclaim(tx);
+    if (tx->head - tx->tail >= UDP_TX_SLOTS) {
+        tx->stats.busy++;
+        return false;
+    }
+
+    uint32_t index = tx->head % UDP_TX_SLOTS;
+    UdpTxSlot* slot = &tx->slots[index];
+    buildHeaders(&tx->config, slot->header, UDP_TX_UDP_HEADER + prefixLength + payloadLength, tx->ipId++);
+    if (prefixLength) memcpy(&slot->header[UDP_TX_HEADER_SIZE], prefix, prefixLength);
+    slot->payload = static_cast<const uint8_t*>(payload);
+    slot->payloadLength = payloadLength;
+    slot->done = done;
+    slot->context = context;
+
+    UdpTxDescriptor* first = &tx->descriptors[2 * index];
+    UdpTxDescriptor* last = &tx->descriptors[2 * index + 1];
+    first->buffer = dmaAddress(slot->header);
+    first->size = (UDP_TX_HEADER_SIZE + prefixLength) & UDP_TX_DESC_TBS1;
+    last->buffer = dmaAddress(slot->payload);
+    last->size = payloadLength & UDP_TX_DESC_TBS1;
+
+    // Last segment first, the DMA starts at the first one
+    last->status = UDP_TX_DESC_OWN | UDP_TX_DESC_LS | UDP_TX_DESC_CIC_FULL | UDP_TX_DESC_TCH;
+    first->status = UDP_TX_DESC_OWN | UDP_TX_DESC_FS | UDP_TX_DESC_CIC_FULL | UDP_TX_DESC_TCH;
+
+    tx->head++;
+    tx->stats.packets++;
+    return true;
+}
+
+uint32_t UdpTx_Reclaim(UdpTx* tx) {
+    uint32_t released = 0;
+    while (tx->tail != tx->head) {
+        uint32_t index = tx->tail % UDP_TX_SLOTS;
+        const UdpTxDescriptor* first = &tx->descriptors[2 * index];
+        const UdpTxDescriptor* last = &tx->descriptors[2 * index + 1];
+        if ((first->status | last->status) & UDP_TX_DESC_OWN) break;
+        if (last->status & UDP_TX_DESC_ES) tx->stats.errors++;
+
+        UdpTxSlot* slot = &tx->slots[index];
+        tx->tail++;
+        released++;
+        if (slot->done) slot->done(slot->context);
+    }
+    return released;
+}
+
+void UdpTx_Reset(UdpTx* tx) {
+    while (tx->tail != tx->head) {
+        uint32_t index = tx->tail % UDP_TX_SLOTS;
+        tx->descriptors[2 * index].status &= ~UDP_TX_DESC_OWN;
+        tx->descriptors[2 * index + 1].status &= ~UDP_TX_DESC_OWN;
+        UdpTxSlot* slot = &tx->slots[index];
+        tx->tail++;
+        if (slot->done) slot->done(slot->context);
+    }
+    tx->head = 0;
+    tx->tail = 0;
+}
+
+uint32_t UdpTx_InFlight(const UdpTx* tx) {
+    return tx->head - tx->tail;
+}
+
+uint16_t UdpTx_ChecksumAdd(const uint8_t* data, uint32_t length, uint16_t sum) {
+    uint32_t acc = sum;
+    for (uint32_t i = 0; i + 1 < length; i += 2) acc += (uint32_t)data[i] << 8 | data[i + 1];
+    if (length & 1) acc += (uint32_t)data[length - 1] << 8;
+    while (acc >> 16) acc = (acc & 0xFFFF) + (acc >> 16);
+    return (uint16_t)acc;
+}
+
+} // extern "C"
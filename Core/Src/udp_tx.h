@@ -0,0 +1,140 @@
+/**
+ * @file    udp_tx.h
+ * @brief   Zero-copy UDP/IPv4 transmit path for the Ethernet DMA (shared with Tools/udp_receive)
+ *
+ * Every packet takes two chained TX descriptors: the first points at a small per-slot buffer with
+ * the Ethernet, IPv4 and UDP headers plus an optional caller prefix, the second points straight at
+ * the caller's payload. Nothing is copied; the payload must stay untouched until the packet's done
+ * callback runs (from UdpTx_Reclaim, once the DMA has released both descriptors).
+ *
+ * The IPv4 header checksum is computed here, the UDP checksum is inserted by the MAC (checksum
+ * offload, CIC = full). No ARP, no routing, no receive path: packets go to a fixed MAC/IP, by
+ * default broadcast.
+ *
+ * Portable, no HAL: the target wrapper (udp_publisher.h) locks, points the DMA at the descriptors
+ * and issues the poll demand; the host receiver runs the same code against a DMA stand-in.
+ * Payload buffers and descriptors must be reachable by the Ethernet DMA (SRAM, not CCM RAM).
+ */
+
+#ifndef UDP_TX_H
+#define UDP_TX_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define UDP_TX_ETH_HEADER    14
+#define UDP_TX_IP_HEADER     20
+#define UDP_TX_UDP_HEADER    8
+#define UDP_TX_HEADER_SIZE   (UDP_TX_ETH_HEADER + UDP_TX_IP_HEADER + UDP_TX_UDP_HEADER)
+#define UDP_TX_MAX_PREFIX    16
+#define UDP_TX_MAX_PAYLOAD   1472  /* 1500 byte MTU */
+
+/* Packets in flight, two descriptors each */
+#define UDP_TX_SLOTS         4
+#define UDP_TX_DESCRIPTORS   (2 * UDP_TX_SLOTS)
+
+/* TDES0 bits (RM0090, normal TX descriptor) */
+#define UDP_TX_DESC_OWN      0x80000000u
+#define UDP_TX_DESC_IC       0x40000000u
+#define UDP_TX_DESC_LS       0x20000000u
+#define UDP_TX_DESC_FS       0x10000000u
+#define UDP_TX_DESC_CIC_FULL 0x00C00000u
+#define UDP_TX_DESC_TCH      0x00100000u
+#define UDP_TX_DESC_ES       0x00008000u
+#define UDP_TX_DESC_TBS1     0x00001FFFu
+
+/* Ethernet DMA TX descriptor, enhanced format in chained mode as set up by HAL_ETH_Init */
+typedef struct {
+    volatile uint32_t status;    /* TDES0 */
+    volatile uint32_t size;      /* TDES1, buffer 1 size */
+    volatile uint32_t buffer;    /* TDES2, buffer 1 address */
+    volatile uint32_t next;      /* TDES3, next descriptor address */
+    volatile uint32_t extended[4];
+} UdpTxDescriptor;
+
+typedef struct {
+    uint8_t srcMac[6];
+    uint8_t dstMac[6];
+    uint8_t srcIp[4];
+    uint8_t dstIp[4];
+    uint16_t srcPort;
+    uint16_t dstPort;
+} UdpTxConfig;
+
+typedef void (*UdpTxDoneCallback)(void* context);
+
+typedef struct {
+    uint8_t header[UDP_TX_HEADER_SIZE + UDP_TX_MAX_PREFIX];
+    const uint8_t* payload;
+    uint32_t payloadLength;
+    UdpTxDoneCallback done;
+    void* context;
+} UdpTxSlot;
+
+typedef struct {
+    uint32_t packets;  /* Packets handed to the DMA */
+    uint32_t busy;     /* Sends refused because all slots were in flight */
+    uint32_t errors;   /* Packets the MAC reported with an error summary */
+} UdpTxStats;
+
+typedef struct {
+    UdpTxDescriptor* descriptors;  /* UDP_TX_DESCRIPTORS entries, DMA accessible */
+    UdpTxSlot slots[UDP_TX_SLOTS];
+    UdpTxConfig config;
+    uint32_t head;                 /* Next slot to fill (free-running) */
+    uint32_t tail;                 /* Oldest slot in flight (free-running) */
+    uint16_t ipId;
+    UdpTxStats stats;
+} UdpTx;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief  Chain the descriptors into a ring and reset all slots
+ * @param  descriptors: UDP_TX_DESCRIPTORS entries, the DMA list address is &descriptors[0]
+ */
+void UdpTx_Init(UdpTx* tx, UdpTxDescriptor* descriptors, const UdpTxConfig* config);
+
+/**
+ * @brief  Queue one datagram without copying the payload
+ * @param  prefix: up to UDP_TX_MAX_PREFIX bytes copied in front of the payload (may be NULL)
+ * @param  payload: at least one byte, referenced until done(context) is called
+ * @param  done: called when the DMA no longer reads the payload (may be NULL)
+ * @return false if the size is invalid or all slots are in flight
+ * @note   Reclaims finished slots first. Not reentrant; the caller then issues the DMA poll demand.
+ */
+bool UdpTx_Send(UdpTx* tx, const void* prefix, uint32_t prefixLength,
+                const void* payload, uint32_t payloadLength,
+                UdpTxDoneCallback done, void* context);
+
+/**
+ * @brief  Release slots whose descriptors the DMA has handed back, calling their done callbacks
+ * @return Number of slots released
+ */
+uint32_t UdpTx_Reclaim(UdpTx* tx);
+
+/**
+ * @brief  Drop every packet still in flight (done callbacks run) and restart at descriptor 0
+ * @note   Only with the DMA stopped, it takes the descriptors back from the DMA
+ */
+void UdpTx_Reset(UdpTx* tx);
+
+/**
+ * @brief  Packets still owned by the DMA
+ */
+uint32_t UdpTx_InFlight(const UdpTx* tx);
+
+/**
+ * @brief  Internet checksum (RFC 1071) over data, continuing from a partial sum
+ * @return Folded one's complement sum, not inverted
+ * @note   When summing in pieces, all but the last piece must have an even length
+ */
+uint16_t UdpTx_ChecksumAdd(const uint8_t* data, uint32_t length, uint16_t sum);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UDP_TX_H */
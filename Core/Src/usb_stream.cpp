@@ -0,0 +1,397 @@
+// USB CDC-ACM stream device
+// Control transfers are answered straight from the PCD callbacks (no USB middleware in this
+// project). EP0 IN data longer than one packet is continued from the data IN callback, the bulk
+// endpoint gets whole contiguous ring pieces and the PCD splits them into packets.
+
+#include "usb_stream.h"
+#include "deferred_log.h"
+#include "lazy_init.h"
+#include "main.h"
+#include <string.h>
+
+extern PCD_HandleTypeDef hpcd_USB_OTG_FS;
+
+// ENDPOINTS
+static const uint8_t EP0_SIZE = 64;
+static const uint8_t DATA_IN_EP = 0x81;
+static const uint8_t DATA_OUT_EP = 0x01;
+static const uint8_t NOTIFY_EP = 0x82;
+static const uint16_t DATA_PACKET = 64;
+static const uint16_t NOTIFY_PACKET = 8;
+
+// Largest bulk transfer started at once
+static const uint32_t MAX_TRANSFER = 2048;
+
+// FIFO sizes in 32-bit words, 320 words total on OTG_FS
+static const uint16_t RX_FIFO_WORDS = 0x80;
+static const uint16_t EP0_TX_FIFO_WORDS = 0x20;
+static const uint16_t DATA_TX_FIFO_WORDS = 0x80;
+static const uint16_t NOTIFY_TX_FIFO_WORDS = 0x10;
+
+// DESCRIPTORS
+static const uint8_t deviceDescriptor[18] = {
+    18, 0x01, 0x00, 0x02,             // USB 2.0
+    0x02, 0x00, 0x00, EP0_SIZE,       // CDC device class
+    USB_STREAM_VID & 0xFF, USB_STREAM_VID >> 8,
+    USB_STREAM_PID & 0xFF, USB_STREAM_PID >> 8,
+    0x00, 0x02,                       // bcdDevice 2.00
+    1, 2, 3,                          // manufacturer, product, serial strings
+    1                                 // configurations
+};
+
+static const uint8_t configDescriptor[67] = {
+    9, 0x02, 67, 0, 2, 1, 0, 0x80, 50,              // 2 interfaces, bus powered, 100 mA
+    // Communication interface
+    9, 0x04, 0, 0, 1, 0x02, 0x02, 0x01, 0,          // CDC, ACM, AT commands
+    5, 0x24, 0x00, 0x10, 0x01,                      // header, CDC 1.10
+    5, 0x24, 0x01, 0x00, 0x01,                      // call management, data interface 1
+    4, 0x24, 0x02, 0x02,                            // ACM: line coding and control line state
+    5, 0x24, 0x06, 0x00, 0x01,                      // union: master 0, slave 1
+    7, 0x05, NOTIFY_EP, 0x03, NOTIFY_PACKET, 0, 16, // interrupt IN, 16 ms
+    // Data interface
+    9, 0x04, 1, 0, 2, 0x0A, 0x00, 0x00, 0,
+    7, 0x05, DATA_OUT_EP, 0x02, DATA_PACKET, 0, 0,  // bulk OUT
+    7, 0x05, DATA_IN_EP, 0x02, DATA_PACKET, 0, 0    // bulk IN
+};
+
+static const char* const strings[] = {"STMicroelectronics", "Alexa_Ver2 KWS stream"};
+
+// CONTROL STATE (OTG_FS interrupt only)
+enum Ep0State { EP0_IDLE, EP0_DATA_IN, EP0_DATA_OUT, EP0_STATUS_IN, EP0_STATUS_OUT };
+static Ep0State ep0State = EP0_IDLE;
+static const uint8_t* ep0Data = nullptr;
+static uint32_t ep0Remaining = 0;
+static bool ep0Zlp = false;
+static uint8_t ep0Buffer[EP0_SIZE];
+static uint8_t stringDescriptor[2 + 2 * 32];
+static uint8_t rxPacket[DATA_PACKET];
+
+// 921600 8N1, only reported back to the host, the data rate is set by USB
+static uint8_t lineCoding[7] = {0x00, 0x10, 0x0E, 0x00, 0, 0, 8};
+
+// STATE
+static volatile bool configured = false;
+static volatile bool suspended = false;
+static volatile bool hostOpen = false;  // DTR from SET_CONTROL_LINE_STATE
+static volatile uint32_t inFlight = 0;  // bytes handed to the bulk IN endpoint
+static volatile uint64_t bytesSent = 0;
+static volatile UsbStreamReceiveCallback receiveCallback = nullptr;
+
+// TX RING (written under PRIMASK, drained from the OTG_FS interrupt)
+static StreamMuxTx tx;
+
+// CONTROL TRANSFERS
+
+static void ep0Stall(PCD_HandleTypeDef* hpcd) {
+    HAL_PCD_EP_SetStall(hpcd, 0x80);
+    HAL_PCD_EP_SetStall(hpcd, 0x00);
+    ep0State = EP0_IDLE;
+}
+
+static void ep0SendStatus(PCD_HandleTypeDef* hpcd) {
+    ep0State = EP0_STATUS_IN;
+    HAL_PCD_EP_Transmit(hpcd, 0x80, nullptr, 0);
+}
+
+static void ep0SendNext(PCD_HandleTypeDef* hpcd) {
+    uint32_t n = ep0Remaining < EP0_SIZE ? ep0Remaining : EP0_SIZE;
+    const uint8_t* data = ep0Data;
+    ep0Data += n;
+    ep0Remaining -= n;
+    HAL_PCD_EP_Transmit(hpcd, 0x80, const_cast<uint8_t*>(data), n);
+}
+
+static void ep0Send(PCD_HandleTypeDef* hpcd, const uint8_t* data, uint32_t length, uint16_t requested) {
+    if (length > requested) length = requested;
+    ep0Data = data;
+    ep0Remaining = length;
+    // A short reply that ends on a packet boundary needs a zero-length packet
+    ep0Zlp = length < requested && length % EP0_SIZE == 0;
+    ep0State = EP0_DATA_IN;
+    ep0SendNext(hpcd);
+}
+
+static uint32_t buildString(uint8_t index) {
+    uint32_t length = 2;
+    if (index == 0) {
+        stringDescriptor[2] = 0x09;  // English (US)
+        stringDescriptor[3] = 0x04;
+        length = 4;
+    } else if (index == 3) {
+        // Serial number from the 96-bit device UID
+        static const char hex[] = "0123456789ABCDEF";
+        const uint8_t* uid = reinterpret_cast<const uint8_t*>(UID_BASE);
+        for (uint32_t i = 0; i < 12; i++) {
+            stringDescriptor[length] = hex[uid[i] >> 4];
+            stringDescriptor[length + 1] = 0;
+            stringDescriptor[length + 2] = hex[uid[i] & 0x0F];
+            stringDescriptor[length + 3] = 0;
+            length += 4;
+        }
+    } else {
+        const char* s = strings[index - 1];
+        while (*s && length < sizeof(stringDescriptor)) {
+            stringDescriptor[length++] = (uint8_t)*s++;
+            stringDescriptor[length++] = 0;
+        }
+    }
+    stringDescriptor[0] = (uint8_t)length;
+    stringDescriptor[1] = 0x03;
+    return length;
+}
+
+static void openDataEndpoints(PCD_HandleTypeDef* hpcd) {
+    HAL_PCD_EP_Open(hpcd, DATA_IN_EP, DATA_PACKET, EP_TYPE_BULK);
+    HAL_PCD_EP_Open(hpcd, DATA_OUT_EP, DATA_PACKET, EP_TYPE_BULK);
+    HAL_PCD_EP_Open(hpcd, NOTIFY_EP, NOTIFY_PACKET, EP_TYPE_INTR);
+    HAL_PCD_EP_Receive(hpcd, DATA_OUT_EP, rxPacket, DATA_PACKET);
+    inFlight = 0;
+    configured = true;
+}
+
+static void closeDataEndpoints(PCD_HandleTypeDef* hpcd) {
+    configured = false;
+    hostOpen = false;
+    HAL_PCD_EP_Close(hpcd, DATA_IN_EP);
+    HAL_PCD_EP_Close(hpcd, DATA_OUT_EP);
+    HAL_PCD_EP_Close(hpcd, NOTIFY_EP);
+    inFlight = 0;
+}
+
+static void standardRequest(PCD_HandleTypeDef* hpcd, const uint8_t* setup) {
+    uint8_t recipient = setup[0] & 0x1F;
+    uint16_t value = setup[2] | setup[3] << 8;
+    uint16_t index = setup[4] | setup[5] << 8;
+    uint16_t length = setup[6] | setup[7] << 8;
+
+    switch (setup[1]) {
+    case 0x00:  // GET_STATUS
+        ep0Buffer[0] = 0;
+        ep0Buffer[1] = 0;
+        ep0Send(hpcd, ep0Buffer, 2, length);
+        return;
+    case 0x01:  // CLEAR_FEATURE
+    case 0x03:  // SET_FEATURE
+        if (recipient == 2 && value == 0 && (index & 0x7F) != 0) {  // ENDPOINT_HALT
+            if (setup[1] == 0x01) HAL_PCD_EP_ClrStall(hpcd, (uint8_t)index);
+            else HAL_PCD_EP_SetStall(hpcd, (uint8_t)index);
+        }
+        ep0SendStatus(hpcd);
+        return;
+    case 0x05:  // SET_ADDRESS, the OTG core takes the address before the status stage
+        HAL_PCD_SetAddress(hpcd, (uint8_t)(value & 0x7F));
+        ep0SendStatus(hpcd);
+        return;
+    case 0x06:  // GET_DESCRIPTOR
+        switch (value >> 8) {
+        case 0x01:
+            ep0Send(hpcd, deviceDescriptor, sizeof(deviceDescriptor), length);
+            return;
+        case 0x02:
+            ep0Send(hpcd, configDescriptor, sizeof(configDescriptor), length);
+            return;
+        case 0x03:
+            if ((value & 0xFF) <= 3) {
+                ep0Send(hpcd, stringDescriptor, buildString((uint8_t)value), length);
+                return;
+            }
+            break;
+        }
+        break;  // device qualifier etc.: full speed only
+    case 0x08:  // GET_CONFIGURATION
+        ep0Buffer[0] = configured ? 1 : 0;
+        ep0Send(hpcd, ep0Buffer, 1, length);
+        return;
+    case 0x09:  // SET_CONFIGURATION
+        if (value > 1) break;
+        if (configured) closeDataEndpoints(hpcd);
+        if (value == 1) openDataEndpoints(hpcd);
+        ep0SendStatus(hpcd);
+        return;
+    case 0x0A:  // GET_INTERFACE
+        ep0Buffer[0] = 0;
+        ep0Send(hpcd, ep0Buffer, 1, length);
+        return;
+    case 0x0B:  // SET_INTERFACE
+        ep0SendStatus(hpcd);
+        return;
+    }
+    ep0Stall(hpcd);
+}
+
+static void classRequest(PCD_HandleTypeDef* hpcd, const uint8_t* setup) {
+    uint16_t value = setup[2] | setup[3] << 8;
+    uint16_t length = setup[6] | setup[7] << 8;
+
+    switch (setup[1]) {
+    case 0x20:  // SET_LINE_CODING
+        ep0State = EP0_DATA_OUT;
+        HAL_PCD_EP_Receive(hpcd, 0x00, ep0Buffer, sizeof(lineCoding));
+        return;
+    case 0x21:  // GET_LINE_CODING
+        ep0Send(hpcd, lineCoding, sizeof(lineCoding), length);
+        return;
+    case 0x22:  // SET_CONTROL_LINE_STATE
+        hostOpen = (value & 0x01) != 0;
+        ep0SendStatus(hpcd);
+        return;
+    case 0x23:  // SEND_BREAK
+        ep0SendStatus(hpcd);
+        return;
+    }
+    ep0Stall(hpcd);
+}
+
+extern "C" {
+
+void UsbStream_Init(void) {
+    if (!LazyInit_Require(LAZY_USB)) return;
+    StreamMux_TxInit(&tx);
+
+    HAL_PCDEx_SetRxFiFo(&hpcd_USB_OTG_FS, RX_FIFO_WORDS);
+    HAL_PCDEx_SetTxFiFo(&hpcd_USB_OTG_FS, 0, EP0_TX_FIFO_WORDS);
+    HAL_PCDEx_SetTxFiFo(&hpcd_USB_OTG_FS, DATA_IN_EP & 0x7F, DATA_TX_FIFO_WORDS);
+    HAL_PCDEx_SetTxFiFo(&hpcd_USB_OTG_FS, NOTIFY_EP & 0x7F, NOTIFY_TX_FIFO_WORDS);
+
+    // Below the UART DMA (5)
+    HAL_NVIC_SetPriority(OTG_FS_IRQn, 6, 0);
+    HAL_NVIC_EnableIRQ(OTG_FS_IRQn);
+
+    if (HAL_PCD_Start(&hpcd_USB_OTG_FS) != HAL_OK) {
+        DLOG("[ERROR] USB start failed");
+    }
+}
+
+bool UsbStream_IsOpen(void) {
+    return configured && hostOpen && !suspended;
+}
+
+bool UsbStream_Send(StreamMuxChannel channel, uint32_t tag, const void* payload, uint32_t length) {
+    if (!UsbStream_IsOpen()) return false;
+
+    StreamMuxFrame frame;
+    if (!StreamMux_Prepare(&tx, channel, tag, payload, length, &frame)) return false;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    bool queued = StreamMux_Commit(&tx, &frame);
+    __set_PRIMASK(primask);
+
+    if (queued && !inFlight) NVIC_SetPendingIRQ(OTG_FS_IRQn);
+    return queued;
+}
+
+bool UsbStream_CanSend(uint32_t length) {
+    uint32_t size = STREAM_MUX_HEADER_SIZE + length + STREAM_MUX_TRAILER_SIZE;
+    return UsbStream_IsOpen() && STREAM_MUX_TX_SIZE - StreamMux_Pending(&tx) >= size;
+}
+
+void UsbStream_SetReceiveCallback(UsbStreamReceiveCallback callback) {
+    receiveCallback = callback;
+}
+
+void UsbStream_Service(void) {
+    if (!configured || inFlight) return;
+    if (!hostOpen) {
+        // Nobody reads, drop what is queued so the host gets fresh data when it opens the port
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        StreamMux_Consume(&tx, StreamMux_Pending(&tx));
+        __set_PRIMASK(primask);
+        return;
+    }
+
+    const uint8_t* data;
+    uint32_t length = StreamMux_Peek(&tx, &data);
+    if (length == 0) return;
+    if (length > MAX_TRANSFER) length = MAX_TRANSFER;
+    inFlight = length;
+    if (HAL_PCD_EP_Transmit(&hpcd_USB_OTG_FS, DATA_IN_EP, const_cast<uint8_t*>(data), length) != HAL_OK) {
+        inFlight = 0;
+    }
+}
+
+void UsbStream_PrintStats(void) {
+    if (tx.frames == 0 && tx.dropped == 0) return;
+    DLOG("[USB] frames: %lu, dropped: %lu, sent: %lu kB",
+         (unsigned long)tx.frames, (unsigned long)tx.dropped, (unsigned long)(bytesSent / 1024));
+}
+
+// PCD CALLBACKS (OTG_FS interrupt)
+
+void HAL_PCD_SetupStageCallback(PCD_HandleTypeDef* hpcd) {
+    const uint8_t* setup = reinterpret_cast<const uint8_t*>(hpcd->Setup);
+    switch (setup[0] & 0x60) {
+    case 0x00:
+        standardRequest(hpcd, setup);
+        break;
+    case 0x20:
+        classRequest(hpcd, setup);
+        break;
+    default:
+        ep0Stall(hpcd);
+        break;
+    }
+}
+
+void HAL_PCD_DataInStageCallback(PCD_HandleTypeDef* hpcd, uint8_t epnum) {
+    if (epnum == 0) {
+        if (ep0State == EP0_DATA_IN) {
+            if (ep0Remaining > 0) {
+                ep0SendNext(hpcd);
+            } else if (ep0Zlp) {
+                ep0Zlp = false;
+                HAL_PCD_EP_Transmit(hpcd, 0x80, nullptr, 0);
+            } else {
+                ep0State = EP0_STATUS_OUT;
+                HAL_PCD_EP_Receive(hpcd, 0x00, nullptr, 0);
+            }
+        } else if (ep0State == EP0_STATUS_IN) {
+            ep0State = EP0_IDLE;
+        }
+    } else if (epnum == (DATA_IN_EP & 0x7F)) {
+        StreamMux_Consume(&tx, inFlight);
+        bytesSent += inFlight;
+        inFlight = 0;
+    }
+}
+
+void HAL_PCD_DataOutStageCallback(PCD_HandleTypeDef* hpcd, uint8_t epnum) {
+    if (epnum == 0) {
+        if (ep0State == EP0_DATA_OUT) {
+            memcpy(lineCoding, ep0Buffer, sizeof(lineCoding));
+            ep0SendStatus(hpcd);
+        } else if (ep0State == EP0_STATUS_OUT) {
+            ep0State = EP0_IDLE;
+        }
+    } else if (epnum == DATA_OUT_EP) {
+        uint32_t length = HAL_PCD_EP_GetRxCount(hpcd, DATA_OUT_EP);
+        UsbStreamReceiveCallback callback = receiveCallback;
+        if (callback && length) callback(rxPacket, length);
+        HAL_PCD_EP_Receive(hpcd, DATA_OUT_EP, rxPacket, DATA_PACKET);
+    }
+}
+
+void HAL_PCD_ResetCallback(PCD_HandleTypeDef* hpcd) {
+    if (configured) closeDataEndpoints(hpcd);
+    suspended = false;
+    ep0State = EP0_IDLE;
+    HAL_PCD_EP_Open(hpcd, 0x00, EP0_SIZE, EP_TYPE_CTRL);
+    HAL_PCD_EP_Open(hpcd, 0x80, EP0_SIZE, EP_TYPE_CTRL);
+}
+
+void HAL_PCD_SuspendCallback(PCD_HandleTypeDef* hpcd) {
+    (void)hpcd;
+    suspended = true;
+}
+
+void HAL_PCD_ResumeCallback(PCD_HandleTypeDef* hpcd) {
+    (void)hpcd;
+    suspended = false;
+}
+
+void HAL_PCD_DisconnectCallback(PCD_HandleTypeDef* hpcd) {
+    if (configured) closeDataEndpoints(hpcd);
+}
+
+} // extern "C"
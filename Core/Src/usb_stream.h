@@ -0,0 +1,76 @@
+/**
+ * @file    usb_stream.h
+ * @brief   USB full-speed CDC-ACM device that streams audio, features, logits and trace records
+ *
+ * A minimal device stack on the CubeMX PCD handle (hpcd_USB_OTG_FS): enumeration, the CDC class
+ * requests and one bulk IN pipe fed from a stream_mux.h TX ring. The board shows up as a virtual
+ * COM port; data only flows while a host has the port open (DTR set), e.g.
+ *   stty -F /dev/ttyACM0 raw && cat /dev/ttyACM0 > capture.bin
+ * Tools/stream_mux splits a capture into its channels. Bytes sent by the host go to the receive
+ * callback (single-letter commands, e.g. the clip download of flash_recorder.h).
+ *
+ * All PCD calls run in the OTG_FS interrupt; UsbStream_Send only queues and pends it.
+ */
+
+#ifndef USB_STREAM_H
+#define USB_STREAM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "stream_mux.h"
+
+#define USB_STREAM_VID  0x0483  /* STMicroelectronics */
+#define USB_STREAM_PID  0x5740  /* Virtual COM port */
+
+/* Called with every packet the host sends, in the OTG_FS interrupt */
+typedef void (*UsbStreamReceiveCallback)(const uint8_t* data, uint32_t length);
+
+/**
+ * @brief  Initialize the USB core (first use, lazy_init.h), set up the endpoint FIFOs and
+ *         connect to the bus
+ */
+void UsbStream_Init(void);
+
+/**
+ * @brief  true while the device is configured and the host has the port open
+ */
+bool UsbStream_IsOpen(void);
+
+/**
+ * @brief  Queue one frame on a channel
+ * @param  tag: channel specific value (see StreamMuxChannel)
+ * @return false if the port is closed or the TX ring is full
+ * @note   Safe from interrupts, one context per channel (sequence numbers)
+ */
+bool UsbStream_Send(StreamMuxChannel channel, uint32_t tag, const void* payload, uint32_t length);
+
+/**
+ * @brief  true if the port is open and a frame with this payload fits the TX ring now
+ * @note   For producers that wait instead of dropping (bulk transfers from the main loop)
+ */
+bool UsbStream_CanSend(uint32_t length);
+
+/**
+ * @brief  Set the callback for data from the host, nullptr to ignore it
+ */
+void UsbStream_SetReceiveCallback(UsbStreamReceiveCallback callback);
+
+/**
+ * @brief  Start the next bulk IN transfer, called at the end of OTG_FS_IRQHandler
+ */
+void UsbStream_Service(void);
+
+/**
+ * @brief  Print frames sent, dropped frames and bytes
+ */
+void UsbStream_PrintStats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* USB_STREAM_H */
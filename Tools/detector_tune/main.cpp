@@ -0,0 +1,410 @@
+// detector_tune - search the trigger parameters (Core/Src/detector_config.h) on a labeled corpus
+//
+// Replays long recordings through the firmware trigger (Core/Src/trigger_detector.cpp) with the
+// block loop of Audio1Sec around it, for many parameter sets in parallel on all cores, and prints
+// the Pareto front of false triggers per hour against the miss rate.
+//
+// Usage:
+//   detector_tune [-j threads] [-n samples] [-r rounds] [-s seed] [--dc offset] [--coverage c]
+//                 [--write out.h] [--max-fph f] <wav|dir>...
+//
+// Every <name>.wav (16 kHz, directories are searched recursively) may come with <name>.txt, an
+// Audacity label track: one "<start s> <end s> [label]" per line marks a word the trigger must
+// catch. Time outside the labels is background, a recording there is a false trigger. A word
+// counts as caught if a recording covers at least the coverage fraction of it (default 0.9),
+// a recording that touches a word without covering it is neither a hit nor a false trigger.
+// The trigger sees the raw microphone signal including its DC offset, before the AGC. Captures of
+// the audio stream (Core/Src/audio_stream.h, decoded with Tools/stream_decode) are exactly that
+// and need no option; --dc adds an offset to recordings made elsewhere that have none (e.g. the
+// MicWarmup DC value). Recordings after gain (the KWS recordings, other microphones) tune the
+// thresholds on the wrong amplitude scale.
+//
+// Search: the hand-tuned defaults plus -n random parameter sets, then -r rounds of -n / 2
+// mutations of Pareto-front members with a shrinking step.
+//
+// --write generates a new Core/Src/detector_config.h: the front member with the lowest miss
+// rate at no more than --max-fph false triggers per hour (default 1), the whole front listed in
+// its header comment.
+
+#include "trigger_detector.h"
+#include "detector_config.h"
+#include "audio_timeline.h"
+#include "pipeline_config.h"
+#include "work_stealing_pool.h"
+#include "wav.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static const uint32_t BLOCK_SAMPLES = PIPELINE.blockSamples;
+static const uint32_t RECORDING_SAMPLES = PIPELINE.recordingSamples;
+
+struct Event {
+    uint64_t start, end;  // Samples, end exclusive
+};
+
+struct Recording {
+    std::string path;
+    std::vector<int32_t> samples;
+    std::vector<Event> events;
+};
+
+struct Score {
+    uint32_t recordings = 0;
+    uint32_t hits = 0;        // Words caught
+    uint32_t partial = 0;     // Recordings that cut a word
+    uint32_t falseTriggers = 0;
+};
+
+struct Candidate {
+    TriggerDetectorParams params;
+    Score score;
+    double falsePerHour = 0.0;
+    double missRate = 0.0;
+};
+
+// CORPUS
+
+static bool loadLabels(const std::string& path, std::vector<Event>& events) {
+    std::ifstream in(path);
+    if (!in) return false;
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        double start, end;
+        if (!(fields >> start >> end) || end <= start) continue;
+        events.push_back({ (uint64_t)llround(start * AUDIO_TIMELINE_SAMPLE_RATE),
+                           (uint64_t)llround(end * AUDIO_TIMELINE_SAMPLE_RATE) });
+    }
+    std::sort(events.begin(), events.end(), [](const Event& a, const Event& b) { return a.start < b.start; });
+    return true;
+}
+
+static void findWavs(const std::string& source, std::vector<std::string>& paths) {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    if (fs::is_directory(source, ec)) {
+        for (const fs::directory_entry& file : fs::recursive_directory_iterator(source, ec)) {
+            if (file.is_regular_file() && file.path().extension() == ".wav") paths.push_back(file.path().string());
+        }
+    } else {
+        paths.push_back(source);
+    }
+}
+
+// REPLAY (same block loop as Audio1Sec)
+
+static Score replay(const TriggerDetectorParams& params, const Recording& rec, double coverage) {
+    Score score;
+    TriggerDetector detector;
+    TriggerDetector_Init(&detector, &params);
+
+    // Timeline positions of the samples in the ring, to know where a recording's audio starts
+    std::vector<uint64_t> ring(params.preRollSamples);
+    uint32_t ringIndex = 0, ringFilled = 0;
+    bool recording = false;
+    uint32_t recorded = 0;
+    uint64_t windowStart = 0;
+
+    const std::vector<int32_t>& x = rec.samples;
+    size_t nextEvent = 0;
+    for (size_t block = 0; block + BLOCK_SAMPLES <= x.size(); block += BLOCK_SAMPLES) {
+        TriggerDetector_BlockStart(&detector);
+        for (uint32_t i = 0; i < BLOCK_SAMPLES; i++) {
+            uint64_t sample = block + i;
+            TriggerEvent event = TriggerDetector_Sample(&detector, x[sample], sample);
+            if (event == TRIGGER_SPIKE) continue;
+            if (!recording) {
+                ring[ringIndex] = sample;
+                ringIndex = (ringIndex + 1) % params.preRollSamples;
+                if (ringFilled < params.preRollSamples) ringFilled++;
+            }
+            if (event == TRIGGER_START) {
+                recording = true;
+                // The ring is cleared after every recording, older parts of the pre-roll are zeros
+                windowStart = ring[(ringIndex + params.preRollSamples - ringFilled) % params.preRollSamples];
+                recorded = params.preRollSamples;
+            }
+            if (!recording || ++recorded < RECORDING_SAMPLES) continue;
+
+            // Recording full: score the window [windowStart, sample]
+            recording = false;
+            TriggerDetector_RecordingDone(&detector, sample);
+            ringFilled = 0;
+            score.recordings++;
+            uint64_t windowEnd = sample + 1;
+            while (nextEvent < rec.events.size() && rec.events[nextEvent].end <= windowStart) nextEvent++;
+            bool touched = false, caught = false;
+            for (size_t e = nextEvent; e < rec.events.size() && rec.events[e].start < windowEnd; e++) {
+                const Event& ev = rec.events[e];
+                uint64_t overlap = std::min(ev.end, windowEnd) - std::max(ev.start, windowStart);
+                touched = true;
+                if (overlap >= coverage * (ev.end - ev.start)) {
+                    score.hits++;
+                    caught = true;
+                    nextEvent = e + 1;  // A word is caught once
+                }
+            }
+            if (!touched) score.falseTriggers++;
+            else if (!caught) score.partial++;
+            break;  // Rest of the block is skipped, as in Audio1Sec
+        }
+    }
+    return score;
+}
+
+// SEARCH SPACE
+
+struct Range {
+    double low, high;
+    bool logarithmic;
+};
+
+static const int DIMENSIONS = 7;
+static const Range space[DIMENSIONS] = {
+    { 6000.0, 60000.0, true },   // noiseThreshold
+    { 1000.0, 20000.0, true },   // initialOffset
+    { 0.02, 0.40, true },        // attack
+    { 0.70, 0.99, false },       // decay
+    { 1.0, 24.0, true },         // loudSamples
+    { 200.0, 2500.0, true },     // cooldownMs
+    { 1000.0, 8000.0, false },   // preRollSamples
+};
+
+// Parameters <-> unit cube
+static void toUnit(const TriggerDetectorParams& p, double* u) {
+    double v[DIMENSIONS] = { (double)p.noiseThreshold, (double)p.initialOffset, p.attack, p.decay,
+                             (double)p.loudSamples, (double)p.cooldownMs, (double)p.preRollSamples };
+    for (int d = 0; d < DIMENSIONS; d++) {
+        const Range& r = space[d];
+        double t = r.logarithmic ? log(v[d] / r.low) / log(r.high / r.low) : (v[d] - r.low) / (r.high - r.low);
+        u[d] = std::min(1.0, std::max(0.0, t));
+    }
+}
+
+static TriggerDetectorParams fromUnit(const double* u) {
+    double v[DIMENSIONS];
+    for (int d = 0; d < DIMENSIONS; d++) {
+        const Range& r = space[d];
+        double t = std::min(1.0, std::max(0.0, u[d]));
+        v[d] = r.logarithmic ? r.low * pow(r.high / r.low, t) : r.low + t * (r.high - r.low);
+    }
+    TriggerDetectorParams p;
+    p.noiseThreshold = (int32_t)lround(v[0]);
+    p.initialOffset = (int32_t)lround(v[1]);
+    p.attack = lround(v[2] * 1000.0) / 1000.0;
+    p.decay = lround(v[3] * 1000.0) / 1000.0;
+    p.loudSamples = (uint32_t)lround(v[4]);
+    p.cooldownMs = (uint32_t)(lround(v[5] / 50.0) * 50);
+    p.preRollSamples = (uint32_t)(lround(v[6] / 250.0) * 250);
+    return p;
+}
+
+static std::vector<Candidate> paretoFront(const std::vector<Candidate>& all) {
+    std::vector<Candidate> sorted = all;
+    std::sort(sorted.begin(), sorted.end(), [](const Candidate& a, const Candidate& b) {
+        return a.falsePerHour != b.falsePerHour ? a.falsePerHour < b.falsePerHour : a.missRate < b.missRate;
+    });
+    std::vector<Candidate> front;
+    for (const Candidate& c : sorted) {
+        if (front.empty() || c.missRate < front.back().missRate) front.push_back(c);
+    }
+    return front;
+}
+
+static void evaluate(WorkStealingPool& pool, const std::vector<Recording>& corpus, double coverage, double hours,
+                     uint32_t events, std::vector<Candidate>& candidates) {
+    // One task per (candidate, recording), long files do not serialize a candidate
+    size_t n = corpus.size();
+    std::vector<Score> scores(candidates.size() * n);
+    pool.parallelFor(scores.size(), 1, [&](size_t begin, size_t end, unsigned) {
+        for (size_t i = begin; i < end; i++) scores[i] = replay(candidates[i / n].params, corpus[i % n], coverage);
+    });
+    for (size_t c = 0; c < candidates.size(); c++) {
+        Score total;
+        for (size_t r = 0; r < n; r++) {
+            const Score& s = scores[c * n + r];
+            total.recordings += s.recordings;
+            total.hits += s.hits;
+            total.partial += s.partial;
+            total.falseTriggers += s.falseTriggers;
+        }
+        candidates[c].score = total;
+        candidates[c].falsePerHour = hours > 0.0 ? total.falseTriggers / hours : 0.0;
+        candidates[c].missRate = events ? 1.0 - (double)total.hits / events : 0.0;
+    }
+}
+
+static void printCandidate(FILE* f, const char* prefix, const Candidate& c) {
+    const TriggerDetectorParams& p = c.params;
+    fprintf(f, "%s%8.2f %7.2f %% %6ld %6ld %6.3f %6.3f %4lu %5lu %5lu\n", prefix, c.falsePerHour,
+            100.0 * c.missRate, (long)p.noiseThreshold, (long)p.initialOffset, p.attack, p.decay,
+            (unsigned long)p.loudSamples, (unsigned long)p.cooldownMs, (unsigned long)p.preRollSamples);
+}
+
+static const char* TABLE_HEADER = " false/h    miss  noise offset attack  decay loud  cool   pre\n";
+
+static bool writeConfig(const std::string& path, const std::vector<Candidate>& front, size_t chosen,
+                        const Candidate& defaults, size_t files, double hours, uint32_t events, double coverage) {
+    FILE* f = fopen(path.c_str(), "w");
+    if (!f) return false;
+    const TriggerDetectorParams& p = front[chosen].params;
+    fprintf(f, "/**\n * @file    detector_config.h\n * @brief   Trigger detector parameters (see trigger_detector.h)\n *\n");
+    fprintf(f, " * Generated by: detector_tune --write detector_config.h <corpus>\n");
+    fprintf(f, " * Corpus:       %zu recordings, %.2f h, %lu words, coverage %.2f\n *\n",
+            files, hours, (unsigned long)events, coverage);
+    fprintf(f, " * Pareto front (* = chosen, last line = hand-tuned defaults):\n *  ");
+    fprintf(f, "%s", TABLE_HEADER);
+    for (size_t i = 0; i < front.size(); i++) printCandidate(f, i == chosen ? " * *" : " *  ", front[i]);
+    printCandidate(f, " *  ", defaults);
+    fprintf(f, " */\n\n#ifndef DETECTOR_CONFIG_H\n#define DETECTOR_CONFIG_H\n\n");
+    fprintf(f, "#define DETECTOR_NOISE_THRESHOLD   %ld\n", (long)p.noiseThreshold);
+    fprintf(f, "#define DETECTOR_INITIAL_OFFSET    %ld\n", (long)p.initialOffset);
+    fprintf(f, "#define DETECTOR_ATTACK            %.3f\n", p.attack);
+    fprintf(f, "#define DETECTOR_DECAY             %.3f\n", p.decay);
+    fprintf(f, "#define DETECTOR_LOUD_SAMPLES      %lu\n", (unsigned long)p.loudSamples);
+    fprintf(f, "#define DETECTOR_COOLDOWN_MS       %lu\n", (unsigned long)p.cooldownMs);
+    fprintf(f, "#define DETECTOR_PRE_ROLL_SAMPLES  %lu\n", (unsigned long)p.preRollSamples);
+    fprintf(f, "\n#endif /* DETECTOR_CONFIG_H */\n");
+    fclose(f);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    unsigned threads = 0;
+    uint32_t samplesPerRound = 400, rounds = 4, seed = 1;
+    int32_t dc = 0;
+    double coverage = 0.9, maxFalsePerHour = 1.0;
+    std::string configOut;
+    std::vector<std::string> sources;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-j") && i + 1 < argc) threads = (unsigned)atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-n") && i + 1 < argc) samplesPerRound = (uint32_t)atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-r") && i + 1 < argc) rounds = (uint32_t)atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-s") && i + 1 < argc) seed = (uint32_t)strtoul(argv[++i], nullptr, 0);
+        else if (!strcmp(argv[i], "--dc") && i + 1 < argc) dc = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--coverage") && i + 1 < argc) coverage = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--write") && i + 1 < argc) configOut = argv[++i];
+        else if (!strcmp(argv[i], "--max-fph") && i + 1 < argc) maxFalsePerHour = atof(argv[++i]);
+        else sources.push_back(argv[i]);
+    }
+    if (sources.empty()) {
+        fprintf(stderr, "usage: %s [-j threads] [-n samples] [-r rounds] [-s seed] [--dc offset] [--coverage c]\n"
+                        "       [--write out.h] [--max-fph f] <wav|dir>...\n", argv[0]);
+        return 2;
+    }
+
+    std::vector<std::string> paths;
+    for (const std::string& s : sources) findWavs(s, paths);
+    std::sort(paths.begin(), paths.end());
+
+    WorkStealingPool pool(threads);
+    std::vector<Recording> corpus(paths.size());
+    std::vector<char> usable(paths.size(), 0);
+    pool.parallelFor(paths.size(), 1, [&](size_t begin, size_t end, unsigned) {
+        for (size_t i = begin; i < end; i++) {
+            Recording& rec = corpus[i];
+            rec.path = paths[i];
+            WavInfo info;
+            if (!wavRead(rec.path, rec.samples, &info) || info.sampleRate != AUDIO_TIMELINE_SAMPLE_RATE) continue;
+            for (int32_t& x : rec.samples) x += dc;
+            std::string labels = std::filesystem::path(rec.path).replace_extension(".txt").string();
+            loadLabels(labels, rec.events);
+            usable[i] = 1;
+        }
+    });
+    std::vector<Recording> loaded;
+    for (size_t i = 0; i < corpus.size(); i++) {
+        if (usable[i]) loaded.push_back(std::move(corpus[i]));
+        else fprintf(stderr, "skipped %s (unreadable or not 16 kHz)\n", paths[i].c_str());
+    }
+    corpus.swap(loaded);
+    if (corpus.empty()) {
+        fprintf(stderr, "no recordings\n");
+        return 1;
+    }
+
+    uint64_t totalSamples = 0;
+    uint32_t events = 0;
+    for (const Recording& rec : corpus) {
+        totalSamples += rec.samples.size();
+        events += (uint32_t)rec.events.size();
+    }
+    double hours = (double)totalSamples / AUDIO_TIMELINE_SAMPLE_RATE / 3600.0;
+    printf("corpus: %zu recordings, %.2f h, %lu words\n", corpus.size(), hours, (unsigned long)events);
+
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::normal_distribution<double> normal(0.0, 1.0);
+    auto start = std::chrono::steady_clock::now();
+
+    // Round 0: the defaults and random points
+    std::vector<Candidate> all, batch(1);
+    TriggerDetector_DefaultParams(&batch[0].params);
+    for (uint32_t i = 0; i < samplesPerRound; i++) {
+        double u[DIMENSIONS];
+        for (double& v : u) v = uniform(rng);
+        batch.push_back(Candidate());
+        batch.back().params = fromUnit(u);
+    }
+    evaluate(pool, corpus, coverage, hours, events, batch);
+    Candidate defaults = batch[0];
+    all.insert(all.end(), batch.begin(), batch.end());
+
+    // Refinement: mutate front members, the step shrinks every round
+    double step = 0.15;
+    for (uint32_t round = 1; round <= rounds; round++, step *= 0.6) {
+        std::vector<Candidate> front = paretoFront(all);
+        batch.assign(samplesPerRound / 2, Candidate());
+        for (Candidate& c : batch) {
+            double u[DIMENSIONS];
+            toUnit(front[rng() % front.size()].params, u);
+            for (double& v : u) v += step * normal(rng);
+            c.params = fromUnit(u);
+        }
+        evaluate(pool, corpus, coverage, hours, events, batch);
+        all.insert(all.end(), batch.begin(), batch.end());
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<Candidate> front = paretoFront(all);
+    size_t chosen = 0;
+    bool reachable = false;
+    for (size_t i = 0; i < front.size(); i++) {
+        if (front[i].falsePerHour <= maxFalsePerHour) {
+            chosen = i;  // The front is sorted by false triggers, later members miss less
+            reachable = true;
+        }
+    }
+
+    printf("\nPareto front (%zu of %zu parameter sets)\n   %s", front.size(), all.size(), TABLE_HEADER);
+    for (size_t i = 0; i < front.size(); i++) printCandidate(stdout, i == chosen ? " * " : "   ", front[i]);
+    printf("\ndefaults:\n");
+    printCandidate(stdout, "   ", defaults);
+    printf("  %lu recordings, %lu words caught, %lu cut, %lu false triggers\n",
+           (unsigned long)defaults.score.recordings, (unsigned long)defaults.score.hits,
+           (unsigned long)defaults.score.partial, (unsigned long)defaults.score.falseTriggers);
+    printf("throughput: %.0f parameter sets/s, %.1f h of audio per second (%u threads, %.2f s)\n",
+           all.size() / seconds, all.size() * hours / seconds, pool.workers(), seconds);
+    if (!reachable) fprintf(stderr, "warning: no parameter set reaches %.2f false/h, chose the lowest\n", maxFalsePerHour);
+
+    if (!configOut.empty()) {
+        if (!writeConfig(configOut, front, chosen, defaults, corpus.size(), hours, events, coverage)) {
+            fprintf(stderr, "cannot write %s\n", configOut.c_str());
+            return 1;
+        }
+        printf("configuration written to %s\n", configOut.c_str());
+    }
+    return 0;
+}
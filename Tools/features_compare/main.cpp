@@ -0,0 +1,222 @@
+// features_compare - fixed-point vs float MFCC front-end (Core/Src/feature_extraction.cpp)
+//
+// Usage:
+//   features_compare <dataset>
+//   features_compare --synthetic [clips] [seed]
+//
+// <dataset> is a directory searched recursively for .wav files or a manifest with one
+// "<path> [label]" per line. --synthetic generates clips with tones, formant-like harmonic bursts,
+// chirps and noise over 60 dB of level, so the comparison runs without a corpus.
+//
+// Both paths are built from the same source (FEATURES_BOTH_PATHS). Reports the feature SNR of the fixed path against the float path
+// (overall and per coefficient) and how often the cascade (silence floor, network, decision
+// stage; same flow as Tools/kws_eval) ends with the same result on both feature sets.
+
+#include "feature_extraction.h"
+#include "kws.h"
+#include "kws_decision.h"
+#include "reference_network.h"
+#include "wav.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static const int CLIP_SAMPLES = 16000;
+
+static bool loadPaths(const std::string& source, std::vector<std::string>& paths) {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    if (fs::is_directory(source, ec)) {
+        for (const fs::directory_entry& file : fs::recursive_directory_iterator(source, ec)) {
+            if (file.is_regular_file() && file.path().extension() == ".wav") paths.push_back(file.path().string());
+        }
+    } else {
+        std::ifstream manifest(source);
+        std::string line;
+        while (std::getline(manifest, line)) {
+            std::istringstream fields(line);
+            std::string path;
+            if (fields >> path) paths.push_back(path);
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+    return !paths.empty();
+}
+
+// One synthetic second: background noise plus up to three events at random levels
+static void synthesize(std::mt19937& rng, std::vector<int32_t>& samples) {
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::normal_distribution<double> gauss(0.0, 1.0);
+    auto dbfs = [&](double low, double high) { return 131071.0 * pow(10.0, (low + (high - low) * uniform(rng)) / 20.0); };
+
+    std::vector<double> x(CLIP_SAMPLES, 0.0);
+    double noise = dbfs(-80.0, -30.0);
+    for (double& v : x) v = noise * gauss(rng);
+
+    int events = (int)(rng() % 4);
+    for (int e = 0; e < events; e++) {
+        int start = (int)(rng() % 12000);
+        int length = 2000 + (int)(rng() % 6000);
+        double amplitude = dbfs(-60.0, -3.0);
+        int kind = (int)(rng() % 3);
+        double f0 = 80.0 + 220.0 * uniform(rng);
+        double f1 = 200.0 + 3500.0 * uniform(rng);
+        double phase = 0.0;
+        for (int i = 0; i < length && start + i < CLIP_SAMPLES; i++) {
+            double t = (double)i / length;
+            double envelope = sin(M_PI * t);
+            double v = 0.0;
+            if (kind == 0) {
+                // Voiced: harmonics of f0 shaped by two formant bumps
+                double pitch = f0 * (1.0 + 0.05 * sin(2.0 * M_PI * 5.0 * i / 16000.0));
+                phase += 2.0 * M_PI * pitch / 16000.0;
+                for (int h = 1; h * f0 < 4000.0; h++) {
+                    double f = h * f0;
+                    double gain = exp(-pow((f - 700.0) / 300.0, 2)) + 0.5 * exp(-pow((f - 1800.0) / 400.0, 2)) + 0.02;
+                    v += gain * sin(h * phase);
+                }
+                v *= 0.3;
+            } else if (kind == 1) {
+                // Chirp f0 -> f1
+                phase += 2.0 * M_PI * (f0 + (f1 - f0) * t) / 16000.0;
+                v = sin(phase);
+            } else {
+                // Noise burst (fricative-like)
+                v = 0.5 * gauss(rng);
+            }
+            x[start + i] += amplitude * envelope * v;
+        }
+    }
+
+    samples.resize(CLIP_SAMPLES);
+    for (int i = 0; i < CLIP_SAMPLES; i++) samples[i] = (int32_t)std::max(-131072.0, std::min(131071.0, x[i]));
+}
+
+struct Outcome {
+    bool silent;
+    KwsDecision decision;
+};
+
+// Same flow as Kws_Step
+static Outcome classify(const ReferenceNetwork& net, const float* features) {
+    Outcome o = {};
+    float meanLogEnergy = KwsDecision_MeanLogEnergy(features);
+    o.decision.type = KWS_DECISION_SILENCE;
+    o.decision.label = -1;
+    o.decision.best = -1;
+    o.silent = KwsDecision_IsSilent(meanLogEnergy);
+    if (o.silent) return o;
+    float logits[REF_OUT_SIZE];
+    net.run(features, logits);
+    KwsDecision_Decide(logits, meanLogEnergy, KWS_NETWORK_THRESHOLD, &o.decision);
+    return o;
+}
+
+struct Totals {
+    double signal[FEATURES_NUM_MFCC] = {};
+    double error[FEATURES_NUM_MFCC] = {};
+    double maxError = 0.0;
+    size_t clips = 0;
+    size_t sameSilence = 0;
+    size_t bothRan = 0;
+    size_t sameBest = 0;
+    size_t sameDecision = 0;
+};
+
+static void compare(const ReferenceNetwork& net, const std::vector<int32_t>& samples, Totals& t) {
+    float reference[FEATURES_SIZE];
+    int16_t fixed[FEATURES_SIZE];
+    float converted[FEATURES_SIZE];
+    Features_ComputeFloat(samples.data(), reference);
+    Features_ComputeFixed(samples.data(), fixed);
+
+    for (int i = 0; i < FEATURES_SIZE; i++) {
+        converted[i] = fixed[i] * (1.0f / (1 << FEATURES_Q_FRAC_BITS));
+        double e = (double)converted[i] - reference[i];
+        t.signal[i % FEATURES_NUM_MFCC] += (double)reference[i] * reference[i];
+        t.error[i % FEATURES_NUM_MFCC] += e * e;
+        t.maxError = std::max(t.maxError, fabs(e));
+    }
+
+    Outcome a = classify(net, reference);
+    Outcome b = classify(net, converted);
+    t.clips++;
+    if (a.silent == b.silent) t.sameSilence++;
+    if (!a.silent && !b.silent) {
+        t.bothRan++;
+        if (a.decision.best == b.decision.best) t.sameBest++;
+    }
+    if (a.decision.type == b.decision.type && a.decision.label == b.decision.label) t.sameDecision++;
+}
+
+static double snrDb(double signal, double error) {
+    return error > 0.0 ? 10.0 * log10(signal / error) : INFINITY;
+}
+
+static double percent(size_t part, size_t whole) {
+    return whole ? 100.0 * part / whole : 100.0;
+}
+
+int main(int argc, char** argv) {
+    std::vector<std::string> paths;
+    size_t synthetic = 0;
+    uint32_t seed = 1;
+    if (argc >= 2 && strcmp(argv[1], "--synthetic") == 0) {
+        synthetic = argc >= 3 ? strtoul(argv[2], nullptr, 0) : 500;
+        if (argc >= 4) seed = (uint32_t)strtoul(argv[3], nullptr, 0);
+    } else if (argc == 2) {
+        if (!loadPaths(argv[1], paths)) {
+            fprintf(stderr, "no clips found in %s\n", argv[1]);
+            return 1;
+        }
+    } else {
+        fprintf(stderr, "usage: %s <dir|manifest>\n       %s --synthetic [clips] [seed]\n", argv[0], argv[0]);
+        return 2;
+    }
+
+    Features_Init();
+    const ReferenceNetwork net;
+    Totals t;
+    std::vector<int32_t> samples;
+
+    if (synthetic) {
+        std::mt19937 rng(seed);
+        for (size_t i = 0; i < synthetic; i++) {
+            synthesize(rng, samples);
+            compare(net, samples, t);
+        }
+    } else {
+        for (const std::string& path : paths) {
+            if (!wavRead(path, samples)) {
+                fprintf(stderr, "skipping %s\n", path.c_str());
+                continue;
+            }
+            samples.resize(CLIP_SAMPLES, 0);
+            compare(net, samples, t);
+        }
+    }
+
+    double signal = 0.0, error = 0.0;
+    printf("clips:              %zu\n", t.clips);
+    printf("feature SNR per coefficient (dB):\n ");
+    for (int c = 0; c < FEATURES_NUM_MFCC; c++) {
+        signal += t.signal[c];
+        error += t.error[c];
+        printf(" c%d %.1f", c, snrDb(t.signal[c], t.error[c]));
+    }
+    printf("\nfeature SNR:        %.1f dB (max abs error %.3f)\n", snrDb(signal, error), t.maxError);
+    printf("same silence check: %.2f %%\n", percent(t.sameSilence, t.clips));
+    printf("same network top-1: %.2f %% of %zu clips that reached the network on both paths\n",
+           percent(t.sameBest, t.bothRan), t.bothRan);
+    printf("same decision:      %.2f %%\n", percent(t.sameDecision, t.clips));
+    return 0;
+}
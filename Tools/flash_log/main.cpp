@@ -0,0 +1,520 @@
+// flash_log - decode a clip download (Core/Src/flash_recorder.h), or check the log store on a
+// simulated flash device
+//
+// Usage:
+//   flash_log <capture.bin> <outdir>
+//   flash_log --simulate [seed]
+//
+// <capture.bin> is the raw USB stream while the board sends its clips, e.g.
+//   stty -F /dev/ttyACM0 raw && (cat /dev/ttyACM0 > capture.bin &) && printf D > /dev/ttyACM0
+// Written to <outdir>: clip_<id>.wav per clip and clips.csv with the metadata.
+//
+// --simulate runs Core/Src/flash_log.cpp on a NOR flash model with the geometry and timing of the
+// firmware's log (4 x 128 KB, 16 us per word, 1 - 2 s per sector erase). The model rejects
+// programming a 0 bit back to 1, overlapping operations and reads while an operation runs.
+//   steady       a clip every 2 s for several wraps of the ring: no poll may wait for an erase,
+//                the log must keep the newest clips, every clip decodes to the recorded samples
+//   power loss   power cut at a random erase / program step, then remount: every committed clip
+//                that was not aged out is still there and intact, torn records are skipped and
+//                appending continues
+// Exit code 0 if everything holds.
+
+#include "flash_log.h"
+#include "flash_recorder.h"
+#include "stream_mux.h"
+#include "kws_labels.h"
+#include "audio_timeline.h"
+#include "wav.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+static const uint32_t CLIP_SAMPLES = 16000;
+
+// DOWNLOAD DECODER
+
+struct Download {
+    std::map<uint32_t, std::vector<uint8_t>> records;  // by clip id
+    std::map<uint32_t, uint32_t> nextSequence;
+    std::map<uint32_t, bool> broken;                   // chunks lost
+    bool ended = false;
+    uint32_t announced = 0;
+};
+
+static void onDownloadFrame(void* context, StreamMuxChannel channel, uint16_t sequence, uint32_t tag,
+                            const uint8_t* payload, uint32_t length) {
+    if (channel != STREAM_MUX_CLIPS) return;
+    Download* d = static_cast<Download*>(context);
+    if (tag == FLASH_RECORDER_END_TAG) {
+        d->ended = true;
+        if (length >= 4) memcpy(&d->announced, payload, 4);
+        return;
+    }
+    auto next = d->nextSequence.find(tag);
+    if (next != d->nextSequence.end() && next->second != sequence) d->broken[tag] = true;
+    d->nextSequence[tag] = (uint16_t)(sequence + 1);
+    std::vector<uint8_t>& record = d->records[tag];
+    record.insert(record.end(), payload, payload + length);
+}
+
+static const char* decisionName(uint8_t decision) {
+    switch (decision) {
+    case 0: return "keyword";
+    case 1: return "silence";
+    case 2: return "unknown";
+    default: return "?";
+    }
+}
+
+static const char* labelName(uint8_t label) {
+    return label < KWS_NUM_LABELS ? kwsLabelNames[label] : "-";
+}
+
+static int decode(const char* capture, const std::string& dir) {
+    std::ifstream in(capture, std::ios::binary);
+    if (!in) {
+        fprintf(stderr, "cannot read %s\n", capture);
+        return 1;
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    static StreamMuxParser parser;
+    Download d;
+    StreamMux_ParserInit(&parser);
+    StreamMux_Parse(&parser, data.data(), (uint32_t)data.size(), onDownloadFrame, &d);
+
+    FILE* csv = fopen((dir + "/clips.csv").c_str(), "w");
+    if (!csv) {
+        fprintf(stderr, "cannot write to %s\n", dir.c_str());
+        return 1;
+    }
+    fprintf(csv, "id,uptime_ms,trigger_sample,samples,lost_blocks,label,best,decision,score,bytes\n");
+
+    uint32_t good = 0, bad = 0;
+    std::vector<int32_t> samples;
+    for (const auto& entry : d.records) {
+        const std::vector<uint8_t>& bytes = entry.second;
+        FlashLogRecord r;
+        bool ok = !d.broken[entry.first] && bytes.size() >= sizeof(r);
+        if (ok) {
+            memcpy(&r, bytes.data(), sizeof(r));
+            ok = r.magic == FLASH_LOG_RECORD_MAGIC && r.headerCrc == FlashLog_HeaderCrc(&r) &&
+                 bytes.size() == sizeof(r) + r.length &&
+                 r.payloadCrc == AudioCodec_Crc16(&bytes[sizeof(r)], r.length, 0xFFFF);
+        }
+        if (ok) {
+            samples.resize(r.info.samples);
+            ok = FlashLog_DecodeClip(&bytes[sizeof(r)], r.length, samples.data(), r.info.samples);
+        }
+        if (!ok) {
+            fprintf(stderr, "clip %lu: incomplete or corrupt, skipped\n", (unsigned long)entry.first);
+            bad++;
+            continue;
+        }
+
+        char name[64];
+        snprintf(name, sizeof(name), "/clip_%06lu.wav", (unsigned long)r.id);
+        if (!wavWrite(dir + name, samples, AUDIO_TIMELINE_SAMPLE_RATE, 24)) {
+            fprintf(stderr, "cannot write %s%s\n", dir.c_str(), name);
+            return 1;
+        }
+        bool result = (r.info.flags & FLASH_LOG_FLAG_RESULT) != 0;
+        fprintf(csv, "%lu,%lu,%llu,%u,%u,%s,%s,%s,%.4f,%lu\n", (unsigned long)r.id,
+                (unsigned long)r.info.uptimeMs, (unsigned long long)r.info.triggerSample, r.info.samples,
+                r.info.lostBlocks, result ? labelName(r.info.label) : "", result ? labelName(r.info.best) : "",
+                result ? decisionName(r.info.decision) : "",
+                r.info.score / 65535.0, (unsigned long)r.length);
+        good++;
+    }
+    fclose(csv);
+
+    printf("clips: %lu decoded, %lu corrupt", (unsigned long)good, (unsigned long)bad);
+    if (d.ended) printf(", board sent %lu\n", (unsigned long)d.announced);
+    else printf(", no end marker (download cut short?)\n");
+    printf("crc errors: %lu, lost frames: %lu\n", (unsigned long)parser.stats.crcErrors,
+           (unsigned long)parser.stats.lost[STREAM_MUX_CLIPS]);
+    return bad == 0 && d.ended ? 0 : 1;
+}
+
+// SIMULATED FLASH (NOR: erase sets all bits, programming only clears bits)
+
+struct PowerLoss {};
+
+struct SimFlash {
+    uint32_t sectorSize = FLASH_RECORDER_SECTOR_SIZE;
+    uint32_t sectorCount = FLASH_RECORDER_SECTORS;
+    double programUs = 16.0;
+    double eraseUs = 1.0e6;
+    std::vector<uint8_t> memory;
+    std::vector<uint32_t> sectorErases;
+
+    double nowUs = 0.0;
+    double busyUntilUs = 0.0;
+    bool eraseRunning = false;
+    uint32_t eraseSector = 0;
+
+    uint64_t operations = 0;
+    uint64_t cutAt = 0;        // Power loss at this operation, 0 = none
+    double cutAtUs = 0.0;      // or at this time, 0 = none
+    bool cutInHeader = false;  // or while the next record header is programmed
+    uint32_t violations = 0;
+    std::mt19937* rng = nullptr;
+
+    bool busy() const { return nowUs < busyUntilUs; }
+
+    void violation(const char* what) {
+        if (violations++ < 5) fprintf(stderr, "  flash model: %s\n", what);
+    }
+
+    // The operation in flight is cut: an erase leaves random bits, a program a subset of its zeros
+    void cut() {
+        if (eraseRunning) {
+            uint8_t* s = &memory[(size_t)eraseSector * sectorSize];
+            for (uint32_t i = 0; i < sectorSize; i++) {
+                if ((*rng)() % 4 == 0) s[i] = (uint8_t)(*rng)();
+            }
+        }
+        throw PowerLoss();
+    }
+
+    void step() {
+        operations++;
+        if (cutAt && operations == cutAt) cut();
+    }
+};
+
+static SimFlash sim;
+
+static const uint8_t* simRead(uint32_t sector) {
+    if (sim.busy()) sim.violation("read while an operation runs");
+    return &sim.memory[(size_t)sector * sim.sectorSize];
+}
+
+static void simEraseStart(uint32_t sector) {
+    if (sim.busy()) sim.violation("erase started while busy");
+    sim.eraseRunning = true;
+    sim.eraseSector = sector;
+    sim.busyUntilUs = sim.nowUs + sim.eraseUs;
+    sim.step();
+    memset(&sim.memory[(size_t)sector * sim.sectorSize], 0xFF, sim.sectorSize);
+    sim.sectorErases[sector]++;
+}
+
+static void simProgramStart(uint32_t sector, uint32_t offset, uint32_t word) {
+    if (sim.busy()) sim.violation("program started while busy");
+    if (offset % 4 != 0 || offset + 4 > sim.sectorSize) sim.violation("unaligned or out of range program");
+    sim.eraseRunning = false;
+    sim.busyUntilUs = sim.nowUs + sim.programUs;
+    uint8_t* p = &sim.memory[(size_t)sector * sim.sectorSize + offset];
+    uint32_t old;
+    memcpy(&old, p, 4);
+    if ((old & word) != word) sim.violation("program would set a 0 bit back to 1");
+    uint32_t value = old & word;
+    if (sim.cutInHeader && word == FLASH_LOG_RECORD_MAGIC) {
+        sim.cutInHeader = false;
+        sim.cutAt = sim.operations + 1 + (*sim.rng)() % (sizeof(FlashLogRecord) / 4 - 1);
+    }
+    if (sim.cutAt && sim.operations + 1 == sim.cutAt) {
+        // Cut mid-program: only some of the zeros land
+        value = old & (word | (uint32_t)(*sim.rng)());
+        memcpy(p, &value, 4);
+    } else {
+        memcpy(p, &value, 4);
+    }
+    sim.step();
+}
+
+static FlashLogDevStatus simStatus(void) {
+    if (sim.cutAtUs > 0.0 && sim.nowUs >= sim.cutAtUs) sim.cut();
+    if (sim.busy()) {
+        // One status poll; a program is waited out in one go
+        sim.nowUs = sim.eraseRunning ? sim.nowUs + 1.0 : sim.busyUntilUs;
+        return FLASH_LOG_DEV_BUSY;
+    }
+    if (sim.eraseRunning) sim.eraseRunning = false;
+    return FLASH_LOG_DEV_IDLE;
+}
+
+static const FlashLogDevice simDevice = {
+    FLASH_RECORDER_SECTOR_SIZE, FLASH_RECORDER_SECTORS, simRead, simEraseStart, simProgramStart, simStatus
+};
+
+static void simReset(uint32_t seed, std::mt19937& rng) {
+    sim = SimFlash();
+    sim.memory.assign((size_t)sim.sectorSize * sim.sectorCount, 0);
+    for (size_t i = 0; i < sim.memory.size(); i++) sim.memory[i] = (uint8_t)rng();  // factory state unknown
+    sim.sectorErases.assign(sim.sectorCount, 0);
+    sim.rng = &rng;
+    (void)seed;
+}
+
+// One synthetic recording: noise floor, then a voiced burst with a few harmonics
+static void synthesize(std::mt19937& rng, std::vector<int32_t>& samples) {
+    std::uniform_real_distribution<double> u(0.0, 1.0);
+    std::normal_distribution<double> noise(0.0, 1.0);
+    samples.resize(CLIP_SAMPLES);
+    double floor = 20.0 + 200.0 * u(rng);
+    double level = 2000.0 + 60000.0 * u(rng);
+    double f0 = 90.0 + 200.0 * u(rng);
+    uint32_t start = 2000 + rng() % 4000, length = 3000 + rng() % 7000;
+    for (uint32_t i = 0; i < CLIP_SAMPLES; i++) {
+        double v = floor * noise(rng);
+        if (i >= start && i < start + length) {
+            double env = sin(M_PI * (i - start) / length);
+            for (int h = 1; h <= 4; h++) v += env * level / h * sin(2.0 * M_PI * f0 * h * i / 16000.0);
+        }
+        long s = lround(v);
+        samples[i] = (int32_t)std::max(-131072L, std::min(131071L, s));
+    }
+}
+
+struct Clip {
+    std::vector<int32_t> samples;
+    std::vector<uint8_t> payload;
+    uint16_t crc;
+};
+
+// Synthesizing and encoding dominate the run time, the trials draw from a fixed set of clips
+static std::vector<Clip> clipPool;
+
+static bool buildPool(std::mt19937& rng) {
+    clipPool.resize(32);
+    std::vector<uint8_t> staging(FLASH_LOG_MAX_PAYLOAD(CLIP_SAMPLES));
+    std::vector<int32_t> decoded(CLIP_SAMPLES);
+    for (Clip& clip : clipPool) {
+        synthesize(rng, clip.samples);
+        uint32_t bytes = FlashLog_EncodeClip(clip.samples.data(), CLIP_SAMPLES, staging.data());
+        clip.payload.assign(staging.begin(), staging.begin() + bytes);
+        clip.crc = AudioCodec_Crc16(clip.payload.data(), bytes, 0xFFFF);
+        // A payload read back byte for byte then decodes to the recording
+        if (!FlashLog_DecodeClip(clip.payload.data(), bytes, decoded.data(), CLIP_SAMPLES) ||
+            decoded != clip.samples) {
+            printf("clip codec round trip FAILED\n");
+            return false;
+        }
+    }
+    return true;
+}
+
+struct Checker {
+    std::map<uint32_t, const Clip*> clips;  // by id, what was appended
+    std::set<uint32_t> committed;           // ids known to be complete in flash
+    uint32_t corrupt = 0;
+    uint32_t wrongContent = 0;
+    uint32_t missing = 0;
+};
+
+// Walk the log: ids ascending, headers and payloads intact, samples as recorded, no committed
+// clip missing between the oldest and the newest found. A record cut short leaves a gap in the ids.
+static bool readBack(const FlashLog& log, Checker& check, uint32_t* first, uint32_t* last, uint32_t* count) {
+    FlashLogCursor cursor = {};
+    const FlashLogRecord* r;
+    const uint8_t* payload;
+    bool ordered = true;
+    std::set<uint32_t> found;
+    *count = 0;
+    std::vector<int32_t> samples(CLIP_SAMPLES);
+    while (FlashLog_Next(&log, &cursor, &r, &payload)) {
+        if (*count == 0) *first = r->id;
+        else if (r->id <= *last) ordered = false;
+        *last = r->id;
+        (*count)++;
+        found.insert(r->id);
+        auto clip = check.clips.find(r->id);
+        if (clip != check.clips.end() && r->length == clip->second->payload.size() &&
+            r->payloadCrc == clip->second->crc && memcmp(payload, clip->second->payload.data(), r->length) == 0) {
+            continue;
+        }
+        if (r->payloadCrc != AudioCodec_Crc16(payload, r->length, 0xFFFF) ||
+            !FlashLog_DecodeClip(payload, r->length, samples.data(), r->info.samples)) {
+            check.corrupt++;
+        } else {
+            check.wrongContent++;
+        }
+    }
+    if (*count > 0) {
+        for (auto id = check.committed.lower_bound(*first); id != check.committed.end(); ++id) {
+            if (!found.count(*id)) check.missing++;
+        }
+    }
+    return ordered;
+}
+
+// Append and poll like the main loop: every loopUs a poll, a clip every intervalUs
+struct Run {
+    uint32_t appended = 0;
+    uint32_t refused = 0;
+    double maxPollUs = 0.0;
+    uint32_t lastCommitted = 0;
+    bool anyCommitted = false;
+};
+
+static void runClips(FlashLog& log, Checker& check, std::mt19937& rng, uint32_t clips, double intervalUs,
+                     Run& run) {
+    const double loopUs = 1000.0;
+    // The first clip comes an interval after the start, like a recording after boot
+    double nextClipUs = sim.nowUs + intervalUs;
+    uint32_t pendingId = 0;
+    bool pending = false;
+    uint32_t added = 0;
+
+    while (added < clips || !FlashLog_IsIdle(&log)) {
+        if (added < clips && sim.nowUs >= nextClipUs) {
+            const Clip& clip = clipPool[rng() % clipPool.size()];
+            FlashLogClipInfo info = {};
+            info.samples = CLIP_SAMPLES;
+            info.uptimeMs = (uint32_t)(sim.nowUs / 1000.0);
+            uint32_t id = log.nextId;
+            if (FlashLog_IsIdle(&log) && FlashLog_Append(&log, &info, clip.payload.data(), (uint32_t)clip.payload.size())) {
+                check.clips[id] = &clip;
+                pendingId = id;
+                pending = true;
+                run.appended++;
+            } else {
+                run.refused++;
+            }
+            added++;
+            nextClipUs += intervalUs;
+        }
+
+        double before = sim.nowUs;
+        FlashLog_Poll(&log, FLASH_RECORDER_POLL_WORDS);
+        run.maxPollUs = std::max(run.maxPollUs, sim.nowUs - before);
+        if (pending && FlashLog_IsIdle(&log)) {
+            pending = false;
+            run.lastCommitted = pendingId;
+            run.anyCommitted = true;
+            check.committed.insert(pendingId);
+        }
+        sim.nowUs += loopUs;
+    }
+    // Let the erase scheduled last finish
+    while (FlashLog_DeviceBusy(&log) || sim.busy()) {
+        FlashLog_Poll(&log, FLASH_RECORDER_POLL_WORDS);
+        sim.nowUs += loopUs;
+    }
+}
+
+static bool simulateSteady(uint32_t seed, double eraseUs) {
+    std::mt19937 rng(seed);
+    simReset(seed, rng);
+    sim.eraseUs = eraseUs;
+    static FlashLog log;
+    FlashLog_Mount(&log, &simDevice);
+    Checker check;
+    Run run;
+    const uint32_t clips = 120;
+    runClips(log, check, rng, clips, 2.0e6, run);
+
+    uint32_t first = 0, last = 0, count = 0;
+    bool ordered = readBack(log, check, &first, &last, &count);
+    uint64_t payload = 0;
+    for (const auto& c : check.clips) payload += c.second->payload.size();
+    double avgBytes = check.clips.empty() ? 0.0 : (double)payload / check.clips.size();
+    // At least the sectors behind the writer hold clips
+    uint32_t expectedMin = (uint32_t)((FLASH_RECORDER_SECTORS - 2) *
+                                      (FLASH_RECORDER_SECTOR_SIZE / (avgBytes + sizeof(FlashLogRecord))));
+    uint32_t minErases = *std::min_element(sim.sectorErases.begin(), sim.sectorErases.end());
+    uint32_t maxErases = *std::max_element(sim.sectorErases.begin(), sim.sectorErases.end());
+
+    bool ok = ordered && run.refused == 0 && log.stats.waits == 0 && log.stats.errors == 0 &&
+              sim.violations == 0 && check.corrupt == 0 && check.wrongContent == 0 &&
+              check.missing == 0 && last == run.lastCommitted && count >= expectedMin && maxErases - minErases <= 1 &&
+              run.maxPollUs < 2000.0;
+    printf("steady (erase %.1f s): %lu clips (%.1f kB, %.2f bit/sample), log keeps %lu (ids %lu..%lu), "
+           "%lu erase waits, poll max %.0f us, erases per sector %lu..%lu: %s\n",
+           eraseUs / 1e6, (unsigned long)run.appended, avgBytes / 1024.0, avgBytes * 8.0 / CLIP_SAMPLES,
+           (unsigned long)count, (unsigned long)first, (unsigned long)last, (unsigned long)log.stats.waits,
+           run.maxPollUs, (unsigned long)minErases, (unsigned long)maxErases, ok ? "ok" : "FAILED");
+    if (!ok) {
+        printf("  refused %lu, corrupt %lu, wrong content %lu, missing %lu, violations %lu, expected >= %lu clips%s\n",
+               (unsigned long)run.refused, (unsigned long)check.corrupt, (unsigned long)check.wrongContent,
+               (unsigned long)check.missing, (unsigned long)sim.violations, (unsigned long)expectedMin, ordered ? "" : ", ids out of order");
+    }
+    return ok;
+}
+
+static bool simulatePowerLoss(uint32_t seed, uint32_t trials) {
+    std::mt19937 rng(seed);
+    uint32_t failures = 0, tornSkipped = 0, cutsInErase = 0;
+    for (uint32_t t = 0; t < trials; t++) {
+        simReset(seed, rng);
+        static FlashLog log;
+        FlashLog_Mount(&log, &simDevice);
+        Checker check;
+        Run run;
+
+        // Fill past one wrap, then cut at a random program or erase operation of the next clips,
+        // at a random time (the erases take most of the device time), or in a record header
+        runClips(log, check, rng, 20 + rng() % 10, 2.0e6, run);
+        if (t % 4 == 3) sim.cutInHeader = true;
+        else if (t % 2 == 0) sim.cutAt = sim.operations + 1 + rng() % 15000;
+        else sim.cutAtUs = sim.nowUs + 1.0 + (rng() % 12000000);
+        bool cutInErase = false;
+        try {
+            runClips(log, check, rng, 6, 2.0e6, run);
+        } catch (const PowerLoss&) {
+            cutInErase = sim.eraseRunning;
+        }
+        if (cutInErase) cutsInErase++;
+        sim.cutAt = 0;
+        sim.cutAtUs = 0.0;
+        sim.cutInHeader = false;
+        sim.busyUntilUs = sim.nowUs;  // reset ends any operation
+        sim.eraseRunning = false;
+
+        // Remount, everything committed and not aged out must be back and intact
+        FlashLog_Mount(&log, &simDevice);
+        uint32_t first = 0, last = 0, count = 0;
+        bool ordered = readBack(log, check, &first, &last, &count);
+        bool ok = ordered && check.corrupt == 0 && check.wrongContent == 0 && check.missing == 0 &&
+                  (!run.anyCommitted || (count > 0 && last >= run.lastCommitted && last <= run.lastCommitted + 1));
+        tornSkipped += log.stats.closedTails;
+
+        // Appending goes on after the reset
+        Run after;
+        runClips(log, check, rng, 4, 2.0e6, after);
+        uint32_t first2 = 0, last2 = 0, count2 = 0;
+        ordered = readBack(log, check, &first2, &last2, &count2);
+        ok = ok && ordered && after.refused == 0 && check.corrupt == 0 && check.wrongContent == 0 &&
+             check.missing == 0 && last2 == after.lastCommitted && last2 > last && sim.violations == 0;
+        if (!ok && failures++ < 5) {
+            printf("  trial %lu: committed up to %lu, found %lu..%lu after the reset, %lu after appending; "
+                   "%lu corrupt, %lu wrong, %lu missing, %lu refused, %lu violations\n",
+                   (unsigned long)t, (unsigned long)run.lastCommitted, (unsigned long)first, (unsigned long)last,
+                   (unsigned long)last2, (unsigned long)check.corrupt, (unsigned long)check.wrongContent,
+                   (unsigned long)check.missing, (unsigned long)after.refused, (unsigned long)sim.violations);
+        }
+    }
+    printf("power loss: %lu cuts (%lu during an erase, %lu torn tails skipped), %lu failures: %s\n",
+           (unsigned long)trials, (unsigned long)cutsInErase, (unsigned long)tornSkipped,
+           (unsigned long)failures, failures == 0 ? "ok" : "FAILED");
+    return failures == 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc >= 2 && strcmp(argv[1], "--simulate") == 0) {
+        uint32_t seed = argc >= 3 ? (uint32_t)strtoul(argv[2], nullptr, 0) : 1;
+        std::mt19937 rng(seed);
+        if (!buildPool(rng)) return 1;
+        bool ok = simulateSteady(seed, 1.0e6);
+        ok = simulateSteady(seed + 1, 2.0e6) && ok;
+        ok = simulatePowerLoss(seed, 200) && ok;
+        return ok ? 0 : 1;
+    }
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s <capture.bin> <outdir>\n       %s --simulate [seed]\n", argv[0], argv[0]);
+        return 2;
+    }
+    return decode(argv[1], argv[2]);
+}
@@ -0,0 +1,299 @@
+/**
+ * @file    arm_math.h
+ * @brief   Host stand-in for the CMSIS-DSP functions used by the firmware front-end
+ *
+ * Host tools put this directory in front of the include path, so firmware sources in
+ * Core/Src compile unchanged on x86. Only the functions the firmware calls are provided,
+ * with the same signatures and output layout as CMSIS-DSP V1.5.3.
+ */
+
+#ifndef HOST_ARM_MATH_H
+#define HOST_ARM_MATH_H
+
+#include <stdint.h>
+#include <math.h>
+#include <complex>
+#include <vector>
+
+typedef float float32_t;
+typedef int16_t q15_t;
+typedef int32_t q31_t;
+typedef int64_t q63_t;
+
+#define PI 3.14159265358979f
+
+typedef enum {
+    ARM_MATH_SUCCESS = 0,
+    ARM_MATH_ARGUMENT_ERROR = -1
+} arm_status;
+
+typedef struct {
+    uint16_t fftLenRFFT;
+} arm_rfft_fast_instance_f32;
+
+static inline arm_status arm_rfft_fast_init_f32(arm_rfft_fast_instance_f32* S, uint16_t fftLen) {
+    if (fftLen < 32 || (fftLen & (fftLen - 1)) != 0) return ARM_MATH_ARGUMENT_ERROR;
+    S->fftLenRFFT = fftLen;
+    return ARM_MATH_SUCCESS;
+}
+
+/* Complex FFT of n real inputs in double precision, shared by the real transforms below */
+template <typename T>
+static inline std::vector<std::complex<double>> host_real_fft(const T* p, int n) {
+    std::vector<std::complex<double>> x(n);
+
+    // Bit-reversed load
+    for (int i = 0, j = 0; i < n; i++) {
+        x[j] = (double)p[i];
+        int bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j |= bit;
+    }
+
+    // Iterative radix-2
+    for (int len = 2; len <= n; len <<= 1) {
+        std::complex<double> step = std::polar(1.0, -2.0 * M_PI / len);
+        for (int i = 0; i < n; i += len) {
+            std::complex<double> w = 1.0;
+            for (int k = 0; k < len / 2; k++) {
+                std::complex<double> a = x[i + k];
+                std::complex<double> b = x[i + k + len / 2] * w;
+                x[i + k] = a + b;
+                x[i + k + len / 2] = a - b;
+                w *= step;
+            }
+        }
+    }
+    return x;
+}
+
+/* Forward transform only. Output packing as CMSIS: [0] = DC, [1] = Nyquist, then (re, im) pairs */
+static inline void arm_rfft_fast_f32(arm_rfft_fast_instance_f32* S, float32_t* p, float32_t* pOut, uint8_t ifftFlag) {
+    (void)ifftFlag;
+    const int n = S->fftLenRFFT;
+    std::vector<std::complex<double>> x = host_real_fft(p, n);
+
+    pOut[0] = (float32_t)x[0].real();
+    pOut[1] = (float32_t)x[n / 2].real();
+    for (int k = 1; k < n / 2; k++) {
+        pOut[2 * k] = (float32_t)x[k].real();
+        pOut[2 * k + 1] = (float32_t)x[k].imag();
+    }
+}
+
+static inline void arm_cmplx_mag_squared_f32(float32_t* pSrc, float32_t* pDst, uint32_t numSamples) {
+    for (uint32_t i = 0; i < numSamples; i++) {
+        pDst[i] = pSrc[2 * i] * pSrc[2 * i] + pSrc[2 * i + 1] * pSrc[2 * i + 1];
+    }
+}
+
+static inline void arm_dot_prod_f32(float32_t* pSrcA, float32_t* pSrcB, uint32_t blockSize, float32_t* result) {
+    float32_t sum = 0.0f;
+    for (uint32_t i = 0; i < blockSize; i++) sum += pSrcA[i] * pSrcB[i];
+    *result = sum;
+}
+
+/* Q31 functions: same fixed-point arithmetic as CMSIS-DSP V1.5.3. The complex FFT of the RFFT shifts
+ * its inputs down in every stage and truncates every twiddle product (radix-4, radix-4-by-2 for odd
+ * powers of two), the split into the real spectrum rounds. The twiddle tables are computed here,
+ * round to nearest like the CMSIS tables. */
+
+typedef struct {
+    uint32_t fftLenReal;
+    std::vector<q31_t> twiddle;  /* Complex FFT of fftLenReal / 2: cos, sin of 2 pi i / (fftLenReal / 2) */
+    std::vector<q31_t> splitA;   /* Real split: 0.5 (1 - sin), -0.5 cos of 2 pi i / fftLenReal */
+    std::vector<q31_t> splitB;   /* 0.5 (1 + sin), 0.5 cos */
+} arm_rfft_instance_q31;
+
+static inline q31_t host_q31(double v) {
+    double s = v * 2147483648.0;
+    return s >= 2147483647.0 ? 0x7FFFFFFF : (q31_t)llround(s);
+}
+
+/* mult_32x32_keep32: high word of the product, truncated */
+static inline q31_t host_mul_hi(q31_t x, q31_t y) {
+    return (q31_t)(((q63_t)x * y) >> 32);
+}
+
+/* mult / multAcc / multSub_32x32_keep32_R: high word, rounded */
+static inline q31_t host_mul_hi_r(q31_t a, q31_t x, q31_t y, int sign) {
+    return (q31_t)((((q63_t)a << 32) + sign * ((q63_t)x * y) + 0x80000000LL) >> 32);
+}
+
+/* Outputs 1..3 of a radix-4 butterfly: (r + j s) x (co - j si), << 1 in the first stage, >> 1 after */
+static inline void host_radix4_rotate(q31_t* p, uint32_t i, q31_t r, q31_t s, const q31_t* coef, bool first) {
+    q31_t re = host_mul_hi(r, coef[0]) + host_mul_hi(s, coef[1]);
+    q31_t im = host_mul_hi(s, coef[0]) - host_mul_hi(r, coef[1]);
+    p[2 * i] = first ? (q31_t)((uint32_t)re << 1) : re >> 1;
+    p[2 * i + 1] = first ? (q31_t)((uint32_t)im << 1) : im >> 1;
+}
+
+/* arm_radix4_butterfly_q31: in place, inputs >> 4 in the first stage and >> 2 in the middle stages,
+ * none in the last, output in bit-reversed order */
+static inline void host_radix4_q31(q31_t* p, uint32_t fftLen, const q31_t* coef, uint32_t modifier) {
+    for (uint32_t n1 = fftLen; n1 > 4; n1 >>= 2, modifier <<= 2) {
+        uint32_t n2 = n1 >> 2;
+        bool first = n1 == fftLen;
+        int shift = first ? 4 : 0;
+        for (uint32_t j = 0; j < n2; j++) {
+            const q31_t* co1 = &coef[2 * j * modifier];
+            const q31_t* co2 = &coef[4 * j * modifier];
+            const q31_t* co3 = &coef[6 * j * modifier];
+            for (uint32_t i0 = j; i0 < fftLen; i0 += n1) {
+                uint32_t i1 = i0 + n2, i2 = i1 + n2, i3 = i2 + n2;
+                q31_t r1 = (p[2 * i0] >> shift) + (p[2 * i2] >> shift);
+                q31_t r2 = (p[2 * i0] >> shift) - (p[2 * i2] >> shift);
+                q31_t s1 = (p[2 * i0 + 1] >> shift) + (p[2 * i2 + 1] >> shift);
+                q31_t s2 = (p[2 * i0 + 1] >> shift) - (p[2 * i2 + 1] >> shift);
+                q31_t t1 = (p[2 * i1] >> shift) + (p[2 * i3] >> shift);
+                q31_t t2 = (p[2 * i1 + 1] >> shift) + (p[2 * i3 + 1] >> shift);
+                p[2 * i0] = first ? r1 + t1 : (r1 + t1) >> 2;
+                p[2 * i0 + 1] = first ? s1 + t2 : (s1 + t2) >> 2;
+                r1 -= t1;
+                s1 -= t2;
+                t1 = (p[2 * i1 + 1] >> shift) - (p[2 * i3 + 1] >> shift);
+                t2 = (p[2 * i1] >> shift) - (p[2 * i3] >> shift);
+                host_radix4_rotate(p, i1, r1, s1, co2, first);
+                host_radix4_rotate(p, i2, r2 + t1, s2 - t2, co1, first);
+                host_radix4_rotate(p, i3, r2 - t1, s2 + t2, co3, first);
+            }
+        }
+    }
+
+    // Last stage, groups of four, no scaling
+    for (uint32_t i = 0; i < fftLen; i += 4) {
+        q31_t* g = &p[2 * i];
+        q31_t xa = g[0], ya = g[1], xb = g[2], yb = g[3], xc = g[4], yc = g[5], xd = g[6], yd = g[7];
+        g[0] = xa + xb + xc + xd;
+        g[1] = ya + yb + yc + yd;
+        g[2] = xa - xb + xc - xd;
+        g[3] = ya - yb + yc - yd;
+        g[4] = xa + yb - xc - yd;
+        g[5] = ya - xb - yc + xd;
+        g[6] = xa - yb - xc + yd;
+        g[7] = ya + xb - yc - xd;
+    }
+}
+
+static inline uint32_t host_bit_reverse(uint32_t i, uint32_t n) {
+    uint32_t r = 0;
+    for (uint32_t bit = n >> 1; bit; bit >>= 1, i >>= 1) r = (r << 1) | (i & 1);
+    return r;
+}
+
+/* arm_cfft_q31 (forward, bit reversal on): in place, natural order, output scaled down by fftLen */
+static inline void host_cfft_q31(q31_t* p, uint32_t fftLen, const q31_t* coef) {
+    std::vector<q31_t> x(p, p + 2 * fftLen);
+    uint32_t bits = 0;
+    while ((1u << bits) < fftLen) bits++;
+
+    if ((bits & 1) == 0) {
+        host_radix4_q31(x.data(), fftLen, coef, 1);
+        for (uint32_t i = 0; i < fftLen; i++) {
+            uint32_t k = host_bit_reverse(i, fftLen);
+            p[2 * k] = x[2 * i];
+            p[2 * k + 1] = x[2 * i + 1];
+        }
+        return;
+    }
+
+    // arm_cfft_radix4by2_q31: one radix-2 stage (inputs >> 2), two radix-4 halves, everything << 1
+    uint32_t n2 = fftLen >> 1;
+    for (uint32_t i = 0; i < n2; i++) {
+        uint32_t l = i + n2;
+        q31_t xt = (x[2 * i] >> 2) - (x[2 * l] >> 2);
+        q31_t yt = (x[2 * i + 1] >> 2) - (x[2 * l + 1] >> 2);
+        x[2 * i] = (x[2 * i] >> 2) + (x[2 * l] >> 2);
+        x[2 * i + 1] = (x[2 * i + 1] >> 2) + (x[2 * l + 1] >> 2);
+        q31_t p0 = host_mul_hi(xt, coef[2 * i]) + host_mul_hi(yt, coef[2 * i + 1]);
+        q31_t p1 = host_mul_hi(yt, coef[2 * i]) - host_mul_hi(xt, coef[2 * i + 1]);
+        x[2 * l] = (q31_t)((uint32_t)p0 << 1);
+        x[2 * l + 1] = (q31_t)((uint32_t)p1 << 1);
+    }
+    host_radix4_q31(x.data(), n2, coef, 2);
+    host_radix4_q31(x.data() + fftLen, n2, coef, 2);
+    // First half holds the even bins, second half the odd bins, each bit-reversed
+    for (uint32_t i = 0; i < n2; i++) {
+        uint32_t k = 2 * host_bit_reverse(i, n2);
+        p[2 * k] = (q31_t)((uint32_t)x[2 * i] << 1);
+        p[2 * k + 1] = (q31_t)((uint32_t)x[2 * i + 1] << 1);
+        p[2 * k + 2] = (q31_t)((uint32_t)x[2 * (n2 + i)] << 1);
+        p[2 * k + 3] = (q31_t)((uint32_t)x[2 * (n2 + i) + 1] << 1);
+    }
+}
+
+static inline arm_status arm_rfft_init_q31(arm_rfft_instance_q31* S, uint32_t fftLenReal, uint32_t ifftFlagR,
+                                           uint32_t bitReverseFlag) {
+    (void)ifftFlagR;
+    (void)bitReverseFlag;
+    if (fftLenReal < 32 || fftLenReal > 8192 || (fftLenReal & (fftLenReal - 1)) != 0) return ARM_MATH_ARGUMENT_ERROR;
+    S->fftLenReal = fftLenReal;
+    uint32_t half = fftLenReal / 2;
+    S->twiddle.resize(2 * half);
+    S->splitA.resize(2 * half);
+    S->splitB.resize(2 * half);
+    for (uint32_t i = 0; i < half; i++) {
+        S->twiddle[2 * i] = host_q31(cos(2.0 * M_PI * i / half));
+        S->twiddle[2 * i + 1] = host_q31(sin(2.0 * M_PI * i / half));
+        double c = cos(2.0 * M_PI * i / fftLenReal), s = sin(2.0 * M_PI * i / fftLenReal);
+        S->splitA[2 * i] = host_q31(0.5 * (1.0 - s));
+        S->splitA[2 * i + 1] = host_q31(-0.5 * c);
+        S->splitB[2 * i] = host_q31(0.5 * (1.0 + s));
+        S->splitB[2 * i + 1] = host_q31(0.5 * c);
+    }
+    return ARM_MATH_SUCCESS;
+}
+
+/* Forward transform, 1.31 in, output scaled down by fftLenReal, full complex spectrum.
+ * pSrc is scratch (the complex FFT runs in place on it), as on the target. */
+static inline void arm_rfft_q31(const arm_rfft_instance_q31* S, q31_t* pSrc, q31_t* pDst) {
+    const uint32_t n = S->fftLenReal, half = n / 2;
+    host_cfft_q31(pSrc, half, S->twiddle.data());
+
+    // arm_split_rfft_q31
+    for (uint32_t k = 1; k < half; k++) {
+        q31_t a1 = S->splitA[2 * k], a2 = S->splitA[2 * k + 1], b1 = S->splitB[2 * k];
+        q31_t zr = pSrc[2 * k], zi = pSrc[2 * k + 1];
+        q31_t yr = pSrc[2 * (half - k)], yi = pSrc[2 * (half - k) + 1];
+        q31_t outR = host_mul_hi_r(0, zr, a1, 1);
+        q31_t outI = host_mul_hi_r(0, zr, a2, 1);
+        outR = host_mul_hi_r(outR, zi, a2, -1);
+        outI = host_mul_hi_r(outI, zi, a1, 1);
+        outR = host_mul_hi_r(outR, yi, a2, -1);
+        outI = host_mul_hi_r(outI, yi, b1, -1);
+        outR = host_mul_hi_r(outR, yr, b1, 1);
+        outI = host_mul_hi_r(outI, yr, a2, -1);
+        pDst[2 * k] = outR;
+        pDst[2 * k + 1] = outI;
+        pDst[2 * (n - k)] = outR;
+        pDst[2 * (n - k) + 1] = -outI;
+    }
+    pDst[2 * half] = (pSrc[0] - pSrc[1]) >> 1;
+    pDst[2 * half + 1] = 0;
+    pDst[0] = (pSrc[0] + pSrc[1]) >> 1;
+    pDst[1] = 0;
+}
+
+static inline void arm_cmplx_mag_squared_q31(q31_t* pSrc, q31_t* pDst, uint32_t numSamples) {
+    for (uint32_t i = 0; i < numSamples; i++) {
+        q31_t re = pSrc[2 * i], im = pSrc[2 * i + 1];
+        pDst[i] = (q31_t)(((q63_t)re * re) >> 33) + (q31_t)(((q63_t)im * im) >> 33);
+    }
+}
+
+static inline void arm_mult_q31(q31_t* pSrcA, q31_t* pSrcB, q31_t* pDst, uint32_t blockSize) {
+    for (uint32_t i = 0; i < blockSize; i++) {
+        q63_t out = ((q63_t)pSrcA[i] * pSrcB[i]) >> 32;
+        if (out > 0x3FFFFFFF) out = 0x3FFFFFFF;
+        if (out < -0x40000000) out = -0x40000000;
+        pDst[i] = (q31_t)(out << 1);
+    }
+}
+
+static inline void arm_dot_prod_q31(q31_t* pSrcA, q31_t* pSrcB, uint32_t blockSize, q63_t* result) {
+    q63_t sum = 0;
+    for (uint32_t i = 0; i < blockSize; i++) sum += ((q63_t)pSrcA[i] * pSrcB[i]) >> 14;
+    *result = sum;
+}
+
+#endif /* HOST_ARM_MATH_H */
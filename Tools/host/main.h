@@ -0,0 +1,32 @@
+/**
+ * @file    main.h
+ * @brief   Host stand-in for the CubeMX main.h: the Cortex-M intrinsics of the portable modules
+ *
+ * Modules like agc.cpp and block_stats.cpp only need main.h for interrupt masking and memory
+ * barriers around their published state, and for a few CMSIS intrinsics. Host tools put this
+ * directory in front of the include path and call those modules from one thread, so masking is
+ * a no-op and a barrier only stops the compiler from reordering.
+ */
+
+#ifndef HOST_MAIN_H
+#define HOST_MAIN_H
+
+#include <stdint.h>
+
+static inline uint32_t __get_PRIMASK(void) { return 0; }
+static inline void __set_PRIMASK(uint32_t primask) { (void)primask; }
+static inline void __disable_irq(void) {}
+static inline void __enable_irq(void) {}
+static inline void __DMB(void) { __asm__ volatile("" : : : "memory"); }
+
+/* Leading zeros, 32 for 0 like the CLZ instruction */
+static inline uint32_t __CLZ(uint32_t value) { return value ? (uint32_t)__builtin_clz(value) : 32u; }
+
+/* Saturate to a signed range of bits, like SSAT */
+static inline int32_t __SSAT(int32_t value, uint32_t bits) {
+    const int32_t high = (int32_t)((1u << (bits - 1)) - 1);
+    const int32_t low = -high - 1;
+    return value > high ? high : (value < low ? low : value);
+}
+
+#endif /* HOST_MAIN_H */
@@ -0,0 +1,93 @@
+// Minimal PCM WAV reader/writer
+
+#include "wav.h"
+#include <cstdio>
+#include <cstring>
+
+static const int FIRMWARE_BITS = 18;
+
+static uint32_t le32(const uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+static uint16_t le16(const uint8_t* p) { return p[0] | (p[1] << 8); }
+
+bool wavRead(const std::string& path, std::vector<int32_t>& samples, WavInfo* info) {
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return false;
+
+    std::vector<uint8_t> data;
+    uint8_t buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) data.insert(data.end(), buf, buf + n);
+    fclose(f);
+
+    if (data.size() < 12 || memcmp(&data[0], "RIFF", 4) != 0 || memcmp(&data[8], "WAVE", 4) != 0) return false;
+
+    WavInfo fmt;
+    uint16_t format = 0;
+    size_t pos = 12;
+    while (pos + 8 <= data.size()) {
+        uint32_t size = le32(&data[pos + 4]);
+        const uint8_t* body = &data[pos + 8];
+        if (pos + 8 + size > data.size()) size = (uint32_t)(data.size() - pos - 8);
+
+        if (memcmp(&data[pos], "fmt ", 4) == 0 && size >= 16) {
+            format = le16(body);
+            fmt.channels = le16(body + 2);
+            fmt.sampleRate = le32(body + 4);
+            fmt.bitsPerSample = le16(body + 14);
+            if (format == 0xFFFE && size >= 26) format = le16(body + 24);  // WAVE_FORMAT_EXTENSIBLE
+        } else if (memcmp(&data[pos], "data", 4) == 0) {
+            if (format != 1 || fmt.channels == 0) return false;
+            int bytes = fmt.bitsPerSample / 8;
+            if (bytes < 2 || bytes > 4) return false;
+
+            size_t frame = (size_t)bytes * fmt.channels;
+            size_t count = size / frame;
+            samples.resize(count);
+            for (size_t i = 0; i < count; i++) {
+                const uint8_t* s = body + i * frame;
+                uint32_t v = 0;
+                for (int b = 0; b < bytes; b++) v |= (uint32_t)s[b] << (8 * b + (32 - 8 * bytes));
+                samples[i] = (int32_t)v >> (32 - FIRMWARE_BITS);  // sign-extend and scale to 18 bit
+            }
+            if (info) *info = fmt;
+            return true;
+        }
+        pos += 8 + size + (size & 1);
+    }
+    return false;
+}
+
+bool wavWrite(const std::string& path, const std::vector<int32_t>& samples,
+              uint32_t sampleRate, uint16_t bitsPerSample) {
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) return false;
+
+    const int bytes = bitsPerSample / 8;
+    const uint32_t dataSize = (uint32_t)(samples.size() * bytes);
+    uint8_t header[44];
+    auto put32 = [&](int at, uint32_t v) { for (int b = 0; b < 4; b++) header[at + b] = (uint8_t)(v >> (8 * b)); };
+    auto put16 = [&](int at, uint16_t v) { header[at] = (uint8_t)v; header[at + 1] = (uint8_t)(v >> 8); };
+
+    memcpy(header, "RIFF", 4);
+    put32(4, 36 + dataSize);
+    memcpy(header + 8, "WAVEfmt ", 8);
+    put32(16, 16);
+    put16(20, 1);
+    put16(22, 1);
+    put32(24, sampleRate);
+    put32(28, sampleRate * bytes);
+    put16(32, (uint16_t)bytes);
+    put16(34, bitsPerSample);
+    memcpy(header + 36, "data", 4);
+    put32(40, dataSize);
+    fwrite(header, 1, sizeof(header), f);
+
+    std::vector<uint8_t> out(dataSize);
+    for (size_t i = 0; i < samples.size(); i++) {
+        uint32_t v = (uint32_t)samples[i] << (32 - FIRMWARE_BITS);  // left-justify, then keep the top bytes
+        for (int b = 0; b < bytes; b++) out[i * bytes + b] = (uint8_t)(v >> (32 - 8 * bytes + 8 * b));
+    }
+    bool ok = fwrite(out.data(), 1, out.size(), f) == out.size();
+    fclose(f);
+    return ok;
+}
@@ -0,0 +1,34 @@
+/**
+ * @file    wav.h
+ * @brief   Minimal PCM WAV reader/writer for host tools
+ *
+ * Samples are exchanged in the firmware's 18-bit scale (see HAL_I2S_RxHalfCpltCallback),
+ * so recordings and firmware buffers can be compared directly.
+ */
+
+#ifndef HOST_WAV_H
+#define HOST_WAV_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct WavInfo {
+    uint32_t sampleRate = 0;
+    uint16_t channels = 0;
+    uint16_t bitsPerSample = 0;
+};
+
+/**
+ * Reads a 16/24/32-bit PCM WAV file, first channel only.
+ * Samples are rescaled to 18 bit. Returns false on I/O or format errors.
+ */
+bool wavRead(const std::string& path, std::vector<int32_t>& samples, WavInfo* info = nullptr);
+
+/**
+ * Writes 18-bit samples as a mono WAV file with the given sample width (16 or 24 bit).
+ */
+bool wavWrite(const std::string& path, const std::vector<int32_t>& samples,
+              uint32_t sampleRate, uint16_t bitsPerSample = 24);
+
+#endif /* HOST_WAV_H */
@@ -0,0 +1,293 @@
+// kernel_bench - host runner of the firmware kernel microbenchmarks (Core/Src/kernel_bench.h)
+//
+// Times the shared DSP kernels and the reference network layers (Tools/kws_eval) with the
+// steady clock and prints a Google Benchmark style table. The firmware runs the same kernel
+// table with DWT cycles in its benchmark mode (Core/Src/benchmark.h).
+//
+// Usage:
+//   kernel_bench [--benchmark_filter=<regex>] [--benchmark_min_time=<s>] [--benchmark_repetitions=<n>]
+//                [--save <file>] [--compare <file>] [--tolerance <fraction>]
+//   kernel_bench --budgets <benchmark log> --write <kernel_budgets.h> [--headroom <fraction>]
+//
+// Each kernel runs in batches until a batch takes --benchmark_min_time (default 0.1 s), the
+// batch is repeated --benchmark_repetitions times (default 5) and the fastest is reported.
+// --save writes "<name> <ns per run>" lines; --compare reads such a file (a baseline from the
+// previous build on the same machine) and fails with exit code 1 if a kernel got slower by more
+// than --tolerance (default 0.10). `make check` does this against baseline.txt, `make baseline`
+// records it. Run both on an otherwise idle machine: a loaded or frequency-scaling CPU moves the
+// short kernels by more than the tolerance.
+//
+// --budgets converts the UART log of a board run in benchmark mode (Core/Src/benchmark.h) into
+// Core/Src/kernel_budgets.h: every kernel and layer of the tables gets the measured minimum plus
+// --headroom (default 0.15) as its target budget, 0 if the log does not have it.
+
+#include "kernel_bench.h"
+#include "feature_extraction.h"
+#include "agc.h"
+#include "reference_network.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <map>
+#include <regex>
+#include <string>
+#include <vector>
+
+struct Benchmark {
+    std::string name;
+    std::string unit;
+    uint32_t items;
+    void (*run)(void);
+};
+
+struct Measurement {
+    double ns;        // Wall time per run, fastest repetition
+    double cpuNs;     // Process CPU time per run, same repetition
+    uint64_t iterations;
+};
+
+// REFERENCE NETWORK LAYERS (names from KernelBench_Layers)
+static ReferenceNetwork* network = nullptr;
+static ReferenceNetwork::Activations* activations = nullptr;
+static float networkInput[REF_IN_SIZE];
+
+static void runConv2d0(void) { network->conv2d0(networkInput, *activations); }
+static void runConv2d1(void) { network->conv2d1(*activations); }
+static void runConv2d2(void) { network->conv2d2(*activations); }
+static void runGemm5(void) { network->gemm5(*activations); }
+
+static void (*layerRunner(const char* name))(void) {
+    if (!strcmp(name, "conv2d_0")) return runConv2d0;
+    if (!strcmp(name, "conv2d_1")) return runConv2d1;
+    if (!strcmp(name, "conv2d_2")) return runConv2d2;
+    if (!strcmp(name, "gemm_5")) return runGemm5;
+    return nullptr;
+}
+
+static double cpuSeconds() {
+    timespec t;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static Measurement measure(void (*run)(void), double minTime, int repetitions) {
+    typedef std::chrono::steady_clock Clock;
+    // Batch size: grow until one batch takes minTime
+    uint64_t iterations = 1;
+    for (;;) {
+        Clock::time_point start = Clock::now();
+        for (uint64_t i = 0; i < iterations; i++) run();
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        if (seconds >= minTime) break;
+        double factor = seconds > 0.0 ? 1.4 * minTime / seconds : 10.0;
+        iterations = (uint64_t)(iterations * (factor < 10.0 ? factor : 10.0)) + 1;
+    }
+
+    Measurement best = { 0.0, 0.0, iterations };
+    for (int r = 0; r < repetitions; r++) {
+        double cpuStart = cpuSeconds();
+        Clock::time_point start = Clock::now();
+        for (uint64_t i = 0; i < iterations; i++) run();
+        double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / iterations;
+        double cpuNs = (cpuSeconds() - cpuStart) * 1e9 / iterations;
+        if (r == 0 || ns < best.ns) {
+            best.ns = ns;
+            best.cpuNs = cpuNs;
+        }
+    }
+    return best;
+}
+
+static std::map<std::string, double> loadBaseline(const std::string& path) {
+    std::map<std::string, double> baseline;
+    std::ifstream in(path);
+    std::string name;
+    double ns;
+    while (in >> name >> ns) baseline[name] = ns;
+    return baseline;
+}
+
+static std::string humanRate(double perSecond) {
+    static const char* const prefixes[] = { "", "k", "M", "G" };
+    int p = 0;
+    while (perSecond >= 1000.0 && p < 3) {
+        perSecond /= 1000.0;
+        p++;
+    }
+    char text[32];
+    snprintf(text, sizeof(text), "%.4g%s/s", perSecond, prefixes[p]);
+    return text;
+}
+
+// Value of key=<value> in a [BENCH] line, quotes stripped, empty if absent
+static std::string benchField(const std::string& line, const char* key) {
+    std::string k = std::string(" ") + key + "=";
+    size_t at = line.find(k);
+    if (at == std::string::npos) return "";
+    at += k.size();
+    if (at < line.size() && line[at] == '"') {
+        size_t end = line.find('"', at + 1);
+        return line.substr(at + 1, end == std::string::npos ? std::string::npos : end - at - 1);
+    }
+    size_t end = line.find_first_of(" \r\n", at);
+    return line.substr(at, end == std::string::npos ? std::string::npos : end - at);
+}
+
+static void writeBudget(FILE* f, const char* name, const std::map<std::string, uint32_t>& measured,
+                        double headroom) {
+    std::string macro = "KERNEL_BUDGET_";
+    for (const char* c = name; *c; c++) macro += (char)toupper((unsigned char)*c);
+    std::map<std::string, uint32_t>::const_iterator m = measured.find(name);
+    unsigned long budget = m == measured.end() ? 0 : (unsigned long)ceil(m->second * (1.0 + headroom));
+    if (m == measured.end()) fprintf(stderr, "%s: not in the log, no budget\n", name);
+    fprintf(f, "#define %-31s %lu\n", macro.c_str(), budget);
+}
+
+static int writeBudgets(const std::string& logPath, const std::string& outPath, double headroom) {
+    std::ifstream in(logPath);
+    if (!in) {
+        fprintf(stderr, "cannot read %s\n", logPath.c_str());
+        return 2;
+    }
+    std::map<std::string, uint32_t> measured;
+    std::string line, build, hclk;
+    while (std::getline(in, line)) {
+        if (line.find("[BENCH]") == std::string::npos) continue;
+        if (!benchField(line, "format").empty()) {
+            build = benchField(line, "build");
+            hclk = benchField(line, "hclk");
+        }
+        std::string name = benchField(line, "kernel"), min = benchField(line, "min");
+        if (!name.empty() && !min.empty()) measured[name] = (uint32_t)strtoul(min.c_str(), nullptr, 10);
+    }
+    if (measured.empty()) {
+        fprintf(stderr, "no [BENCH] kernel lines in %s\n", logPath.c_str());
+        return 2;
+    }
+
+    FILE* f = fopen(outPath.c_str(), "w");
+    if (!f) {
+        fprintf(stderr, "cannot write %s\n", outPath.c_str());
+        return 2;
+    }
+    fprintf(f, "/**\n * @file    kernel_budgets.h\n"
+               " * @brief   Target cycle budgets of the kernel benchmarks (see kernel_bench.h), 0 = no budget\n *\n");
+    fprintf(f, " * Generated by: kernel_bench --budgets <benchmark log> --write kernel_budgets.h\n");
+    fprintf(f, " * Board run:    build \"%s\", hclk %s Hz, measured minimum + %.0f %%\n */\n\n",
+            build.c_str(), hclk.c_str(), 100.0 * headroom);
+    fprintf(f, "#ifndef KERNEL_BUDGETS_H\n#define KERNEL_BUDGETS_H\n\n");
+    uint32_t count;
+    const KernelBenchKernel* kernels = KernelBench_Kernels(&count);
+    for (uint32_t k = 0; k < count; k++) writeBudget(f, kernels[k].name, measured, headroom);
+    const KernelBenchLayer* layers = KernelBench_Layers(&count);
+    for (uint32_t l = 0; l < count; l++) writeBudget(f, layers[l].name, measured, headroom);
+    fprintf(f, "\n#endif /* KERNEL_BUDGETS_H */\n");
+    fclose(f);
+    printf("%zu measurements from %s written to %s\n", measured.size(), logPath.c_str(), outPath.c_str());
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    std::string filter = ".*", savePath, comparePath, budgetLog, budgetOut;
+    double minTime = 0.1, tolerance = 0.10, headroom = 0.15;
+    int repetitions = 5;
+    bool usage = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strncmp(argv[i], "--benchmark_filter=", 19)) filter = argv[i] + 19;
+        else if (!strncmp(argv[i], "--benchmark_min_time=", 21)) minTime = atof(argv[i] + 21);
+        else if (!strncmp(argv[i], "--benchmark_repetitions=", 24)) repetitions = atoi(argv[i] + 24);
+        else if (!strcmp(argv[i], "--save") && i + 1 < argc) savePath = argv[++i];
+        else if (!strcmp(argv[i], "--compare") && i + 1 < argc) comparePath = argv[++i];
+        else if (!strcmp(argv[i], "--tolerance") && i + 1 < argc) tolerance = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--budgets") && i + 1 < argc) budgetLog = argv[++i];
+        else if (!strcmp(argv[i], "--write") && i + 1 < argc) budgetOut = argv[++i];
+        else if (!strcmp(argv[i], "--headroom") && i + 1 < argc) headroom = atof(argv[++i]);
+        else usage = true;
+    }
+    if (usage || budgetLog.empty() != budgetOut.empty()) {
+        fprintf(stderr, "usage: %s [--benchmark_filter=<regex>] [--benchmark_min_time=<s>] "
+                        "[--benchmark_repetitions=<n>]\n"
+                        "       [--save <file>] [--compare <file>] [--tolerance <fraction>]\n"
+                        "       %s --budgets <benchmark log> --write <kernel_budgets.h> [--headroom <fraction>]\n",
+                argv[0], argv[0]);
+        return 2;
+    }
+    if (!budgetLog.empty()) return writeBudgets(budgetLog, budgetOut, headroom);
+    if (repetitions < 1) repetitions = 1;
+
+    Features_Init();
+    Agc_Init();
+    std::vector<uint32_t> scratch(KERNEL_BENCH_SCRATCH_BYTES / sizeof(uint32_t));
+    KernelBench_Setup(scratch.data());
+
+    // Network input: the features of the test recording, as on the target
+    std::vector<int32_t> recording(16000);
+    KernelBench_TestVector(recording.data(), 0, (uint32_t)recording.size());
+    Features_Compute(recording.data(), networkInput);
+    network = new ReferenceNetwork();
+    activations = new ReferenceNetwork::Activations();
+    // Every layer reads the tensor of the previous one
+    network->conv2d0(networkInput, *activations);
+    network->conv2d1(*activations);
+    network->conv2d2(*activations);
+
+    std::vector<Benchmark> benchmarks;
+    uint32_t count;
+    const KernelBenchKernel* kernels = KernelBench_Kernels(&count);
+    for (uint32_t k = 0; k < count; k++) {
+        benchmarks.push_back({ kernels[k].name, kernels[k].unit, kernels[k].items, kernels[k].run });
+    }
+    const KernelBenchLayer* layers = KernelBench_Layers(&count);
+    for (uint32_t l = 0; l < count; l++) {
+        void (*run)(void) = layerRunner(layers[l].name);
+        if (run) benchmarks.push_back({ layers[l].name, "macc", layers[l].macc, run });
+    }
+
+    std::regex pattern(filter);
+    std::map<std::string, double> baseline;
+    if (!comparePath.empty()) {
+        baseline = loadBaseline(comparePath);
+        if (baseline.empty()) {
+            fprintf(stderr, "no baseline in %s\n", comparePath.c_str());
+            return 2;
+        }
+    }
+
+    const char* rule = "------------------------------------------------------------------------------";
+    printf("%s\n%-24s %13s %13s %12s\n%s\n", rule, "Benchmark", "Time", "CPU", "Iterations", rule);
+    FILE* save = savePath.empty() ? nullptr : fopen(savePath.c_str(), "w");
+    if (!savePath.empty() && !save) {
+        fprintf(stderr, "cannot write %s\n", savePath.c_str());
+        return 2;
+    }
+    int regressions = 0;
+    for (const Benchmark& b : benchmarks) {
+        if (!std::regex_search(b.name, pattern)) continue;
+        Measurement m = measure(b.run, minTime, repetitions);
+        printf("%-24s %10.0f ns %10.0f ns %12llu %s_per_second=%s", b.name.c_str(), m.ns, m.cpuNs,
+               (unsigned long long)m.iterations, b.unit.c_str(), humanRate(b.items * 1e9 / m.ns).c_str());
+        if (save) fprintf(save, "%s %.1f\n", b.name.c_str(), m.ns);
+
+        std::map<std::string, double>::const_iterator base = baseline.find(b.name);
+        if (base != baseline.end()) {
+            double change = m.ns / base->second - 1.0;
+            bool slower = change > tolerance;
+            if (slower) regressions++;
+            printf("  %+.1f %%%s", 100.0 * change, slower ? "  REGRESSION" : "");
+        }
+        printf("\n");
+    }
+    if (save) fclose(save);
+
+    if (!comparePath.empty()) {
+        printf("%s\n%d regression(s) beyond %.0f %% against %s\n", rule, regressions, 100.0 * tolerance,
+               comparePath.c_str());
+    }
+    return regressions ? 1 : 0;
+}
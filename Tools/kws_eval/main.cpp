@@ -0,0 +1,301 @@
+// kws_eval - host accuracy/throughput evaluation of the KWS pipeline
+//
+// Runs the firmware front-end and decision stage (Core/Src/feature_extraction.cpp,
+// kws_decision.cpp) and a reference implementation of the generated network over a clip set,
+// in parallel on all cores.
+//
+// Usage:
+//   kws_eval [-j threads] [-t network_threshold]
+//            [--calibrate out.h] [-p target_precision] <dataset>
+//
+// <dataset> is either a directory in Speech Commands layout (<label>/<clip>.wav) or a manifest
+// file with one "<path> <label>" per line. Labels that are not model classes (silence, unknown,
+// _background_noise_, ...) are expected to be rejected and are scored as "none".
+//
+// --calibrate writes a new Core/Src/kws_calibration.h: for every command class the threshold /
+// margin pair with the best recall at the target precision, and a silence floor below 99 % of
+// the labeled words.
+
+#include "feature_extraction.h"
+#include "kws.h"
+#include "kws_calibration.h"
+#include "kws_decision.h"
+#include "kws_labels.h"
+#include "reference_network.h"
+#include "work_stealing_pool.h"
+#include "wav.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static const int CLIP_SAMPLES = 16000;
+static const int NONE_CLASS = KWS_NUM_LABELS;      // rejected / not a model class
+static const int NUM_CLASSES = KWS_NUM_LABELS + 1;
+
+struct Clip {
+    std::string path;
+    int label;
+};
+
+// Per-clip result, written by exactly one worker
+struct ClipRecord {
+    bool readable = false;
+    bool silent = false;         // below the silence floor, stage 2 did not run
+    int predicted = NONE_CLASS;  // argmax of the network, NONE_CLASS if stage 2 did not run
+    float meanLogEnergy = 0.0f;
+    KwsDecision decision = {};
+};
+
+static int labelIndex(const std::string& name) {
+    for (int i = 0; i < KWS_NUM_LABELS; i++) {
+        if (name == kwsLabelNames[i]) return i;
+    }
+    return NONE_CLASS;
+}
+
+static const char* className(int c) {
+    return c == NONE_CLASS ? "none" : kwsLabelNames[c];
+}
+
+static bool loadDataset(const std::string& source, std::vector<Clip>& clips) {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+
+    if (fs::is_directory(source, ec)) {
+        for (const fs::directory_entry& dir : fs::directory_iterator(source, ec)) {
+            if (!dir.is_directory()) continue;
+            int label = labelIndex(dir.path().filename().string());
+            for (const fs::directory_entry& file : fs::recursive_directory_iterator(dir.path(), ec)) {
+                if (file.is_regular_file() && file.path().extension() == ".wav") {
+                    clips.push_back({ file.path().string(), label });
+                }
+            }
+        }
+    } else {
+        std::ifstream manifest(source);
+        if (!manifest) return false;
+        std::string line;
+        while (std::getline(manifest, line)) {
+            std::istringstream fields(line);
+            std::string path, label;
+            if (fields >> path >> label) clips.push_back({ path, labelIndex(label) });
+        }
+    }
+
+    // Deterministic order independent of directory iteration
+    std::sort(clips.begin(), clips.end(), [](const Clip& a, const Clip& b) { return a.path < b.path; });
+    return !clips.empty();
+}
+
+// Same flow as Kws_Step
+static void classify(const ReferenceNetwork& net, const std::vector<int32_t>& samples,
+                     float networkThreshold, ClipRecord& record) {
+    float features[FEATURES_SIZE];
+    Features_Compute(samples.data(), features);
+
+    record.meanLogEnergy = KwsDecision_MeanLogEnergy(features);
+    record.decision.type = KWS_DECISION_SILENCE;
+    record.decision.label = -1;
+    record.silent = KwsDecision_IsSilent(record.meanLogEnergy);
+    if (record.silent) return;
+
+    float logits[REF_OUT_SIZE];
+    net.run(features, logits);
+    KwsDecision_Decide(logits, record.meanLogEnergy, networkThreshold, &record.decision);
+    record.predicted = record.decision.best;
+}
+
+static void printModelReport(const std::vector<Clip>& clips, const std::vector<ClipRecord>& records) {
+    std::vector<uint64_t> m(NUM_CLASSES * NUM_CLASSES, 0);  // [truth][predicted]
+    size_t scored = 0, silent = 0;
+    for (size_t i = 0; i < clips.size(); i++) {
+        if (!records[i].readable) continue;
+        scored++;
+        if (records[i].silent) silent++;
+        m[clips[i].label * NUM_CLASSES + records[i].predicted]++;
+    }
+
+    printf("\nConfusion matrix, network argmax (rows: truth, columns: predicted)\n%8s", "");
+    for (int p = 0; p < NUM_CLASSES; p++) printf(" %6.6s", className(p));
+    printf("\n");
+    for (int t = 0; t < NUM_CLASSES; t++) {
+        printf("%8.8s", className(t));
+        for (int p = 0; p < NUM_CLASSES; p++) printf(" %6llu", (unsigned long long)m[t * NUM_CLASSES + p]);
+        printf("\n");
+    }
+
+    printf("\n%-8s %9s %9s %9s\n", "class", "precision", "recall", "support");
+    uint64_t correct = 0;
+    for (int c = 0; c < NUM_CLASSES; c++) {
+        uint64_t tp = m[c * NUM_CLASSES + c], predicted = 0, support = 0;
+        for (int k = 0; k < NUM_CLASSES; k++) {
+            predicted += m[k * NUM_CLASSES + c];
+            support += m[c * NUM_CLASSES + k];
+        }
+        correct += tp;
+        if (support == 0 && predicted == 0) continue;
+        printf("%-8s %9.3f %9.3f %9llu\n", className(c),
+               predicted ? (double)tp / predicted : 0.0,
+               support ? (double)tp / support : 0.0, (unsigned long long)support);
+    }
+
+    printf("\naccuracy:        %.4f (%zu clips, %zu unreadable)\n",
+           scored ? (double)correct / scored : 0.0, scored, clips.size() - scored);
+    printf("silent:          %.2f %%\n", scored ? 100.0 * silent / scored : 0.0);
+}
+
+static void printDecisionReport(const std::vector<Clip>& clips, const std::vector<ClipRecord>& records) {
+    printf("\nDecision stage (commands only)\n%-8s %9s %9s %12s\n", "command", "precision", "recall", "false/1000");
+    for (int c = 0; c < KWS_NUM_LABELS; c++) {
+        if (!kwsCalibration[c].command) continue;
+        uint64_t tp = 0, fp = 0, fn = 0, negatives = 0;
+        for (size_t i = 0; i < clips.size(); i++) {
+            if (!records[i].readable) continue;
+            bool fired = records[i].decision.label == c;
+            bool truth = clips[i].label == c;
+            if (truth) (fired ? tp : fn)++;
+            else { negatives++; if (fired) fp++; }
+        }
+        printf("%-8s %9.3f %9.3f %12.2f\n", className(c),
+               tp + fp ? (double)tp / (tp + fp) : 0.0,
+               tp + fn ? (double)tp / (tp + fn) : 0.0,
+               negatives ? 1000.0 * fp / negatives : 0.0);
+    }
+}
+
+static bool writeCalibration(const std::string& path, const std::string& corpus,
+                             const std::vector<Clip>& clips, const std::vector<ClipRecord>& records,
+                             double targetPrecision) {
+    KwsClassCalibration table[KWS_NUM_LABELS];
+    for (int c = 0; c < KWS_NUM_LABELS; c++) table[c] = kwsCalibration[c];
+
+    for (int c = 0; c < KWS_NUM_LABELS; c++) {
+        if (!table[c].command) continue;
+
+        // Best recall at the target precision; ties go to the stricter setting
+        double bestRecall = -1.0;
+        for (int t = 30; t <= 99; t++) {
+            for (int mg = 0; mg <= 50; mg += 5) {
+                float threshold = t / 100.0f, margin = mg / 100.0f;
+                uint64_t tp = 0, fp = 0, positives = 0;
+                for (size_t i = 0; i < clips.size(); i++) {
+                    const ClipRecord& r = records[i];
+                    if (!r.readable) continue;
+                    if (clips[i].label == c) positives++;
+                    if (r.silent || r.decision.best != c) continue;
+                    if (r.decision.probability < threshold || r.decision.margin < margin) continue;
+                    (clips[i].label == c ? tp : fp)++;
+                }
+                if (positives == 0 || tp + fp == 0) continue;
+                double precision = (double)tp / (tp + fp), recall = (double)tp / positives;
+                if (precision >= targetPrecision && recall > bestRecall) {
+                    bestRecall = recall;
+                    table[c].threshold = threshold;
+                    table[c].margin = margin;
+                }
+            }
+        }
+        if (bestRecall < 0.0) {
+            fprintf(stderr, "warning: %s never reaches precision %.3f, using 0.99 / 0.50\n", className(c), targetPrecision);
+            table[c].threshold = 0.99f;
+            table[c].margin = 0.50f;
+        }
+    }
+
+    // Silence floor: below 99 % of the labeled words
+    std::vector<float> energies;
+    for (size_t i = 0; i < clips.size(); i++) {
+        if (records[i].readable && clips[i].label != NONE_CLASS) energies.push_back(records[i].meanLogEnergy);
+    }
+    if (energies.empty()) {
+        fprintf(stderr, "no labeled words in the corpus, the silence floor needs them\n");
+        return false;
+    }
+    std::sort(energies.begin(), energies.end());
+    float silence = energies[energies.size() / 100] - 0.5f;
+
+    FILE* f = fopen(path.c_str(), "w");
+    if (!f) {
+        fprintf(stderr, "cannot write %s\n", path.c_str());
+        return false;
+    }
+    fprintf(f, "/**\n * @file    kws_calibration.h\n * @brief   Decision thresholds per class (see kws_decision.h)\n *\n");
+    fprintf(f, " * Generated by: kws_eval --calibrate kws_calibration.h <corpus>\n");
+    fprintf(f, " * Corpus:       %s (%zu clips, target precision %.3f)\n */\n\n", corpus.c_str(), clips.size(), targetPrecision);
+    fprintf(f, "#ifndef KWS_CALIBRATION_H\n#define KWS_CALIBRATION_H\n\n#include \"kws_decision.h\"\n#include \"kws_labels.h\"\n\n");
+    fprintf(f, "/* 1 = generated from a labeled corpus, the decision stage is on */\n#define KWS_CALIBRATED 1\n\n");
+    fprintf(f, "/* Windows with a lower mean log mel energy are silence */\n#define KWS_SILENCE_LOG_ENERGY (%.2ff)\n\n", silence);
+    fprintf(f, "static const KwsClassCalibration kwsCalibration[KWS_NUM_LABELS] = {\n");
+    for (int c = 0; c < KWS_NUM_LABELS; c++) {
+        fprintf(f, "    { %-6s %.2ff, %.2ff },  /* %s */\n", table[c].command ? "true," : "false,",
+                table[c].threshold, table[c].margin, className(c));
+    }
+    fprintf(f, "};\n\n#endif /* KWS_CALIBRATION_H */\n");
+    fclose(f);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    unsigned threads = 0;
+    float networkThreshold = KWS_NETWORK_THRESHOLD;
+    double targetPrecision = 0.995;
+    std::string dataset, calibrationOut;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-j") && i + 1 < argc) threads = (unsigned)atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-t") && i + 1 < argc) networkThreshold = (float)atof(argv[++i]);
+        else if (!strcmp(argv[i], "-p") && i + 1 < argc) targetPrecision = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--calibrate") && i + 1 < argc) calibrationOut = argv[++i];
+        else dataset = argv[i];
+    }
+    if (dataset.empty()) {
+        fprintf(stderr, "usage: %s [-j threads] [-t network_threshold]\n"
+                        "       [--calibrate out.h] [-p target_precision] <dir|manifest>\n", argv[0]);
+        return 2;
+    }
+
+    std::vector<Clip> clips;
+    if (!loadDataset(dataset, clips)) {
+        fprintf(stderr, "no clips found in %s\n", dataset.c_str());
+        return 1;
+    }
+
+    // Calibration needs the raw probabilities, so no global floor there
+    if (!calibrationOut.empty()) networkThreshold = 0.0f;
+
+    Features_Init();
+    const ReferenceNetwork net;
+    WorkStealingPool pool(threads);
+    std::vector<ClipRecord> records(clips.size());
+
+    auto start = std::chrono::steady_clock::now();
+    pool.parallelFor(clips.size(), 64, [&](size_t begin, size_t end, unsigned) {
+        std::vector<int32_t> samples;
+        for (size_t i = begin; i < end; i++) {
+            if (!wavRead(clips[i].path, samples)) continue;
+            samples.resize(CLIP_SAMPLES, 0);
+            records[i].readable = true;
+            classify(net, samples, networkThreshold, records[i]);
+        }
+    });
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printModelReport(clips, records);
+    printDecisionReport(clips, records);
+    printf("throughput:      %.1f clips/s (%u threads, %.2f s)\n", clips.size() / seconds, pool.workers(), seconds);
+
+    if (!calibrationOut.empty()) {
+        if (!writeCalibration(calibrationOut, dataset, clips, records, targetPrecision)) return 1;
+        printf("calibration written to %s\n", calibrationOut.c_str());
+    }
+    return 0;
+}
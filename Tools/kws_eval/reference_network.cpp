@@ -0,0 +1,140 @@
+// Host reference implementation of the generated "network" model
+
+#include "reference_network.h"
+#include "network_data.h"
+#include <cstring>
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#endif
+
+// Byte offsets of the tensors in the weights array (network.c, ai_network_configure_weights)
+static const int CONV0_W = 0;
+static const int CONV0_B = 10240;
+static const int CONV1_W = 10496;
+static const int CONV1_B = 12800;
+static const int CONV2_W = 13056;
+static const int CONV2_B = 15104;
+static const int GEMM5_W = 15136;
+static const int GEMM5_B = 23776;
+
+static const float* tensorAt(int byteOffset) {
+    return reinterpret_cast<const float*>(
+        reinterpret_cast<const unsigned char*>(s_network_weights_array_u64) + byteOffset);
+}
+
+// acc[0..n) += x * w[0..n), n multiple of 8
+static inline void madd(float* acc, float x, const float* w, int n) {
+#if defined(__AVX2__) && defined(__FMA__)
+    __m256 vx = _mm256_set1_ps(x);
+    for (int i = 0; i < n; i += 8) {
+        _mm256_store_ps(&acc[i], _mm256_fmadd_ps(vx, _mm256_load_ps(&w[i]), _mm256_load_ps(&acc[i])));
+    }
+#else
+    for (int i = 0; i < n; i++) acc[i] += x * w[i];
+#endif
+}
+
+// acc[0..n) += a[0..n) * w[0..n), n multiple of 8 (acc aligned, a and w aligned)
+static inline void mulAdd(float* acc, const float* a, const float* w, int n) {
+#if defined(__AVX2__) && defined(__FMA__)
+    for (int i = 0; i < n; i += 8) {
+        _mm256_store_ps(&acc[i], _mm256_fmadd_ps(_mm256_load_ps(&a[i]), _mm256_load_ps(&w[i]), _mm256_load_ps(&acc[i])));
+    }
+#else
+    for (int i = 0; i < n; i++) acc[i] += a[i] * w[i];
+#endif
+}
+
+static inline void relu(float* x, int n) {
+    for (int i = 0; i < n; i++) x[i] = x[i] > 0.0f ? x[i] : 0.0f;
+}
+
+ReferenceNetwork::ReferenceNetwork() {
+    // conv2d_0: generated layout [oc][kh][kw][ic=1]
+    const float* src = tensorAt(CONV0_W);
+    for (int oc = 0; oc < 64; oc++)
+        for (int k = 0; k < 40; k++)
+            w0[k * 64 + oc] = src[oc * 40 + k];
+    memcpy(b0, tensorAt(CONV0_B), sizeof(b0));
+
+    // conv2d_1 (depthwise): generated layout [kh][kw][c]
+    memcpy(w1, tensorAt(CONV1_W), sizeof(w1));
+    memcpy(b1, tensorAt(CONV1_B), sizeof(b1));
+
+    // conv2d_2: generated layout [oc][ic]
+    src = tensorAt(CONV2_W);
+    for (int oc = 0; oc < 8; oc++)
+        for (int ic = 0; ic < 64; ic++)
+            w2[ic * 8 + oc] = src[oc * 64 + ic];
+    memcpy(b2, tensorAt(CONV2_B), sizeof(b2));
+
+    // gemm_5: generated layout [out][in]
+    src = tensorAt(GEMM5_W);
+    memset(w5, 0, sizeof(w5));
+    memset(b5, 0, sizeof(b5));
+    for (int o = 0; o < REF_OUT_SIZE; o++)
+        for (int i = 0; i < 72; i++)
+            w5[i * 32 + o] = src[o * 72 + i];
+    memcpy(b5, tensorAt(GEMM5_B), REF_OUT_SIZE * sizeof(float));
+}
+
+void ReferenceNetwork::run(const float* input, float* logits) const {
+    Activations a;
+    conv2d0(input, a);
+    conv2d1(a);
+    conv2d2(a);
+    gemm5(a);
+    memcpy(logits, a.out, REF_OUT_SIZE * sizeof(float));
+}
+
+void ReferenceNetwork::conv2d0(const float* input, Activations& a) const {
+    for (int oh = 0; oh < 20; oh++) {
+        for (int ow = 0; ow < 4; ow++) {
+            float* acc = a.a0[oh][ow];
+            memcpy(acc, b0, sizeof(b0));
+            for (int kh = 0; kh < 10; kh++) {
+                const float* row = &input[(2 * oh + kh) * REF_IN_WIDTH + 2 * ow];
+                for (int kw = 0; kw < 4; kw++) {
+                    madd(acc, row[kw], &w0[(kh * 4 + kw) * 64], 64);
+                }
+            }
+            relu(acc, 64);
+        }
+    }
+}
+
+// Depthwise 3x3
+void ReferenceNetwork::conv2d1(Activations& a) const {
+    for (int oh = 0; oh < 18; oh++) {
+        for (int ow = 0; ow < 2; ow++) {
+            float* acc = a.a1[oh][ow];
+            memcpy(acc, b1, sizeof(b1));
+            for (int kh = 0; kh < 3; kh++)
+                for (int kw = 0; kw < 3; kw++)
+                    mulAdd(acc, a.a0[oh + kh][ow + kw], &w1[(kh * 3 + kw) * 64], 64);
+        }
+    }
+}
+
+// Pointwise, then 2x2 average pool -> 9x1x8
+void ReferenceNetwork::conv2d2(Activations& a) const {
+    for (int h = 0; h < 18; h++) {
+        for (int w = 0; w < 2; w++) {
+            float* acc = a.a2[h][w];
+            memcpy(acc, b2, sizeof(b2));
+            for (int ic = 0; ic < 64; ic++) madd(acc, a.a1[h][w][ic], &w2[ic * 8], 8);
+            relu(acc, 8);
+        }
+    }
+
+    for (int h = 0; h < 9; h++)
+        for (int c = 0; c < 8; c++)
+            a.pooled[h * 8 + c] = 0.25f * (a.a2[2 * h][0][c] + a.a2[2 * h][1][c] + a.a2[2 * h + 1][0][c] +
+                                           a.a2[2 * h + 1][1][c]);
+}
+
+void ReferenceNetwork::gemm5(Activations& a) const {
+    memcpy(a.out, b5, sizeof(b5));
+    for (int i = 0; i < 72; i++) madd(a.out, a.pooled[i], &w5[i * 32], 32);
+}
@@ -0,0 +1,60 @@
+/**
+ * @file    reference_network.h
+ * @brief   Host reference implementation of the generated "network" model
+ *
+ * Same graph as X-CUBE-AI/App/network.c (see network_generate_report.txt), weights taken
+ * directly from s_network_weights_array_u64 in network_data_params.c:
+ *   conv2d_0  10x4 conv, stride 2, 1 -> 64, ReLU      48x10x1 -> 20x4x64
+ *   conv2d_1  3x3 depthwise, stride 1                 20x4x64 -> 18x2x64
+ *   conv2d_2  1x1 conv 64 -> 8, ReLU, 2x2 avg pool    18x2x64 -> 9x1x8
+ *   gemm_5    dense 72 -> 30                          logits
+ * Inner loops use AVX2/FMA when compiled with -mavx2 -mfma.
+ */
+
+#ifndef REFERENCE_NETWORK_H
+#define REFERENCE_NETWORK_H
+
+#define REF_IN_HEIGHT  48
+#define REF_IN_WIDTH   10
+#define REF_IN_SIZE    (REF_IN_HEIGHT * REF_IN_WIDTH)
+#define REF_OUT_SIZE   30
+
+class ReferenceNetwork {
+public:
+    /* Repacks the generated weights into kernel-friendly layouts (once, shared by all threads) */
+    ReferenceNetwork();
+
+    /* Thread-safe: all scratch lives on the caller's stack */
+    void run(const float* input, float* logits) const;
+
+    /* Intermediate tensors of one inference, for per-layer timing (Tools/kernel_bench) */
+    struct Activations {
+        alignas(32) float a0[20][4][64];
+        alignas(32) float a1[18][2][64];
+        alignas(32) float a2[18][2][8];
+        alignas(32) float pooled[9 * 8];
+        alignas(32) float out[32];
+    };
+
+    /* The layers in execution order, each reads the previous one's tensor */
+    void conv2d0(const float* input, Activations& a) const;  // + ReLU
+    void conv2d1(Activations& a) const;
+    void conv2d2(Activations& a) const;                      // + ReLU, 2x2 average pool
+    void gemm5(Activations& a) const;
+
+private:
+    // conv2d_0: [kh][kw][oc]
+    alignas(32) float w0[10 * 4 * 64];
+    alignas(32) float b0[64];
+    // conv2d_1: [kh][kw][c]
+    alignas(32) float w1[3 * 3 * 64];
+    alignas(32) float b1[64];
+    // conv2d_2: [ic][oc]
+    alignas(32) float w2[64 * 8];
+    alignas(32) float b2[8];
+    // gemm_5: [in][out], out padded to 32
+    alignas(32) float w5[72 * 32];
+    alignas(32) float b5[32];
+};
+
+#endif /* REFERENCE_NETWORK_H */
@@ -0,0 +1,94 @@
+/**
+ * @file    work_stealing_pool.h
+ * @brief   Work-stealing parallel-for for host tools
+ *
+ * The index range is cut into chunks and dealt round-robin to per-worker deques.
+ * A worker pops chunks from the back of its own deque and, once empty, steals from
+ * the front of the other workers' deques, so slow clips (long files, disk stalls)
+ * do not leave cores idle at the end of a run.
+ */
+
+#ifndef WORK_STEALING_POOL_H
+#define WORK_STEALING_POOL_H
+
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+class WorkStealingPool {
+public:
+    explicit WorkStealingPool(unsigned threads)
+        : numWorkers(threads ? threads : defaultThreads()) {}
+
+    unsigned workers() const { return numWorkers; }
+
+    static unsigned defaultThreads() {
+        unsigned n = std::thread::hardware_concurrency();
+        return n ? n : 1;
+    }
+
+    /**
+     * Calls body(begin, end, worker) for every chunk of [0, count).
+     * worker is 0..workers()-1, so callers can keep per-worker accumulators without locks.
+     * Blocks until all chunks are done.
+     */
+    template <class Body>
+    void parallelFor(size_t count, size_t chunk, Body body) {
+        if (chunk == 0) chunk = 1;
+
+        std::vector<std::unique_ptr<Queue>> queues;
+        for (unsigned w = 0; w < numWorkers; w++) queues.emplace_back(new Queue);
+
+        size_t next = 0;
+        for (unsigned w = 0; next < count; w = (w + 1) % numWorkers, next += chunk) {
+            queues[w]->items.emplace_back(next, next + chunk < count ? next + chunk : count);
+        }
+
+        std::vector<std::thread> threads;
+        for (unsigned w = 0; w < numWorkers; w++) {
+            threads.emplace_back([&, w] {
+                Range range;
+                while (popLocal(*queues[w], range) || steal(queues, w, range)) {
+                    body(range.first, range.second, w);
+                }
+            });
+        }
+        for (std::thread& t : threads) t.join();
+    }
+
+private:
+    typedef std::pair<size_t, size_t> Range;
+
+    struct Queue {
+        std::mutex lock;
+        std::deque<Range> items;
+    };
+
+    static bool popLocal(Queue& q, Range& out) {
+        std::lock_guard<std::mutex> guard(q.lock);
+        if (q.items.empty()) return false;
+        out = q.items.back();
+        q.items.pop_back();
+        return true;
+    }
+
+    bool steal(std::vector<std::unique_ptr<Queue>>& queues, unsigned self, Range& out) {
+        for (unsigned i = 1; i < numWorkers; i++) {
+            Queue& victim = *queues[(self + i) % numWorkers];
+            std::lock_guard<std::mutex> guard(victim.lock);
+            if (victim.items.empty()) continue;
+            out = victim.items.front();
+            victim.items.pop_front();
+            return true;
+        }
+        return false;
+    }
+
+    unsigned numWorkers;
+};
+
+#endif /* WORK_STEALING_POOL_H */
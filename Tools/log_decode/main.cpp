@@ -0,0 +1,205 @@
+// log_decode - rebuild deferred log records (Core/Src/deferred_log.h) into text
+//
+// Usage:
+//   log_decode <firmware.elf> [capture.bin]    decode a UART capture (stdin if omitted)
+//   log_decode --table <firmware.elf>          print the string table (id, format)
+//
+// The format strings are taken from the .logstr section of the ELF that produced the capture.
+// Bytes outside of valid records (plain printf output) are passed through unchanged.
+
+#include "deferred_log.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+struct StringTable {
+    std::vector<uint8_t> data;
+    uint64_t address = 0;
+
+    const char* lookup(uint32_t id) const {
+        if (id < address || id - address >= data.size()) return nullptr;
+        return reinterpret_cast<const char*>(&data[id - address]);
+    }
+};
+
+static bool readFile(const char* path, std::vector<uint8_t>& out) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    out.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    return true;
+}
+
+template <typename T>
+static T readLe(const std::vector<uint8_t>& d, size_t offset) {
+    T v = 0;
+    for (size_t i = 0; i < sizeof(T) && offset + i < d.size(); i++) v |= (T)d[offset + i] << (8 * i);
+    return v;
+}
+
+// Finds .logstr in a little-endian ELF32 (target) or ELF64 (host test build)
+static bool loadStringTable(const char* elfPath, StringTable& table) {
+    std::vector<uint8_t> elf;
+    if (!readFile(elfPath, elf) || elf.size() < 64 || memcmp(elf.data(), "\x7f" "ELF", 4) != 0 || elf[5] != 1) {
+        fprintf(stderr, "%s: not a little-endian ELF file\n", elfPath);
+        return false;
+    }
+    bool is64 = elf[4] == 2;
+    uint64_t shoff = is64 ? readLe<uint64_t>(elf, 0x28) : readLe<uint32_t>(elf, 0x20);
+    uint16_t shentsize = readLe<uint16_t>(elf, is64 ? 0x3A : 0x2E);
+    uint16_t shnum = readLe<uint16_t>(elf, is64 ? 0x3C : 0x30);
+    uint16_t shstrndx = readLe<uint16_t>(elf, is64 ? 0x3E : 0x32);
+
+    auto section = [&](uint16_t i, uint32_t& name, uint64_t& addr, uint64_t& offset, uint64_t& size) {
+        size_t h = shoff + (size_t)i * shentsize;
+        name = readLe<uint32_t>(elf, h);
+        addr = is64 ? readLe<uint64_t>(elf, h + 0x10) : readLe<uint32_t>(elf, h + 0x0C);
+        offset = is64 ? readLe<uint64_t>(elf, h + 0x18) : readLe<uint32_t>(elf, h + 0x10);
+        size = is64 ? readLe<uint64_t>(elf, h + 0x20) : readLe<uint32_t>(elf, h + 0x14);
+    };
+
+    uint32_t name;
+    uint64_t addr, offset, size, namesOffset, namesSize;
+    section(shstrndx, name, addr, namesOffset, namesSize);
+    for (uint16_t i = 0; i < shnum; i++) {
+        section(i, name, addr, offset, size);
+        if (name >= namesSize || strcmp(reinterpret_cast<const char*>(&elf[namesOffset + name]), ".logstr") != 0) continue;
+        if (offset + size > elf.size()) break;
+        table.address = addr;
+        table.data.assign(elf.begin() + offset, elf.begin() + offset + size);
+        table.data.push_back(0);
+        return true;
+    }
+    fprintf(stderr, "%s: no .logstr section\n", elfPath);
+    return false;
+}
+
+// Formats one record; returns false if the payload does not match the format
+static bool formatRecord(const char* format, const uint8_t* payload, size_t length, std::string& out) {
+    size_t pos = 0;
+    char buffer[256];
+    for (const char* p = format; *p; p++) {
+        if (*p != '%') { out += *p; continue; }
+        if (p[1] == '%') { out += '%'; p++; continue; }
+
+        // %[flags][width][.precision][length]conversion
+        std::string spec = "%";
+        const char* q = p + 1;
+        while (*q && strchr("-+ #0", *q)) spec += *q++;
+        while (*q && ((*q >= '0' && *q <= '9') || *q == '.')) spec += *q++;
+        int longs = 0;
+        while (*q && strchr("hlzjt", *q)) { if (*q == 'l') longs++; q++; }
+        char conversion = *q;
+        if (!conversion) break;
+        p = q;
+
+        if (conversion == 's') {
+            if (pos + 1 > length || pos + 1 + payload[pos] > length) return false;
+            std::string s(reinterpret_cast<const char*>(&payload[pos + 1]), payload[pos]);
+            pos += 1 + payload[pos];
+            snprintf(buffer, sizeof(buffer), (spec + 's').c_str(), s.c_str());
+        } else if (strchr("fFeEgGaA", conversion)) {
+            float f;
+            if (pos + 4 > length) return false;
+            memcpy(&f, &payload[pos], 4);
+            pos += 4;
+            snprintf(buffer, sizeof(buffer), (spec + conversion).c_str(), (double)f);
+        } else if (strchr("diuxXoc", conversion)) {
+            size_t size = longs >= 2 ? 8 : 4;  // target long is 32 bit
+            if (pos + size > length) return false;
+            uint64_t raw = 0;
+            memcpy(&raw, &payload[pos], size);
+            pos += size;
+            long long value = size == 8 ? (long long)raw
+                            : (conversion == 'd' || conversion == 'i') ? (long long)(int32_t)raw
+                            : (long long)(uint32_t)raw;
+            if (conversion == 'c') snprintf(buffer, sizeof(buffer), (spec + 'c').c_str(), (int)value);
+            else snprintf(buffer, sizeof(buffer), (spec + "ll" + conversion).c_str(), value);
+        } else if (conversion == 'p') {
+            uint32_t address;
+            if (pos + 4 > length) return false;
+            memcpy(&address, &payload[pos], 4);
+            pos += 4;
+            snprintf(buffer, sizeof(buffer), "0x%08lx", (unsigned long)address);
+        } else {
+            return false;
+        }
+        out += buffer;
+    }
+    return pos == length;
+}
+
+// Decodes as much of the stream as possible, returns the number of bytes consumed.
+// A possible record cut off at the end is kept for the next call unless final is set.
+static size_t decode(const StringTable& table, const std::vector<uint8_t>& stream, bool final) {
+    size_t i = 0;
+    while (i < stream.size()) {
+        uint8_t byte = stream[i];
+        if (byte == DEFERRED_LOG_SYNC) {
+            size_t total = i + 1 < stream.size() ? DEFERRED_LOG_HEADER_SIZE + stream[i + 1] + 1 : DEFERRED_LOG_HEADER_SIZE;
+            if (i + total > stream.size()) {
+                if (!final) return i;
+            } else {
+                const uint8_t* r = &stream[i];
+                uint8_t sum = 0;
+                for (size_t k = 1; k < total - 1; k++) sum += r[k];
+                const char* format = table.lookup(r[2] | r[3] << 8);
+                std::string text;
+                if (sum == r[total - 1] && format &&
+                    formatRecord(format, r + DEFERRED_LOG_HEADER_SIZE, total - DEFERRED_LOG_HEADER_SIZE - 1, text)) {
+                    uint32_t ms = r[4] | r[5] << 8 | r[6] << 16 | (uint32_t)r[7] << 24;
+                    printf("[%6lu.%03lu] %s\n", (unsigned long)(ms / 1000), (unsigned long)(ms % 1000), text.c_str());
+                    i += total;
+                    continue;
+                }
+            }
+        }
+        // Plain printf output
+        if (byte != '\r') putchar(byte);
+        i++;
+    }
+    return i;
+}
+
+int main(int argc, char** argv) {
+    if (argc == 3 && !strcmp(argv[1], "--table")) {
+        StringTable table;
+        if (!loadStringTable(argv[2], table)) return 1;
+        for (size_t id = 0; id + 1 < table.data.size();) {
+            const char* s = reinterpret_cast<const char*>(&table.data[id]);
+            if (*s) printf("%5zu  %s\n", (size_t)(table.address + id), s);
+            id += strlen(s) + 1;
+        }
+        return 0;
+    }
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "usage: %s <firmware.elf> [capture.bin]\n       %s --table <firmware.elf>\n", argv[0], argv[0]);
+        return 2;
+    }
+
+    StringTable table;
+    if (!loadStringTable(argv[1], table)) return 1;
+
+    FILE* in = argc == 3 ? fopen(argv[2], "rb") : stdin;
+    if (!in) {
+        fprintf(stderr, "cannot read %s\n", argv[2]);
+        return 1;
+    }
+
+    // Streaming, so "log_decode fw.elf < /dev/ttyACM0" works live
+    std::vector<uint8_t> stream;
+    uint8_t chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), in)) > 0) {
+        stream.insert(stream.end(), chunk, chunk + n);
+        stream.erase(stream.begin(), stream.begin() + decode(table, stream, false));
+        fflush(stdout);
+    }
+    decode(table, stream, true);
+    if (in != stdin) fclose(in);
+    return 0;
+}
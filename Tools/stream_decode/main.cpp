@@ -0,0 +1,103 @@
+// stream_decode - decode the firmware's lossless audio stream (Core/Src/audio_stream.h) to WAV
+//
+// Usage:
+//   stream_decode <capture.bin> <out.wav>
+//
+// <capture.bin> is the raw USART3 byte stream at AUDIO_STREAM_BAUDRATE, e.g.
+//   stty -F /dev/ttyACM0 921600 raw && cat /dev/ttyACM0 > capture.bin
+// Text and log records between frames are skipped. Missing block sequence numbers (lost on the
+// board or on the line) are filled with silence so the WAV keeps real-time alignment.
+
+#include "audio_codec.h"
+#include "audio_stream.h"
+#include "wav.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s <capture.bin> <out.wav>\n", argv[0]);
+        return 2;
+    }
+
+    std::ifstream in(argv[1], std::ios::binary);
+    if (!in) {
+        fprintf(stderr, "cannot read %s\n", argv[1]);
+        return 1;
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    std::vector<int32_t> samples;
+    std::vector<int32_t> block;
+    bool first = true;
+    uint32_t nextSequence = 0;
+    uint64_t frames = 0, payloadBytes = 0, badFrames = 0, missingBlocks = 0, boardGaps = 0;
+
+    size_t i = 0;
+    while (i + AUDIO_STREAM_HEADER_SIZE + 2 <= data.size()) {
+        const uint8_t* h = &data[i];
+        if (h[0] != AUDIO_STREAM_SYNC0 || h[1] != AUDIO_STREAM_SYNC1 || h[2] != AUDIO_STREAM_VERSION) {
+            i++;
+            continue;
+        }
+        uint32_t n = h[4] | h[5] << 8;
+        uint32_t payload = h[6] | h[7] << 8;
+        uint32_t sequence = h[8] | h[9] << 8 | h[10] << 16 | (uint32_t)h[11] << 24;
+        size_t size = AUDIO_STREAM_HEADER_SIZE + payload + 2;
+        if (n == 0 || payload > AUDIO_CODEC_MAX_BYTES(n) || i + size > data.size()) {
+            i++;
+            continue;
+        }
+        uint16_t crc = AudioCodec_Crc16(h + 2, (uint32_t)(size - 4), 0xFFFF);
+        if (crc != (h[size - 2] | h[size - 1] << 8)) {
+            badFrames++;
+            i++;
+            continue;
+        }
+
+        block.resize(n);
+        if (!AudioCodec_Decode(h + AUDIO_STREAM_HEADER_SIZE, payload, block.data(), n)) {
+            badFrames++;
+            i += size;
+            continue;
+        }
+
+        // Fill lost blocks with silence
+        if (!first && sequence != nextSequence) {
+            uint32_t missing = sequence - nextSequence;
+            if (missing < 16000) {  // about four minutes of blocks, otherwise treat as restart
+                missingBlocks += missing;
+                samples.insert(samples.end(), (size_t)missing * n, 0);
+            }
+        }
+        if (h[3] & AUDIO_STREAM_FLAG_GAP) boardGaps++;
+        first = false;
+        nextSequence = sequence + 1;
+
+        samples.insert(samples.end(), block.begin(), block.end());
+        frames++;
+        payloadBytes += payload;
+        i += size;
+    }
+
+    if (frames == 0) {
+        fprintf(stderr, "no audio frames in %s\n", argv[1]);
+        return 1;
+    }
+    if (!wavWrite(argv[2], samples, AUDIO_TIMELINE_SAMPLE_RATE, 24)) {
+        fprintf(stderr, "cannot write %s\n", argv[2]);
+        return 1;
+    }
+
+    uint64_t decoded = samples.size() - missingBlocks * block.size();
+    printf("frames:          %llu (%llu corrupt)\n", (unsigned long long)frames, (unsigned long long)badFrames);
+    printf("duration:        %.2f s\n", samples.size() / (double)AUDIO_TIMELINE_SAMPLE_RATE);
+    printf("bits/sample:     %.2f (18 raw)\n", decoded ? payloadBytes * 8.0 / decoded : 0.0);
+    printf("missing blocks:  %llu (%llu board-side gaps)\n", (unsigned long long)missingBlocks, (unsigned long long)boardGaps);
+    printf("written to %s\n", argv[2]);
+    return 0;
+}
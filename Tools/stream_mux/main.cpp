@@ -0,0 +1,235 @@
+// stream_mux - split a USB stream capture (Core/Src/usb_stream.h) into its channels
+//
+// Usage:
+//   stream_mux <capture.bin> <outdir>
+//   stream_mux --loopback [seed]
+//
+// <capture.bin> is the raw CDC byte stream, e.g.
+//   stty -F /dev/ttyACM0 raw && cat /dev/ttyACM0 > capture.bin
+// Written to <outdir>:
+//   audio.bin     audio stream frames, decode with Tools/stream_decode
+//   features.csv  window, FEATURES_SIZE MFCC values
+//   logits.csv    window, KWS_NUM_LABELS raw network logits (softmax not applied)
+//   trace.bin     raw TraceEvent records (8 bytes each)
+// Clip downloads (flash_recorder.h) are only counted here, Tools/flash_log decodes them.
+//
+// --loopback runs the firmware framing through a stand-in for the USB link: frames of all channels
+// are queued in a StreamMuxTx ring, drained in 64-byte packets, then the link drops packets and flips
+// bits. Every delivered frame is checked against what was sent and every lost frame must show up as a
+// sequence gap. Exit code 0 if everything matches.
+
+#include "stream_mux.h"
+#include "feature_extraction.h"
+#include "kws_labels.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+// DEMULTIPLEX
+
+struct Outputs {
+    FILE* audio;
+    FILE* features;
+    FILE* logits;
+    FILE* trace;
+    uint32_t frames[STREAM_MUX_NUM_CHANNELS];
+    uint32_t badLength[STREAM_MUX_NUM_CHANNELS];
+};
+
+static void writeFloats(FILE* f, uint32_t tag, const uint8_t* payload, uint32_t count) {
+    fprintf(f, "%lu", (unsigned long)tag);
+    for (uint32_t i = 0; i < count; i++) {
+        float v;
+        memcpy(&v, payload + i * sizeof(float), sizeof(float));
+        fprintf(f, ",%g", v);
+    }
+    fprintf(f, "\n");
+}
+
+static void onDemuxFrame(void* context, StreamMuxChannel channel, uint16_t sequence, uint32_t tag,
+                         const uint8_t* payload, uint32_t length) {
+    (void)sequence;
+    Outputs* out = static_cast<Outputs*>(context);
+    out->frames[channel]++;
+    switch (channel) {
+    case STREAM_MUX_AUDIO:
+        fwrite(payload, 1, length, out->audio);
+        break;
+    case STREAM_MUX_FEATURES:
+        if (length != FEATURES_SIZE * sizeof(float)) out->badLength[channel]++;
+        else writeFloats(out->features, tag, payload, FEATURES_SIZE);
+        break;
+    case STREAM_MUX_LOGITS:
+        if (length != KWS_NUM_LABELS * sizeof(float)) out->badLength[channel]++;
+        else writeFloats(out->logits, tag, payload, KWS_NUM_LABELS);
+        break;
+    case STREAM_MUX_TRACE:
+        fwrite(payload, 1, length, out->trace);
+        break;
+    default:
+        break;
+    }
+}
+
+static int demux(const char* capture, const std::string& dir) {
+    std::ifstream in(capture, std::ios::binary);
+    if (!in) {
+        fprintf(stderr, "cannot read %s\n", capture);
+        return 1;
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    Outputs out = {};
+    out.audio = fopen((dir + "/audio.bin").c_str(), "wb");
+    out.features = fopen((dir + "/features.csv").c_str(), "w");
+    out.logits = fopen((dir + "/logits.csv").c_str(), "w");
+    out.trace = fopen((dir + "/trace.bin").c_str(), "wb");
+    if (!out.audio || !out.features || !out.logits || !out.trace) {
+        fprintf(stderr, "cannot write to %s\n", dir.c_str());
+        return 1;
+    }
+
+    static StreamMuxParser parser;
+    StreamMux_ParserInit(&parser);
+    StreamMux_Parse(&parser, data.data(), (uint32_t)data.size(), onDemuxFrame, &out);
+
+    fclose(out.audio);
+    fclose(out.features);
+    fclose(out.logits);
+    fclose(out.trace);
+
+    printf("%-10s %8s %8s %8s\n", "channel", "frames", "lost", "bad len");
+    for (uint32_t c = 0; c < STREAM_MUX_NUM_CHANNELS; c++) {
+        printf("%-10s %8lu %8lu %8lu\n", StreamMux_ChannelName((StreamMuxChannel)c),
+               (unsigned long)out.frames[c], (unsigned long)parser.stats.lost[c], (unsigned long)out.badLength[c]);
+    }
+    printf("crc errors: %lu, skipped bytes: %lu\n",
+           (unsigned long)parser.stats.crcErrors, (unsigned long)parser.stats.skippedBytes);
+    return 0;
+}
+
+// LOOPBACK
+
+static const uint32_t PACKET_SIZE = 64;  // full-speed bulk packet
+
+// Payload is a function of channel, sequence and tag, so the receiver can check it
+static void fillPayload(StreamMuxChannel channel, uint16_t sequence, uint32_t tag, uint8_t* out, uint32_t length) {
+    uint32_t x = (uint32_t)channel * 0x9E3779B9u ^ sequence * 0x85EBCA6Bu ^ tag * 0xC2B2AE35u;
+    for (uint32_t i = 0; i < length; i++) {
+        x = x * 1664525u + 1013904223u;
+        out[i] = (uint8_t)(x >> 24);
+    }
+}
+
+struct Loopback {
+    uint32_t delivered = 0;
+    uint32_t mismatches = 0;
+};
+
+static void onLoopbackFrame(void* context, StreamMuxChannel channel, uint16_t sequence, uint32_t tag,
+                            const uint8_t* payload, uint32_t length) {
+    Loopback* lb = static_cast<Loopback*>(context);
+    uint8_t expected[STREAM_MUX_MAX_PAYLOAD];
+    fillPayload(channel, sequence, tag, expected, length);
+    if (tag != sequence * 7u || memcmp(expected, payload, length) != 0) lb->mismatches++;
+    lb->delivered++;
+}
+
+struct Link {
+    double dropRate;
+    double flipRate;
+};
+
+// Drain the TX ring in USB packets through the impaired link
+static void drain(StreamMuxTx* tx, StreamMuxParser* parser, Loopback* lb, const Link& link,
+                  std::mt19937& rng, uint32_t* packetsDropped, uint32_t* bitsFlipped) {
+    std::uniform_real_distribution<double> u(0.0, 1.0);
+    const uint8_t* data;
+    uint32_t length;
+    while ((length = StreamMux_Peek(tx, &data)) > 0) {
+        if (length > PACKET_SIZE) length = PACKET_SIZE;
+        uint8_t packet[PACKET_SIZE];
+        memcpy(packet, data, length);
+        StreamMux_Consume(tx, length);
+
+        if (u(rng) < link.dropRate) {
+            (*packetsDropped)++;
+            continue;
+        }
+        if (u(rng) < link.flipRate) {
+            packet[rng() % length] ^= (uint8_t)(1u << (rng() % 8));
+            (*bitsFlipped)++;
+        }
+        StreamMux_Parse(parser, packet, length, onLoopbackFrame, lb);
+    }
+}
+
+static bool runLoopback(const char* name, const Link& link, uint32_t seed) {
+    static StreamMuxTx tx;
+    static StreamMuxParser parser;
+    StreamMux_TxInit(&tx);
+    StreamMux_ParserInit(&parser);
+    std::mt19937 rng(seed);
+    Loopback lb;
+    uint32_t packetsDropped = 0, bitsFlipped = 0;
+
+    // Typical payload sizes: audio frame, feature matrix, logits, trace chunk, clip chunk
+    const uint32_t maxLength[STREAM_MUX_NUM_CHANNELS] = {
+        600, FEATURES_SIZE * sizeof(float), KWS_NUM_LABELS * sizeof(float), 1024, 1024};
+    const uint32_t frames = 20000;
+    uint8_t payload[STREAM_MUX_MAX_PAYLOAD];
+
+    for (uint32_t i = 0; i < frames; i++) {
+        // The last round of frames goes over a clean link so trailing losses show up as gaps
+        StreamMuxChannel channel = (StreamMuxChannel)(i < frames - STREAM_MUX_NUM_CHANNELS
+                                                          ? rng() % STREAM_MUX_NUM_CHANNELS
+                                                          : i % STREAM_MUX_NUM_CHANNELS);
+        uint32_t length = 1 + rng() % maxLength[channel];
+        uint16_t sequence = tx.sequence[channel];
+        uint32_t tag = sequence * 7u;
+        fillPayload(channel, sequence, tag, payload, length);
+        while (!StreamMux_Write(&tx, channel, tag, payload, length)) {
+            tx.dropped--;  // not a loss, the loopback drains synchronously
+            drain(&tx, &parser, &lb, i < frames - STREAM_MUX_NUM_CHANNELS ? link : Link{0.0, 0.0},
+                  rng, &packetsDropped, &bitsFlipped);
+        }
+        if (i >= frames - STREAM_MUX_NUM_CHANNELS) drain(&tx, &parser, &lb, Link{0.0, 0.0}, rng, &packetsDropped, &bitsFlipped);
+    }
+    drain(&tx, &parser, &lb, Link{0.0, 0.0}, rng, &packetsDropped, &bitsFlipped);
+
+    // Every frame is either delivered intact or counted as lost, no frame is invented
+    uint32_t lost = 0;
+    for (uint32_t c = 0; c < STREAM_MUX_NUM_CHANNELS; c++) lost += parser.stats.lost[c];
+    bool ok = lb.mismatches == 0 && lb.delivered + lost == frames;
+    if (link.dropRate == 0.0 && link.flipRate == 0.0) ok = ok && lb.delivered == frames;
+
+    printf("%-12s sent %lu, delivered %lu, lost %lu, crc errors %lu, skipped %lu bytes "
+           "(%lu packets dropped, %lu bits flipped): %s\n",
+           name, (unsigned long)frames, (unsigned long)lb.delivered, (unsigned long)lost,
+           (unsigned long)parser.stats.crcErrors, (unsigned long)parser.stats.skippedBytes,
+           (unsigned long)packetsDropped, (unsigned long)bitsFlipped, ok ? "ok" : "FAILED");
+    if (lb.mismatches) printf("             %lu frames with wrong content\n", (unsigned long)lb.mismatches);
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    if (argc >= 2 && strcmp(argv[1], "--loopback") == 0) {
+        uint32_t seed = argc >= 3 ? (uint32_t)strtoul(argv[2], nullptr, 0) : 1;
+        bool ok = runLoopback("clean", Link{0.0, 0.0}, seed);
+        ok = runLoopback("drops", Link{0.01, 0.0}, seed) && ok;
+        ok = runLoopback("bit errors", Link{0.0, 0.01}, seed) && ok;
+        ok = runLoopback("both", Link{0.01, 0.01}, seed) && ok;
+        return ok ? 0 : 1;
+    }
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s <capture.bin> <outdir>\n       %s --loopback [seed]\n", argv[0], argv[0]);
+        return 2;
+    }
+    return demux(argv[1], argv[2]);
+}
@@ -0,0 +1,224 @@
+// trace_convert - turn the UART trace dumps of the firmware into Chrome trace JSON
+//
+// Usage:
+//   trace_convert <uart.log> <trace.json>
+//
+// <uart.log> is the captured serial output, other lines are ignored. Every "[TRACE] begin" block
+// is one utterance. Open the JSON in chrome://tracing or https://ui.perfetto.dev.
+// A per-utterance latency summary (relative to the trigger) is printed to stdout.
+// Cycle counts are converted with the clock of the dump header and, going back in time, the old
+// clock of every CLOCK_SWITCH event (clock governor).
+
+#include "trace_events.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+struct Event {
+    double us;  // absolute, from the HAL tick of the dump
+    TraceEvent raw;
+};
+
+struct Dump {
+    std::vector<Event> events;
+    unsigned long dropped = 0;
+    unsigned long cpu = 0;   // Core clock, HAL tick and cycle counter when the dump was taken
+    unsigned long tick = 0;
+    unsigned long now = 0;
+};
+
+#define TRACE_NAME(id, name, context) name,
+static const char* const eventNames[TRACE_NUM_IDS] = { TRACE_EVENTS(TRACE_NAME) };
+#undef TRACE_NAME
+#define TRACE_CONTEXT(id, name, context) context,
+static const char* const eventContexts[TRACE_NUM_IDS] = { TRACE_EVENTS(TRACE_CONTEXT) };
+#undef TRACE_CONTEXT
+
+static const char* const contexts[] = { "i2s_isr", "kws_job", "main" };
+
+static int contextTid(int id) {
+    for (int i = 0; i < 3; i++) {
+        if (!strcmp(eventContexts[id], contexts[i])) return i + 1;
+    }
+    return 9;
+}
+
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Newest to oldest: age relative to the dump header, or to the last clock switch after the event,
+// at the clock that was running then. Wrap-safe for events up to ~25 s before that reference.
+static void timestamp(Dump& dump) {
+    double referenceUs = dump.tick * 1000.0;
+    uint32_t referenceCycles = (uint32_t)dump.now;
+    double hz = (double)dump.cpu;
+    for (size_t i = dump.events.size(); i-- > 0;) {
+        Event& e = dump.events[i];
+        uint32_t age = referenceCycles - e.raw.cycles;
+        e.us = referenceUs - age * 1e6 / hz;
+        if (e.raw.id == TRACE_CLOCK_SWITCH && (e.raw.arg >> 8) != 0) {
+            referenceUs = e.us;
+            referenceCycles = e.raw.cycles;
+            hz = (e.raw.arg >> 8) * 1e6;
+        }
+    }
+}
+
+static bool parseLog(const char* path, std::vector<Dump>& dumps) {
+    std::ifstream in(path);
+    if (!in) return false;
+
+    std::string line;
+    bool inDump = false;
+    unsigned long cpu = 0, tick = 0, now = 0;
+    while (std::getline(in, line)) {
+        size_t tag = line.find("[TRACE] ");
+        if (tag == std::string::npos) continue;
+        const char* body = line.c_str() + tag + 8;
+
+        if (!strncmp(body, "begin", 5)) {
+            unsigned long events = 0, dropped = 0;
+            if (sscanf(body, "begin cpu=%lu tick=%lu now=%lu events=%lu dropped=%lu",
+                       &cpu, &tick, &now, &events, &dropped) != 5 || cpu == 0) {
+                fprintf(stderr, "bad dump header: %s\n", body);
+                inDump = false;
+                continue;
+            }
+            dumps.emplace_back();
+            dumps.back().dropped = dropped;
+            dumps.back().cpu = cpu;
+            dumps.back().tick = tick;
+            dumps.back().now = now;
+            inDump = true;
+        } else if (!strncmp(body, "end", 3)) {
+            inDump = false;
+        } else if (inDump) {
+            for (const char* p = body; hexValue(p[0]) >= 0; p += 2 * sizeof(TraceEvent)) {
+                uint8_t bytes[sizeof(TraceEvent)];
+                bool ok = true;
+                for (size_t b = 0; b < sizeof(TraceEvent) && ok; b++) {
+                    int hi = hexValue(p[2 * b]), lo = hi < 0 ? -1 : hexValue(p[2 * b + 1]);
+                    ok = hi >= 0 && lo >= 0;
+                    bytes[b] = (uint8_t)(hi << 4 | lo);
+                }
+                if (!ok) break;
+
+                Event e;
+                memcpy(&e.raw, bytes, sizeof(bytes));  // dump is little-endian like the host
+                if (e.raw.id >= TRACE_NUM_IDS) continue;
+                if (e.raw.phase != TRACE_PHASE_BEGIN && e.raw.phase != TRACE_PHASE_END &&
+                    e.raw.phase != TRACE_PHASE_INSTANT) continue;
+                dumps.back().events.push_back(e);
+            }
+        }
+    }
+    for (Dump& dump : dumps) timestamp(dump);
+    return true;
+}
+
+// First event with the given id/phase at or after the trigger, -1 if none
+static double firstAfter(const Dump& dump, double from, int id, uint8_t phase) {
+    for (const Event& e : dump.events) {
+        if (e.raw.id == id && e.raw.phase == phase && e.us >= from) return e.us;
+    }
+    return -1.0;
+}
+
+static void printMs(double ms) {
+    if (std::isnan(ms)) printf(" %10s", "-");
+    else printf(" %10.2f", ms);
+}
+
+static void printSummary(const std::vector<Dump>& dumps) {
+    printf("%-4s %10s %10s %10s %10s %10s %10s %10s\n", "utt", "block>trig", "rec_end", "features",
+           "inference", "result", "rf_done", "dropped");
+    for (size_t u = 0; u < dumps.size(); u++) {
+        const Dump& dump = dumps[u];
+        double trigger = -1.0, block = -1.0;
+        uint16_t sequence = 0;
+        for (const Event& e : dump.events) {
+            if (e.raw.id == TRACE_TRIGGER) { trigger = e.us; sequence = e.raw.arg; break; }
+        }
+        if (trigger < 0) {
+            printf("%-4zu (no trigger)\n", u);
+            continue;
+        }
+        for (const Event& e : dump.events) {
+            if (e.raw.id == TRACE_DMA_BLOCK && e.raw.phase == TRACE_PHASE_BEGIN && e.raw.arg == sequence) block = e.us;
+        }
+
+        // Block arrival -> trigger, then every stage relative to the trigger; NAN if it did not run
+        double stages[5] = {
+            firstAfter(dump, trigger, TRACE_RECORDING_END, TRACE_PHASE_INSTANT),
+            firstAfter(dump, trigger, TRACE_FEATURES, TRACE_PHASE_END),
+            firstAfter(dump, trigger, TRACE_INFERENCE, TRACE_PHASE_END),
+            firstAfter(dump, trigger, TRACE_RESULT, TRACE_PHASE_BEGIN),
+            firstAfter(dump, trigger, TRACE_SEND_SEQUENCE, TRACE_PHASE_END),
+        };
+        printf("%-4zu", u);
+        printMs(block >= 0 ? (trigger - block) / 1000.0 : NAN);
+        for (double t : stages) printMs(t >= 0 ? (t - trigger) / 1000.0 : NAN);
+        printf(" %10lu\n", dump.dropped);
+    }
+}
+
+static bool writeChromeTrace(const char* path, const std::vector<Dump>& dumps) {
+    FILE* f = fopen(path, "w");
+    if (!f) return false;
+
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for (int i = 0; i < 3; i++) {
+        fprintf(f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}},\n",
+                i + 1, contexts[i]);
+    }
+
+    bool first = true;
+    for (size_t u = 0; u < dumps.size(); u++) {
+        for (const Event& e : dumps[u].events) {
+            fprintf(f, "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%d",
+                    first ? "" : ",\n", eventNames[e.raw.id], (char)e.raw.phase, e.us, contextTid(e.raw.id));
+            if (e.raw.phase == TRACE_PHASE_INSTANT) fprintf(f, ",\"s\":\"t\"");
+            fprintf(f, ",\"args\":{\"arg\":%u,\"utterance\":%zu}}", e.raw.arg, u);
+            first = false;
+        }
+    }
+    fprintf(f, "\n]}\n");
+    fclose(f);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s <uart.log> <trace.json>\n", argv[0]);
+        return 2;
+    }
+
+    std::vector<Dump> dumps;
+    if (!parseLog(argv[1], dumps)) {
+        fprintf(stderr, "cannot read %s\n", argv[1]);
+        return 1;
+    }
+    if (dumps.empty()) {
+        fprintf(stderr, "no [TRACE] dumps in %s\n", argv[1]);
+        return 1;
+    }
+
+    printf("Latency per utterance, ms relative to the trigger sample\n");
+    printSummary(dumps);
+
+    if (!writeChromeTrace(argv[2], dumps)) {
+        fprintf(stderr, "cannot write %s\n", argv[2]);
+        return 1;
+    }
+    printf("%zu utterances written to %s\n", dumps.size(), argv[2]);
+    return 0;
+}
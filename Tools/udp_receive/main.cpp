@@ -0,0 +1,376 @@
+// udp_receive - listen for the firmware's UDP messages (Core/Src/udp_publisher.h)
+//
+// Usage:
+//   udp_receive [-p port] [-a audio.bin]
+//   udp_receive --loopback [seed]
+//
+// Prints detection events and metrics snapshots as they arrive and counts sequence gaps per message
+// type. With -a the audio frames are appended to a file for Tools/stream_decode. Stop with Ctrl-C.
+// The board sends broadcasts from UDP_PUBLISHER_SRC_IP, so the host interface has to be in the
+// same subnet (or the capture taken with tcpdump).
+//
+// --loopback runs the firmware transmit path (Core/Src/udp_tx.cpp) against a stand-in for the
+// Ethernet DMA: it walks the descriptor ring like the hardware, gathers header and payload buffers,
+// inserts the UDP checksum like the MAC offload and hands the frame to the receive checks here.
+// Payload buffers are scribbled over as soon as their done callback runs, so a late DMA read or a
+// hidden copy shows up as a content mismatch. Exit code 0 if everything matches.
+
+#include "udp_tx.h"
+#include "udp_publisher.h"
+#include "kws_labels.h"
+
+#include <arpa/inet.h>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <netinet/in.h>
+#include <random>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+static const int NUM_TYPES = 4;
+static const char* const typeNames[NUM_TYPES] = {"?", "detection", "audio", "metrics"};
+
+static const char* labelName(int32_t label) {
+    return label >= 0 && label < KWS_NUM_LABELS ? kwsLabelNames[label] : "none";
+}
+
+// Split a datagram into message header and payload
+static bool parseDatagram(const uint8_t* data, size_t length, UdpMessageHeader* header,
+                          const uint8_t** payload, size_t* payloadLength) {
+    if (length < sizeof(UdpMessageHeader)) return false;
+    memcpy(header, data, sizeof(*header));
+    if (header->magic != UDP_PUBLISHER_MAGIC || header->version != UDP_PUBLISHER_VERSION) return false;
+    if (header->type == 0 || header->type >= NUM_TYPES) return false;
+    *payload = data + sizeof(UdpMessageHeader);
+    *payloadLength = length - sizeof(UdpMessageHeader);
+    return true;
+}
+
+// LISTEN
+
+static volatile sig_atomic_t stop = 0;
+
+static void onSignal(int) {
+    stop = 1;
+}
+
+struct Counters {
+    bool synced[NUM_TYPES] = {};
+    uint32_t next[NUM_TYPES] = {};
+    uint32_t received[NUM_TYPES] = {};
+    uint32_t lost[NUM_TYPES] = {};
+    uint32_t invalid = 0;
+};
+
+static void printDatagram(const UdpMessageHeader& h, const uint8_t* payload, size_t length, FILE* audio) {
+    if (h.type == UDP_MSG_DETECTION && length == sizeof(UdpDetectionEvent)) {
+        UdpDetectionEvent e;
+        memcpy(&e, payload, sizeof(e));
+        printf("[%9.3f s] window %lu: %-8s (best %s, %.0f %%, margin %.2f), latency %lu ms, %.1f Mcycles\n",
+               h.timeMs / 1000.0, (unsigned long)e.window, labelName(e.label), labelName(e.best),
+               e.score * 100.0f, e.margin, (unsigned long)e.latencyMs, e.cycles / 1e6);
+    } else if (h.type == UDP_MSG_METRICS && length == sizeof(UdpMetrics)) {
+        UdpMetrics m;
+        memcpy(&m, payload, sizeof(m));
+        printf("[%9.3f s] metrics: windows %lu (early reject %lu, unknown %lu, keywords %lu, %lu cycles/window), "
+               "audio blocks %lu (lost %lu in %lu gaps), agc gain %.2f (envelope %lu, clipped %lu), "
+               "stream %lu (dropped %lu), udp %lu (busy %lu, errors %lu)\n",
+               m.uptimeMs / 1000.0, (unsigned long)m.kwsWindows, (unsigned long)m.kwsRejectedEarly,
+               (unsigned long)m.kwsUnknown, (unsigned long)m.kwsKeywords, (unsigned long)m.kwsAvgCycles,
+               (unsigned long)m.audioBlocks, (unsigned long)m.audioLostBlocks, (unsigned long)m.audioGaps,
+               m.agcGain / 4096.0, (unsigned long)m.agcEnvelope, (unsigned long)m.agcClipped,
+               (unsigned long)m.streamFrames, (unsigned long)m.streamDropped,
+               (unsigned long)m.udpPackets, (unsigned long)m.udpBusy, (unsigned long)m.udpErrors);
+    } else if (h.type == UDP_MSG_AUDIO) {
+        if (audio) fwrite(payload, 1, length, audio);
+    }
+    fflush(stdout);
+}
+
+static int listen(uint16_t port, const char* audioPath) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        perror("socket");
+        return 1;
+    }
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    setsockopt(fd, SOL_SOCKET, SO_BROADCAST, &on, sizeof(on));
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        perror("bind");
+        return 1;
+    }
+
+    FILE* audio = nullptr;
+    if (audioPath && !(audio = fopen(audioPath, "wb"))) {
+        fprintf(stderr, "cannot write %s\n", audioPath);
+        return 1;
+    }
+
+    struct sigaction sa = {};
+    sa.sa_handler = onSignal;
+    sigaction(SIGINT, &sa, nullptr);
+    printf("listening on UDP port %u\n", port);
+
+    Counters c;
+    uint8_t buffer[2048];
+    while (!stop) {
+        ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n < 0) break;
+
+        UdpMessageHeader h;
+        const uint8_t* payload;
+        size_t length;
+        if (!parseDatagram(buffer, (size_t)n, &h, &payload, &length)) {
+            c.invalid++;
+            continue;
+        }
+        if (c.synced[h.type] && h.sequence != c.next[h.type]) c.lost[h.type] += h.sequence - c.next[h.type];
+        c.synced[h.type] = true;
+        c.next[h.type] = h.sequence + 1;
+        c.received[h.type]++;
+        printDatagram(h, payload, length, audio);
+    }
+
+    if (audio) fclose(audio);
+    close(fd);
+    printf("\n%-10s %8s %8s\n", "type", "received", "lost");
+    for (int t = 1; t < NUM_TYPES; t++) {
+        printf("%-10s %8lu %8lu\n", typeNames[t], (unsigned long)c.received[t], (unsigned long)c.lost[t]);
+    }
+    printf("invalid datagrams: %lu\n", (unsigned long)c.invalid);
+    return 0;
+}
+
+// LOOPBACK
+
+static inline uint32_t getBe16(const uint8_t* p) {
+    return (uint32_t)p[0] << 8 | p[1];
+}
+
+// Stand-in for the Ethernet DMA: follows the descriptor chain from where it stopped, like the
+// hardware after a poll demand
+struct DmaStandIn {
+    uint32_t current = 0;
+    std::vector<std::vector<uint8_t>> frames;
+    uint32_t chainErrors = 0;
+
+    // Transmit up to maxPackets frames, returns the number sent
+    uint32_t run(UdpTx* tx, uint32_t maxPackets) {
+        uint32_t sent = 0;
+        while (sent < maxPackets && (tx->descriptors[current].status & UDP_TX_DESC_OWN)) {
+            std::vector<uint8_t> frame;
+            bool first = true;
+            while (true) {
+                UdpTxDescriptor& d = tx->descriptors[current];
+                if (!(d.status & UDP_TX_DESC_OWN) || (first != ((d.status & UDP_TX_DESC_FS) != 0))) {
+                    chainErrors++;
+                    return sent;
+                }
+                // Resolve the buffer through the slot (host pointers do not fit the 32-bit field)
+                const UdpTxSlot& slot = tx->slots[current / 2];
+                const uint8_t* buffer = (current % 2 == 0) ? slot.header : slot.payload;
+                if (d.buffer != (uint32_t)(uintptr_t)buffer ||
+                    d.next != (uint32_t)(uintptr_t)&tx->descriptors[(current + 1) % UDP_TX_DESCRIPTORS]) {
+                    chainErrors++;
+                }
+                frame.insert(frame.end(), buffer, buffer + (d.size & UDP_TX_DESC_TBS1));
+                bool last = (d.status & UDP_TX_DESC_LS) != 0;
+                bool offload = (d.status & UDP_TX_DESC_CIC_FULL) == UDP_TX_DESC_CIC_FULL;
+                d.status &= ~UDP_TX_DESC_OWN;
+                current = (current + 1) % UDP_TX_DESCRIPTORS;
+                first = false;
+                if (last) {
+                    if (offload) insertUdpChecksum(frame);
+                    break;
+                }
+            }
+            frames.push_back(frame);
+            sent++;
+        }
+        return sent;
+    }
+
+    // What the MAC does with CIC = full: UDP checksum including the pseudo-header
+    static void insertUdpChecksum(std::vector<uint8_t>& f) {
+        if (f.size() < UDP_TX_HEADER_SIZE) return;
+        uint8_t* ip = &f[UDP_TX_ETH_HEADER];
+        uint8_t* udp = &ip[UDP_TX_IP_HEADER];
+        uint32_t udpLength = getBe16(&udp[4]);
+        if (UDP_TX_ETH_HEADER + UDP_TX_IP_HEADER + udpLength > f.size()) return;
+        uint8_t pseudo[12] = {ip[12], ip[13], ip[14], ip[15], ip[16], ip[17], ip[18], ip[19],
+                              0, 17, (uint8_t)(udpLength >> 8), (uint8_t)udpLength};
+        udp[6] = udp[7] = 0;
+        uint16_t sum = UdpTx_ChecksumAdd(pseudo, sizeof(pseudo), 0);
+        sum = UdpTx_ChecksumAdd(udp, udpLength, sum);
+        uint16_t checksum = (uint16_t)~sum;
+        if (checksum == 0) checksum = 0xFFFF;
+        udp[6] = (uint8_t)(checksum >> 8);
+        udp[7] = (uint8_t)checksum;
+    }
+};
+
+// Receive side checks, returns the UDP payload or nullptr
+static const uint8_t* checkFrame(const std::vector<uint8_t>& f, const UdpTxConfig& config, size_t* length) {
+    if (f.size() < UDP_TX_HEADER_SIZE) return nullptr;
+    const uint8_t* ip = &f[UDP_TX_ETH_HEADER];
+    const uint8_t* udp = &ip[UDP_TX_IP_HEADER];
+    if (memcmp(&f[0], config.dstMac, 6) != 0 || memcmp(&f[6], config.srcMac, 6) != 0) return nullptr;
+    if (getBe16(&f[12]) != 0x0800 || ip[0] != 0x45 || ip[9] != 17) return nullptr;
+    if ((uint16_t)~UdpTx_ChecksumAdd(ip, UDP_TX_IP_HEADER, 0) != 0) return nullptr;
+    if (getBe16(&ip[2]) != f.size() - UDP_TX_ETH_HEADER) return nullptr;
+    uint32_t udpLength = getBe16(&udp[4]);
+    if (udpLength != f.size() - UDP_TX_ETH_HEADER - UDP_TX_IP_HEADER) return nullptr;
+    if (getBe16(&udp[2]) != config.dstPort) return nullptr;
+
+    uint8_t pseudo[12] = {ip[12], ip[13], ip[14], ip[15], ip[16], ip[17], ip[18], ip[19],
+                          0, 17, (uint8_t)(udpLength >> 8), (uint8_t)udpLength};
+    uint16_t sum = UdpTx_ChecksumAdd(pseudo, sizeof(pseudo), 0);
+    if ((uint16_t)~UdpTx_ChecksumAdd(udp, udpLength, sum) != 0) return nullptr;
+
+    *length = udpLength - UDP_TX_UDP_HEADER;
+    return &udp[UDP_TX_UDP_HEADER];
+}
+
+struct PoolBuffer {
+    uint8_t data[UDP_TX_MAX_PAYLOAD];
+    bool busy = false;
+    uint32_t doneCalls = 0;
+};
+
+static void onPacketDone(void* context) {
+    PoolBuffer* b = static_cast<PoolBuffer*>(context);
+    b->busy = false;
+    b->doneCalls++;
+    memset(b->data, 0xEE, sizeof(b->data));  // the DMA must not read it any more
+}
+
+struct Expected {
+    UdpMessageHeader header;
+    std::vector<uint8_t> payload;
+};
+
+static int loopback(uint32_t seed) {
+    static UdpTxDescriptor descriptors[UDP_TX_DESCRIPTORS];
+    static UdpTx tx;
+    UdpTxConfig config = {{0x00, 0x80, 0xE1, 0x00, 0x00, 0x00}, {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF},
+                          {192, 168, 1, 50}, {255, 255, 255, 255}, UDP_PUBLISHER_PORT, UDP_PUBLISHER_PORT};
+    UdpTx_Init(&tx, descriptors, &config);
+
+    std::mt19937 rng(seed);
+    DmaStandIn dma;
+    static PoolBuffer pool[UDP_TX_SLOTS + 2];
+    std::deque<Expected> expected;
+    uint32_t sequence[NUM_TYPES] = {};
+    uint32_t sent = 0, received = 0, mismatches = 0, badFrames = 0, busyRetries = 0;
+    const uint32_t packets = 20000;
+
+    auto receive = [&]() {
+        for (const std::vector<uint8_t>& f : dma.frames) {
+            size_t length;
+            const uint8_t* data = checkFrame(f, config, &length);
+            UdpMessageHeader h;
+            const uint8_t* payload;
+            size_t payloadLength;
+            if (!data || !parseDatagram(data, length, &h, &payload, &payloadLength)) {
+                badFrames++;
+                continue;
+            }
+            received++;
+            if (expected.empty()) {
+                mismatches++;
+                continue;
+            }
+            const Expected& e = expected.front();
+            if (h.type != e.header.type || h.sequence != e.header.sequence || payloadLength != e.payload.size() ||
+                memcmp(payload, e.payload.data(), payloadLength) != 0) {
+                mismatches++;
+            }
+            expected.pop_front();
+        }
+        dma.frames.clear();
+    };
+
+    while (sent < packets) {
+        PoolBuffer* buffer = nullptr;
+        for (PoolBuffer& b : pool) {
+            if (!b.busy) {
+                buffer = &b;
+                break;
+            }
+        }
+        if (buffer) {
+            uint32_t length = 1 + rng() % (UDP_TX_MAX_PAYLOAD - sizeof(UdpMessageHeader));
+            for (uint32_t i = 0; i < length; i++) buffer->data[i] = (uint8_t)rng();
+            uint8_t type = (uint8_t)(1 + rng() % (NUM_TYPES - 1));
+
+            Expected e;
+            e.header.magic = UDP_PUBLISHER_MAGIC;
+            e.header.version = UDP_PUBLISHER_VERSION;
+            e.header.type = type;
+            e.header.sequence = sequence[type];
+            e.header.timeMs = sent;
+            e.payload.assign(buffer->data, buffer->data + length);
+
+            buffer->busy = true;
+            if (UdpTx_Send(&tx, &e.header, sizeof(e.header), buffer->data, length, onPacketDone, buffer)) {
+                sequence[type]++;
+                expected.push_back(e);
+                sent++;
+            } else {
+                buffer->busy = false;
+                busyRetries++;
+            }
+        }
+
+        // The DMA runs at its own pace: sometimes not at all, sometimes several packets
+        dma.run(&tx, rng() % 3);
+        receive();
+    }
+    while (dma.run(&tx, UDP_TX_SLOTS)) receive();
+    UdpTx_Reclaim(&tx);
+
+    uint32_t doneCalls = 0;
+    bool leaked = false;
+    for (const PoolBuffer& b : pool) {
+        doneCalls += b.doneCalls;
+        leaked = leaked || b.busy;
+    }
+
+    bool ok = received == sent && mismatches == 0 && badFrames == 0 && dma.chainErrors == 0 &&
+              doneCalls == sent && !leaked && UdpTx_InFlight(&tx) == 0 && tx.stats.packets == sent;
+    printf("sent %lu, received %lu, content mismatches %lu, bad frames %lu, chain errors %lu, "
+           "done callbacks %lu, refused while full %lu: %s\n",
+           (unsigned long)sent, (unsigned long)received, (unsigned long)mismatches, (unsigned long)badFrames,
+           (unsigned long)dma.chainErrors, (unsigned long)doneCalls, (unsigned long)busyRetries,
+           ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    if (argc >= 2 && strcmp(argv[1], "--loopback") == 0) {
+        return loopback(argc >= 3 ? (uint32_t)strtoul(argv[2], nullptr, 0) : 1);
+    }
+
+    uint16_t port = UDP_PUBLISHER_PORT;
+    const char* audioPath = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            port = (uint16_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-a") == 0 && i + 1 < argc) {
+            audioPath = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [-p port] [-a audio.bin]\n       %s --loopback [seed]\n", argv[0], argv[0]);
+            return 2;
+        }
+    }
+    return listen(port, audioPath);
+}